@@ -0,0 +1,447 @@
+// Microbenchmarks of the math core: vector, matrix, quaternion, complex
+// and color operations, and nearest-neighbor queries. Each benchmark runs
+// one operation over arrays of kElements random operands, and reports the
+// time per operation and the throughput as JSON on stdout, so results can
+// be compared across releases. Progress goes to stderr. Runs headless.
+//
+// usage: cmu462_bench [options]
+//   --filter <text>      only run the benchmarks whose name contains text
+//   --min-time <sec>     time per repetition (default 0.05)
+//   --repetitions <n>    repetitions per benchmark (default 5)
+//   --simd <level>       cap the SIMD level: scalar, sse2 or avx2
+//   --list               list the benchmarks and exit
+//   --help               print the usage and exit
+
+#include "CMU462/vector2D.h"
+#include "CMU462/vector3D.h"
+#include "CMU462/vector4D.h"
+#include "CMU462/matrix3x3.h"
+#include "CMU462/matrix4x4.h"
+#include "CMU462/quaternion.h"
+#include "CMU462/quaternionBatch.h"
+#include "CMU462/complex.h"
+#include "CMU462/color.h"
+#include "CMU462/spectrum.h"
+#include "CMU462/kdTree.h"
+#include "CMU462/spatialHash.h"
+#include "CMU462/simd.h"
+#include "CMU462/timer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace CMU462;
+
+// Operands per pass; the arrays of the largest type (Matrix4x4) fit in L2.
+static const size_t kElements = 1024;
+
+// Points searched by the nearest-neighbor queries, far more than fit in
+// cache, like the point clouds and particle systems they are meant for.
+static const size_t kPoints = 1 << 20;
+
+//------------------------------------------------------------------------------
+// Harness
+//------------------------------------------------------------------------------
+
+struct Options {
+  const char *filter;
+  double minTime;
+  int repetitions;
+  bool list;
+};
+
+struct Result {
+  std::string name;
+  double nsPerOp;       ///< best repetition
+  double nsPerOpMedian; ///< median repetition
+  size_t passes;        ///< passes per repetition
+};
+
+// Keeps the compiler from optimizing across passes: the arrays may have
+// been read and written in between.
+static inline void clobber() {
+#if defined(__GNUC__)
+  asm volatile("" : : : "memory");
+#endif
+}
+
+class Bench {
+public:
+  Bench(const Options &options) : options(options) {}
+
+  /**
+   * Times pass(), which performs kElements operations, unless the
+   * benchmark is filtered out.
+   */
+  template <typename F>
+  void run(const char *name, F pass);
+
+  /**
+   * Returns whether run() would time the benchmark, so that expensive
+   * setup can be skipped otherwise.
+   */
+  inline bool selected(const char *name) const {
+    return !options.list && (!options.filter || strstr(name, options.filter));
+  }
+
+  inline const std::vector<Result> &results(void) const { return out; }
+
+private:
+  Options options;
+  std::vector<Result> out;
+};
+
+template <typename F>
+void Bench::run(const char *name, F pass) {
+  if (options.filter && !strstr(name, options.filter)) return;
+  if (options.list) {
+    printf("%s\n", name);
+    return;
+  }
+
+  // number of passes taking about minTime, after a warm-up
+  Timer timer;
+  size_t passes = 1;
+  for (;;) {
+    timer.start();
+    for (size_t p = 0; p < passes; p++) {
+      pass();
+      clobber();
+    }
+    timer.stop();
+    if (timer.duration() >= options.minTime / 4) break;
+    passes *= 2;
+  }
+  double t = timer.duration() > 0 ? timer.duration() : 1e-9;
+  passes = std::max((size_t)1, (size_t)(passes * options.minTime / t));
+
+  std::vector<double> ns(options.repetitions);
+  for (int r = 0; r < options.repetitions; r++) {
+    timer.start();
+    for (size_t p = 0; p < passes; p++) {
+      pass();
+      clobber();
+    }
+    timer.stop();
+    ns[r] = 1e9 * timer.duration() / (passes * kElements);
+  }
+  std::sort(ns.begin(), ns.end());
+
+  Result result = {name, ns[0], ns[ns.size() / 2], passes};
+  out.push_back(result);
+  fprintf(stderr, "%-36s %10.3f ns/op %10.3f ns/op (median)\n", name,
+          result.nsPerOp, result.nsPerOpMedian);
+}
+
+static const char *levelName(SIMD::Level level) {
+  switch (level) {
+  case SIMD::AVX2: return "avx2";
+  case SIMD::SSE2: return "sse2";
+  default: return "scalar";
+  }
+}
+
+// s as a JSON string
+static std::string quote(const char *s) {
+  std::string q = "\"";
+  for (; *s; s++) {
+    if (*s == '"' || *s == '\\') q += '\\';
+    q += *s;
+  }
+  return q + "\"";
+}
+
+static void writeJSON(const Options &options,
+                      const std::vector<Result> &results) {
+  char date[32];
+  time_t now = time(NULL);
+  strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+  int threads = 1;
+#ifdef _OPENMP
+  threads = omp_get_max_threads();
+#endif
+#ifdef __VERSION__
+  const char *compiler = __VERSION__;
+#else
+  const char *compiler = "unknown";
+#endif
+
+  printf("{\n");
+  printf("  \"context\": {\n");
+  printf("    \"date\": \"%s\",\n", date);
+  printf("    \"compiler\": %s,\n", quote(compiler).c_str());
+  printf("    \"simd\": \"%s\",\n", levelName(SIMD::level()));
+  printf("    \"threads\": %d,\n", threads);
+  printf("    \"elements\": %zu,\n", kElements);
+  printf("    \"min_time\": %g,\n", options.minTime);
+  printf("    \"repetitions\": %d\n", options.repetitions);
+  printf("  },\n");
+  printf("  \"benchmarks\": [");
+  for (size_t i = 0; i < results.size(); i++) {
+    const Result &r = results[i];
+    printf("%s\n    {\"name\": %s, \"ns_per_op\": %.4f, "
+           "\"ns_per_op_median\": %.4f, \"ops_per_second\": %.6g, "
+           "\"passes\": %zu}",
+           i ? "," : "", quote(r.name.c_str()).c_str(), r.nsPerOp,
+           r.nsPerOpMedian, 1e9 / r.nsPerOp, r.passes);
+  }
+  printf("\n  ]\n}\n");
+}
+
+//------------------------------------------------------------------------------
+// Operands
+//------------------------------------------------------------------------------
+
+static double uniform() { return 2.0 * rand() / RAND_MAX - 1.0; }
+
+static double randomScalar() { return uniform(); }
+
+static Vector2D randomVector2D() { return Vector2D(uniform(), uniform()); }
+
+static Vector3D randomVector3D() {
+  return Vector3D(uniform(), uniform(), uniform());
+}
+
+static Vector4D randomVector4D() {
+  return Vector4D(uniform(), uniform(), uniform(), uniform());
+}
+
+// random matrices, shifted away from singular ones
+static Matrix3x3 randomMatrix3x3() {
+  Matrix3x3 A;
+  for (int i = 0; i < 3; i++)
+    for (int j = 0; j < 3; j++) A(i, j) = uniform() + (i == j ? 3 : 0);
+  return A;
+}
+
+static Matrix4x4 randomMatrix4x4() {
+  Matrix4x4 A;
+  for (int i = 0; i < 4; i++)
+    for (int j = 0; j < 4; j++) A(i, j) = uniform() + (i == j ? 4 : 0);
+  return A;
+}
+
+static Quaternion randomRotation() {
+  Quaternion q;
+  q.from_axis_angle(randomVector3D(), M_PI * uniform());
+  return q;
+}
+
+static Complex randomComplex() { return Complex(uniform(), uniform()); }
+
+static Color randomColor() {
+  return Color(uniform(), uniform(), uniform(), uniform());
+}
+
+static Spectrum randomSpectrum() {
+  return Spectrum(uniform(), uniform(), uniform());
+}
+
+// kElements operands from f
+template <typename T>
+static std::vector<T> generate(T (*f)()) {
+  std::vector<T> v(kElements);
+  for (size_t i = 0; i < kElements; i++) v[i] = f();
+  return v;
+}
+
+//------------------------------------------------------------------------------
+// Benchmarks
+//------------------------------------------------------------------------------
+
+// runs out[i] = expr for every operand i
+#define CMU462_BENCH(bench, name, out, expr)                                 \
+  bench.run(name, [&] {                                                      \
+    for (size_t i = 0; i < kElements; i++) out[i] = (expr);                  \
+  })
+
+static void vectors(Bench &b) {
+  std::vector<double> s = generate(randomScalar), d(kElements);
+
+  std::vector<Vector2D> u2 = generate(randomVector2D);
+  std::vector<Vector2D> v2 = generate(randomVector2D), w2(kElements);
+  CMU462_BENCH(b, "Vector2D/add", w2, u2[i] + v2[i]);
+  CMU462_BENCH(b, "Vector2D/scale", w2, u2[i] * s[i]);
+  CMU462_BENCH(b, "Vector2D/dot", d, dot(u2[i], v2[i]));
+  CMU462_BENCH(b, "Vector2D/norm", d, u2[i].norm());
+  CMU462_BENCH(b, "Vector2D/unit", w2, u2[i].unit());
+
+  std::vector<Vector3D> u3 = generate(randomVector3D);
+  std::vector<Vector3D> v3 = generate(randomVector3D), w3(kElements);
+  CMU462_BENCH(b, "Vector3D/add", w3, u3[i] + v3[i]);
+  CMU462_BENCH(b, "Vector3D/scale", w3, u3[i] * s[i]);
+  CMU462_BENCH(b, "Vector3D/dot", d, dot(u3[i], v3[i]));
+  CMU462_BENCH(b, "Vector3D/cross", w3, cross(u3[i], v3[i]));
+  CMU462_BENCH(b, "Vector3D/norm", d, u3[i].norm());
+  CMU462_BENCH(b, "Vector3D/unit", w3, u3[i].unit());
+
+  std::vector<Vector4D> u4 = generate(randomVector4D);
+  std::vector<Vector4D> v4 = generate(randomVector4D), w4(kElements);
+  CMU462_BENCH(b, "Vector4D/add", w4, u4[i] + v4[i]);
+  CMU462_BENCH(b, "Vector4D/scale", w4, u4[i] * s[i]);
+  CMU462_BENCH(b, "Vector4D/dot", d, dot(u4[i], v4[i]));
+  CMU462_BENCH(b, "Vector4D/norm", d, u4[i].norm());
+  CMU462_BENCH(b, "Vector4D/unit", w4, u4[i].unit());
+}
+
+static void matrices(Bench &b) {
+  std::vector<double> d(kElements);
+  std::vector<Vector3D> u3 = generate(randomVector3D), w3(kElements);
+  std::vector<Vector4D> u4 = generate(randomVector4D), w4(kElements);
+
+  std::vector<Matrix3x3> A3 = generate(randomMatrix3x3);
+  std::vector<Matrix3x3> B3 = generate(randomMatrix3x3), C3(kElements);
+  CMU462_BENCH(b, "Matrix3x3/multiply", C3, A3[i] * B3[i]);
+  CMU462_BENCH(b, "Matrix3x3/multiply vector", w3, A3[i] * u3[i]);
+  CMU462_BENCH(b, "Matrix3x3/transpose", C3, A3[i].T());
+  CMU462_BENCH(b, "Matrix3x3/det", d, A3[i].det());
+  CMU462_BENCH(b, "Matrix3x3/inv", C3, A3[i].inv());
+
+  std::vector<Matrix4x4> A4 = generate(randomMatrix4x4);
+  std::vector<Matrix4x4> B4 = generate(randomMatrix4x4), C4(kElements);
+  CMU462_BENCH(b, "Matrix4x4/multiply", C4, A4[i] * B4[i]);
+  CMU462_BENCH(b, "Matrix4x4/multiply vector", w4, A4[i] * u4[i]);
+  CMU462_BENCH(b, "Matrix4x4/transpose", C4, A4[i].T());
+  CMU462_BENCH(b, "Matrix4x4/det", d, A4[i].det());
+  CMU462_BENCH(b, "Matrix4x4/inv", C4, A4[i].inv());
+
+  // the batch kernels of matrix4x4.h
+  b.run("Matrix4x4/multiply (batch)",
+        [&] { multiply(&A4[0], &B4[0], &C4[0], kElements); });
+  b.run("Matrix4x4/det (batch)", [&] { det(&A4[0], &d[0], kElements); });
+  b.run("Matrix4x4/inv (batch)",
+        [&] { inverse(&A4[0], &C4[0], kElements); });
+  b.run("Matrix4x4/transform points (batch)",
+        [&] { transformPoints(A4[0], &u3[0], &w3[0], kElements); });
+}
+
+static void quaternions(Bench &b) {
+  std::vector<double> t(kElements);
+  for (size_t i = 0; i < kElements; i++) t[i] = 0.5 + 0.5 * uniform();
+  std::vector<Vector3D> u3 = generate(randomVector3D), w3(kElements);
+
+  std::vector<Quaternion> p = generate(randomRotation);
+  std::vector<Quaternion> q = generate(randomRotation), r(kElements);
+  CMU462_BENCH(b, "Quaternion/multiply", r, p[i] * q[i]);
+  CMU462_BENCH(b, "Quaternion/rotate vector", w3, p[i].rotatedVector(u3[i]));
+  CMU462_BENCH(b, "Quaternion/slerp", r, Quaternion::slerp(p[i], q[i], t[i]));
+  CMU462_BENCH(b, "Quaternion/inverse", r, p[i].inverse());
+
+  // the batch kernels of quaternionBatch.h
+  b.run("Quaternion/rotate vector (batch)",
+        [&] { rotate(&p[0], &u3[0], &w3[0], kElements); });
+  b.run("Quaternion/nlerp (batch)",
+        [&] { nlerp(&p[0], &q[0], 0.3, &r[0], kElements); });
+  b.run("Quaternion/slerp approx (batch)",
+        [&] { slerpApprox(&p[0], &q[0], 0.3, &r[0], kElements); });
+}
+
+static void complexes(Bench &b) {
+  std::vector<Complex> u = generate(randomComplex);
+  std::vector<Complex> v = generate(randomComplex), w(kElements);
+  CMU462_BENCH(b, "Complex/add", w, u[i] + v[i]);
+  CMU462_BENCH(b, "Complex/multiply", w, u[i] * v[i]);
+  CMU462_BENCH(b, "Complex/divide", w, u[i] / v[i]);
+  CMU462_BENCH(b, "Complex/exponential", w, u[i].exponential());
+}
+
+static void colors(Bench &b) {
+  std::vector<float> f(kElements);
+  for (size_t i = 0; i < kElements; i++) f[i] = (float)uniform();
+
+  std::vector<Color> a = generate(randomColor);
+  std::vector<Color> c = generate(randomColor), o(kElements);
+  CMU462_BENCH(b, "Color/add", o, a[i] + c[i]);
+  CMU462_BENCH(b, "Color/multiply", o, a[i] * c[i]);
+  CMU462_BENCH(b, "Color/scale", o, a[i] * f[i]);
+
+  std::vector<Spectrum> s = generate(randomSpectrum);
+  std::vector<Spectrum> t = generate(randomSpectrum), u(kElements);
+  CMU462_BENCH(b, "Spectrum/add", u, s[i] + t[i]);
+  CMU462_BENCH(b, "Spectrum/multiply", u, s[i] * t[i]);
+  CMU462_BENCH(b, "Spectrum/scale", u, s[i] * f[i]);
+  CMU462_BENCH(b, "Spectrum/illum", f, s[i].illum());
+}
+
+// queries among kPoints random points in [-1, 1]^3
+static void nearestNeighbors(Bench &b) {
+  std::vector<Vector3D> points(kPoints);
+  for (size_t i = 0; i < kPoints; i++) points[i] = randomVector3D();
+  std::vector<Vector3D> queries = generate(randomVector3D);
+
+  // the structures are only built when a benchmark runs
+  const char *names[] = {"KdTree/knn k=1 (batch)", "KdTree/knn k=8 (batch)",
+                         "SpatialHash/neighbors"};
+  // radius holding about 16 points on average, one cell wide
+  double r = cbrt(8 * 16.0 / (kPoints * 4.0 / 3.0 * M_PI));
+  KdTree tree;
+  SpatialHash hash(r);
+  if (b.selected(names[0]) || b.selected(names[1]))
+    tree.build(&points[0], kPoints);
+  if (b.selected(names[2])) hash.build(&points[0], kPoints);
+
+  std::vector<uint32_t> indices(8 * kElements);
+  b.run(names[0],
+        [&] { tree.knn(&queries[0], kElements, 1, &indices[0], NULL); });
+  b.run(names[1],
+        [&] { tree.knn(&queries[0], kElements, 8, &indices[0], NULL); });
+  b.run(names[2], [&] {
+    for (size_t i = 0; i < kElements; i++)
+      hash.neighbors(queries[i], r, indices);
+  });
+}
+
+#undef CMU462_BENCH
+
+int main(int argc, char *argv[]) {
+  Options options = {NULL, 0.05, 5, false};
+  for (int i = 1; i < argc; i++) {
+    bool more = i + 1 < argc;
+    if (!strcmp(argv[i], "--filter") && more) {
+      options.filter = argv[++i];
+    } else if (!strcmp(argv[i], "--min-time") && more) {
+      options.minTime = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "--repetitions") && more) {
+      options.repetitions = std::max(1, atoi(argv[++i]));
+    } else if (!strcmp(argv[i], "--simd") && more) {
+      const char *level = argv[++i];
+      if (!strcmp(level, "scalar")) SIMD::setLevel(SIMD::SCALAR);
+      else if (!strcmp(level, "sse2")) SIMD::setLevel(SIMD::SSE2);
+      else if (!strcmp(level, "avx2")) SIMD::setLevel(SIMD::AVX2);
+      else {
+        fprintf(stderr, "%s: unknown SIMD level %s\n", argv[0], level);
+        return 1;
+      }
+    } else if (!strcmp(argv[i], "--list")) {
+      options.list = true;
+    } else {
+      bool help = !strcmp(argv[i], "--help") || !strcmp(argv[i], "-h");
+      fprintf(help ? stdout : stderr,
+              "usage: %s [--filter text] [--min-time sec] "
+              "[--repetitions n] [--simd scalar|sse2|avx2] [--list]\n",
+              argv[0]);
+      return help ? 0 : 1;
+    }
+  }
+
+  srand(462);
+  Bench bench(options);
+  vectors(bench);
+  matrices(bench);
+  quaternions(bench);
+  complexes(bench);
+  colors(bench);
+  nearestNeighbors(bench);
+
+  if (!options.list) writeJSON(options, bench.results());
+  return 0;
+}
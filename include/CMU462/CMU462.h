@@ -7,14 +7,42 @@
 
 namespace CMU462 {
 
-class Vector2D;
-class Vector3D;
-class Vector4D;
+// The math core is templated on the scalar type and instantiated for float
+// and double. The unsuffixed names are the double precision types.
+
+template <typename T> class BasicVector2D;
+template <typename T> class BasicVector3D;
+template <typename T> class BasicVector4D;
+
+template <typename T> class BasicMatrix3x3;
+template <typename T> class BasicMatrix4x4;
+template <typename T> class BasicAffine3;
+
+template <typename T> class BasicQuaternion;
+template <typename T> class BasicDualQuaternion;
+
+typedef BasicVector2D<double> Vector2D;
+typedef BasicVector3D<double> Vector3D;
+typedef BasicVector4D<double> Vector4D;
+typedef BasicMatrix3x3<double> Matrix3x3;
+typedef BasicMatrix4x4<double> Matrix4x4;
+typedef BasicAffine3<double> Affine3;
+typedef BasicQuaternion<double> Quaternion;
+typedef BasicDualQuaternion<double> DualQuaternion;
+
+typedef BasicVector2D<float> Vector2f;
+typedef BasicVector3D<float> Vector3f;
+typedef BasicVector4D<float> Vector4f;
+typedef BasicMatrix3x3<float> Matrix3x3f;
+typedef BasicMatrix4x4<float> Matrix4x4f;
+typedef BasicAffine3<float> Affine3f;
+typedef BasicQuaternion<float> Quaternionf;
+typedef BasicDualQuaternion<float> DualQuaternionf;
+
+class Vector3DArray;
+class BBox;
+struct Ray;
 
-class Matrix3x3;
-class Matrix4x4;
-
-class Quaternion;
 class Complex;
 
 class Color;
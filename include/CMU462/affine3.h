@@ -0,0 +1,168 @@
+#ifndef CMU462_AFFINE3_H
+#define CMU462_AFFINE3_H
+
+#include "CMU462.h"
+#include "vector3D.h"
+#include "vector4D.h"
+#include "matrix3x3.h"
+#include "matrix4x4.h"
+
+#include <cstddef>
+#include <iosfwd>
+
+namespace CMU462 {
+
+/**
+ * Defines an affine transformation of 3D space over the scalar type S,
+ * x -> A x + t, stored as its 3x3 linear part A and translation t (a 3x4
+ * matrix). Affine3 (double) and Affine3f (float) are the instantiated types.
+ *
+ * This is the Matrix4x4 without its constant last row (0, 0, 0, 1), which
+ * saves a quarter of the storage and lets composition and inversion skip
+ * the work on that row. Conversions to and from Matrix4x4 are lossless for
+ * affine matrices.
+ */
+template <typename S>
+class BasicAffine3 {
+
+public:
+  typedef S Scalar;
+
+  /**
+   * Constructor.
+   * Initializes to the identity transformation.
+   */
+  constexpr BasicAffine3(void)
+      : A(BasicMatrix3x3<S>::identity()), t(0, 0, 0) {}
+
+  /**
+   * Constructor.
+   * Initializes to x -> A x + t.
+   */
+  constexpr BasicAffine3(const BasicMatrix3x3<S> &A,
+                         const BasicVector3D<S> &t = BasicVector3D<S>())
+      : A(A), t(t) {}
+
+  /**
+   * Constructor.
+   * Initializes from the upper 3x4 block of M; the last row of M is
+   * assumed to be (0, 0, 0, 1).
+   */
+  constexpr explicit BasicAffine3(const BasicMatrix4x4<S> &M)
+      : A(BasicVector3D<S>(M[0].x, M[0].y, M[0].z),
+          BasicVector3D<S>(M[1].x, M[1].y, M[1].z),
+          BasicVector3D<S>(M[2].x, M[2].y, M[2].z)),
+        t(M[3].x, M[3].y, M[3].z) {}
+
+  /**
+   * Returns the identity transformation.
+   */
+  static constexpr BasicAffine3 identity(void) { return BasicAffine3(); }
+
+  /**
+   * Returns the translation by t.
+   */
+  static constexpr BasicAffine3 translate(const BasicVector3D<S> &t) {
+    return BasicAffine3(BasicMatrix3x3<S>::identity(), t);
+  }
+
+  /**
+   * Returns the equivalent 4x4 matrix in homogeneous coordinates.
+   */
+  constexpr BasicMatrix4x4<S> toMatrix4x4(void) const {
+    return BasicMatrix4x4<S>(BasicVector4D<S>(A[0].x, A[0].y, A[0].z, 0),
+                             BasicVector4D<S>(A[1].x, A[1].y, A[1].z, 0),
+                             BasicVector4D<S>(A[2].x, A[2].y, A[2].z, 0),
+                             BasicVector4D<S>(t.x, t.y, t.z, 1));
+  }
+
+  /**
+   * Returns the linear part.
+   */
+  inline BasicMatrix3x3<S> &linear(void) { return A; }
+  constexpr const BasicMatrix3x3<S> &linear(void) const { return A; }
+
+  /**
+   * Returns the translation.
+   */
+  inline BasicVector3D<S> &translation(void) { return t; }
+  constexpr const BasicVector3D<S> &translation(void) const { return t; }
+
+  /**
+   * Returns the determinant of the linear part.
+   */
+  constexpr S det(void) const { return dot(A[0], cross(A[1], A[2])); }
+
+  /**
+   * Returns the inverse transformation.
+   * Only the linear part is inverted, via the cross products of its
+   * columns; the translation of the inverse is -A^-1 t.
+   */
+  BasicAffine3 inv(void) const;
+
+  /**
+   * Returns the inverse of a rigid transformation, i.e. one whose linear
+   * part is a rotation (orthonormal). This is just a transpose.
+   * REQUIRES: the linear part is orthonormal.
+   */
+  constexpr BasicAffine3 rigidInv(void) const {
+    return BasicAffine3(A.T(), -(A.T() * t));
+  }
+
+  /**
+   * Applies the transformation to the point p, A p + t.
+   */
+  constexpr BasicVector3D<S> transformPoint(const BasicVector3D<S> &p) const {
+    return A * p + t;
+  }
+
+  /**
+   * Applies the linear part to the direction v, A v.
+   */
+  constexpr BasicVector3D<S>
+  transformVector(const BasicVector3D<S> &v) const {
+    return A * v;
+  }
+
+  // applies to a point, see transformPoint
+  constexpr BasicVector3D<S> operator*(const BasicVector3D<S> &p) const {
+    return A * p + t;
+  }
+
+  // returns the composition, (*this)(B(x))
+  constexpr BasicAffine3 operator*(const BasicAffine3 &B) const {
+    return BasicAffine3(A * B.A, A * B.t + t);
+  }
+
+  // composes with B on the right
+  inline void operator*=(const BasicAffine3 &B) { *this = (*this) * B; }
+
+protected:
+  // linear part
+  BasicMatrix3x3<S> A;
+
+  // translation
+  BasicVector3D<S> t;
+
+}; // class BasicAffine3
+
+// prints the 3x4 matrix [ A | t ]
+template <typename S>
+std::ostream &operator<<(std::ostream &os, const BasicAffine3<S> &T);
+
+/**
+ * Batch transforms of n contiguous vectors by T, see transformPoints() in
+ * matrix4x4.h for details.
+ */
+void transformPoints(const Affine3 &T, const Vector3D *in, Vector3D *out,
+                     size_t n);
+void transformPoints(const Affine3f &T, const Vector3f *in, Vector3f *out,
+                     size_t n);
+void transformVectors(const Affine3 &T, const Vector3D *in, Vector3D *out,
+                      size_t n);
+void transformVectors(const Affine3f &T, const Vector3f *in, Vector3f *out,
+                      size_t n);
+
+} // namespace CMU462
+
+#endif // CMU462_AFFINE3_H
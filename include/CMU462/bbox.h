@@ -0,0 +1,134 @@
+#ifndef CMU462_BBOX_H
+#define CMU462_BBOX_H
+
+#include "CMU462.h"
+#include "vector3D.h"
+#include "ray.h"
+
+#include <algorithm>
+#include <iosfwd>
+#include <limits>
+
+namespace CMU462 {
+
+/**
+ * Axis-aligned bounding box [min, max] over Vector3D. A default
+ * constructed box is empty (min > max) and grows with expand().
+ */
+class BBox {
+public:
+  Vector3D min; ///< corner with the smallest coordinates
+  Vector3D max; ///< corner with the largest coordinates
+
+  /**
+   * Constructor.
+   * Initializes to the empty box.
+   */
+  BBox()
+      : min(std::numeric_limits<double>::infinity()),
+        max(-std::numeric_limits<double>::infinity()) {}
+
+  /**
+   * Constructor.
+   * Initializes to the box containing only p.
+   */
+  explicit BBox(const Vector3D &p) : min(p), max(p) {}
+
+  /**
+   * Constructor.
+   * Initializes to [min, max].
+   */
+  BBox(const Vector3D &min, const Vector3D &max) : min(min), max(max) {}
+
+  /**
+   * Grows the box to contain p.
+   */
+  inline void expand(const Vector3D &p) {
+    min = Vector3D(std::min(min.x, p.x), std::min(min.y, p.y),
+                   std::min(min.z, p.z));
+    max = Vector3D(std::max(max.x, p.x), std::max(max.y, p.y),
+                   std::max(max.z, p.z));
+  }
+
+  /**
+   * Grows the box to contain b.
+   */
+  inline void expand(const BBox &b) {
+    min = Vector3D(std::min(min.x, b.min.x), std::min(min.y, b.min.y),
+                   std::min(min.z, b.min.z));
+    max = Vector3D(std::max(max.x, b.max.x), std::max(max.y, b.max.y),
+                   std::max(max.z, b.max.z));
+  }
+
+  /**
+   * Returns true if the box contains no point.
+   */
+  inline bool empty(void) const {
+    return min.x > max.x || min.y > max.y || min.z > max.z;
+  }
+
+  /**
+   * Returns max - min.
+   */
+  constexpr Vector3D extent(void) const { return max - min; }
+
+  /**
+   * Returns the center of the box.
+   */
+  constexpr Vector3D centroid(void) const { return 0.5 * (min + max); }
+
+  /**
+   * Returns the surface area, or 0 for an empty box.
+   */
+  inline double surfaceArea(void) const {
+    if (empty()) return 0;
+    Vector3D e = extent();
+    return 2 * (e.x * e.y + e.y * e.z + e.z * e.x);
+  }
+
+  /**
+   * Returns the axis (0, 1 or 2) along which the box is longest.
+   */
+  inline int maxAxis(void) const {
+    Vector3D e = extent();
+    return e.x > e.y ? (e.x > e.z ? 0 : 2) : (e.y > e.z ? 1 : 2);
+  }
+
+  /**
+   * Returns true if p is inside the box (boundary included).
+   */
+  inline bool contains(const Vector3D &p) const {
+    return p.x >= min.x && p.x <= max.x && p.y >= min.y && p.y <= max.y &&
+           p.z >= min.z && p.z <= max.z;
+  }
+
+  /**
+   * Slab test: returns true if r enters the box for some t in
+   * [r.minT, r.maxT], and then sets [t0, t1] to the part of that interval
+   * inside the box. Zero direction components are handled through the
+   * infinite r.invD, except that a ray exactly in the plane of a face may
+   * or may not hit. This is the single-ray fallback of the packet kernels
+   * in intersect.h.
+   */
+  inline bool intersect(const Ray &r, double &t0, double &t1) const {
+    double tn = r.minT, tf = r.maxT;
+    for (int a = 0; a < 3; a++) {
+      double ta = (min[a] - r.o[a]) * r.invD[a];
+      double tb = (max[a] - r.o[a]) * r.invD[a];
+      tn = std::max(tn, std::min(ta, tb));
+      tf = std::min(tf, std::max(ta, tb));
+    }
+    if (tn > tf) return false;
+    t0 = tn;
+    t1 = tf;
+    return true;
+  }
+
+}; // class BBox
+
+// prints the corners
+std::ostream &operator<<(std::ostream &os, const BBox &b);
+
+} // namespace CMU462
+
+#endif // CMU462_BBOX_H
@@ -0,0 +1,338 @@
+#ifndef CMU462_BVH_H
+#define CMU462_BVH_H
+
+#include "CMU462.h"
+#include "vector3D.h"
+#include "ray.h"
+#include "bbox.h"
+#include "intersect.h"
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+namespace CMU462 {
+
+/**
+ * Bounding volume hierarchy over a set of primitives given by their
+ * bounding boxes (triangles or anything else).
+ *
+ * The tree is built top down with the surface area heuristic evaluated
+ * over 32 bins per axis, or from Morton codes for fast rebuilds (see
+ * buildLinear()). Large nodes are binned in parallel and subtrees are
+ * built as parallel tasks (when built with OpenMP). The nodes are then
+ * stored in depth-first order in a flat array of 32-byte nodes: the first
+ * child of an inner node is the next node, so only the second child index
+ * is stored. Node bounds are floats rounded outwards, so they always
+ * contain the double precision bounds of the primitives.
+ *
+ * The tree stores indices into the caller's primitive arrays and does not
+ * keep a pointer to them.
+ */
+class BVH {
+public:
+  /**
+   * A node of the flat array, 32 bytes.
+   */
+  struct Node {
+    float min[3];    ///< lower corner of the bounds
+    uint32_t offset; ///< leaf: first entry in primitives(),
+                     ///< inner node: index of the second child
+    float max[3];    ///< upper corner of the bounds
+    uint16_t count;  ///< number of primitives, 0 for inner nodes
+    uint16_t axis;   ///< split axis of inner nodes
+
+    inline bool leaf(void) const { return count != 0; }
+  };
+
+  /**
+   * Constructor.
+   * Initializes to the empty hierarchy.
+   */
+  BVH() {}
+
+  /**
+   * Constructor.
+   * Builds the hierarchy over the n primitives with the given bounds, see
+   * build().
+   */
+  BVH(const BBox *bounds, size_t n, size_t maxLeafSize = 4) {
+    build(bounds, n, maxLeafSize);
+  }
+
+  /**
+   * Builds the hierarchy over the n primitives with the given bounds.
+   * Leaves hold at most maxLeafSize primitives (1 to 65535), fewer when
+   * the heuristic finds splitting cheaper.
+   */
+  void build(const BBox *bounds, size_t n, size_t maxLeafSize = 4);
+
+  /**
+   * Builds the hierarchy like build(), but as a linear BVH: the
+   * primitives are sorted by the 30-bit Morton code of their centroid (see
+   * morton.h) and the tree is the binary radix tree over the sorted codes
+   * (Karras, "Maximizing Parallelism in the Construction of BVHs, Octrees,
+   * and k-d Trees", 2012), with subtrees of at most maxLeafSize
+   * primitives made leaves. Every step runs in parallel; this is several
+   * times faster than build() but the tree is somewhat worse for
+   * tracing, which suits geometry rebuilt every frame.
+   */
+  void buildLinear(const BBox *bounds, size_t n, size_t maxLeafSize = 4);
+
+  /**
+   * Recomputes the node bounds bottom up for new primitive bounds, keeping
+   * the topology. This is much faster than build() for animated geometry
+   * but the tree degrades as the primitives move away from where they were
+   * when it was built. bounds must have as many entries as in build().
+   */
+  void refit(const BBox *bounds);
+
+  /**
+   * Returns the bounds of all primitives, empty if there are none.
+   */
+  BBox bounds(void) const;
+
+  /**
+   * Returns the nodes, the root first.
+   */
+  inline const std::vector<Node> &nodes(void) const { return tree; }
+
+  /**
+   * Returns the primitive indices referenced by the leaves.
+   */
+  inline const std::vector<uint32_t> &primitives(void) const {
+    return order;
+  }
+
+  /**
+   * Finds the closest hit along r. Calls hit(p, r) for each primitive p
+   * in a leaf that r reaches, nearest child first; hit must return true
+   * and shorten r.maxT to the hit parameter if r hits p. Returns true if
+   * any call returned true; r.maxT is then the closest hit.
+   */
+  template <typename F>
+  bool intersect(Ray &r, F &&hit) const;
+
+private:
+  std::vector<Node> tree;
+  std::vector<uint32_t> order;
+
+}; // class BVH
+
+/**
+ * Wide hierarchy whose nodes have up to W = 4 or 8 children, collapsed
+ * from a BVH by repeatedly opening the child with the largest surface
+ * area. The child bounds of a node are stored as a structure of arrays
+ * so that a ray is tested against all of them at once (SSE2 for 4
+ * children, AVX2 for 8, see simd.h). BVH4 and BVH8 are the instantiated
+ * types.
+ *
+ * The wide slab test is done in single precision with a small relative
+ * tolerance, so it is conservative except for rays passing within about
+ * 1e-6 (relative to the coordinates) of a box edge.
+ */
+template <int W>
+class WideBVH {
+public:
+  /**
+   * A node of the flat array. Unused children come last, have NaN bounds
+   * and child set to kEmpty, and never hit.
+   */
+  struct Node {
+    float min[3][W];   ///< lower corners, min[axis][child]
+    float max[3][W];   ///< upper corners
+    uint32_t child[W]; ///< leaf: first entry in primitives(),
+                       ///< otherwise index of the child node
+    uint32_t count[W]; ///< number of primitives, 0 for inner children
+  };
+
+  static const uint32_t kEmpty = 0xFFFFFFFF;
+
+  /**
+   * Constructor.
+   * Initializes to the empty hierarchy.
+   */
+  WideBVH() {}
+
+  /**
+   * Constructor.
+   * Collapses bvh, whose leaves and primitive order are kept.
+   */
+  explicit WideBVH(const BVH &bvh);
+
+  /**
+   * Recomputes the child bounds bottom up for new primitive bounds, see
+   * BVH::refit().
+   */
+  void refit(const BBox *bounds);
+
+  /**
+   * Returns the nodes, the root first.
+   */
+  inline const std::vector<Node> &nodes(void) const { return tree; }
+
+  /**
+   * Returns the primitive indices referenced by the leaves.
+   */
+  inline const std::vector<uint32_t> &primitives(void) const {
+    return order;
+  }
+
+  /**
+   * Finds the closest hit along r, see BVH::intersect().
+   */
+  template <typename F>
+  bool intersect(Ray &r, F &&hit) const;
+
+private:
+  uint32_t collapse(const BVH &bvh, uint32_t node);
+
+  /**
+   * Slab tests of r (origin o and inverse direction invD, in floats)
+   * against the children of node. Returns the mask of the children hit
+   * within [t0, t1] and writes their entry parameters to tEnter.
+   */
+  static int hitChildren(const Node &node, const float o[3],
+                         const float invD[3], float t0, float t1,
+                         float tEnter[W]);
+
+  std::vector<Node> tree;
+  std::vector<uint32_t> order;
+
+}; // class WideBVH
+
+typedef WideBVH<4> BVH4;
+typedef WideBVH<8> BVH8;
+
+/**
+ * Writes the bounds of the n triangles of a triangle soup into bounds;
+ * triangle i has the vertices vertices[indices[3i + k]], k = 0..2.
+ */
+void triangleBounds(const Vector3D *vertices, const int *indices,
+                    BBox *bounds, size_t n);
+
+/**
+ * Primitive callback for BVH::intersect() over a triangle soup (indexed as
+ * in triangleBounds()). After a hit, primitive is the closest triangle and
+ * (u, v) the barycentric coordinates of the hit point on it.
+ */
+struct TriangleHit {
+  const Vector3D *vertices;
+  const int *indices;
+  uint32_t primitive;
+  double u, v;
+
+  TriangleHit(const Vector3D *vertices, const int *indices)
+      : vertices(vertices), indices(indices), primitive(0), u(0), v(0) {}
+
+  inline bool operator()(uint32_t p, Ray &r) {
+    const int *t = indices + 3 * p;
+    double ht;
+    if (!intersectTriangle(r, vertices[t[0]], vertices[t[1]],
+                           vertices[t[2]], ht, u, v))
+      return false;
+    r.maxT = ht;
+    primitive = p;
+    return true;
+  }
+};
+
+//------------------------------------------------------------------------------
+// Traversal
+//------------------------------------------------------------------------------
+
+// Both builds bound the depth of the tree, so fixed size stacks suffice.
+static const int kBVHStackSize = 128;
+
+template <typename F>
+bool BVH::intersect(Ray &r, F &&hit) const {
+  if (tree.empty()) return false;
+
+  uint32_t stack[kBVHStackSize];
+  int top = 0;
+  uint32_t i = 0;
+  bool found = false;
+  for (;;) {
+    const Node &node = tree[i];
+
+    // slab test, see BBox::intersect
+    double tn = r.minT, tf = r.maxT;
+    for (int a = 0; a < 3; a++) {
+      double ta = (node.min[a] - r.o[a]) * r.invD[a];
+      double tb = (node.max[a] - r.o[a]) * r.invD[a];
+      tn = std::max(tn, std::min(ta, tb));
+      tf = std::min(tf, std::max(ta, tb));
+    }
+
+    if (tn <= tf) {
+      if (node.leaf()) {
+        for (uint32_t k = 0; k < node.count; k++)
+          if (hit(order[node.offset + k], r)) found = true;
+      } else {
+        // visit the child on the side the ray comes from first
+        bool flip = r.d[node.axis] < 0;
+        stack[top++] = flip ? i + 1 : node.offset;
+        i = flip ? node.offset : i + 1;
+        continue;
+      }
+    }
+
+    if (!top) break;
+    i = stack[--top];
+  }
+  return found;
+}
+
+template <int W>
+template <typename F>
+bool WideBVH<W>::intersect(Ray &r, F &&hit) const {
+  if (tree.empty()) return false;
+
+  float o[3], invD[3];
+  for (int a = 0; a < 3; a++) {
+    o[a] = (float)r.o[a];
+    invD[a] = (float)r.invD[a];
+  }
+
+  // pending children, visited nearest first
+  struct Entry {
+    uint32_t child, count;
+    float t;
+  } stack[kBVHStackSize * (W - 1) + 1];
+  int top = 0;
+  stack[top++] = Entry{0, 0, (float)r.minT};
+
+  bool found = false;
+  while (top) {
+    Entry e = stack[--top];
+    if (e.t > r.maxT) continue;
+
+    if (e.count) {
+      for (uint32_t k = 0; k < e.count; k++)
+        if (hit(order[e.child + k], r)) found = true;
+      continue;
+    }
+
+    float tEnter[W];
+    int mask = hitChildren(tree[e.child], o, invD, (float)r.minT,
+                           (float)r.maxT, tEnter);
+
+    // push the hits sorted by decreasing entry parameter
+    int first = top;
+    for (int c = 0; c < W; c++) {
+      if (!(mask & (1 << c))) continue;
+      Entry n = {tree[e.child].child[c], tree[e.child].count[c], tEnter[c]};
+      int j = top++;
+      while (j > first && stack[j - 1].t < n.t) {
+        stack[j] = stack[j - 1];
+        j--;
+      }
+      stack[j] = n;
+    }
+  }
+  return found;
+}
+
+} // namespace CMU462
+
+#endif // CMU462_BVH_H
@@ -0,0 +1,165 @@
+#ifndef CMU462_COLOR32_H
+#define CMU462_COLOR32_H
+
+#include "CMU462.h"
+#include "color.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <stdint.h>
+#include <string>
+
+namespace CMU462 {
+
+/**
+ * Color with 8 bits per channel, packed in 32 bits: the storage for a
+ * Color in frame buffers and images, 4 bytes instead of 16. The bytes are
+ * in R, G, B, A order, as expected by lodepng and OpenGL (GL_RGBA,
+ * GL_UNSIGNED_BYTE).
+ *
+ * Channel k stands for k / 255, so converting to Color and back is
+ * lossless; converting a Color clamps it to [0, 1] and rounds to nearest.
+ */
+struct Color32 {
+  uint8_t r, g, b, a;
+
+  /**
+   * Constructor.
+   * Initializes to transparent black.
+   */
+  Color32() : r(0), g(0), b(0), a(0) {}
+
+  Color32(uint8_t r, uint8_t g, uint8_t b, uint8_t a = 255)
+      : r(r), g(g), b(b), a(a) {}
+
+  explicit Color32(const Color &c)
+      : r(toByte(c.r)), g(toByte(c.g)), b(toByte(c.b)), a(toByte(c.a)) {}
+
+  inline Color toColor(void) const {
+    return Color(r / 255.0f, g / 255.0f, b / 255.0f, a / 255.0f);
+  }
+
+  /**
+   * Returns the 32-bit word holding the channels, red in the low byte on
+   * little-endian machines.
+   */
+  inline uint32_t packed(void) const {
+    uint32_t u;
+    memcpy(&u, this, 4);
+    return u;
+  }
+
+  static inline Color32 fromPacked(uint32_t u) {
+    Color32 c;
+    memcpy((void *)&c, &u, 4);
+    return c;
+  }
+
+  /**
+   * Returns the color premultiplied by its alpha, as used by
+   * blendOverPremultiplied().
+   */
+  inline Color32 premultiplied(void) const {
+    return Color32(mul(r, a), mul(g, a), mul(b, a), a);
+  }
+
+  // comparison
+  inline bool operator==(const Color32 &rhs) const {
+    return packed() == rhs.packed();
+  }
+
+  inline bool operator!=(const Color32 &rhs) const { return !operator==(rhs); }
+
+  /**
+   * Same as Color::fromHex(), without going through floats: parses
+   * "rrggbb", with an optional leading '#', with alpha 255, or "none" as
+   * transparent black.
+   */
+  static Color32 fromHex(const char *s);
+
+  /**
+   * Returns the hexadecimal string "#rrggbb" of this color, which
+   * fromHex() parses back.
+   */
+  std::string toHex(void) const;
+
+  /**
+   * Same encoding as Color::fromPickIndex(): the low three bytes of i in
+   * the red, green and blue channels, with alpha 255.
+   */
+  static inline Color32 fromPickIndex(int i) {
+    return Color32(i & 0xFF, (i >> 8) & 0xFF, (i >> 16) & 0xFF, 255);
+  }
+
+  inline int toPickIndex(void) const { return r + g * 256 + b * 256 * 256; }
+
+  /**
+   * Returns c in [0, 1] as a channel, rounded to nearest even.
+   */
+  static inline uint8_t toByte(float c) {
+    c = c > 0 ? c : 0;
+    c = c < 1 ? c : 1;
+    return (uint8_t)lrintf(c * 255);
+  }
+
+  /**
+   * Returns x * y / 255 rounded to nearest, exactly.
+   */
+  static inline uint8_t mul(uint32_t x, uint32_t y) {
+    uint32_t t = x * y + 128;
+    return (uint8_t)((t + (t >> 8)) >> 8);
+  }
+
+}; // struct Color32
+
+/**
+ * Bulk conversions of n colors to and from Color32, dispatched to SSE2 or
+ * AVX2 kernels (see simd.h), with large arrays converted in parallel
+ * blocks. All levels give the same results as the Color32 constructor
+ * and toColor().
+ */
+void toColor32(const Color *in, Color32 *out, size_t n);
+void fromColor32(const Color32 *in, Color *out, size_t n);
+
+/**
+ * Span kernels for compositing follow. They are meant for the spans of a
+ * rasterizer, so they run on the calling thread, and are dispatched like
+ * the conversions; all levels give the same results, computed in
+ * integers with rounding to nearest.
+ *
+ * Sets the n pixels of dst to c.
+ */
+void fill(Color32 *dst, size_t n, Color32 c);
+
+/**
+ * Copies n pixels from src to dst. The spans may overlap.
+ */
+void copySpan(const Color32 *src, Color32 *dst, size_t n);
+
+/**
+ * Composites src over dst, both not premultiplied:
+ * dst.rgb = src.rgb * src.a + dst.rgb * (1 - src.a) and
+ * dst.a = src.a + dst.a * (1 - src.a). The colors are exact when dst is
+ * opaque, which is the common case of drawing onto a background; they
+ * are not divided by the resulting alpha otherwise.
+ */
+void blendOver(const Color32 *src, Color32 *dst, size_t n);
+void blendOver(Color32 src, Color32 *dst, size_t n);
+
+/**
+ * Composites src over dst, both premultiplied by their alpha:
+ * dst = src + dst * (1 - src.a) for all four channels, saturated.
+ * See Color32::premultiplied() and premultiply().
+ */
+void blendOverPremultiplied(const Color32 *src, Color32 *dst, size_t n);
+void blendOverPremultiplied(Color32 src, Color32 *dst, size_t n);
+
+/**
+ * Premultiplies n pixels by their alpha, in place.
+ */
+void premultiply(Color32 *pixels, size_t n);
+
+} // namespace CMU462
+
+#endif // CMU462_COLOR32_H
@@ -0,0 +1,121 @@
+#ifndef CMU462_CURVES_H
+#define CMU462_CURVES_H
+
+#include "CMU462.h"
+#include "vector2D.h"
+#include "vector3D.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace CMU462 {
+
+/**
+ * Evaluates the quadratic Bezier curve with control points p0, p1, p2 at
+ * t in [0, 1], by de Casteljau's algorithm. Works for any vector type.
+ */
+template <typename V>
+inline V quadraticBezier(const V &p0, const V &p1, const V &p2, double t) {
+  V a = p0 + t * (p1 - p0), b = p1 + t * (p2 - p1);
+  return a + t * (b - a);
+}
+
+/**
+ * Evaluates the cubic Bezier curve with control points p0, p1, p2, p3 at
+ * t in [0, 1], by de Casteljau's algorithm.
+ */
+template <typename V>
+inline V cubicBezier(const V &p0, const V &p1, const V &p2, const V &p3,
+                     double t) {
+  V a = p0 + t * (p1 - p0), b = p1 + t * (p2 - p1), c = p2 + t * (p3 - p2);
+  a = a + t * (b - a);
+  b = b + t * (c - b);
+  return a + t * (b - a);
+}
+
+/**
+ * Returns the control points of the cubic Bezier curve equal to the
+ * segment between p[1] and p[2] of the uniform Catmull-Rom spline through
+ * p[0], ..., p[3].
+ */
+template <typename V> inline void catmullRomToBezier(const V *p, V *b) {
+  b[0] = p[1];
+  b[1] = p[1] + (p[2] - p[0]) * (1.0 / 6);
+  b[2] = p[2] - (p[3] - p[1]) * (1.0 / 6);
+  b[3] = p[2];
+}
+
+/**
+ * Evaluates the segment between p1 and p2 of the uniform Catmull-Rom
+ * spline through p0, p1, p2, p3, at t in [0, 1].
+ */
+template <typename V>
+inline V catmullRom(const V &p0, const V &p1, const V &p2, const V &p3,
+                    double t) {
+  V p[4] = {p0, p1, p2, p3}, b[4];
+  catmullRomToBezier(p, b);
+  return cubicBezier(b[0], b[1], b[2], b[3], t);
+}
+
+/**
+ * Batch evaluation of a curve at n parameters t, into out. p holds the
+ * control points: 3 for a quadratic, 4 for a cubic, and the 4 points
+ * around the segment for Catmull-Rom.
+ *
+ * The parameters are evaluated several at a time by de Casteljau's
+ * algorithm in SSE2 or AVX2 kernels (see simd.h), and large batches in
+ * parallel blocks. The results are those of the functions above, up to
+ * the last bit with AVX2, which fuses multiplications and additions.
+ */
+void quadraticBezier(const Vector2D *p, const double *t, Vector2D *out,
+                     size_t n);
+void quadraticBezier(const Vector3D *p, const double *t, Vector3D *out,
+                     size_t n);
+void cubicBezier(const Vector2D *p, const double *t, Vector2D *out,
+                 size_t n);
+void cubicBezier(const Vector3D *p, const double *t, Vector3D *out,
+                 size_t n);
+void catmullRom(const Vector2D *p, const double *t, Vector2D *out, size_t n);
+void catmullRom(const Vector3D *p, const double *t, Vector3D *out, size_t n);
+
+/**
+ * Evaluates a curve (control points as above) at the n >= 2 uniformly
+ * spaced parameters t = i / (n - 1), into out, by forward differencing:
+ * three additions per coordinate and point. Differencing restarts from
+ * an exact evaluation every 64 points, which keeps the error within a few
+ * ulps of the control points; the first and last points are exact.
+ */
+void quadraticBezierUniform(const Vector2D *p, Vector2D *out, size_t n);
+void quadraticBezierUniform(const Vector3D *p, Vector3D *out, size_t n);
+void cubicBezierUniform(const Vector2D *p, Vector2D *out, size_t n);
+void cubicBezierUniform(const Vector3D *p, Vector3D *out, size_t n);
+void catmullRomUniform(const Vector2D *p, Vector2D *out, size_t n);
+void catmullRomUniform(const Vector3D *p, Vector3D *out, size_t n);
+
+/**
+ * Flattens a curve (control points as above) into a polyline whose
+ * distance to the curve is at most tolerance (in screen space, typically
+ * a fraction of a pixel). The vertices after the first control point are
+ * appended to out, so the curves of a path can be flattened one after
+ * the other; returns the number appended.
+ *
+ * The vertices are spaced by the integral of the square root of the
+ * curvature, which makes the error of the segments about the same
+ * (R. Levien, "Flattening quadratic Bezier curves", 2019). Cubics are
+ * first approximated by quadratics within a twentieth of the tolerance,
+ * and the segments are counted over all of them at once; a vertex is
+ * added at the end of a quadratic only where a segment across it would
+ * leave the tolerance. On random cubics this takes 13 to 15 percent more
+ * segments than a greedy split making each segment as long as the
+ * tolerance allows, and about 45 percent fewer than uniform subdivision.
+ */
+size_t flattenQuadratic(const Vector2D *p, double tolerance,
+                        std::vector<Vector2D> &out);
+size_t flattenCubic(const Vector2D *p, double tolerance,
+                    std::vector<Vector2D> &out);
+size_t flattenCatmullRom(const Vector2D *p, double tolerance,
+                         std::vector<Vector2D> &out);
+
+} // namespace CMU462
+
+#endif // CMU462_CURVES_H
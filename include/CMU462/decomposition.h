@@ -0,0 +1,76 @@
+#ifndef CMU462_DECOMPOSITION_H
+#define CMU462_DECOMPOSITION_H
+
+#include "CMU462.h"
+#include "vector3D.h"
+#include "matrix3x3.h"
+
+#include <cstddef>
+
+namespace CMU462 {
+
+/**
+ * Decompositions of 3x3 matrices: symmetric eigen-decomposition, singular
+ * value decomposition and polar decomposition. All of them are based on
+ * cyclic Jacobi rotations, which for 3x3 matrices converge in a few sweeps
+ * with no data dependent control flow besides the convergence test, so
+ * many matrices can be decomposed side by side in SIMD lanes.
+ *
+ * The computations are done in double precision for both Matrix3x3 and
+ * Matrix3x3f. The batch versions decompose A[k] for k = 0..n-1, four
+ * matrices at a time with AVX2 when available (see simd.h), split into
+ * blocks that are processed in parallel (when built with OpenMP).
+ * Outputs given as NULL are not computed or not written.
+ */
+
+/**
+ * Eigen-decomposition of the symmetric matrix A (only its upper triangle
+ * is read): A = V diag(lambda) V^T, with the eigenvalues in increasing
+ * order and the eigenvectors in the columns of the rotation V.
+ *
+ * For the covariance matrix of a point neighborhood, V[0] is the normal of
+ * the best fitting plane and V[2] the principal direction.
+ */
+template <typename S>
+void eigenSymmetric(const BasicMatrix3x3<S> &A, BasicVector3D<S> &lambda,
+                    BasicMatrix3x3<S> &V);
+
+void eigenSymmetric(const Matrix3x3 *A, Vector3D *lambda, Matrix3x3 *V,
+                    size_t n);
+void eigenSymmetric(const Matrix3x3f *A, Vector3f *lambda, Matrix3x3f *V,
+                    size_t n);
+
+/**
+ * Singular value decomposition A = U diag(sigma) V^T, with U and V
+ * rotations and |sigma.x| >= |sigma.y| >= |sigma.z|. sigma.x and sigma.y
+ * are non-negative; sigma.z is negative when det(A) < 0 (negate it and the
+ * last column of U for the usual convention with U a reflection).
+ *
+ * V diagonalizes A^T A and U is the QR factorization of A V by Givens
+ * rotations, so singular values much smaller than sigma.x are only
+ * accurate to about eps sigma.x^2 / sigma.z.
+ */
+template <typename S>
+void svd(const BasicMatrix3x3<S> &A, BasicMatrix3x3<S> &U,
+         BasicVector3D<S> &sigma, BasicMatrix3x3<S> &V);
+
+void svd(const Matrix3x3 *A, Matrix3x3 *U, Vector3D *sigma, Matrix3x3 *V,
+         size_t n);
+void svd(const Matrix3x3f *A, Matrix3x3f *U, Vector3f *sigma, Matrix3x3f *V,
+         size_t n);
+
+/**
+ * Polar decomposition A = R P with R = U V^T the closest rotation to A and
+ * P = V diag(sigma) V^T symmetric, computed from svd(). P is positive
+ * semi-definite unless det(A) < 0.
+ */
+template <typename S>
+void polar(const BasicMatrix3x3<S> &A, BasicMatrix3x3<S> &R,
+           BasicMatrix3x3<S> &P);
+
+void polar(const Matrix3x3 *A, Matrix3x3 *R, Matrix3x3 *P, size_t n);
+void polar(const Matrix3x3f *A, Matrix3x3f *R, Matrix3x3f *P, size_t n);
+
+} // namespace CMU462
+
+#endif // CMU462_DECOMPOSITION_H
@@ -0,0 +1,162 @@
+#ifndef CMU462_DUALQUATERNION_H
+#define CMU462_DUALQUATERNION_H
+
+#include "CMU462.h"
+#include "vector3D.h"
+#include "quaternion.h"
+#include "matrix4x4.h"
+#include "affine3.h"
+
+#include <iosfwd>
+
+namespace CMU462 {
+
+/**
+ * Defines dual quaternions r + e d over the scalar type T, with r (real)
+ * and d (dual) quaternions and e^2 = 0. DualQuaternion (double) and
+ * DualQuaternionf (float) are the instantiated types.
+ *
+ * A unit dual quaternion (|r| = 1, r.d = 0) represents the rigid motion
+ * that rotates by r and then translates by t, where d = t r / 2 with t as
+ * the pure quaternion (t, 0). Blending unit dual quaternions and
+ * renormalizing interpolates rigid motions without the volume loss of
+ * blended matrices, see skinning.h.
+ */
+template <typename T>
+class BasicDualQuaternion {
+public:
+  typedef T Scalar;
+
+  // real and dual part
+  BasicQuaternion<T> real, dual;
+
+  /**
+   * Constructor.
+   * Initializes to the identity motion (0,0,0,1) + e (0,0,0,0).
+   */
+  BasicDualQuaternion() : real(), dual(0, 0, 0, 0) {}
+
+  /**
+   * Constructor.
+   * Initializes to real + e dual.
+   */
+  BasicDualQuaternion(const BasicQuaternion<T> &real,
+                      const BasicQuaternion<T> &dual)
+      : real(real), dual(dual) {}
+
+  /**
+   * Constructor.
+   * Initializes to the rotation by the unit quaternion r followed by the
+   * translation by t.
+   */
+  BasicDualQuaternion(const BasicQuaternion<T> &r, const BasicVector3D<T> &t)
+      : real(r), dual(T(0.5) * (BasicQuaternion<T>(t, 0) * r)) {}
+
+  /**
+   * Returns the rotation part of a unit dual quaternion.
+   */
+  inline const BasicQuaternion<T> &rotation(void) const { return real; }
+
+  /**
+   * Returns the translation part of a unit dual quaternion, 2 d r*.
+   */
+  inline BasicVector3D<T> translation(void) const {
+    return (T(2) * (dual * real.conjugate())).complex();
+  }
+
+  /**
+   * Returns the quaternion conjugate r* + e d*.
+   * For a unit dual quaternion this is the inverse motion.
+   */
+  inline BasicDualQuaternion conjugate(void) const {
+    return BasicDualQuaternion(real.conjugate(), dual.conjugate());
+  }
+
+  /**
+   * Returns the norm of the real part.
+   */
+  inline T norm(void) const { return real.norm(); }
+
+  /**
+   * Returns the dual quaternion divided by the norm of its real part.
+   * This makes the real part unit but does not enforce r.d = 0, which
+   * holds for blends of unit dual quaternions to first order.
+   */
+  inline BasicDualQuaternion unit(void) const {
+    T r = T(1) / real.norm();
+    return BasicDualQuaternion(r * real, r * dual);
+  }
+
+  /**
+   * Divides by the norm of the real part.
+   */
+  inline void normalize(void) { *this = unit(); }
+
+  /**
+   * Applies the motion of a unit dual quaternion to the point p.
+   */
+  inline BasicVector3D<T> transformPoint(const BasicVector3D<T> &p) const {
+    return real.rotatedVector(p) + translation();
+  }
+
+  /**
+   * Applies the rotation of a unit dual quaternion to the direction v.
+   */
+  inline BasicVector3D<T> transformVector(const BasicVector3D<T> &v) const {
+    return real.rotatedVector(v);
+  }
+
+  /**
+   * Returns the motion of a unit dual quaternion as an affine transform.
+   */
+  inline BasicAffine3<T> toAffine3(void) const {
+    return BasicAffine3<T>(real.rotationMatrix(), translation());
+  }
+
+  /**
+   * Returns the motion of a unit dual quaternion as a 4x4 matrix.
+   */
+  inline BasicMatrix4x4<T> toMatrix4x4(void) const {
+    return toAffine3().toMatrix4x4();
+  }
+
+  // addition
+  inline BasicDualQuaternion operator+(const BasicDualQuaternion &q) const {
+    return BasicDualQuaternion(real + q.real, dual + q.dual);
+  }
+
+  // addition / assignment
+  inline void operator+=(const BasicDualQuaternion &q) {
+    real += q.real;
+    dual += q.dual;
+  }
+
+  // right scalar multiplication
+  inline BasicDualQuaternion operator*(T c) const {
+    return BasicDualQuaternion(c * real, c * dual);
+  }
+
+  // product, i.e. the composition of the motions (q first)
+  inline BasicDualQuaternion operator*(const BasicDualQuaternion &q) const {
+    return BasicDualQuaternion(real * q.real,
+                               BasicQuaternion<T>(real * q.dual) +
+                                   BasicQuaternion<T>(dual * q.real));
+  }
+
+}; // class BasicDualQuaternion
+
+// left scalar multiplication
+template <typename T>
+inline BasicDualQuaternion<T>
+operator*(typename BasicDualQuaternion<T>::Scalar c,
+          const BasicDualQuaternion<T> &q) {
+  return q * c;
+}
+
+// prints components
+template <typename T>
+std::ostream &operator<<(std::ostream &os, const BasicDualQuaternion<T> &q);
+
+} // namespace CMU462
+
+#endif // CMU462_DUALQUATERNION_H
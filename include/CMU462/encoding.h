@@ -0,0 +1,200 @@
+#ifndef CMU462_ENCODING_H
+#define CMU462_ENCODING_H
+
+#include "CMU462.h"
+#include "vector3D.h"
+#include "quaternion.h"
+
+#include <cmath>
+#include <cstddef>
+#include <stdint.h>
+
+namespace CMU462 {
+
+//------------------------------------------------------------------------------
+// Octahedral normals
+//
+// A direction is projected onto the octahedron |x| + |y| + |z| = 1, whose
+// lower half is folded over the upper one, and the resulting square is
+// quantized uniformly (Cigolle et al., "A Survey of Efficient
+// Representations for Independent Unit Vectors", 2014). The vector need
+// not be unit, but must be nonzero; zero encodes as (0, 0, 1). Decoded
+// vectors are unit. The angle between a vector and its decoding is at
+// most (measured over 6 million random directions, rounded up):
+//
+//   16 bits (8 per coordinate):   0.96 degrees
+//   32 bits (16 per coordinate):  0.0038 degrees
+//------------------------------------------------------------------------------
+
+// the octahedral coordinates of v in [-1, 1]^2, times scale, rounded
+inline void octQuantize(const Vector3D &v, double scale, long &x, long &y) {
+  double s = fabs(v.x) + fabs(v.y) + fabs(v.z);
+  if (s == 0) s = 1;
+  double px = v.x / s, py = v.y / s;
+  if (v.z < 0) {
+    double fx = (1 - fabs(py)) * copysign(1.0, px);
+    py = (1 - fabs(px)) * copysign(1.0, py);
+    px = fx;
+  }
+  x = lrint(px * scale);
+  y = lrint(py * scale);
+}
+
+// the unit vector with octahedral coordinates (x, y) / scale
+inline Vector3D octDirection(long x, long y, double scale) {
+  double px = x * (1 / scale), py = y * (1 / scale);
+  double pz = 1 - fabs(px) - fabs(py);
+  if (pz < 0) {
+    double fx = (1 - fabs(py)) * copysign(1.0, px);
+    py = (1 - fabs(px)) * copysign(1.0, py);
+    px = fx;
+  }
+  double r = 1 / sqrt(px * px + py * py + pz * pz);
+  return Vector3D(px * r, py * r, pz * r);
+}
+
+/**
+ * Encodes the direction of v in 32 bits: x in the low 16 bits and y in
+ * the high ones, as signed normalized integers.
+ */
+inline uint32_t encodeOct32(const Vector3D &v) {
+  long x, y;
+  octQuantize(v, 32767, x, y);
+  return (uint32_t)(x & 0xFFFF) | (uint32_t)(y & 0xFFFF) << 16;
+}
+
+inline Vector3D decodeOct32(uint32_t code) {
+  return octDirection((int16_t)(code & 0xFFFF), (int16_t)(code >> 16), 32767);
+}
+
+/**
+ * Encodes the direction of v in 16 bits: x in the low byte and y in the
+ * high one, as signed normalized integers.
+ */
+inline uint16_t encodeOct16(const Vector3D &v) {
+  long x, y;
+  octQuantize(v, 127, x, y);
+  return (uint16_t)((x & 0xFF) | (y & 0xFF) << 8);
+}
+
+inline Vector3D decodeOct16(uint16_t code) {
+  return octDirection((int8_t)(code & 0xFF), (int8_t)(code >> 8), 127);
+}
+
+//------------------------------------------------------------------------------
+// Smallest-three quaternions
+//
+// A rotation is stored as the index of the component of largest magnitude
+// and the other three, which lie in [-1/sqrt(2), 1/sqrt(2)], quantized
+// uniformly. The quaternion is negated if needed to make the largest
+// component positive, so it is recovered as the square root of one minus
+// the sum of the squares of the others. The quaternion need not be unit,
+// but must be nonzero; decoded quaternions are unit.
+//
+// The components are quantized in steps of 1 / (sqrt(2) scale), so
+// rounding moves the three by at most sqrt(3) / (2 sqrt(2) scale) in all.
+// Recovering the largest one, which is at least 1/2, stretches that by at
+// most 2 on the unit sphere, and rotation angles are twice the angles
+// between quaternions, so decoded rotations are within sqrt(6) / scale
+// radians of the original:
+//
+//   32 bits (2-bit index, 10 bits per component, scale 511):  0.28 degrees
+//   64 bits (2-bit index, 20 bits per component, scale 524287):
+//     0.00027 degrees
+//
+// Rotations with all components near 1/2 come close to these bounds.
+//------------------------------------------------------------------------------
+
+// the index of the largest component of q, and its other components
+// scaled to [-scale, scale], rounded, and offset to [0, 2 scale]
+inline int quatQuantize(const Quaternion &q, double scale, long c[3]) {
+  int largest = 0;
+  double best = fabs(q[0]);
+  for (int i = 1; i < 4; i++) {
+    if (fabs(q[i]) > best) {
+      best = fabs(q[i]);
+      largest = i;
+    }
+  }
+  double n2 = q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w;
+  double f = copysign(M_SQRT2 * scale / sqrt(n2), q[largest]);
+  for (int i = 0, j = 0; i < 4; i++) {
+    if (i != largest) c[j++] = lrint(q[i] * f) + (long)scale;
+  }
+  return largest;
+}
+
+// the unit quaternion with the given largest component and quantized
+// other ones
+inline Quaternion quatDirection(int largest, const long c[3],
+                                double scale) {
+  double v[3];
+  double sum = 1;
+  for (int j = 0; j < 3; j++) {
+    v[j] = (c[j] - scale) * (M_SQRT1_2 / scale);
+    sum -= v[j] * v[j];
+  }
+  Quaternion q;
+  for (int i = 0, j = 0; i < 4; i++)
+    q[i] = i == largest ? sqrt(sum > 0 ? sum : 0) : v[j++];
+  return q;
+}
+
+/**
+ * Encodes the rotation q in 32 bits: the index of the largest component
+ * in the two high bits, then the other components by increasing index,
+ * 10 bits each.
+ */
+inline uint32_t encodeQuat32(const Quaternion &q) {
+  long c[3];
+  uint32_t largest = quatQuantize(q, 511, c);
+  return largest << 30 | (uint32_t)c[0] << 20 | (uint32_t)c[1] << 10 |
+         (uint32_t)c[2];
+}
+
+inline Quaternion decodeQuat32(uint32_t code) {
+  long c[3] = {(long)(code >> 20 & 0x3FF), (long)(code >> 10 & 0x3FF),
+               (long)(code & 0x3FF)};
+  return quatDirection(code >> 30, c, 511);
+}
+
+/**
+ * Encodes the rotation q in 64 bits: the index of the largest component
+ * in bits 60 and 61, then the other components by increasing index, 20
+ * bits each.
+ */
+inline uint64_t encodeQuat64(const Quaternion &q) {
+  long c[3];
+  uint64_t largest = quatQuantize(q, 524287, c);
+  return largest << 60 | (uint64_t)c[0] << 40 | (uint64_t)c[1] << 20 |
+         (uint64_t)c[2];
+}
+
+inline Quaternion decodeQuat64(uint64_t code) {
+  long c[3] = {(long)(code >> 40 & 0xFFFFF), (long)(code >> 20 & 0xFFFFF),
+               (long)(code & 0xFFFFF)};
+  return quatDirection((int)(code >> 60 & 3), c, 524287);
+}
+
+/**
+ * Bulk encoding and decoding of n vectors or quaternions.
+ *
+ * These are dispatched to AVX2 kernels when available (see simd.h), and
+ * large arrays are processed in parallel blocks. The kernels follow the
+ * functions above operation by operation, but may fuse multiplications
+ * and additions, so in rare cases a code or a decoded component differs
+ * from theirs in the last bit.
+ */
+void encodeOct32(const Vector3D *in, uint32_t *out, size_t n);
+void decodeOct32(const uint32_t *in, Vector3D *out, size_t n);
+void encodeOct16(const Vector3D *in, uint16_t *out, size_t n);
+void decodeOct16(const uint16_t *in, Vector3D *out, size_t n);
+
+void encodeQuat32(const Quaternion *in, uint32_t *out, size_t n);
+void decodeQuat32(const uint32_t *in, Quaternion *out, size_t n);
+void encodeQuat64(const Quaternion *in, uint64_t *out, size_t n);
+void decodeQuat64(const uint64_t *in, Quaternion *out, size_t n);
+
+} // namespace CMU462
+
+#endif // CMU462_ENCODING_H
@@ -0,0 +1,140 @@
+#ifndef CMU462_FFT_H
+#define CMU462_FFT_H
+
+#include "CMU462.h"
+#include "complex.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace CMU462 {
+
+/**
+ * Fast Fourier transforms over contiguous arrays of Complex.
+ *
+ * A plan holds everything that depends only on the size (factorization
+ * and twiddle factors), so it is built once and reused for any number of
+ * transforms of that size. The transforms do not modify the plan and may
+ * run concurrently on different data.
+ *
+ * The forward transform is X[k] = sum_j x[j] exp(-2 pi i jk/n), unscaled;
+ * the inverse transform has the opposite sign and divides by n, so that
+ * inverse(forward(x)) = x.
+ */
+class FFTPlan {
+public:
+  /**
+   * Constructor.
+   * Plans transforms of size n >= 1. Any n is supported: it is factored
+   * into radix-4 and radix-2 stages followed by stages for the odd prime
+   * factors (mixed radix), so sizes with large prime factors are slower.
+   */
+  explicit FFTPlan(size_t n = 1);
+
+  // transform size
+  inline size_t size(void) const { return n; }
+
+  /**
+   * Transforms the n values in data in place.
+   * scratch must hold n values; the overloads without it allocate one.
+   */
+  void forward(Complex *data, Complex *scratch) const;
+  void inverse(Complex *data, Complex *scratch) const;
+  void forward(Complex *data) const;
+  void inverse(Complex *data) const;
+
+private:
+  // one pass of the self-sorting (Stockham) algorithm
+  struct Stage {
+    size_t radix;   ///< butterfly size p
+    size_t m;       ///< butterflies per group, length / p
+    size_t stride;  ///< number of interleaved groups
+    size_t twiddle; ///< offset into twiddles, (p - 1) * m values
+    size_t roots;   ///< offset into twiddles of the p-th roots of unity
+  };
+
+  void run(double *x, double *y) const;
+
+  size_t n;
+  std::vector<Stage> stages;
+  std::vector<Complex> twiddles;
+
+}; // class FFTPlan
+
+/**
+ * Transforms of real sequences of even length n, computed with a complex
+ * transform of length n/2. By symmetry only the n/2 + 1 values X[0] to
+ * X[n/2] of the spectrum are stored.
+ */
+class RealFFTPlan {
+public:
+  /**
+   * Constructor.
+   * Plans transforms of size n.
+   * REQUIRES: n is even.
+   */
+  explicit RealFFTPlan(size_t n = 2);
+
+  // transform size
+  inline size_t size(void) const { return n; }
+
+  /**
+   * Writes X[0] to X[n/2] of the n real values in into out, which must
+   * hold n/2 + 1 values.
+   */
+  void forward(const double *in, Complex *out) const;
+
+  /**
+   * Writes the n real values whose spectrum starts with the n/2 + 1 values
+   * in into out. in is not modified.
+   */
+  void inverse(const Complex *in, double *out) const;
+
+private:
+  size_t n;
+  FFTPlan half;
+  std::vector<Complex> twiddles; ///< exp(-2 pi i k/n), k = 0..n/2
+
+}; // class RealFFTPlan
+
+/**
+ * Two-dimensional transforms of width x height values stored row by row.
+ * The rows are transformed in parallel, the array is transposed in cache
+ * sized blocks so that the columns become contiguous, transformed in
+ * parallel, and transposed back.
+ */
+class FFTPlan2D {
+public:
+  /**
+   * Constructor.
+   * Plans transforms of width x height values.
+   */
+  FFTPlan2D(size_t width = 1, size_t height = 1);
+
+  inline size_t width(void) const { return rows.size(); }
+  inline size_t height(void) const { return columns.size(); }
+
+  /**
+   * Transforms the width x height values in data in place.
+   */
+  void forward(Complex *data) const;
+  void inverse(Complex *data) const;
+
+private:
+  void run(Complex *data, bool inverse) const;
+
+  FFTPlan rows;    ///< transforms of length width
+  FFTPlan columns; ///< transforms of length height
+
+}; // class FFTPlan2D
+
+/**
+ * Writes the transpose of the rows x cols array in (stored row by row)
+ * into out, in square blocks that fit in the cache.
+ * REQUIRES: in and out do not overlap.
+ */
+void transpose(const Complex *in, Complex *out, size_t rows, size_t cols);
+
+} // namespace CMU462
+
+#endif // CMU462_FFT_H
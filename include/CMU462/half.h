@@ -0,0 +1,146 @@
+#ifndef CMU462_HALF_H
+#define CMU462_HALF_H
+
+#include "CMU462.h"
+#include "vector3D.h"
+#include "color.h"
+#include "spectrum.h"
+
+#include <cstddef>
+#include <cstring>
+#include <stdint.h>
+
+namespace CMU462 {
+
+/**
+ * IEEE 754 binary16 conversions. Rounding is to nearest even; overflow
+ * gives infinity, results below the normal range give subnormals and NaN
+ * gives a quiet NaN.
+ */
+inline uint16_t floatToHalf(float f) {
+  uint32_t u;
+  memcpy(&u, &f, 4);
+  uint32_t sign = u & 0x80000000u;
+  u ^= sign;
+
+  uint32_t h;
+  if (u >= 0x47800000u) {
+    // too large for a half: infinity, or NaN
+    h = u > 0x7F800000u ? 0x7E00 : 0x7C00;
+  } else if (u < 0x38800000u) {
+    // subnormal (or zero): adding 0.5 shifts the mantissa into place and
+    // rounds it
+    float s;
+    memcpy(&s, &u, 4);
+    s += 0.5f;
+    memcpy(&h, &s, 4);
+    h -= 0x3F000000u;
+  } else {
+    // normal: rebias the exponent and round the mantissa to 10 bits
+    uint32_t odd = (u >> 13) & 1;
+    h = (u + 0xC8000FFFu + odd) >> 13;
+  }
+  return (uint16_t)(h | sign >> 16);
+}
+
+inline float halfToFloat(uint16_t h) {
+  // scaling by 2^112 rebiases normals and normalizes subnormals
+  uint32_t u = (uint32_t)(h & 0x7FFF) << 13;
+  float f;
+  memcpy(&f, &u, 4);
+  f *= 5.192296858534828e+33f;
+  memcpy(&u, &f, 4);
+  if ((h & 0x7FFF) > 0x7BFF) u |= 0x7F800000u; // infinity or NaN
+  u |= (uint32_t)(h & 0x8000) << 16;
+  memcpy(&f, &u, 4);
+  return f;
+}
+
+/**
+ * Half precision (binary16) float, for storage: 11 bits of precision and
+ * a range of about 6e-8 to 65504. Converts to and from float; arithmetic
+ * happens in float.
+ */
+class half {
+public:
+  uint16_t bits; ///< binary16 encoding
+
+  /**
+   * Constructor.
+   * Initializes to zero.
+   */
+  half() : bits(0) {}
+
+  /**
+   * Constructor.
+   * Initializes to f, rounded to nearest.
+   */
+  half(float f) : bits(floatToHalf(f)) {}
+
+  /**
+   * Returns the half with the given encoding.
+   */
+  static inline half fromBits(uint16_t bits) {
+    half h;
+    h.bits = bits;
+    return h;
+  }
+
+  // conversion to float (exact)
+  inline operator float() const { return halfToFloat(bits); }
+
+}; // class half
+
+/**
+ * Three halves, the storage for a Vector3D (vertex attributes) or a
+ * Spectrum (HDR images) at rest: 6 bytes instead of 24 or 12.
+ */
+struct Vector3h {
+  half x, y, z;
+
+  Vector3h() {}
+  Vector3h(half x, half y, half z) : x(x), y(y), z(z) {}
+  explicit Vector3h(const Vector3D &v)
+      : x((float)v.x), y((float)v.y), z((float)v.z) {}
+  explicit Vector3h(const Spectrum &s) : x(s.r), y(s.g), z(s.b) {}
+
+  inline Vector3D toVector3D(void) const { return Vector3D(x, y, z); }
+  inline Spectrum toSpectrum(void) const { return Spectrum(x, y, z); }
+};
+
+/**
+ * Four halves, the storage for a Color at rest: 8 bytes instead of 16.
+ */
+struct Color4h {
+  half r, g, b, a;
+
+  Color4h() {}
+  Color4h(half r, half g, half b, half a) : r(r), g(g), b(b), a(a) {}
+  explicit Color4h(const Color &c) : r(c.r), g(c.g), b(c.b), a(c.a) {}
+
+  inline Color toColor(void) const { return Color(r, g, b, a); }
+};
+
+/**
+ * Bulk conversions of n values (or vectors, colors) to and from halves.
+ *
+ * These are dispatched to the F16C instructions at the AVX2 level (see
+ * simd.h), or to an SSE2 emulation, and large arrays are converted in
+ * parallel blocks. All levels give the same results, except for the
+ * payloads of NaNs. Doubles are rounded to float first.
+ */
+void toHalf(const float *in, half *out, size_t n);
+void toHalf(const double *in, half *out, size_t n);
+void fromHalf(const half *in, float *out, size_t n);
+void fromHalf(const half *in, double *out, size_t n);
+
+void toHalf(const Vector3D *in, Vector3h *out, size_t n);
+void fromHalf(const Vector3h *in, Vector3D *out, size_t n);
+void toHalf(const Spectrum *in, Vector3h *out, size_t n);
+void fromHalf(const Vector3h *in, Spectrum *out, size_t n);
+void toHalf(const Color *in, Color4h *out, size_t n);
+void fromHalf(const Color4h *in, Color *out, size_t n);
+
+} // namespace CMU462
+
+#endif // CMU462_HALF_H
@@ -0,0 +1,78 @@
+#ifndef CMU462_INTERSECT_H
+#define CMU462_INTERSECT_H
+
+#include "CMU462.h"
+#include "vector3D.h"
+#include "ray.h"
+#include "bbox.h"
+
+#include <cmath>
+
+namespace CMU462 {
+
+/**
+ * Ray intersection kernels: slab tests against a BBox and Moller-Trumbore
+ * tests against a triangle, for one ray and for packets of 4 or 8 rays.
+ *
+ * The packet versions test all rays of the packet against the same box or
+ * triangle, dispatched at runtime to the widest instruction set available
+ * (see simd.h; two or four rays per instruction). They return a bit mask
+ * with bit k set if ray k hits, and write their outputs only for those
+ * rays, so that the outputs of successive tests accumulate.
+ */
+
+/**
+ * Moller-Trumbore test of r against the triangle (p0, p1, p2), from both
+ * sides. Returns true if r hits it at some r.minT <= t <= r.maxT, and
+ * then sets t and the barycentric coordinates (u, v) of the hit point
+ * (1 - u - v) p0 + u p1 + v p2.
+ */
+inline bool intersectTriangle(const Ray &r, const Vector3D &p0,
+                              const Vector3D &p1, const Vector3D &p2,
+                              double &t, double &u, double &v) {
+  Vector3D e1 = p1 - p0, e2 = p2 - p0;
+  Vector3D p = cross(r.d, e2);
+  double det = dot(e1, p);
+  if (det == 0) return false;
+
+  double inv = 1 / det;
+  Vector3D s = r.o - p0;
+  double hu = dot(s, p) * inv;
+  Vector3D q = cross(s, e1);
+  double hv = dot(r.d, q) * inv;
+  double ht = dot(e2, q) * inv;
+  if (!(hu >= 0 && hv >= 0 && hu + hv <= 1 && ht >= r.minT && ht <= r.maxT))
+    return false;
+
+  t = ht;
+  u = hu;
+  v = hv;
+  return true;
+}
+
+/**
+ * Slab tests of the rays of r against b, see BBox::intersect. If tEnter is
+ * not NULL, writes the parameter at which ray k enters the box (clamped
+ * to r.minT[k]) into tEnter[k] for the rays that hit, for front to back
+ * traversal.
+ */
+int intersect(const BBox &b, const RayPacket4 &r, double *tEnter = NULL);
+int intersect(const BBox &b, const RayPacket8 &r, double *tEnter = NULL);
+
+/**
+ * Moller-Trumbore tests of the rays of r against the triangle (p0, p1,
+ * p2), see intersectTriangle(). For the rays k that hit, writes the hit
+ * parameter into t[k] and the barycentric coordinates into u[k], v[k]
+ * (u and v may be NULL). t may be r.maxT, which then keeps the closest
+ * hit over successive triangles.
+ */
+int intersectTriangle(const RayPacket4 &r, const Vector3D &p0,
+                      const Vector3D &p1, const Vector3D &p2, double *t,
+                      double *u = NULL, double *v = NULL);
+int intersectTriangle(const RayPacket8 &r, const Vector3D &p0,
+                      const Vector3D &p1, const Vector3D &p2, double *t,
+                      double *u = NULL, double *v = NULL);
+
+} // namespace CMU462
+
+#endif // CMU462_INTERSECT_H
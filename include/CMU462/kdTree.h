@@ -0,0 +1,126 @@
+#ifndef CMU462_KDTREE_H
+#define CMU462_KDTREE_H
+
+#include "CMU462.h"
+#include "vector3D.h"
+
+#include <cmath>
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+namespace CMU462 {
+
+/**
+ * Static k-d tree over a Vector3D point cloud, for nearest neighbor and
+ * radius queries (photon maps, point cloud processing).
+ *
+ * The tree is implicit: the points are reordered so that the node over a
+ * range of points is its median point, split along the longest axis of
+ * the range's cell, with the two halves of the range as children. Ranges
+ * of at most 8 points are leaves and are scanned. Only the split axis of
+ * each median is stored, so the tree takes 29 bytes per point. Large
+ * ranges are split as parallel tasks (when built with OpenMP).
+ *
+ * Queries return the indices of the points in the array given to build().
+ * The single query versions are thread safe; the batched versions run the
+ * queries in parallel.
+ */
+class KdTree {
+public:
+  /**
+   * Index of the missing neighbors of knn() when fewer than k are found.
+   */
+  static const uint32_t kNone = 0xFFFFFFFF;
+
+  /**
+   * Constructor.
+   * Initializes to the empty tree.
+   */
+  KdTree() {}
+
+  /**
+   * Constructor.
+   * Builds the tree over the n points, see build().
+   */
+  KdTree(const Vector3D *points, size_t n) { build(points, n); }
+
+  /**
+   * Builds the tree over the n points, which are copied.
+   */
+  void build(const Vector3D *points, size_t n);
+
+  /**
+   * Returns the number of points.
+   */
+  inline size_t size(void) const { return pts.size(); }
+
+  /**
+   * Finds the (at most) k points closest to q among those within
+   * sqrt(maxDist2) of it. Writes their indices and squared distances to
+   * q into indices and dist2, closest first, and returns how many were
+   * found.
+   *
+   * With eps > 0 the search is approximate: subtrees are skipped unless
+   * they may contain a point closer than 1 / (1 + eps) times the current
+   * k-th distance, so the i-th point returned is at most (1 + eps) times
+   * farther than the true i-th nearest neighbor. This visits far fewer
+   * nodes in dense clouds.
+   */
+  size_t knn(const Vector3D &q, size_t k, uint32_t *indices, double *dist2,
+             double maxDist2 = INFINITY, double eps = 0) const;
+
+  /**
+   * Returns the index of the point closest to q (kNone if the tree is
+   * empty) and, if dist2 is not NULL, its squared distance to q. See
+   * knn() for eps.
+   */
+  uint32_t nearest(const Vector3D &q, double *dist2 = NULL,
+                   double eps = 0) const;
+
+  /**
+   * Replaces the contents of indices with the indices of the points within
+   * distance r of q (boundary included), in no particular order, and
+   * returns their number.
+   */
+  size_t radius(const Vector3D &q, double r,
+                std::vector<uint32_t> &indices) const;
+
+  /**
+   * Batched knn(): the k neighbors of query i go to indices[i * k + j] and
+   * dist2[i * k + j], closest first; missing neighbors have index kNone
+   * and squared distance infinity. dist2 may be NULL.
+   */
+  void knn(const Vector3D *queries, size_t m, size_t k, uint32_t *indices,
+           double *dist2, double maxDist2 = INFINITY, double eps = 0) const;
+
+  /**
+   * Batched radius(): the neighbors of query i are
+   * indices[offsets[i]] to indices[offsets[i + 1] - 1]; offsets gets m + 1
+   * entries.
+   */
+  void radius(const Vector3D *queries, size_t m, double r,
+              std::vector<size_t> &offsets,
+              std::vector<uint32_t> &indices) const;
+
+  /**
+   * Returns the points in tree order.
+   */
+  inline const std::vector<Vector3D> &points(void) const { return pts; }
+
+  /**
+   * Returns the indices of the points in tree order, i.e. points()[i] is
+   * the point given to build() at index indices()[i].
+   */
+  inline const std::vector<uint32_t> &indices(void) const { return ids; }
+
+private:
+  std::vector<Vector3D> pts;
+  std::vector<uint32_t> ids;
+  std::vector<uint8_t> axes; ///< split axis of each median
+
+}; // class KdTree
+
+} // namespace CMU462
+
+#endif // CMU462_KDTREE_H
@@ -10,19 +10,40 @@
 namespace CMU462 {
 
 /**
- * Defines a 3x3 matrix.
+ * Defines a 3x3 matrix over the scalar type S.
+ * Matrix3x3 (double) and Matrix3x3f (float) are the instantiated types.
+ * (The parameter is not called T since T() is the transpose.)
+ *
+ * Element access and arithmetic are defined inline, most of them as
+ * constexpr, see BasicMatrix4x4.
  */
-class Matrix3x3 {
+template <typename S>
+class BasicMatrix3x3 {
 
   public:
 
+  typedef S Scalar;
+
   // The default constructor.
-  Matrix3x3(void) { }
+  BasicMatrix3x3(void) { }
+
+  // Constructor from the three columns.
+  constexpr BasicMatrix3x3( const BasicVector3D<S>& c0,
+                            const BasicVector3D<S>& c1,
+                            const BasicVector3D<S>& c2 )
+    : entries{ c0, c1, c2 } { }
+
+  // Converts from a matrix of another scalar type.
+  template <typename U>
+  constexpr explicit BasicMatrix3x3( const BasicMatrix3x3<U>& M )
+    : entries{ BasicVector3D<S>( M.column(0) ),
+               BasicVector3D<S>( M.column(1) ),
+               BasicVector3D<S>( M.column(2) ) } { }
 
   // Constructor for row major form data.
   // Transposes to the internal column major form.
   // REQUIRES: data should be of size 9 for a 3 by 3 matrix..
-  Matrix3x3(double * data)
+  BasicMatrix3x3(S * data)
   {
     for( int i = 0; i < 3; i++ ) {
       for( int j = 0; j < 3; j++ ) {
@@ -35,107 +56,158 @@ class Matrix3x3 {
   /**
    * Sets all elements to val.
    */
-  void zero(double val = 0.0 );
+  inline void zero( S val = 0 ) {
+    entries[0] = entries[1] = entries[2] = BasicVector3D<S>( val, val, val );
+  }
 
   /**
    * Returns the determinant of A.
    */
-  double det( void ) const;
+  S det( void ) const;
 
   /**
    * Returns the Frobenius norm of A.
    */
-  double norm( void ) const;
+  S norm( void ) const;
 
   /**
    * Returns the 3x3 identity matrix.
    */
-  static Matrix3x3 identity( void );
+  static constexpr BasicMatrix3x3 identity( void ) {
+    return BasicMatrix3x3( BasicVector3D<S>( 1, 0, 0 ),
+                           BasicVector3D<S>( 0, 1, 0 ),
+                           BasicVector3D<S>( 0, 0, 1 ) );
+  }
 
   /**
    * Returns matrix encoding a 2D counter-clockwise rotation by the angle theta in homogeneous coordinates. The angle is given in Radians.
    */
-  static Matrix3x3 rotation( double theta );
+  static BasicMatrix3x3 rotation( S theta );
 
   /**
    * Returns matrix encoding 2D translation by the vector t in homogeneous coordinates.
    */
-  static Matrix3x3 translation( Vector2D t );
+  static BasicMatrix3x3 translation( BasicVector2D<S> t );
 
   /**
    * Returns a matrix representing the (left) cross product with u.
    */
-  static Matrix3x3 crossProduct( const Vector3D& u );
+  static BasicMatrix3x3 crossProduct( const BasicVector3D<S>& u );
 
   /**
    * Assuming this matrix represents a 2D homogeneous transformation,
    * returns the rotation it encodes as an angle in radians.
    */
-  double getRotation( void ) const;
+  S getRotation( void ) const;
 
   /**
    * Returns the ith column.
    */
-        Vector3D& column( int i );
-  const Vector3D& column( int i ) const;
+  inline BasicVector3D<S>& column( int i ) { return entries[i]; }
+  constexpr const BasicVector3D<S>& column( int i ) const {
+    return entries[i];
+  }
 
   /**
    * Returns the transpose of A.
    */
-  Matrix3x3 T( void ) const;
+  constexpr BasicMatrix3x3 T( void ) const {
+    return BasicMatrix3x3(
+      BasicVector3D<S>( entries[0].x, entries[1].x, entries[2].x ),
+      BasicVector3D<S>( entries[0].y, entries[1].y, entries[2].y ),
+      BasicVector3D<S>( entries[0].z, entries[1].z, entries[2].z ) );
+  }
 
   /**
    * Returns the inverse of A.
    */
-  Matrix3x3 inv( void ) const;
+  BasicMatrix3x3 inv( void ) const;
 
   // accesses element (i,j) of A using 0-based indexing
-        double& operator()( int i, int j );
-  const double& operator()( int i, int j ) const;
+  inline       S& operator()( int i, int j )       { return entries[j][i]; }
+  inline const S& operator()( int i, int j ) const { return entries[j][i]; }
 
   // accesses the ith column of A
-        Vector3D& operator[]( int i );
-  const Vector3D& operator[]( int i ) const;
+  inline BasicVector3D<S>& operator[]( int j ) { return entries[j]; }
+  constexpr const BasicVector3D<S>& operator[]( int j ) const {
+    return entries[j];
+  }
 
   // increments by B
-  void operator+=( const Matrix3x3& B );
+  inline void operator+=( const BasicMatrix3x3& B ) {
+    entries[0] += B.entries[0];
+    entries[1] += B.entries[1];
+    entries[2] += B.entries[2];
+  }
 
   // returns -A
-  Matrix3x3 operator-( void ) const;
+  constexpr BasicMatrix3x3 operator-( void ) const {
+    return BasicMatrix3x3( -entries[0], -entries[1], -entries[2] );
+  }
 
   // returns A+B
-  Matrix3x3 operator+( const Matrix3x3& B ) const;
+  constexpr BasicMatrix3x3 operator+( const BasicMatrix3x3& B ) const {
+    return BasicMatrix3x3( entries[0] + B.entries[0],
+                           entries[1] + B.entries[1],
+                           entries[2] + B.entries[2] );
+  }
 
   // returns A-B
-  Matrix3x3 operator-( const Matrix3x3& B ) const;
+  constexpr BasicMatrix3x3 operator-( const BasicMatrix3x3& B ) const {
+    return BasicMatrix3x3( entries[0] - B.entries[0],
+                           entries[1] - B.entries[1],
+                           entries[2] - B.entries[2] );
+  }
 
   // returns c*A
-  Matrix3x3 operator*( double c ) const;
+  constexpr BasicMatrix3x3 operator*( S c ) const {
+    return BasicMatrix3x3( entries[0] * c, entries[1] * c, entries[2] * c );
+  }
 
-  // returns A*B
-  Matrix3x3 operator*( const Matrix3x3& B ) const;
+  // returns A*B, one column of B at a time
+  constexpr BasicMatrix3x3 operator*( const BasicMatrix3x3& B ) const {
+    return BasicMatrix3x3( (*this) * B.entries[0],
+                           (*this) * B.entries[1],
+                           (*this) * B.entries[2] );
+  }
 
   // returns A*x
-  Vector3D operator*( const Vector3D& x ) const;
+  constexpr BasicVector3D<S> operator*( const BasicVector3D<S>& x ) const {
+    return x.x * entries[0] + x.y * entries[1] + x.z * entries[2];
+  }
 
   // divides each element by x
-  void operator/=( double x );
+  inline void operator/=( S x ) {
+    S rx = S(1) / x;
+    entries[0] *= rx;
+    entries[1] *= rx;
+    entries[2] *= rx;
+  }
 
   protected:
 
   // column vectors
-  Vector3D entries[3];
+  BasicVector3D<S> entries[3];
 
-}; // class Matrix3x3
+}; // class BasicMatrix3x3
 
 // returns the outer product of u and v
-Matrix3x3 outer( const Vector3D& u, const Vector3D& v );
+template <typename S>
+constexpr BasicMatrix3x3<S> outer( const BasicVector3D<S>& u,
+                                   const BasicVector3D<S>& v ) {
+  return BasicMatrix3x3<S>( u * v.x, u * v.y, u * v.z );
+}
 
 // returns c*A
-Matrix3x3 operator*( double c, const Matrix3x3& A );
+template <typename S>
+constexpr BasicMatrix3x3<S> operator*( typename BasicMatrix3x3<S>::Scalar c,
+                                       const BasicMatrix3x3<S>& A ) {
+  return BasicMatrix3x3<S>( c * A[0], c * A[1], c * A[2] );
+}
 
 // prints entries
-std::ostream& operator<<( std::ostream& os, const Matrix3x3& A );
+template <typename S>
+std::ostream& operator<<( std::ostream& os, const BasicMatrix3x3<S>& A );
 
 } // namespace CMU462
 
@@ -4,23 +4,47 @@
 #include "CMU462.h"
 #include "vector4D.h"
 
+#include <cstddef>
 #include <iosfwd>
 
 namespace CMU462 {
 
 /**
- * Defines a 4x4 matrix.
+ * Defines a 4x4 matrix over the scalar type S.
+ * Matrix4x4 (double) and Matrix4x4f (float) are the instantiated types.
+ * (The parameter is not called T since T() is the transpose.)
+ *
+ * Element access and arithmetic are defined inline below, most of them as
+ * constexpr, so that transform chains compile to straight-line code and
+ * matrices built from constants can be folded at compile time.
  */
-class Matrix4x4 {
+template <typename S>
+class BasicMatrix4x4 {
 
 public:
+  typedef S Scalar;
+
   // The default constructor.
-  Matrix4x4(void) {}
+  BasicMatrix4x4(void) {}
+
+  // Constructor from the four columns.
+  constexpr BasicMatrix4x4(const BasicVector4D<S> &c0,
+                           const BasicVector4D<S> &c1,
+                           const BasicVector4D<S> &c2,
+                           const BasicVector4D<S> &c3)
+      : entries{c0, c1, c2, c3} {}
+
+  // Converts from a matrix of another scalar type.
+  template <typename U>
+  constexpr explicit BasicMatrix4x4(const BasicMatrix4x4<U> &M)
+      : entries{BasicVector4D<S>(M.column(0)), BasicVector4D<S>(M.column(1)),
+                BasicVector4D<S>(M.column(2)),
+                BasicVector4D<S>(M.column(3))} {}
 
   // Constructor for row major form data.
   // Transposes to the internal column major form.
   // REQUIRES: data should be of size 16.
-  Matrix4x4(double *data) {
+  BasicMatrix4x4(S *data) {
     for (int i = 0; i < 4; i++)
       for (int j = 0; j < 4; j++) {
         // Transpostion happens within the () query.
@@ -31,89 +55,203 @@ public:
   /**
    * Sets all elements to val.
    */
-  void zero(double val = 0.0);
+  inline void zero(S val = 0) {
+    entries[0] = entries[1] = entries[2] = entries[3] =
+        BasicVector4D<S>(val, val, val, val);
+  }
 
   /**
    * Returns the determinant of A.
+   * Uses SIMD when the CPU supports it (see simd.h).
    */
-  double det(void) const;
+  S det(void) const;
 
   /**
    * Returns the Frobenius norm of A.
    */
-  double norm(void) const;
+  S norm(void) const;
 
   /**
    * Returns a fresh 4x4 identity matrix.
    */
-  static Matrix4x4 identity(void);
+  static constexpr BasicMatrix4x4 identity(void) {
+    return BasicMatrix4x4(BasicVector4D<S>(1, 0, 0, 0),
+                          BasicVector4D<S>(0, 1, 0, 0),
+                          BasicVector4D<S>(0, 0, 1, 0),
+                          BasicVector4D<S>(0, 0, 0, 1));
+  }
 
   // No Cross products for 4 by 4 matrix.
 
   /**
    * Returns the ith column.
    */
-  Vector4D &column(int i);
-  const Vector4D &column(int i) const;
+  inline BasicVector4D<S> &column(int i) { return entries[i]; }
+  constexpr const BasicVector4D<S> &column(int i) const { return entries[i]; }
 
   /**
    * Returns the transpose of A.
    */
-  Matrix4x4 T(void) const;
+  constexpr BasicMatrix4x4 T(void) const {
+    return BasicMatrix4x4(
+        BasicVector4D<S>(entries[0].x, entries[1].x, entries[2].x,
+                         entries[3].x),
+        BasicVector4D<S>(entries[0].y, entries[1].y, entries[2].y,
+                         entries[3].y),
+        BasicVector4D<S>(entries[0].z, entries[1].z, entries[2].z,
+                         entries[3].z),
+        BasicVector4D<S>(entries[0].w, entries[1].w, entries[2].w,
+                         entries[3].w));
+  }
 
   /**
    * Returns the inverse of A.
+   * Uses SIMD when the CPU supports it (see simd.h).
    */
-  Matrix4x4 inv(void) const;
+  BasicMatrix4x4 inv(void) const;
 
   // accesses element (i,j) of A using 0-based indexing
   // where (i, j) is (row, column).
-  double &operator()(int i, int j);
-  const double &operator()(int i, int j) const;
+  inline S &operator()(int i, int j) { return entries[j][i]; }
+  inline const S &operator()(int i, int j) const { return entries[j][i]; }
 
   // accesses the ith column of A
-  Vector4D &operator[](int i);
-  const Vector4D &operator[](int i) const;
+  inline BasicVector4D<S> &operator[](int j) { return entries[j]; }
+  constexpr const BasicVector4D<S> &operator[](int j) const {
+    return entries[j];
+  }
 
   // increments by B
-  void operator+=(const Matrix4x4 &B);
+  inline void operator+=(const BasicMatrix4x4 &B) {
+    entries[0] += B.entries[0];
+    entries[1] += B.entries[1];
+    entries[2] += B.entries[2];
+    entries[3] += B.entries[3];
+  }
 
   // returns -A
-  Matrix4x4 operator-(void) const;
+  constexpr BasicMatrix4x4 operator-(void) const {
+    return BasicMatrix4x4(-entries[0], -entries[1], -entries[2], -entries[3]);
+  }
 
   // returns A+B
-  Matrix4x4 operator+(const Matrix4x4 &B) const;
+  constexpr BasicMatrix4x4 operator+(const BasicMatrix4x4 &B) const {
+    return BasicMatrix4x4(entries[0] + B.entries[0], entries[1] + B.entries[1],
+                          entries[2] + B.entries[2], entries[3] + B.entries[3]);
+  }
 
   // returns A-B
-  Matrix4x4 operator-(const Matrix4x4 &B) const;
+  constexpr BasicMatrix4x4 operator-(const BasicMatrix4x4 &B) const {
+    return BasicMatrix4x4(entries[0] - B.entries[0], entries[1] - B.entries[1],
+                          entries[2] - B.entries[2], entries[3] - B.entries[3]);
+  }
 
   // returns c*A
-  Matrix4x4 operator*(double c) const;
+  constexpr BasicMatrix4x4 operator*(S c) const {
+    return BasicMatrix4x4(entries[0] * c, entries[1] * c, entries[2] * c,
+                          entries[3] * c);
+  }
 
-  // returns A*B
-  Matrix4x4 operator*(const Matrix4x4 &B) const;
+  // returns A*B, one column of B at a time
+  constexpr BasicMatrix4x4 operator*(const BasicMatrix4x4 &B) const {
+    return BasicMatrix4x4((*this) * B.entries[0], (*this) * B.entries[1],
+                          (*this) * B.entries[2], (*this) * B.entries[3]);
+  }
 
   // returns A*x
-  Vector4D operator*(const Vector4D &x) const;
+  constexpr BasicVector4D<S> operator*(const BasicVector4D<S> &x) const {
+    return x.x * entries[0] + // Add up products for each matrix column.
+           x.y * entries[1] + x.z * entries[2] + x.w * entries[3];
+  }
 
   // divides each element by x
-  void operator/=(double x);
+  inline void operator/=(S x) {
+    S rx = S(1) / x;
+    entries[0] *= rx;
+    entries[1] *= rx;
+    entries[2] *= rx;
+    entries[3] *= rx;
+  }
 
 protected:
 
   // 4 by 4 matrices are represented by an array of 4 column vectors.
-  Vector4D entries[4];
+  BasicVector4D<S> entries[4];
 
-}; // class Matrix3x3
+}; // class BasicMatrix4x4
 
 // returns the outer product of u and v.
-Matrix4x4 outer(const Vector4D &u, const Vector4D &v);
+template <typename S>
+constexpr BasicMatrix4x4<S> outer(const BasicVector4D<S> &u,
+                                  const BasicVector4D<S> &v) {
+  return BasicMatrix4x4<S>(u * v.x, u * v.y, u * v.z, u * v.w);
+}
 
 // returns c*A
-Matrix4x4 operator*(double c, const Matrix4x4 &A);
+template <typename S>
+constexpr BasicMatrix4x4<S>
+operator*(typename BasicMatrix4x4<S>::Scalar c, const BasicMatrix4x4<S> &A) {
+  return BasicMatrix4x4<S>(c * A[0], c * A[1], c * A[2], c * A[3]);
+}
 
 // prints entries
-std::ostream &operator<<(std::ostream &os, const Matrix4x4 &A);
+template <typename S>
+std::ostream &operator<<(std::ostream &os, const BasicMatrix4x4<S> &A);
+
+/**
+ * Batch operations over arrays of n matrices, dispatched at runtime to the
+ * widest instruction set available (see simd.h). The output array may be
+ * the same as an input array.
+ */
+
+// C[k] = A[k] * B[k]
+void multiply(const Matrix4x4 *A, const Matrix4x4 *B, Matrix4x4 *C, size_t n);
+void multiply(const Matrix4x4f *A, const Matrix4x4f *B, Matrix4x4f *C,
+              size_t n);
+
+// B[k] = A[k].T()
+void transpose(const Matrix4x4 *A, Matrix4x4 *B, size_t n);
+void transpose(const Matrix4x4f *A, Matrix4x4f *B, size_t n);
+
+// B[k] = A[k].inv(), and det[k] = A[k].det() if det is not NULL
+void inverse(const Matrix4x4 *A, Matrix4x4 *B, size_t n, double *det = NULL);
+void inverse(const Matrix4x4f *A, Matrix4x4f *B, size_t n, float *det = NULL);
+
+// det[k] = A[k].det()
+void det(const Matrix4x4 *A, double *det, size_t n);
+void det(const Matrix4x4f *A, float *det, size_t n);
+
+/**
+ * Batch transforms of n contiguous vectors by M, vectorized and split
+ * across threads for large n. out may be the same array as in.
+ */
+
+// out[k] = M * (in[k], 1), i.e. in[k] as a point; w of the result is
+// dropped, so M should be affine (use transform() for projections)
+void transformPoints(const Matrix4x4 &M, const Vector3D *in, Vector3D *out,
+                     size_t n);
+void transformPoints(const Matrix4x4f &M, const Vector3f *in, Vector3f *out,
+                     size_t n);
+
+// out[k] = M * (in[k], 0), i.e. in[k] as a direction
+void transformVectors(const Matrix4x4 &M, const Vector3D *in, Vector3D *out,
+                      size_t n);
+void transformVectors(const Matrix4x4f &M, const Vector3f *in, Vector3f *out,
+                      size_t n);
+
+// out[k] = N * in[k], where N is the inverse transpose of the upper left
+// 3x3 block of M. The results are not renormalized.
+void transformNormals(const Matrix4x4 &M, const Vector3D *in, Vector3D *out,
+                      size_t n);
+void transformNormals(const Matrix4x4f &M, const Vector3f *in, Vector3f *out,
+                      size_t n);
+
+// out[k] = M * in[k]; with perspectiveDivide, x, y and z of the result are
+// divided by its w (w itself is kept, e.g. for perspective correction)
+void transform(const Matrix4x4 &M, const Vector4D *in, Vector4D *out,
+               size_t n, bool perspectiveDivide = false);
+void transform(const Matrix4x4f &M, const Vector4f *in, Vector4f *out,
+               size_t n, bool perspectiveDivide = false);
 
 } // namespace CMU462
 
@@ -0,0 +1,96 @@
+#ifndef CMU462_MORTON_H
+#define CMU462_MORTON_H
+
+#include "CMU462.h"
+#include "vector3D.h"
+#include "bbox.h"
+
+#include <cstddef>
+#include <stdint.h>
+
+namespace CMU462 {
+
+/**
+ * Morton (Z-order) codes and radix sorting, the building blocks of the
+ * linear BVH build (see BVH::buildLinear) and of other spatial sorts.
+ *
+ * A Morton code interleaves the bits of the quantized x, y and z
+ * coordinates of a point, x in the highest bit of each triple, so that
+ * sorting points by code orders them along a space filling curve.
+ */
+
+/**
+ * Spreads the low 10 bits of v so that bit k moves to bit 3k.
+ */
+inline uint32_t mortonSpread10(uint32_t v) {
+  v &= 0x3FF;
+  v = (v | (v << 16)) & 0x030000FF;
+  v = (v | (v << 8)) & 0x0300F00F;
+  v = (v | (v << 4)) & 0x030C30C3;
+  v = (v | (v << 2)) & 0x09249249;
+  return v;
+}
+
+/**
+ * Spreads the low 21 bits of v so that bit k moves to bit 3k.
+ */
+inline uint64_t mortonSpread21(uint64_t v) {
+  v &= 0x1FFFFF;
+  v = (v | (v << 32)) & 0x001F00000000FFFFull;
+  v = (v | (v << 16)) & 0x001F0000FF0000FFull;
+  v = (v | (v << 8)) & 0x100F00F00F00F00Full;
+  v = (v | (v << 4)) & 0x10C30C30C30C30C3ull;
+  v = (v | (v << 2)) & 0x1249249249249249ull;
+  return v;
+}
+
+/**
+ * Returns the 30-bit Morton code of p in [0, 1]^3 (10 bits per axis).
+ * Coordinates outside [0, 1] are clamped.
+ */
+inline uint32_t morton30(const Vector3D &p) {
+  uint32_t q[3];
+  for (int a = 0; a < 3; a++) {
+    double s = p[a] * 1024;
+    q[a] = s <= 0 ? 0 : s >= 1023 ? 1023 : (uint32_t)s;
+  }
+  return (mortonSpread10(q[0]) << 2) | (mortonSpread10(q[1]) << 1) |
+         mortonSpread10(q[2]);
+}
+
+/**
+ * Returns the 63-bit Morton code of p in [0, 1]^3 (21 bits per axis).
+ * Coordinates outside [0, 1] are clamped.
+ */
+inline uint64_t morton63(const Vector3D &p) {
+  uint64_t q[3];
+  for (int a = 0; a < 3; a++) {
+    double s = p[a] * 2097152;
+    q[a] = s <= 0 ? 0 : s >= 2097151 ? 2097151 : (uint64_t)s;
+  }
+  return (mortonSpread21(q[0]) << 2) | (mortonSpread21(q[1]) << 1) |
+         mortonSpread21(q[2]);
+}
+
+/**
+ * Writes the Morton codes of the n points, relative to bounds (which
+ * maps to [0, 1]^3; flat axes map to 0), into codes. Runs in parallel.
+ */
+void mortonCodes(const Vector3D *points, size_t n, const BBox &bounds,
+                 uint32_t *codes);
+void mortonCodes(const Vector3D *points, size_t n, const BBox &bounds,
+                 uint64_t *codes);
+
+/**
+ * Sorts the n keys in increasing order and permutes values along with
+ * them; equal keys keep their order. This is an LSD radix sort over 8-bit
+ * digits with per-block histograms, so the blocks are counted and
+ * scattered in parallel, and digits shared by all keys are skipped (the
+ * top bits of Morton codes, for instance).
+ */
+void radixSort(uint32_t *keys, uint32_t *values, size_t n);
+void radixSort(uint64_t *keys, uint32_t *values, size_t n);
+
+} // namespace CMU462
+
+#endif // CMU462_MORTON_H
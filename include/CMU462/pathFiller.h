@@ -0,0 +1,103 @@
+#ifndef CMU462_PATHFILLER_H
+#define CMU462_PATHFILLER_H
+
+#include "CMU462.h"
+#include "color.h"
+#include "vector2D.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace CMU462 {
+
+/**
+ * Scanline filler for polygons and flattened paths (SVG-style 2D
+ * drawing), with antialiasing by the exact area each pixel covers.
+ *
+ * A path is a set of closed contours of line segments, in pixel
+ * coordinates: pixel (x, y) is the unit square [x, x + 1] x [y, y + 1], and
+ * row 0 is the first row of the image. fill() sweeps the rows through an
+ * active edge table and accumulates, for every pixel an edge crosses, the
+ * signed area and the winding it adds; a running sum along the row then
+ * gives the winding number integrated over each pixel, to which the fill
+ * rule applies. Only pixels that edges cross are visited one by one; the
+ * runs between them have a constant coverage and are filled as spans, so
+ * the cost is proportional to the perimeter plus the filled area, with no
+ * samples per pixel. Coverage is exact wherever the winding number within
+ * a pixel is 0 or 1 (or 0 and ±1 for the nonzero rule), which excludes
+ * only pixels where contours overlap themselves or each other.
+ */
+class PathFiller {
+public:
+  /**
+   * Which points are inside a path, from its winding number around them.
+   */
+  enum FillRule {
+    NONZERO, ///< inside when the winding number is not zero
+    EVEN_ODD ///< inside when the winding number is odd
+  };
+
+  /**
+   * Constructor.
+   * Initializes an empty path.
+   */
+  PathFiller() : open(false) {}
+
+  /**
+   * Removes all contours.
+   */
+  void clear(void);
+
+  /**
+   * Starts a new contour at p, closing the current one.
+   */
+  void moveTo(const Vector2D &p);
+
+  /**
+   * Adds a segment from the current point to p.
+   * REQUIRES: a contour was started with moveTo().
+   */
+  void lineTo(const Vector2D &p);
+
+  /**
+   * Closes the current contour with a segment back to its first point.
+   * fill() closes contours that are still open the same way.
+   */
+  void close(void);
+
+  /**
+   * Adds a closed contour through the n points.
+   */
+  void addPolygon(const Vector2D *points, size_t n);
+
+  /**
+   * Composites color, weighted by the coverage of each pixel, over a
+   * width x height image stored row by row, both not premultiplied:
+   * with alpha = color.a * coverage, dst.rgb becomes
+   * color.rgb * alpha + dst.rgb * (1 - alpha) and dst.a becomes
+   * alpha + dst.a * (1 - alpha). Parts of the path outside the image are
+   * clipped.
+   */
+  void fill(Color *image, size_t width, size_t height, const Color &color,
+            FillRule rule = NONZERO);
+
+private:
+  // a segment, in the direction it was drawn
+  struct Edge {
+    double x0, y0, x1, y1;
+  };
+
+  std::vector<Edge> edges; ///< segments of all contours
+  Vector2D first;          ///< first point of the current contour
+  Vector2D last;           ///< current point
+  bool open;               ///< the current contour needs closing
+
+  // scratch buffers of fill()
+  std::vector<const Edge *> sorted, active;
+  std::vector<float> cells;
+
+}; // class PathFiller
+
+} // namespace CMU462
+
+#endif // CMU462_PATHFILLER_H
@@ -9,49 +9,74 @@
 
 namespace CMU462 {
 
-class Quaternion : public Vector4D {
+/**
+ * Defines quaternions over the scalar type T, stored as (x,y,z,w) with w
+ * the real part. Quaternion (double) and Quaternionf (float) are the
+ * instantiated types.
+ */
+template <typename T>
+class BasicQuaternion : public BasicVector4D<T> {
 public:
+  using BasicVector4D<T>::x;
+  using BasicVector4D<T>::y;
+  using BasicVector4D<T>::z;
+  using BasicVector4D<T>::w;
+  using BasicVector4D<T>::norm;
+  using BasicVector4D<T>::unit;
+  using BasicVector4D<T>::normalize;
+
   /**
    * Constructor.
    * Initializes to 0,0,0,1
    */
-  Quaternion() : Vector4D(0.0, 0.0, 0.0, 1.0) {}
+  BasicQuaternion() : BasicVector4D<T>(0, 0, 0, 1) {}
 
   /**
    * Construct from 3D vector and w.
    */
-  Quaternion(const Vector3D &v, double w) : Vector4D(v.x, v.y, v.z, w) {}
+  BasicQuaternion(const BasicVector3D<T> &v, T w)
+      : BasicVector4D<T>(v.x, v.y, v.z, w) {}
+
+  BasicQuaternion(const BasicVector4D<T> &v)
+      : BasicVector4D<T>(v.x, v.y, v.z, v.w) {}
 
-  Quaternion(const Vector4D &v) : Vector4D(v.x, v.y, v.z, v.w) {}
+  BasicQuaternion(T x, T y, T z, T w) : BasicVector4D<T>(x, y, z, w) {}
 
-  Quaternion(double x, double y, double z, double w) : Vector4D(x, y, z, w) {}
+  /**
+   * Converts from a quaternion of another scalar type.
+   */
+  template <typename U>
+  constexpr explicit BasicQuaternion(const BasicQuaternion<U> &q)
+      : BasicVector4D<T>(T(q.x), T(q.y), T(q.z), T(q.w)) {}
 
   /**
    * Initializes a quaternion that represents a rotation about the given axis
    * and angle.
    */
-  void from_axis_angle(const Vector3D &axis, double radians) {
+  void from_axis_angle(const BasicVector3D<T> &axis, T radians) {
     radians /= 2;
-    const Vector3D &nAxis = axis.unit();
-    double sinTheta = sin(radians);
+    const BasicVector3D<T> &nAxis = axis.unit();
+    T sinTheta = std::sin(radians);
     x = sinTheta * nAxis.x;
     y = sinTheta * nAxis.y;
     z = sinTheta * nAxis.z;
-    w = cos(radians);
+    w = std::cos(radians);
     this->normalize();
   }
 
-  Vector3D complex() const { return Vector3D(x, y, z); }
-  void setComplex(const Vector3D &c) {
+  BasicVector3D<T> complex() const { return BasicVector3D<T>(x, y, z); }
+  void setComplex(const BasicVector3D<T> &c) {
     x = c.x;
     y = c.y;
     z = c.z;
   }
 
-  double real() const { return w; }
-  void setReal(double r) { w = r; }
+  T real() const { return w; }
+  void setReal(T r) { w = r; }
 
-  Quaternion conjugate(void) const { return Quaternion(-complex(), real()); }
+  BasicQuaternion conjugate(void) const {
+    return BasicQuaternion(-complex(), real());
+  }
 
   /**
    * @brief Computes the inverse of this quaternion.
@@ -63,7 +88,7 @@ public:
    * @return The quaternion q such that q * (*this) == (*this) * q
    * == [ 0 0 0 1 ]<sup>T</sup>.
    */
-  Quaternion inverse(void) const { return conjugate() / norm(); }
+  BasicQuaternion inverse(void) const { return conjugate() / norm(); }
 
   /**
    * @brief Computes the product of this quaternion with the
@@ -73,11 +98,11 @@ public:
    *
    * @return The quaternion product (*this) x @p rhs.
    */
-  Quaternion product(const Quaternion &rhs) const {
-    return Quaternion(y * rhs.z - z * rhs.y + x * rhs.w + w * rhs.x,
-                      z * rhs.x - x * rhs.z + y * rhs.w + w * rhs.y,
-                      x * rhs.y - y * rhs.x + z * rhs.w + w * rhs.z,
-                      w * rhs.w - x * rhs.x - y * rhs.y - z * rhs.z);
+  BasicQuaternion product(const BasicQuaternion &rhs) const {
+    return BasicQuaternion(y * rhs.z - z * rhs.y + x * rhs.w + w * rhs.x,
+                           z * rhs.x - x * rhs.z + y * rhs.w + w * rhs.y,
+                           x * rhs.y - y * rhs.x + z * rhs.w + w * rhs.z,
+                           w * rhs.w - x * rhs.x - y * rhs.y - z * rhs.z);
   }
 
   /**
@@ -96,7 +121,9 @@ public:
    *
    * @return The quaternion product (*this) x rhs.
    */
-  Quaternion operator*(const Quaternion &rhs) const { return product(rhs); }
+  BasicQuaternion operator*(const BasicQuaternion &rhs) const {
+    return product(rhs);
+  }
 
   /**
    * @brief Returns a matrix representation of this
@@ -109,11 +136,11 @@ public:
    * Note that this is @e NOT the rotation matrix that may be
    * represented by a unit quaternion.
    */
-  Matrix4x4 matrix() const {
+  BasicMatrix4x4<T> matrix() const {
 
-    double m[16] = {w, -z, y, x, z, w, -x, y, -y, x, w, z, -x, -y, -z, w};
+    T m[16] = {w, -z, y, x, z, w, -x, y, -y, x, w, z, -x, -y, -z, w};
 
-    return Matrix4x4(m);
+    return BasicMatrix4x4<T>(m);
   }
 
   /**
@@ -128,10 +155,10 @@ public:
    * Note that this is @e NOT the rotation matrix that may be
    * represented by a unit quaternion.
    */
-  Matrix4x4 rightMatrix() const {
-    double m[16] = {+w, -z, y, -x, +z, w, -x, -y, -y, x, w, -z, +x, y, z, w};
+  BasicMatrix4x4<T> rightMatrix() const {
+    T m[16] = {+w, -z, y, -x, +z, w, -x, -y, -y, x, w, -z, +x, y, z, w};
 
-    return Matrix4x4(m);
+    return BasicMatrix4x4<T>(m);
   }
 
   /**
@@ -139,7 +166,7 @@ public:
    *
    * This is simply the vector [x y z w]<sup>T</sup>
    */
-  Vector4D vector() const { return Vector4D(x, y, z, w); }
+  BasicVector4D<T> vector() const { return BasicVector4D<T>(x, y, z, w); }
 
   /**
    * @brief Computes the rotation matrix represented by a unit
@@ -149,31 +176,31 @@ public:
    * It formulaically returns the matrix, which will not be a
    * rotation if the quaternion is non-unit.
    */
-  Matrix3x3 rotationMatrix() const {
-    double m[9] = {1 - 2 * y * y - 2 * z * z, 2 * x * y - 2 * z * w,
-                   2 * x * z + 2 * y * w,     2 * x * y + 2 * z * w,
-                   1 - 2 * x * x - 2 * z * z, 2 * y * z - 2 * x * w,
-                   2 * x * z - 2 * y * w,     2 * y * z + 2 * x * w,
-                   1 - 2 * x * x - 2 * y * y};
-
-    return Matrix3x3(m);
+  BasicMatrix3x3<T> rotationMatrix() const {
+    T m[9] = {1 - 2 * y * y - 2 * z * z, 2 * x * y - 2 * z * w,
+              2 * x * z + 2 * y * w,     2 * x * y + 2 * z * w,
+              1 - 2 * x * x - 2 * z * z, 2 * y * z - 2 * x * w,
+              2 * x * z - 2 * y * w,     2 * y * z + 2 * x * w,
+              1 - 2 * x * x - 2 * y * y};
+
+    return BasicMatrix3x3<T>(m);
   }
 
   /**
    * @brief Returns the scaled-axis representation of this
    * quaternion rotation.
    */
-  Vector3D scaledAxis(void) const {
+  BasicVector3D<T> scaledAxis(void) const {
 
-    Quaternion q1 = (Quaternion)unit();
+    BasicQuaternion q1 = (BasicQuaternion)unit();
 
     // Algorithm from
     // http://www.euclideanspace.com/maths/geometry/rotations/conversions/quaternionToAngle/
 
-    double angle = 2 * acos(q1.w);
+    T angle = 2 * std::acos(q1.w);
 
     // s must be positive, because q1 <= 1, due to normalization.
-    double s = sqrt(1 - q1.w * q1.w);
+    T s = std::sqrt(1 - q1.w * q1.w);
 
     // Avoid dividing by 0.
     if (s < 0.001) {
@@ -181,10 +208,10 @@ public:
       // if it is important that axis is normalised then replace with x=1;
       // y=z=0;
 
-      return Vector3D(q1.x, q1.y, q1.z);
+      return BasicVector3D<T>(q1.x, q1.y, q1.z);
     } else {
       // normalise axis
-      return Vector3D(q1.x / s, q1.y / s, q1.z / s);
+      return BasicVector3D<T>(q1.x / s, q1.y / s, q1.z / s);
     }
 
     // NEVER getsgg HERE.
@@ -195,17 +222,17 @@ public:
    * This is the equal and opposite conversion from the scaledAxis(void)
    * function.
    */
-  void scaledAxis(const Vector3D &vec_in) {
-    double theta = vec_in.norm();
+  void scaledAxis(const BasicVector3D<T> &vec_in) {
+    T theta = vec_in.norm();
 
     // Small magnitudes are handled via the default vector.
     if (theta > 0.0001) {
-      double s = sin(theta / 2.0);
-      Vector3D W(vec_in / theta * s);
+      T s = std::sin(theta / 2.0);
+      BasicVector3D<T> W(vec_in / theta * s);
       x = W.x;
       y = W.y;
       z = W.z;
-      w = cos(theta / 2.0);
+      w = std::cos(theta / 2.0);
     } else {
       x = y = z = 0;
       w = 1.0;
@@ -221,8 +248,8 @@ public:
    * @warning conjugate() is used instead of inverse() for better
    * performance, when this quaternion must be normalized.
    */
-  Vector3D rotatedVector(const Vector3D &v) const {
-    return (((*this) * Quaternion(v, 0)) * conjugate()).complex();
+  BasicVector3D<T> rotatedVector(const BasicVector3D<T> &v) const {
+    return (((*this) * BasicQuaternion(v, 0)) * conjugate()).complex();
   }
 
   /**
@@ -230,13 +257,13 @@ public:
    * euler angle rotation.
    * @param euler A 3-vector in order:  roll-pitch-yaw.
    */
-  void euler(const Vector3D &euler) {
-    double c1 = cos(euler[2] * 0.5);
-    double c2 = cos(euler[1] * 0.5);
-    double c3 = cos(euler[0] * 0.5);
-    double s1 = sin(euler[2] * 0.5);
-    double s2 = sin(euler[1] * 0.5);
-    double s3 = sin(euler[0] * 0.5);
+  void euler(const BasicVector3D<T> &euler) {
+    T c1 = std::cos(euler[2] * 0.5);
+    T c2 = std::cos(euler[1] * 0.5);
+    T c3 = std::cos(euler[0] * 0.5);
+    T s1 = std::sin(euler[2] * 0.5);
+    T s2 = std::sin(euler[1] * 0.5);
+    T s3 = std::sin(euler[0] * 0.5);
 
     x = c1 * c2 * s3 - s1 * s2 * c3;
     y = c1 * s2 * c3 + s1 * c2 * s3;
@@ -249,10 +276,10 @@ public:
    * this quaternion.
    * @return Euler angles in roll-pitch-yaw order.
    */
-  Vector3D euler(void) const {
-    Vector3D euler;
-    const static double PI_OVER_2 = M_PI * 0.5;
-    double sqw, sqx, sqy, sqz;
+  BasicVector3D<T> euler(void) const {
+    BasicVector3D<T> euler;
+    const static T PI_OVER_2 = T(M_PI * 0.5);
+    T sqw, sqx, sqy, sqz;
 
     // quick conversion to Euler angles to give tilt to user
     sqw = w * w;
@@ -260,13 +287,13 @@ public:
     sqy = y * y;
     sqz = z * z;
 
-    euler[1] = asin(2.0 * (w * y - x * z));
-    if (PI_OVER_2 - fabs(euler[1]) > EPS_D) {
-      euler[2] = atan2(2.0 * (x * y + w * z), sqx - sqy - sqz + sqw);
-      euler[0] = atan2(2.0 * (w * x + y * z), sqw - sqx - sqy + sqz);
+    euler[1] = std::asin(2.0 * (w * y - x * z));
+    if (PI_OVER_2 - std::fabs(euler[1]) > EPS_D) {
+      euler[2] = std::atan2(2.0 * (x * y + w * z), sqx - sqy - sqz + sqw);
+      euler[0] = std::atan2(2.0 * (w * x + y * z), sqw - sqx - sqy + sqz);
     } else {
       // compute heading from local 'down' vector
-      euler[2] = atan2(2 * y * z - 2 * x * w, 2 * x * z + 2 * y * w);
+      euler[2] = std::atan2(2 * y * z - 2 * x * w, 2 * x * z + 2 * y * w);
       euler[0] = 0.0;
 
       // If facing down, reverse yaw
@@ -285,13 +312,13 @@ public:
    * The decoupled representation is two rotations, Qxy and Qz,
    * so that Q = Qxy * Qz.
    */
-  void decoupleZ(Quaternion *Qxy, Quaternion *Qz) const {
-    Vector3D ztt(0, 0, 1);
-    Vector3D zbt = this->rotatedVector(ztt);
-    Vector3D axis_xy = cross(ztt, zbt);
-    double axis_norm = axis_xy.norm();
+  void decoupleZ(BasicQuaternion *Qxy, BasicQuaternion *Qz) const {
+    BasicVector3D<T> ztt(0, 0, 1);
+    BasicVector3D<T> zbt = this->rotatedVector(ztt);
+    BasicVector3D<T> axis_xy = cross(ztt, zbt);
+    T axis_norm = axis_xy.norm();
 
-    double axis_theta = acos(clamp(zbt.z, -1.0, 1.0));
+    T axis_theta = std::acos(clamp(zbt.z, T(-1), T(1)));
     if (axis_norm > 0.00001) {
       axis_xy = axis_xy * (axis_theta / axis_norm); // limit is *1
     }
@@ -305,32 +332,40 @@ public:
    * t <= 1.
    * Bryce Likes the sound of this.
    */
-  Quaternion slerp(const Quaternion &q1, double t) {
+  BasicQuaternion slerp(const BasicQuaternion &q1, T t) {
     return slerp(*this, q1, t);
   }
 
   /// Returns quaternion that is slerped by fraction 't' between q0 and q1.
-  static Quaternion slerp(const Quaternion &q0, const Quaternion &q1,
-                          double t) {
+  static BasicQuaternion slerp(const BasicQuaternion &q0,
+                               const BasicQuaternion &q1, T t) {
 
-    double omega = acos(clamp(
-        q0.x * q1.x + q0.y * q1.y + q0.z * q1.z + q0.w * q1.w, -1.0, 1.0));
-    if (fabs(omega) < 1e-10) {
+    T omega = std::acos(clamp(
+        q0.x * q1.x + q0.y * q1.y + q0.z * q1.z + q0.w * q1.w, T(-1), T(1)));
+    if (std::fabs(omega) < 1e-10) {
       omega = 1e-10;
     }
-    double som = sin(omega);
-    double st0 = sin((1 - t) * omega) / som;
-    double st1 = sin(t * omega) / som;
+    T som = std::sin(omega);
+    T st0 = std::sin((1 - t) * omega) / som;
+    T st1 = std::sin(t * omega) / som;
 
-    return Quaternion(q0.x * st0 + q1.x * st1, q0.y * st0 + q1.y * st1,
-                      q0.z * st0 + q1.z * st1, q0.w * st0 + q1.w * st1);
+    return BasicQuaternion(q0.x * st0 + q1.x * st1, q0.y * st0 + q1.y * st1,
+                           q0.z * st0 + q1.z * st1, q0.w * st0 + q1.w * st1);
   }
 };
 
 /**
  * @brief Global operator allowing left-multiply by scalar.
  */
-Quaternion operator*(double s, const Quaternion &q);
+template <typename T>
+inline BasicQuaternion<T> operator*(typename BasicQuaternion<T>::Scalar s,
+                                    const BasicQuaternion<T> &q) {
+  return BasicQuaternion<T>(s * q.x, s * q.y, s * q.z, s * q.w);
+}
+
+// prints components
+template <typename T>
+std::ostream &operator<<(std::ostream &os, const BasicQuaternion<T> &q);
 
 } // namespace CMU462
 
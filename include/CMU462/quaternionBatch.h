@@ -0,0 +1,62 @@
+#ifndef CMU462_QUATERNIONBATCH_H
+#define CMU462_QUATERNIONBATCH_H
+
+#include "CMU462.h"
+#include "vector3D.h"
+#include "quaternion.h"
+
+#include <cstddef>
+
+namespace CMU462 {
+
+/**
+ * Batch operations over contiguous arrays of quaternions and vectors, for
+ * skeletal animation and the like. They are dispatched at runtime to the
+ * widest instruction set available (see simd.h), and out may be the same
+ * array as an input. Quaternions representing rotations must be unit.
+ */
+
+/**
+ * Writes q.rotatedVector(in[k]) into out[k]. The rotation matrix of q is
+ * computed once and applied with transformVectors().
+ */
+void rotate(const Quaternion &q, const Vector3D *in, Vector3D *out,
+            size_t n);
+void rotate(const Quaternionf &q, const Vector3f *in, Vector3f *out,
+            size_t n);
+
+/**
+ * Writes q[k].rotatedVector(in[k]) into out[k], computed as
+ * v + w t + u x t with t = 2 u x v (u the complex part of q[k]) instead
+ * of two quaternion products.
+ */
+void rotate(const Quaternion *q, const Vector3D *in, Vector3D *out,
+            size_t n);
+void rotate(const Quaternionf *q, const Vector3f *in, Vector3f *out,
+            size_t n);
+
+/**
+ * Writes the normalized linear interpolation between q0[k] and q1[k] by
+ * the fraction 0 <= t <= 1 into out[k]. q1[k] is negated if needed so that
+ * the interpolation takes the shorter arc.
+ */
+void nlerp(const Quaternion *q0, const Quaternion *q1, double t,
+           Quaternion *out, size_t n);
+void nlerp(const Quaternionf *q0, const Quaternionf *q1, float t,
+           Quaternionf *out, size_t n);
+
+/**
+ * Writes an approximation of Quaternion::slerp(q0[k], q1[k], t) along the
+ * shorter arc into out[k]. This is nlerp with t corrected by a polynomial
+ * fitted to the slerp angle, so there are no acos or sin calls. The
+ * rotation differs from the exact slerp by less than 1e-3 radians
+ * (tests/quaternion_bench measures the worst case).
+ */
+void slerpApprox(const Quaternion *q0, const Quaternion *q1, double t,
+                 Quaternion *out, size_t n);
+void slerpApprox(const Quaternionf *q0, const Quaternionf *q1, float t,
+                 Quaternionf *out, size_t n);
+
+} // namespace CMU462
+
+#endif // CMU462_QUATERNIONBATCH_H
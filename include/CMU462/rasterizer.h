@@ -0,0 +1,153 @@
+#ifndef CMU462_RASTERIZER_H
+#define CMU462_RASTERIZER_H
+
+#include "CMU462.h"
+#include "color.h"
+#include "color32.h"
+#include "spectrum.h"
+#include "vector3D.h"
+#include "vector4D.h"
+#include "matrix4x4.h"
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+namespace CMU462 {
+
+/**
+ * Software triangle rasterizer, for rendering without a GPU (headless
+ * servers, regression tests).
+ *
+ * Triangles are transformed to clip space by a 4x4 matrix, clipped
+ * against the near plane (z >= -w, as in OpenGL) and mapped to the
+ * viewport, with NDC y pointing up and row 0 at the top of the image.
+ * Their vertex colors are interpolated with perspective correction, and
+ * a depth test (less) on z / w keeps the nearest one. Both faces are
+ * drawn and there is no blending: the color, alpha included, replaces
+ * the previous one.
+ *
+ * Each pixel holds supersample x supersample samples, so edges are
+ * antialiased when resolve() averages them. Draw calls only queue the
+ * triangles; flush() sorts them into bins of 32x32 pixel tiles and
+ * rasterizes the tiles in parallel, each in the order the triangles were
+ * drawn, so images do not depend on the number of threads. Within a tile
+ * the edge functions of several samples are evaluated at once (see
+ * simd.h). Vertices are snapped to 1/16 of a sample and the edge
+ * functions are exact, with a top-left fill rule, so triangles sharing an
+ * edge cover every sample once and coverage is the same at every level.
+ *
+ * Samples take 20 bytes (a Color and a float depth), stored tile by tile.
+ */
+class Rasterizer {
+public:
+  /**
+   * Constructor.
+   * Initializes a width x height image with supersample x supersample
+   * samples per pixel, cleared to transparent black, and the identity
+   * transform (vertices in NDC).
+   */
+  Rasterizer(size_t width = 0, size_t height = 0, int supersample = 1);
+
+  /**
+   * Changes the size of the image and the number of samples per pixel,
+   * which clears it and drops the queued triangles.
+   * REQUIRES: 1 <= supersample <= 4.
+   */
+  void resize(size_t width, size_t height, int supersample = 1);
+
+  inline size_t width(void) const { return w; }
+  inline size_t height(void) const { return h; }
+  inline int supersample(void) const { return ss; }
+
+  /**
+   * Sets the matrix taking the vertices of the next draw calls to clip
+   * space, usually projection * view * model.
+   */
+  inline void setTransform(const Matrix4x4 &m) { transform = m; }
+
+  /**
+   * Clears every sample to the given color, with the farthest depth, and
+   * drops the queued triangles.
+   */
+  void clear(const Color &c = Color(0, 0, 0, 0));
+
+  /**
+   * Queues a triangle with a color at each vertex. Spectrum colors have
+   * alpha 1.
+   */
+  void drawTriangle(const Vector3D &p0, const Vector3D &p1,
+                    const Vector3D &p2, const Color &c0, const Color &c1,
+                    const Color &c2);
+  void drawTriangle(const Vector3D &p0, const Vector3D &p1,
+                    const Vector3D &p2, const Spectrum &c0,
+                    const Spectrum &c1, const Spectrum &c2);
+
+  /**
+   * Queues an indexed triangle mesh with a color at each vertex: triangle
+   * t has the vertices indices[3t], indices[3t + 1] and indices[3t + 2].
+   */
+  void drawTriangles(const Vector3D *positions, const Color *colors,
+                     const uint32_t *indices, size_t triangles);
+  void drawTriangles(const Vector3D *positions, const Spectrum *colors,
+                     const uint32_t *indices, size_t triangles);
+
+  /**
+   * Rasterizes the queued triangles.
+   */
+  void flush(void);
+
+  /**
+   * Flushes and writes the image, averaging the samples of each pixel,
+   * row by row from the top. The 8-bit version clamps and rounds the
+   * colors as they are (see tonemap.h for HDR images), and the Spectrum
+   * version drops alpha.
+   */
+  void resolve(Color *out);
+  void resolve(Spectrum *out);
+  void resolve(Color32 *out);
+
+  /**
+   * Flushes and saves the image as an RGBA PNG file with lodepng.
+   * Returns false if the file could not be written.
+   */
+  bool savePNG(const char *filename);
+
+private:
+  // a triangle ready to rasterize, in sample coordinates
+  struct Triangle {
+    double a[3], b[3], c[3]; ///< edge functions a x + b y + c
+    float z[3];              ///< depth of the vertices
+    float q[3];              ///< 1 / w of the vertices
+    Color cq[3];             ///< colors of the vertices times q
+    float invArea;           ///< 1 / the sum of the edge functions
+    int x0, y0, x1, y1;      ///< sample bounds, inclusive
+  };
+
+  // clips a triangle in clip space and queues the pieces
+  void clipAndQueue(const Vector4D *v, const Color *c);
+
+  // queues a triangle whose vertices are in front of the camera
+  void queue(const Vector4D *v, const Color *c);
+
+  // rasterizes the binned triangles of a tile
+  void rasterizeTile(size_t tile);
+
+  // averages the samples of a row of pixels
+  void resolveRow(size_t y, Color *out) const;
+
+  size_t w, h;           ///< size of the image in pixels
+  int ss;                ///< samples per pixel along x and y
+  size_t tilesX, tilesY; ///< number of tiles along x and y
+  Matrix4x4 transform;   ///< vertices to clip space
+
+  std::vector<Triangle> triangles;          ///< queued triangles
+  std::vector<std::vector<uint32_t> > bins; ///< triangles of each tile
+  std::vector<float> depths;                ///< samples, tile by tile
+  std::vector<Color> colors;                ///< samples, tile by tile
+
+}; // class Rasterizer
+
+} // namespace CMU462
+
+#endif // CMU462_RASTERIZER_H
@@ -0,0 +1,83 @@
+#ifndef CMU462_RAY_H
+#define CMU462_RAY_H
+
+#include "CMU462.h"
+#include "vector3D.h"
+
+#include <limits>
+
+namespace CMU462 {
+
+/**
+ * A ray o + t d restricted to minT <= t <= maxT, with the reciprocal of
+ * the direction precomputed for slab tests (see BBox::intersect). Zero
+ * direction components give infinite reciprocals, which the slab tests
+ * handle.
+ */
+struct Ray {
+  Vector3D o;    ///< origin
+  Vector3D d;    ///< direction
+  Vector3D invD; ///< component-wise 1 / d
+  double minT;   ///< start of the valid interval
+  double maxT;   ///< end of the valid interval
+
+  /**
+   * Constructor.
+   * Initializes to the ray o + t d for minT <= t <= maxT.
+   */
+  Ray(const Vector3D &o, const Vector3D &d, double minT = 0,
+      double maxT = std::numeric_limits<double>::infinity())
+      : o(o), d(d), invD(1 / d.x, 1 / d.y, 1 / d.z), minT(minT),
+        maxT(maxT) {}
+
+  /**
+   * Returns the point at parameter t.
+   */
+  constexpr Vector3D at(double t) const { return o + t * d; }
+
+}; // struct Ray
+
+/**
+ * N rays stored as a structure of arrays, for the packet intersection
+ * kernels of intersect.h: o[a][k] is the component a of the origin of
+ * ray k, and so on. RayPacket4 and RayPacket8 are the supported sizes.
+ */
+template <int N>
+struct RayPacket {
+  enum { size = N };
+
+  double o[3][N];    ///< origins
+  double d[3][N];    ///< directions
+  double invD[3][N]; ///< component-wise 1 / d
+  double minT[N];    ///< starts of the valid intervals
+  double maxT[N];    ///< ends of the valid intervals
+
+  /**
+   * Stores r as ray k.
+   */
+  inline void set(int k, const Ray &r) {
+    for (int a = 0; a < 3; a++) {
+      o[a][k] = r.o[a];
+      d[a][k] = r.d[a];
+      invD[a][k] = r.invD[a];
+    }
+    minT[k] = r.minT;
+    maxT[k] = r.maxT;
+  }
+
+  /**
+   * Returns ray k.
+   */
+  inline Ray get(int k) const {
+    return Ray(Vector3D(o[0][k], o[1][k], o[2][k]),
+               Vector3D(d[0][k], d[1][k], d[2][k]), minT[k], maxT[k]);
+  }
+
+}; // struct RayPacket
+
+typedef RayPacket<4> RayPacket4;
+typedef RayPacket<8> RayPacket8;
+
+} // namespace CMU462
+
+#endif // CMU462_RAY_H
@@ -0,0 +1,66 @@
+#ifndef CMU462_SIMD_H
+#define CMU462_SIMD_H
+
+#include "CMU462.h"
+
+#include <cstddef>
+
+// SSE2 is part of the x86-64 baseline, so it is always available there.
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CMU462_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// AVX2 kernels are compiled regardless of the flags used for the rest of
+// the library and must only be called after checking SIMD::hasAVX2(). The
+// AVX2 level includes FMA and the F16C half precision conversions, which
+// every AVX2 processor has.
+#if defined(CMU462_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#define CMU462_AVX2 1
+#define CMU462_TARGET_AVX2 __attribute__((target("avx2,fma,f16c")))
+#include <immintrin.h>
+#elif defined(CMU462_SSE2) && defined(_MSC_VER)
+#define CMU462_AVX2 1
+#define CMU462_TARGET_AVX2
+#include <immintrin.h>
+#endif
+
+namespace CMU462 {
+namespace SIMD {
+
+/**
+ * Instruction set levels used by the batch kernels, in increasing order.
+ */
+enum Level { SCALAR = 0, SSE2 = 1, AVX2 = 2 };
+
+/**
+ * Returns the highest level supported by both the compiler and the CPU,
+ * capped by setLevel(). Detection via CPUID happens once, on first use.
+ */
+Level level(void);
+
+/**
+ * Caps the level used by the batch kernels. This is mostly useful to
+ * compare the vector kernels against the scalar fallback.
+ */
+void setLevel(Level max);
+
+inline bool hasSSE2(void) { return level() >= SSE2; }
+inline bool hasAVX2(void) { return level() >= AVX2; }
+
+/**
+ * Allocates size bytes aligned to the given power-of-two boundary.
+ * Memory must be released with alignedFree().
+ */
+void *alignedAlloc(size_t size, size_t alignment = 32);
+
+/**
+ * Releases memory obtained from alignedAlloc(). Accepts NULL.
+ */
+void alignedFree(void *ptr);
+
+} // namespace SIMD
+} // namespace CMU462
+
+#endif // CMU462_SIMD_H
@@ -0,0 +1,55 @@
+#ifndef CMU462_SKINNING_H
+#define CMU462_SKINNING_H
+
+#include "CMU462.h"
+#include "vector3D.h"
+#include "matrix4x4.h"
+#include "dualQuaternion.h"
+
+#include <cstddef>
+
+namespace CMU462 {
+
+/**
+ * Bone influences of a skinned mesh, four per vertex, stored as a
+ * structure of arrays: vertex i is influenced by bone index[k][i] with
+ * weight weight[k][i] for k = 0..3. The weights of a vertex should sum to
+ * one; unused influences have weight zero (and any valid bone index).
+ * The arrays are owned by the caller.
+ */
+struct SkinInfluences {
+  const int *index[4];
+  const double *weight[4];
+};
+
+/**
+ * Dual quaternion skinning. Blends the unit dual quaternions of the bones
+ * influencing each vertex (aligned to the hemisphere of the first
+ * influence), renormalizes, and applies the resulting rigid motion to
+ * points[i] and normals[i]. This avoids the collapsing joints
+ * ("candy wrapper") of linear blend skinning.
+ *
+ * Vertices are processed four at a time with AVX2 when available and
+ * split into blocks that are skinned in parallel (when built with OpenMP).
+ *
+ * normals and outNormals may be NULL to skip the normals. The outputs may
+ * be the same arrays as the inputs.
+ */
+void skinDualQuaternion(const DualQuaternion *palette,
+                        const SkinInfluences &influences,
+                        const Vector3D *points, const Vector3D *normals,
+                        Vector3D *outPoints, Vector3D *outNormals, size_t n);
+
+/**
+ * Linear blend skinning with the same interface as skinDualQuaternion, for
+ * comparison. Blends the affine bone matrices of each vertex and applies
+ * the result to points[i] and (the upper 3x3 block to) normals[i]. The
+ * normals are not renormalized.
+ */
+void skinLinear(const Matrix4x4 *palette, const SkinInfluences &influences,
+                const Vector3D *points, const Vector3D *normals,
+                Vector3D *outPoints, Vector3D *outNormals, size_t n);
+
+} // namespace CMU462
+
+#endif // CMU462_SKINNING_H
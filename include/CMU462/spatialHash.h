@@ -0,0 +1,171 @@
+#ifndef CMU462_SPATIALHASH_H
+#define CMU462_SPATIALHASH_H
+
+#include "CMU462.h"
+#include "vector3D.h"
+
+#include <cmath>
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+namespace CMU462 {
+
+/**
+ * Spatial hash over a uniform grid of cubic cells, for neighbor queries
+ * over particles that move every frame (fluids, collision broad phase).
+ *
+ * build() hashes the cell of every particle into a table of about twice
+ * as many buckets as particles and counting sorts the particles by
+ * bucket, so each bucket is a contiguous range of one array and no cell
+ * owns any memory. Particles keep increasing index order within a bucket,
+ * so the results do not depend on the number of threads. The positions
+ * are copied in bucket order, which keeps the particles of a cell
+ * together in memory. Rebuilding with the same or fewer particles reuses
+ * all buffers.
+ *
+ * Queries with a radius up to the cell size visit 27 cells; the cell size
+ * should be about the query radius.
+ */
+class SpatialHash {
+public:
+  /**
+   * Constructor.
+   * Initializes an empty hash with the given cell size.
+   */
+  explicit SpatialHash(double cellSize = 1) : bits(1) {
+    setCellSize(cellSize);
+  }
+
+  /**
+   * Sets the cell size. It takes effect at the next build(), and queries
+   * are invalid until then.
+   */
+  inline void setCellSize(double size) {
+    h = size;
+    invH = 1 / size;
+  }
+
+  /**
+   * Returns the cell size.
+   */
+  inline double cellSize(void) const { return h; }
+
+  /**
+   * Hashes the n particles at the given positions, replacing the previous
+   * ones.
+   */
+  void build(const Vector3D *positions, size_t n);
+
+  /**
+   * Returns the number of particles.
+   */
+  inline size_t size(void) const { return order.size(); }
+
+  /**
+   * Calls f(i, d2) for every particle i within distance r of q (boundary
+   * included), where d2 is its squared distance to q.
+   */
+  template <typename F>
+  void forEachNeighbor(const Vector3D &q, double r, F &&f) const;
+
+  /**
+   * Replaces the contents of indices with the particles within distance r
+   * of q, and returns their number.
+   */
+  size_t neighbors(const Vector3D &q, double r,
+                   std::vector<uint32_t> &indices) const;
+
+  /**
+   * Computes the neighbors within distance r of every particle, itself
+   * excluded, in parallel: the neighbors of particle i are indices[k] for
+   * offsets[i] <= k < offsets[i + 1].
+   */
+  void neighborLists(double r, std::vector<size_t> &offsets,
+                     std::vector<uint32_t> &indices) const;
+
+  /**
+   * Computes the pairs of particles within distance r of each other, in
+   * parallel: pair k is (pairs[2k], pairs[2k + 1]), with the first index
+   * smaller. Pairs are sorted by first index.
+   */
+  void pairs(double r, std::vector<uint32_t> &pairs) const;
+
+private:
+  // cell coordinates, 21 bits each, packed in one key
+  inline uint64_t cellKey(long x, long y, long z) const {
+    return ((uint64_t)x & 0x1FFFFF) | ((uint64_t)y & 0x1FFFFF) << 21 |
+           ((uint64_t)z & 0x1FFFFF) << 42;
+  }
+
+  inline uint64_t cellKey(const Vector3D &p) const {
+    return cellKey((long)floor(p.x * invH), (long)floor(p.y * invH),
+                   (long)floor(p.z * invH));
+  }
+
+  // consecutive cells along x go to consecutive buckets, so a query reads
+  // each row of cells from one range of slots
+  inline size_t bucket(uint64_t key) const {
+    uint64_t row = ((key >> 21) * 0x9E3779B97F4A7C15ull) >> (64 - bits);
+    return (size_t)((row + (key & 0x1FFFFF)) & (((uint64_t)1 << bits) - 1));
+  }
+
+  double h, invH;
+  int bits;                     ///< log2 of the number of buckets
+  std::vector<uint32_t> start;  ///< first slot of each bucket, and the end
+  std::vector<uint32_t> order;  ///< particle in each slot
+  std::vector<uint32_t> slot;   ///< slot of each particle
+  std::vector<Vector3D> sorted; ///< position in each slot
+  std::vector<uint64_t> cells;  ///< cell key in each slot
+
+}; // class SpatialHash
+
+template <typename F>
+void SpatialHash::forEachNeighbor(const Vector3D &q, double r, F &&f) const {
+  if (order.empty()) return;
+
+  double r2 = r * r;
+  long lo[3], hi[3];
+  for (int a = 0; a < 3; a++) {
+    lo[a] = (long)floor((q[a] - r) * invH);
+    hi[a] = (long)floor((q[a] + r) * invH);
+  }
+
+  // the cells of a row have consecutive buckets (unless they wrap around
+  // the table, or the 21 bits of x wrap around at x = 0 in a table of more
+  // than 2^21 buckets), so the row is one range of slots, where particles
+  // of other rows or out of [lo, hi] along x come from colliding cells
+  uint64_t width = hi[0] - lo[0];
+  size_t buckets = (size_t)1 << bits;
+  for (long z = lo[2]; z <= hi[2]; z++) {
+    for (long y = lo[1]; y <= hi[1]; y++) {
+      uint64_t first = cellKey(lo[0], y, z), row = first & ~0x1FFFFFull;
+      size_t b = bucket(first);
+      if (b + width < buckets && (first & 0x1FFFFF) + width <= 0x1FFFFF) {
+        for (uint32_t s = start[b]; s < start[b + width + 1]; s++) {
+          uint64_t key = cells[s];
+          if ((key & ~0x1FFFFFull) != row ||
+              ((key - first) & 0x1FFFFF) > width)
+            continue;
+          double d2 = (sorted[s] - q).norm2();
+          if (d2 <= r2) f(order[s], d2);
+        }
+        continue;
+      }
+
+      for (long x = lo[0]; x <= hi[0]; x++) {
+        uint64_t key = cellKey(x, y, z);
+        b = bucket(key);
+        for (uint32_t s = start[b]; s < start[b + 1]; s++) {
+          if (cells[s] != key) continue;
+          double d2 = (sorted[s] - q).norm2();
+          if (d2 <= r2) f(order[s], d2);
+        }
+      }
+    }
+  }
+}
+
+} // namespace CMU462
+
+#endif // CMU462_SPATIALHASH_H
@@ -0,0 +1,101 @@
+#ifndef CMU462_TONEMAP_H
+#define CMU462_TONEMAP_H
+
+#include "CMU462.h"
+#include "color.h"
+#include "spectrum.h"
+
+#include <cmath>
+#include <cstddef>
+#include <stdint.h>
+
+namespace CMU462 {
+
+/**
+ * Converts an sRGB encoded component to linear, exactly.
+ */
+inline float srgbToLinear(float c) {
+  return c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+}
+
+/**
+ * Converts a linear component to sRGB encoding, exactly.
+ */
+inline float linearToSrgb(float c) {
+  return c <= 0.0031308f ? 12.92f * c : 1.055f * powf(c, 1 / 2.4f) - 0.055f;
+}
+
+/**
+ * Bulk sRGB conversions of n components, dispatched to SSE2 or AVX2
+ * kernels (see simd.h), with large arrays converted in parallel blocks.
+ *
+ * The float conversions evaluate the powers with polynomial
+ * approximations of log2 and exp2, and are within 3e-7 of the exact
+ * functions above on [0, 1]; components above 1 are extended by the same
+ * curve. The 8-bit encoding clamps to [0, 1] and interpolates a table of
+ * 1664 lines, which is within 2e-4 of 255 times the exact encoding, so it
+ * rounds to nearest except within that distance of a midpoint. The 8-bit
+ * decoding is an exact table lookup.
+ */
+void srgbToLinear(const float *in, float *out, size_t n);
+void linearToSrgb(const float *in, float *out, size_t n);
+void srgbToLinear(const uint8_t *in, float *out, size_t n);
+void linearToSrgb(const float *in, uint8_t *out, size_t n);
+
+/**
+ * Parameters of tonemap().
+ */
+struct ToneMapping {
+
+  // tone curve applied to each linear component after the exposure
+  enum Operator {
+    CLAMP,    ///< none: clamps to [0, 1]
+    REINHARD, ///< x / (1 + x)
+    ACES      ///< K. Narkowicz's fit of the ACES filmic curve (2015)
+  };
+
+  Operator op;
+  float exposure; ///< scale applied to the components first
+  bool dither;    ///< ordered (8x8 Bayer) dithering of the 8-bit result
+
+  ToneMapping(Operator op = ACES, float exposure = 1, bool dither = true)
+      : op(op), exposure(exposure), dither(dither) {}
+};
+
+/**
+ * Returns the log-average illumination of n pixels,
+ * exp(mean(log(delta + illum))), which estimates the brightness of an
+ * HDR image while discounting a few very bright pixels. Negative
+ * illuminations count as zero.
+ */
+float logAverageIllum(const Spectrum *in, size_t n, float delta = 1e-4f);
+
+/**
+ * Returns the exposure that maps the log-average illumination of the n
+ * pixels to key (middle grey).
+ */
+inline float autoExposure(const Spectrum *in, size_t n, float key = 0.18f) {
+  return key / logAverageIllum(in, n);
+}
+
+/**
+ * Tone maps a width x height image of linear radiance, stored row by row,
+ * to 8-bit sRGB with alpha 255, four bytes per pixel (RGBA) in the same
+ * row order, as expected by lodepng. Rows are processed in parallel and
+ * the components are vectorized (see simd.h); all levels give the same
+ * bytes, except possibly when a component falls within 1e-6 of a
+ * rounding threshold.
+ */
+void tonemap(const Spectrum *in, size_t width, size_t height, uint8_t *rgba,
+             const ToneMapping &params = ToneMapping());
+
+/**
+ * Same as above for linear colors, whose alpha is copied (clamped to
+ * [0, 1], rounded, and not dithered) instead of being set to 1.
+ */
+void tonemap(const Color *in, size_t width, size_t height, uint8_t *rgba,
+             const ToneMapping &params = ToneMapping());
+
+} // namespace CMU462
+
+#endif // CMU462_TONEMAP_H
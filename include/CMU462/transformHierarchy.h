@@ -0,0 +1,145 @@
+#ifndef CMU462_TRANSFORMHIERARCHY_H
+#define CMU462_TRANSFORMHIERARCHY_H
+
+#include "CMU462.h"
+#include "affine3.h"
+#include "matrix4x4.h"
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+namespace CMU462 {
+
+/**
+ * Hierarchy of transforms (a scene graph without the scene): every node
+ * has a local transform relative to its parent, and its world transform
+ * is the product of the local transforms from its root down to it.
+ *
+ * Nodes are kept in flat arrays in depth-first order, so each parent
+ * precedes its children and every subtree is one contiguous range.
+ * Changing a local transform only marks the node dirty; update() then
+ * recomputes the world transforms and their cached inverses of the dirty
+ * subtrees, so its cost is proportional to the number of nodes below the
+ * nodes that changed, not to the size of the hierarchy. Adding nodes or
+ * changing parents reorders the arrays at the next update(), in time
+ * linear in the number of nodes. Transforms are affine, stored as Affine3
+ * (a Matrix4x4 without its last row).
+ *
+ * Nodes are referred to by the index add() returns, which does not
+ * change when the arrays are reordered.
+ */
+class TransformHierarchy {
+public:
+  static const uint32_t kNone = 0xFFFFFFFF;
+
+  /**
+   * Constructor.
+   * Initializes an empty hierarchy.
+   */
+  TransformHierarchy() : stale(false) {}
+
+  /**
+   * Adds a node with the given parent (kNone for a root) and local
+   * transform, and returns its index.
+   */
+  uint32_t add(uint32_t parent = kNone,
+               const Affine3 &local = Affine3::identity());
+
+  /**
+   * Removes all nodes.
+   */
+  void clear(void);
+
+  /**
+   * Returns the number of nodes.
+   */
+  inline size_t size(void) const { return parents.size(); }
+
+  /**
+   * Returns the parent of a node, kNone for a root.
+   */
+  inline uint32_t parent(uint32_t node) const { return parents[node]; }
+
+  /**
+   * Moves a node, with its subtree, under a new parent (kNone to make it a
+   * root). Its local transform is kept, so its world transform changes.
+   * REQUIRES: parent is not in the subtree of node.
+   */
+  void setParent(uint32_t node, uint32_t parent);
+
+  /**
+   * Returns the local transform of a node.
+   */
+  inline const Affine3 &local(uint32_t node) const {
+    return locals[slots[node]];
+  }
+
+  /**
+   * Sets the local transform of a node, which marks its subtree dirty.
+   * The Matrix4x4 version assumes the last row is (0, 0, 0, 1).
+   */
+  void setLocal(uint32_t node, const Affine3 &local);
+  inline void setLocal(uint32_t node, const Matrix4x4 &local) {
+    setLocal(node, Affine3(local));
+  }
+
+  /**
+   * Recomputes the world transforms, and their inverses, of the dirty
+   * subtrees. Disjoint subtrees are updated in parallel.
+   */
+  void update(void);
+
+  /**
+   * Returns true if update() has work to do.
+   */
+  inline bool dirty(void) const { return stale || !changed.empty(); }
+
+  /**
+   * Returns the world transform of a node, as of the last update().
+   */
+  inline const Affine3 &world(uint32_t node) const {
+    return worlds[slots[node]];
+  }
+
+  inline Matrix4x4 worldMatrix(uint32_t node) const {
+    return world(node).toMatrix4x4();
+  }
+
+  /**
+   * Returns the inverse of the world transform of a node, as of the last
+   * update().
+   */
+  inline const Affine3 &worldInv(uint32_t node) const {
+    return inverses[slots[node]];
+  }
+
+  inline Matrix4x4 worldInvMatrix(uint32_t node) const {
+    return worldInv(node).toMatrix4x4();
+  }
+
+private:
+  // rebuilds the depth-first order from the parents
+  void relayout(void);
+
+  // by node
+  std::vector<uint32_t> parents; ///< parent of each node
+  std::vector<uint32_t> slots;   ///< position of each node in the order
+  std::vector<uint8_t> marked;   ///< whether the node is in changed
+
+  // by position in the depth-first order
+  std::vector<uint32_t> nodes;   ///< node at each position
+  std::vector<uint32_t> up;      ///< position of the parent, or kNone
+  std::vector<uint32_t> ends;    ///< end of the subtree at each position
+  std::vector<Affine3> locals;   ///< local transforms
+  std::vector<Affine3> worlds;   ///< world transforms
+  std::vector<Affine3> inverses; ///< inverse world transforms
+
+  std::vector<uint32_t> changed; ///< nodes whose subtree is dirty
+  bool stale;                    ///< the order must be rebuilt
+
+}; // class TransformHierarchy
+
+} // namespace CMU462
+
+#endif // CMU462_TRANSFORMHIERARCHY_H
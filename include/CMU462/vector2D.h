@@ -9,82 +9,88 @@
 namespace CMU462 {
 
 /**
- * Defines 2D vectors.
+ * Defines 2D vectors over the scalar type T.
+ * Vector2D (double) and Vector2f (float) are the instantiated types.
  */
-class Vector2D {
+template <typename T>
+class BasicVector2D {
 public:
+  typedef T Scalar;
+
   // components
-  double x, y;
+  T x, y;
 
   /**
    * Constructor.
    * Initializes to vector (0,0).
    */
-  Vector2D() : x(0.0), y(0.0) {}
+  constexpr BasicVector2D() : x(0), y(0) {}
 
   /**
    * Constructor.
    * Initializes to vector (a,b).
    */
-  Vector2D(double x, double y) : x(x), y(y) {}
+  constexpr BasicVector2D(T x, T y) : x(x), y(y) {}
 
   /**
    * Constructor.
    * Copy constructor. Creates a copy of the given vector.
    */
-  Vector2D(const Vector2D &v) : x(v.x), y(v.y) {}
+  constexpr BasicVector2D(const BasicVector2D &v) : x(v.x), y(v.y) {}
+
+  /**
+   * Constructor.
+   * Converts from a vector of another scalar type.
+   */
+  template <typename U>
+  constexpr explicit BasicVector2D(const BasicVector2D<U> &v)
+      : x(T(v.x)), y(T(v.y)) {}
 
   // additive inverse
-  inline Vector2D operator-(void) const { return Vector2D(-x, -y); }
+  constexpr BasicVector2D operator-(void) const {
+    return BasicVector2D(-x, -y);
+  }
 
   // addition
-  inline Vector2D operator+(const Vector2D &v) const {
-    Vector2D u = *this;
-    u += v;
-    return u;
+  constexpr BasicVector2D operator+(const BasicVector2D &v) const {
+    return BasicVector2D(x + v.x, y + v.y);
   }
 
   // subtraction
-  inline Vector2D operator-(const Vector2D &v) const {
-    Vector2D u = *this;
-    u -= v;
-    return u;
+  constexpr BasicVector2D operator-(const BasicVector2D &v) const {
+    return BasicVector2D(x - v.x, y - v.y);
   }
 
   // right scalar multiplication
-  inline Vector2D operator*(double r) const {
-    Vector2D vr = *this;
-    vr *= r;
-    return vr;
+  constexpr BasicVector2D operator*(T r) const {
+    return BasicVector2D(x * r, y * r);
   }
 
   // scalar division
-  inline Vector2D operator/(double r) const {
-    Vector2D vr = *this;
-    vr /= r;
-    return vr;
+  constexpr BasicVector2D operator/(T r) const {
+    return BasicVector2D(x / r, y / r);
   }
 
   // add v
-  inline void operator+=(const Vector2D &v) {
+  inline void operator+=(const BasicVector2D &v) {
     x += v.x;
     y += v.y;
   }
 
   // subtract v
-  inline void operator-=(const Vector2D &v) {
+  inline void operator-=(const BasicVector2D &v) {
     x -= v.x;
     y -= v.y;
   }
 
   // scalar multiply by r
-  inline void operator*=(double r) {
+  inline void operator*=(T r) {
     x *= r;
     y *= r;
   }
 
   // scalar divide by r
-  inline void operator/=(double r) {
+  inline void operator/=(T r) {
     x /= r;
     y /= r;
   }
@@ -92,35 +98,42 @@ public:
   /**
    * Returns norm.
    */
-  inline double norm(void) const { return sqrt(x * x + y * y); }
+  inline T norm(void) const { return std::sqrt(x * x + y * y); }
 
   /**
    * Returns norm squared.
    */
-  inline double norm2(void) const { return x * x + y * y; }
+  constexpr T norm2(void) const { return x * x + y * y; }
 
   /**
    * Returns unit vector parallel to this one.
    */
-  inline Vector2D unit(void) const { return *this / this->norm(); }
+  inline BasicVector2D unit(void) const { return *this / this->norm(); }
 
-}; // clasd Vector2D
+}; // clasd BasicVector2D
 
 // left scalar multiplication
-inline Vector2D operator*(double r, const Vector2D &v) { return v * r; }
+template <typename T>
+constexpr BasicVector2D<T> operator*(typename BasicVector2D<T>::Scalar r,
+                                     const BasicVector2D<T> &v) {
+  return v * r;
+}
 
 // inner product
-inline double dot(const Vector2D &v1, const Vector2D &v2) {
+template <typename T>
+constexpr T dot(const BasicVector2D<T> &v1, const BasicVector2D<T> &v2) {
   return v1.x * v2.x + v1.y * v2.y;
 }
 
 // cross product
-inline double cross(const Vector2D &v1, const Vector2D &v2) {
+template <typename T>
+constexpr T cross(const BasicVector2D<T> &v1, const BasicVector2D<T> &v2) {
   return v1.x * v2.y - v1.y * v2.x;
 }
 
 // prints components
-std::ostream &operator<<(std::ostream &os, const Vector2D &v);
+template <typename T>
+std::ostream &operator<<(std::ostream &os, const BasicVector2D<T> &v);
 
 } // namespace CMU462
 
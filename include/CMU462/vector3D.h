@@ -9,114 +9,125 @@
 namespace CMU462 {
 
 /**
- * Defines 3D vectors.
+ * Defines 3D vectors over the scalar type T.
+ * Vector3D (double) and Vector3f (float) are the instantiated types.
  */
-class Vector3D {
+template <typename T>
+class BasicVector3D {
 public:
+  typedef T Scalar;
+
   // components
-  double x, y, z;
+  T x, y, z;
 
   /**
    * Constructor.
    * Initializes tp vector (0,0,0).
    */
-  Vector3D() : x(0.0), y(0.0), z(0.0) {}
+  constexpr BasicVector3D() : x(0), y(0), z(0) {}
 
   /**
    * Constructor.
    * Initializes to vector (x,y,z).
    */
-  Vector3D(double x, double y, double z) : x(x), y(y), z(z) {}
+  constexpr BasicVector3D(T x, T y, T z) : x(x), y(y), z(z) {}
 
   /**
    * Constructor.
    * Initializes to vector (c,c,c)
    */
-  Vector3D(double c) : x(c), y(c), z(c) {}
+  constexpr BasicVector3D(T c) : x(c), y(c), z(c) {}
 
   /**
    * Constructor.
    * Initializes from existing vector
    */
-  Vector3D(const Vector3D &v) : x(v.x), y(v.y), z(v.z) {}
+  constexpr BasicVector3D(const BasicVector3D &v) : x(v.x), y(v.y), z(v.z) {}
+
+  /**
+   * Constructor.
+   * Converts from a vector of another scalar type.
+   */
+  template <typename U>
+  constexpr explicit BasicVector3D(const BasicVector3D<U> &v)
+      : x(T(v.x)), y(T(v.y)), z(T(v.z)) {}
 
   // returns reference to the specified component (0-based indexing: x, y, z)
-  inline double &operator[](const int &index) { return (&x)[index]; }
+  inline T &operator[](const int &index) { return (&x)[index]; }
 
   // returns const reference to the specified component (0-based indexing: x, y,
   // z)
-  inline const double &operator[](const int &index) const {
-    return (&x)[index];
-  }
+  inline const T &operator[](const int &index) const { return (&x)[index]; }
 
-  inline bool operator==(const Vector3D &v) const {
+  constexpr bool operator==(const BasicVector3D &v) const {
     return v.x == x && v.y == y && v.z == z;
   }
 
   // negation
-  inline Vector3D operator-(void) const { return Vector3D(-x, -y, -z); }
+  constexpr BasicVector3D operator-(void) const {
+    return BasicVector3D(-x, -y, -z);
+  }
 
   // addition
-  inline Vector3D operator+(const Vector3D &v) const {
-    return Vector3D(x + v.x, y + v.y, z + v.z);
+  constexpr BasicVector3D operator+(const BasicVector3D &v) const {
+    return BasicVector3D(x + v.x, y + v.y, z + v.z);
   }
 
   // subtraction
-  inline Vector3D operator-(const Vector3D &v) const {
-    return Vector3D(x - v.x, y - v.y, z - v.z);
+  constexpr BasicVector3D operator-(const BasicVector3D &v) const {
+    return BasicVector3D(x - v.x, y - v.y, z - v.z);
   }
 
   // right scalar multiplication
-  inline Vector3D operator*(const double &c) const {
-    return Vector3D(x * c, y * c, z * c);
+  constexpr BasicVector3D operator*(const T &c) const {
+    return BasicVector3D(x * c, y * c, z * c);
   }
 
   // scalar division
-  inline Vector3D operator/(const double &c) const {
-    const double rc = 1.0 / c;
-    return Vector3D(rc * x, rc * y, rc * z);
+  constexpr BasicVector3D operator/(const T &c) const {
+    return (*this) * (T(1) / c);
   }
 
   // addition / assignment
-  inline void operator+=(const Vector3D &v) {
+  inline void operator+=(const BasicVector3D &v) {
     x += v.x;
     y += v.y;
     z += v.z;
   }
 
   // subtraction / assignment
-  inline void operator-=(const Vector3D &v) {
+  inline void operator-=(const BasicVector3D &v) {
     x -= v.x;
     y -= v.y;
     z -= v.z;
   }
 
   // scalar multiplication / assignment
-  inline void operator*=(const double &c) {
+  inline void operator*=(const T &c) {
     x *= c;
     y *= c;
     z *= c;
   }
 
   // scalar division / assignment
-  inline void operator/=(const double &c) { (*this) *= (1. / c); }
+  inline void operator/=(const T &c) { (*this) *= (T(1) / c); }
 
   /**
    * Returns Euclidean length.
    */
-  inline double norm(void) const { return sqrt(x * x + y * y + z * z); }
+  inline T norm(void) const { return std::sqrt(x * x + y * y + z * z); }
 
   /**
    * Returns Euclidean length squared.
    */
-  inline double norm2(void) const { return x * x + y * y + z * z; }
+  constexpr T norm2(void) const { return x * x + y * y + z * z; }
 
   /**
    * Returns unit vector.
    */
-  inline Vector3D unit(void) const {
-    double rNorm = 1. / sqrt(x * x + y * y + z * z);
-    return Vector3D(rNorm * x, rNorm * y, rNorm * z);
+  inline BasicVector3D unit(void) const {
+    T rNorm = T(1) / std::sqrt(x * x + y * y + z * z);
+    return BasicVector3D(rNorm * x, rNorm * y, rNorm * z);
   }
 
   /**
@@ -124,26 +135,33 @@ public:
    */
   inline void normalize(void) { (*this) /= norm(); }
 
-}; // class Vector3D
+}; // class BasicVector3D
 
 // left scalar multiplication
-inline Vector3D operator*(const double &c, const Vector3D &v) {
-  return Vector3D(c * v.x, c * v.y, c * v.z);
+template <typename T>
+constexpr BasicVector3D<T>
+operator*(const typename BasicVector3D<T>::Scalar &c,
+          const BasicVector3D<T> &v) {
+  return BasicVector3D<T>(c * v.x, c * v.y, c * v.z);
 }
 
 // dot product (a.k.a. inner or scalar product)
-inline double dot(const Vector3D &u, const Vector3D &v) {
+template <typename T>
+constexpr T dot(const BasicVector3D<T> &u, const BasicVector3D<T> &v) {
   return u.x * v.x + u.y * v.y + u.z * v.z;
 }
 
 // cross product
-inline Vector3D cross(const Vector3D &u, const Vector3D &v) {
-  return Vector3D(u.y * v.z - u.z * v.y, u.z * v.x - u.x * v.z,
-                  u.x * v.y - u.y * v.x);
+template <typename T>
+constexpr BasicVector3D<T> cross(const BasicVector3D<T> &u,
+                                 const BasicVector3D<T> &v) {
+  return BasicVector3D<T>(u.y * v.z - u.z * v.y, u.z * v.x - u.x * v.z,
+                          u.x * v.y - u.y * v.x);
 }
 
 // prints components
-std::ostream &operator<<(std::ostream &os, const Vector3D &v);
+template <typename T>
+std::ostream &operator<<(std::ostream &os, const BasicVector3D<T> &v);
 
 } // namespace CMU462
 
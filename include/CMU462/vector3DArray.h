@@ -0,0 +1,166 @@
+#ifndef CMU462_VECTOR3DARRAY_H
+#define CMU462_VECTOR3DARRAY_H
+
+#include "CMU462.h"
+#include "vector3D.h"
+
+#include <cstddef>
+
+namespace CMU462 {
+
+/**
+ * Defines a resizable array of 3D vectors stored as a structure of arrays.
+ * The x, y and z components live in three separate 32-byte aligned arrays
+ * so that the batch operations below process several vectors per
+ * instruction (SSE2 or AVX2, selected at runtime). Individual elements are
+ * read and written as Vector3D through get() and set().
+ */
+class Vector3DArray {
+public:
+  /**
+   * Constructor.
+   * Initializes to an empty array.
+   */
+  Vector3DArray() : n(0), cap(0), data(NULL) {}
+
+  /**
+   * Constructor.
+   * Initializes to n zero vectors.
+   */
+  explicit Vector3DArray(size_t n);
+
+  /**
+   * Constructor.
+   * Initializes from n vectors stored contiguously (gather).
+   */
+  Vector3DArray(const Vector3D *v, size_t n);
+
+  /**
+   * Constructor.
+   * Initializes from existing array.
+   */
+  Vector3DArray(const Vector3DArray &a);
+
+  ~Vector3DArray();
+
+  Vector3DArray &operator=(const Vector3DArray &a);
+
+  // number of vectors
+  inline size_t size(void) const { return n; }
+  inline size_t capacity(void) const { return cap; }
+  inline bool empty(void) const { return n == 0; }
+
+  // component arrays, each holding size() values
+  inline double *x(void) { return data; }
+  inline double *y(void) { return data + cap; }
+  inline double *z(void) { return data + 2 * cap; }
+  inline const double *x(void) const { return data; }
+  inline const double *y(void) const { return data + cap; }
+  inline const double *z(void) const { return data + 2 * cap; }
+
+  // returns the ith vector
+  inline Vector3D get(size_t i) const {
+    return Vector3D(data[i], data[cap + i], data[2 * cap + i]);
+  }
+
+  // sets the ith vector to v
+  inline void set(size_t i, const Vector3D &v) {
+    data[i] = v.x;
+    data[cap + i] = v.y;
+    data[2 * cap + i] = v.z;
+  }
+
+  // returns the ith vector
+  inline Vector3D operator[](size_t i) const { return get(i); }
+
+  /**
+   * Changes the number of vectors. New vectors are set to zero.
+   */
+  void resize(size_t n);
+
+  /**
+   * Makes room for at least n vectors without changing the size.
+   */
+  void reserve(size_t n);
+
+  /**
+   * Removes all vectors. The storage is kept.
+   */
+  inline void clear(void) { n = 0; }
+
+  /**
+   * Appends v to the end of the array.
+   */
+  void push_back(const Vector3D &v);
+
+  /**
+   * Replaces the contents with n vectors stored contiguously in v.
+   */
+  void gather(const Vector3D *v, size_t n);
+
+  /**
+   * Writes all vectors contiguously into v, which must hold size() vectors.
+   */
+  void scatter(Vector3D *v) const;
+
+  /**
+   * Writes the Euclidean length of each vector into out.
+   */
+  void norm(double *out) const;
+
+  /**
+   * Writes the Euclidean length squared of each vector into out.
+   */
+  void norm2(double *out) const;
+
+  /**
+   * Writes the unit vector of each vector into out, which is resized to
+   * match. out may be this array.
+   */
+  void unit(Vector3DArray &out) const;
+
+  /**
+   * Divides each vector by its Euclidean length.
+   */
+  inline void normalize(void) { unit(*this); }
+
+  /**
+   * Returns the componentwise minimum over all vectors.
+   * REQUIRES: the array is not empty.
+   */
+  Vector3D min(void) const;
+
+  /**
+   * Returns the componentwise maximum over all vectors.
+   * REQUIRES: the array is not empty.
+   */
+  Vector3D max(void) const;
+
+private:
+  size_t n;     ///< number of vectors
+  size_t cap;   ///< allocated vectors per component array
+  double *data; ///< x, y and z arrays back to back, each cap long
+
+}; // class Vector3DArray
+
+/**
+ * Writes dot(u[i], v[i]) into out[i].
+ * REQUIRES: u and v have the same size, out holds that many values.
+ */
+void dot(const Vector3DArray &u, const Vector3DArray &v, double *out);
+
+/**
+ * Writes cross(u[i], v[i]) into out[i], resizing out to match.
+ * REQUIRES: u and v have the same size. out may alias u or v.
+ */
+void cross(const Vector3DArray &u, const Vector3DArray &v, Vector3DArray &out);
+
+/**
+ * Computes y[i] += a * x[i].
+ * REQUIRES: x and y have the same size.
+ */
+void axpy(double a, const Vector3DArray &x, Vector3DArray &y);
+
+} // namespace CMU462
+
+#endif // CMU462_VECTOR3DARRAY_H
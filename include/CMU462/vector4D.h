@@ -10,99 +10,113 @@
 namespace CMU462 {
 
 /**
- * Defines 4D standard vectors.
+ * Defines 4D standard vectors over the scalar type T.
+ * Vector4D (double) and Vector4f (float) are the instantiated types.
  */
-class Vector4D {
+template <typename T>
+class BasicVector4D {
 public:
+  typedef T Scalar;
+
   // components
-  double x, y, z, w;
+  T x, y, z, w;
 
   /**
    * Constructor.
    * Initializes tp vector (0,0,0, 0).
    */
-  Vector4D() : x(0.0), y(0.0), z(0.0), w(0.0) {}
+  constexpr BasicVector4D() : x(0), y(0), z(0), w(0) {}
 
   /**
    * Constructor.
    * Initializes to vector (x,y,z,w).
    */
-  Vector4D(double x, double y, double z, double w) : x(x), y(y), z(z), w(w) {}
+  constexpr BasicVector4D(T x, T y, T z, T w) : x(x), y(y), z(z), w(w) {}
 
   /**
    * Constructor.
    * Initializes to vector (x,y,z,0).
    */
-  Vector4D(double x, double y, double z) : x(x), y(y), z(z), w(0.0) {}
+  constexpr BasicVector4D(T x, T y, T z) : x(x), y(y), z(z), w(0) {}
 
   /**
    * Constructor.
    * Initializes to vector (c,c,c,c)
    */
-  Vector4D(double c) : x(c), y(c), z(c), w(c) {}
+  constexpr BasicVector4D(T c) : x(c), y(c), z(c), w(c) {}
 
   /**
    * Constructor.
    * Initializes from existing vector4D.
    */
-  Vector4D(const Vector4D &v) : x(v.x), y(v.y), z(v.z), w(v.w) {}
+  constexpr BasicVector4D(const BasicVector4D &v)
+      : x(v.x), y(v.y), z(v.z), w(v.w) {}
 
   /**
    * Constructor.
    * Initializes from existing vector3D.
    * Note that the w component is initialied to 1.
    */
-  Vector4D(const Vector3D &v) : x(v.x), y(v.y), z(v.z), w(1.0) {}
+  constexpr BasicVector4D(const BasicVector3D<T> &v)
+      : x(v.x), y(v.y), z(v.z), w(1) {}
 
   /**
     * Constructor.
     * Initializes from existing vector3D and w value.
     */
-  Vector4D(const Vector3D &v, double w) : x(v.x), y(v.y), z(v.z), w(w) {}
+  constexpr BasicVector4D(const BasicVector3D<T> &v, T w)
+      : x(v.x), y(v.y), z(v.z), w(w) {}
+
+  /**
+   * Constructor.
+   * Converts from a vector of another scalar type.
+   */
+  template <typename U>
+  constexpr explicit BasicVector4D(const BasicVector4D<U> &v)
+      : x(T(v.x)), y(T(v.y)), z(T(v.z)), w(T(v.w)) {}
 
   // returns reference to the specified component (0-based indexing: x, y, z)
-  inline double &operator[](const int &index) { return (&x)[index]; }
+  inline T &operator[](const int &index) { return (&x)[index]; }
 
   // returns const reference to the specified component (0-based indexing: x, y,
   // z)
-  inline const double &operator[](const int &index) const {
-    return (&x)[index];
-  }
+  inline const T &operator[](const int &index) const { return (&x)[index]; }
 
   // negation
-  inline Vector4D operator-(void) const { return Vector4D(-x, -y, -z, -w); }
+  constexpr BasicVector4D operator-(void) const {
+    return BasicVector4D(-x, -y, -z, -w);
+  }
 
   // addition
-  inline Vector4D operator+(const Vector4D &v) const {
-    return Vector4D(x + v.x, y + v.y, z + v.z, w + v.w);
+  constexpr BasicVector4D operator+(const BasicVector4D &v) const {
+    return BasicVector4D(x + v.x, y + v.y, z + v.z, w + v.w);
   }
 
   // subtraction
-  inline Vector4D operator-(const Vector4D &v) const {
-    return Vector4D(x - v.x, y - v.y, z - v.z, w - v.w);
+  constexpr BasicVector4D operator-(const BasicVector4D &v) const {
+    return BasicVector4D(x - v.x, y - v.y, z - v.z, w - v.w);
   }
 
   // right scalar multiplication
-  inline Vector4D operator*(const double &c) const {
-    return Vector4D(x * c, y * c, z * c, w * c);
+  constexpr BasicVector4D operator*(const T &c) const {
+    return BasicVector4D(x * c, y * c, z * c, w * c);
   }
 
   // scalar division
-  inline Vector4D operator/(const double &c) const {
-    const double rc = 1.0 / c;
-    return Vector4D(rc * x, rc * y, rc * z, rc * w);
+  constexpr BasicVector4D operator/(const T &c) const {
+    return (*this) * (T(1) / c);
   }
 
   // addition / assignment
-  inline void operator+=(const Vector4D &v) {
+  inline void operator+=(const BasicVector4D &v) {
     x += v.x;
     y += v.y;
     z += v.z;
-    z += v.w;
+    w += v.w;
   }
 
   // subtraction / assignment
-  inline void operator-=(const Vector4D &v) {
+  inline void operator-=(const BasicVector4D &v) {
     x -= v.x;
     y -= v.y;
     z -= v.z;
@@ -110,7 +124,7 @@ public:
   }
 
   // scalar multiplication / assignment
-  inline void operator*=(const double &c) {
+  inline void operator*=(const T &c) {
     x *= c;
     y *= c;
     z *= c;
@@ -118,24 +132,24 @@ public:
   }
 
   // scalar division / assignment
-  inline void operator/=(const double &c) { (*this) *= (1. / c); }
+  inline void operator/=(const T &c) { (*this) *= (T(1) / c); }
 
   /**
    * Returns Euclidean distance metric extended to 4 dimensions.
    */
-  inline double norm(void) const { return sqrt(x * x + y * y + z * z + w * w); }
+  inline T norm(void) const { return std::sqrt(x * x + y * y + z * z + w * w); }
 
   /**
    * Returns Euclidean length squared.
    */
-  inline double norm2(void) const { return x * x + y * y + z * z + w * w; }
+  constexpr T norm2(void) const { return x * x + y * y + z * z + w * w; }
 
   /**
    * Returns unit vector. (returns the normalized copy of this vector.)
    */
-  inline Vector4D unit(void) const {
-    double rNorm = 1. / sqrt(x * x + y * y + z * z + w * w);
-    return Vector4D(rNorm * x, rNorm * y, rNorm * z);
+  inline BasicVector4D unit(void) const {
+    T rNorm = T(1) / std::sqrt(x * x + y * y + z * z + w * w);
+    return BasicVector4D(rNorm * x, rNorm * y, rNorm * z, rNorm * w);
   }
 
   /**
@@ -147,28 +161,32 @@ public:
   /**
    * Converts this vector to a 3D vector ignoring the w component.
    */
-  Vector3D to3D();
+  BasicVector3D<T> to3D();
 
   /**
    * Converts this vector to a 3D vector by dividing x, y, and z by w.
    */
-  Vector3D projectTo3D();
+  BasicVector3D<T> projectTo3D();
 
-}; // class Vector4D
+}; // class BasicVector4D
 
 // left scalar multiplication
-inline Vector4D operator*(const double &c, const Vector4D &v) {
-  return Vector4D(c * v.x, c * v.y, c * v.z, c * v.w);
+template <typename T>
+constexpr BasicVector4D<T>
+operator*(const typename BasicVector4D<T>::Scalar &c,
+          const BasicVector4D<T> &v) {
+  return BasicVector4D<T>(c * v.x, c * v.y, c * v.z, c * v.w);
 }
 
 // dot product (a.k.a. inner or scalar product)
-inline double dot(const Vector4D &u, const Vector4D &v) {
+template <typename T>
+constexpr T dot(const BasicVector4D<T> &u, const BasicVector4D<T> &v) {
   return u.x * v.x + u.y * v.y + u.z * v.z + u.w * v.w;
-  ;
 }
 
 // prints components
-std::ostream &operator<<(std::ostream &os, const Vector4D &v);
+template <typename T>
+std::ostream &operator<<(std::ostream &os, const BasicVector4D<T> &v);
 
 } // namespace CMU462
 
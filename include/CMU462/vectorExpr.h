@@ -0,0 +1,278 @@
+#ifndef CMU462_VECTOREXPR_H
+#define CMU462_VECTOREXPR_H
+
+#include "CMU462.h"
+#include "vector3D.h"
+#include "vector4D.h"
+#include "vector3DArray.h"
+
+#include <cstddef>
+#include <type_traits>
+
+namespace CMU462 {
+
+/**
+ * Opt-in expression templates for Vector3D, Vector4D and Vector3DArray.
+ *
+ * Wrapping an operand in lazy() makes the operators below build an
+ * expression object instead of computing a temporary vector for every
+ * operator. The expression is evaluated in one pass, one component at a
+ * time, when it is converted to a vector or assigned to an array:
+ *
+ *   Vector3D p = lazy(a) * s + lazy(b) * t - c;
+ *   assign(x, lazy(x) + lazy(v) * dt); // x, v are Vector3DArrays
+ *
+ * Only componentwise operations are supported (+, -, negation, scaling by
+ * a scalar), so every output component depends only on the same component
+ * of the operands, and the output array may also appear as an operand.
+ * Plain vectors combine with expressions, but an expression is only formed
+ * once one operand has been made lazy; ordinary vector arithmetic is not
+ * affected by including this header.
+ */
+namespace Expr {
+
+/**
+ * Base class of all expression nodes (CRTP). A node E provides
+ *   typedef ... Scalar;         the scalar type
+ *   static const int dim;       the number of components (3 or 4)
+ *   Scalar at(size_t i, int k); component k of element i
+ *   size_t size();              the number of elements, 0 if not an array
+ * Nodes hold their operands by value; leaves are vectors or pointers.
+ */
+template <typename E>
+struct Node {
+  inline const E &self(void) const { return static_cast<const E &>(*this); }
+
+  // evaluates into a 3D vector
+  template <typename T>
+  inline operator BasicVector3D<T>(void) const {
+    static_assert(E::dim == 3, "expression is not three dimensional");
+    const E &e = self();
+    return BasicVector3D<T>(e.at(0, 0), e.at(0, 1), e.at(0, 2));
+  }
+
+  // evaluates into a 4D vector
+  template <typename T>
+  inline operator BasicVector4D<T>(void) const {
+    static_assert(E::dim == 4, "expression is not four dimensional");
+    const E &e = self();
+    return BasicVector4D<T>(e.at(0, 0), e.at(0, 1), e.at(0, 2), e.at(0, 3));
+  }
+};
+
+// a single vector, broadcast over all elements
+template <typename T, int N>
+struct Vector : public Node<Vector<T, N> > {
+  typedef T Scalar;
+  static const int dim = N;
+  T v[N];
+
+  Vector(const BasicVector3D<T> &u) : v{u.x, u.y, u.z} {}
+  Vector(const BasicVector4D<T> &u) : v{u.x, u.y, u.z, u.w} {}
+
+  inline T at(size_t, int k) const { return v[k]; }
+  inline size_t size(void) const { return 0; }
+};
+
+// the elements of a Vector3DArray
+struct Array : public Node<Array> {
+  typedef double Scalar;
+  static const int dim = 3;
+  const double *c[3];
+  size_t n;
+
+  Array(const Vector3DArray &a) : c{a.x(), a.y(), a.z()}, n(a.size()) {}
+
+  inline double at(size_t i, int k) const { return c[k][i]; }
+  inline size_t size(void) const { return n; }
+};
+
+template <typename A, typename B>
+struct Sum : public Node<Sum<A, B> > {
+  typedef typename A::Scalar Scalar;
+  static const int dim = A::dim;
+  static_assert(A::dim == B::dim, "adding vectors of different dimension");
+  A a;
+  B b;
+
+  Sum(const A &a, const B &b) : a(a), b(b) {}
+
+  inline Scalar at(size_t i, int k) const { return a.at(i, k) + b.at(i, k); }
+  inline size_t size(void) const {
+    return a.size() > b.size() ? a.size() : b.size();
+  }
+};
+
+template <typename A, typename B>
+struct Difference : public Node<Difference<A, B> > {
+  typedef typename A::Scalar Scalar;
+  static const int dim = A::dim;
+  static_assert(A::dim == B::dim,
+                "subtracting vectors of different dimension");
+  A a;
+  B b;
+
+  Difference(const A &a, const B &b) : a(a), b(b) {}
+
+  inline Scalar at(size_t i, int k) const { return a.at(i, k) - b.at(i, k); }
+  inline size_t size(void) const {
+    return a.size() > b.size() ? a.size() : b.size();
+  }
+};
+
+template <typename A>
+struct Negation : public Node<Negation<A> > {
+  typedef typename A::Scalar Scalar;
+  static const int dim = A::dim;
+  A a;
+
+  Negation(const A &a) : a(a) {}
+
+  inline Scalar at(size_t i, int k) const { return -a.at(i, k); }
+  inline size_t size(void) const { return a.size(); }
+};
+
+template <typename A>
+struct Scaled : public Node<Scaled<A> > {
+  typedef typename A::Scalar Scalar;
+  static const int dim = A::dim;
+  A a;
+  Scalar c;
+
+  Scaled(const A &a, Scalar c) : a(a), c(c) {}
+
+  inline Scalar at(size_t i, int k) const { return a.at(i, k) * c; }
+  inline size_t size(void) const { return a.size(); }
+};
+
+// true if X is an expression node
+template <typename X>
+struct IsNode : public std::is_base_of<Node<X>, X> {};
+
+// maps an operand type to the node type that stores it; value is false
+// for types that cannot be operands
+template <typename X, bool = IsNode<X>::value>
+struct Wrap {
+  static const bool value = false;
+};
+
+template <typename E>
+struct Wrap<E, true> {
+  static const bool value = true;
+  typedef E type;
+};
+
+template <typename T>
+struct Wrap<BasicVector3D<T>, false> {
+  static const bool value = true;
+  typedef Vector<T, 3> type;
+};
+
+template <typename T>
+struct Wrap<BasicVector4D<T>, false> {
+  static const bool value = true;
+  typedef Vector<T, 4> type;
+};
+
+// node type for a binary operation on A and B, defined if either is a node
+// and both are valid operands
+template <template <typename, typename> class Op, typename A, typename B,
+          bool = (IsNode<A>::value || IsNode<B>::value) && Wrap<A>::value &&
+                 Wrap<B>::value>
+struct Binary {};
+
+template <template <typename, typename> class Op, typename A, typename B>
+struct Binary<Op, A, B, true> {
+  typedef Op<typename Wrap<A>::type, typename Wrap<B>::type> type;
+};
+
+// addition
+template <typename A, typename B>
+inline typename Binary<Sum, A, B>::type operator+(const A &a, const B &b) {
+  return typename Binary<Sum, A, B>::type(a, b);
+}
+
+// subtraction
+template <typename A, typename B>
+inline typename Binary<Difference, A, B>::type operator-(const A &a,
+                                                         const B &b) {
+  return typename Binary<Difference, A, B>::type(a, b);
+}
+
+// negation
+template <typename E>
+inline Negation<E> operator-(const Node<E> &a) {
+  return Negation<E>(a.self());
+}
+
+// right scalar multiplication
+template <typename E>
+inline Scaled<E> operator*(const Node<E> &a, typename E::Scalar c) {
+  return Scaled<E>(a.self(), c);
+}
+
+// left scalar multiplication
+template <typename E>
+inline Scaled<E> operator*(typename E::Scalar c, const Node<E> &a) {
+  return Scaled<E>(a.self(), c);
+}
+
+// scalar division
+template <typename E>
+inline Scaled<E> operator/(const Node<E> &a, typename E::Scalar c) {
+  return Scaled<E>(a.self(), typename E::Scalar(1) / c);
+}
+
+} // namespace Expr
+
+/**
+ * Starts a lazily evaluated expression, see Expr.
+ */
+template <typename T>
+inline Expr::Vector<T, 3> lazy(const BasicVector3D<T> &v) {
+  return Expr::Vector<T, 3>(v);
+}
+
+template <typename T>
+inline Expr::Vector<T, 4> lazy(const BasicVector4D<T> &v) {
+  return Expr::Vector<T, 4>(v);
+}
+
+inline Expr::Array lazy(const Vector3DArray &a) { return Expr::Array(a); }
+
+/**
+ * Evaluates the expression e into a BasicVector3D or BasicVector4D.
+ */
+template <typename E>
+inline typename std::conditional<E::dim == 3,
+                                 BasicVector3D<typename E::Scalar>,
+                                 BasicVector4D<typename E::Scalar> >::type
+eval(const Expr::Node<E> &e) {
+  return e;
+}
+
+/**
+ * Evaluates the array expression e into out, which is resized to match.
+ * Each component is computed in its own loop over the elements, which the
+ * compiler vectorizes. out may appear in e.
+ * REQUIRES: the arrays in e have the same size.
+ */
+template <typename E>
+inline void assign(Vector3DArray &out, const Expr::Node<E> &e) {
+  static_assert(E::dim == 3, "expression is not three dimensional");
+  const E &x = e.self();
+  size_t n = x.size();
+  out.resize(n);
+
+  double *c[3] = {out.x(), out.y(), out.z()};
+  for (int k = 0; k < 3; k++) {
+    double *o = c[k];
+    for (size_t i = 0; i < n; i++) {
+      o[i] = x.at(i, k);
+    }
+  }
+}
+
+} // namespace CMU462
+
+#endif // CMU462_VECTOREXPR_H
@@ -0,0 +1,70 @@
+#include "affine3.h"
+
+#include <iostream>
+
+namespace CMU462 {
+
+template <typename S>
+BasicAffine3<S> BasicAffine3<S>::inv(void) const {
+  // The rows of the inverse of [a b c] are the cross products
+  // b x c, c x a, a x b divided by the determinant.
+  BasicVector3D<S> r0 = cross(A[1], A[2]);
+  BasicVector3D<S> r1 = cross(A[2], A[0]);
+  BasicVector3D<S> r2 = cross(A[0], A[1]);
+
+  // Invertable iff the determinant is not equal to zero.
+  S rdet = S(1) / dot(A[0], r0);
+  r0 *= rdet;
+  r1 *= rdet;
+  r2 *= rdet;
+
+  BasicMatrix3x3<S> B = BasicMatrix3x3<S>(r0, r1, r2).T();
+  return BasicAffine3<S>(B, BasicVector3D<S>(-dot(r0, t), -dot(r1, t),
+                                             -dot(r2, t)));
+}
+
+template <typename S>
+std::ostream &operator<<(std::ostream &os, const BasicAffine3<S> &T) {
+  const BasicMatrix3x3<S> &A = T.linear();
+  const BasicVector3D<S> &t = T.translation();
+
+  for (int i = 0; i < 3; i++) {
+    os << "[ ";
+
+    for (int j = 0; j < 3; j++) {
+      os << A(i, j) << " ";
+    }
+
+    os << "| " << t[i] << " ]" << std::endl;
+  }
+
+  return os;
+}
+
+void transformPoints(const Affine3 &T, const Vector3D *in, Vector3D *out,
+                     size_t n) {
+  transformPoints(T.toMatrix4x4(), in, out, n);
+}
+
+void transformPoints(const Affine3f &T, const Vector3f *in, Vector3f *out,
+                     size_t n) {
+  transformPoints(T.toMatrix4x4(), in, out, n);
+}
+
+void transformVectors(const Affine3 &T, const Vector3D *in, Vector3D *out,
+                      size_t n) {
+  transformVectors(T.toMatrix4x4(), in, out, n);
+}
+
+void transformVectors(const Affine3f &T, const Vector3f *in, Vector3f *out,
+                      size_t n) {
+  transformVectors(T.toMatrix4x4(), in, out, n);
+}
+
+template class BasicAffine3<double>;
+template class BasicAffine3<float>;
+
+template std::ostream &operator<<(std::ostream &os, const Affine3 &T);
+template std::ostream &operator<<(std::ostream &os, const Affine3f &T);
+
+} // namespace CMU462
@@ -0,0 +1,791 @@
+#include "bvh.h"
+#include "simd.h"
+#include "morton.h"
+
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+
+using namespace std;
+
+namespace CMU462 {
+
+static_assert(sizeof(BVH::Node) == 32, "BVH::Node must be 32 bytes");
+
+//------------------------------------------------------------------------------
+// Build
+//
+// The hierarchy is first built into BuildNodes, allocated from a shared
+// array in whatever order the tasks finish, and then flattened depth
+// first into the 32-byte nodes. Each node partitions its range of the
+// primitive order in place.
+//------------------------------------------------------------------------------
+
+// SAH bins per axis.
+static const int kBins = 32;
+
+// Cost of traversing an inner node relative to intersecting a primitive.
+static const double kTraversalCost = 1;
+
+// Past this depth nodes are split at the median, which bounds the depth
+// (see kBVHStackSize) for any input.
+static const int kMaxDepth = 64;
+
+// Subtrees with fewer primitives are built by a single task.
+static const size_t kTaskGrain = 4096;
+
+// Nodes with more primitives are bounded and binned in parallel chunks of
+// this size.
+static const size_t kChunk = 65536;
+
+struct BuildNode {
+  BBox box;
+  uint32_t left, right; ///< children of inner nodes
+  uint32_t begin;       ///< first entry of the primitive order
+  uint32_t count;       ///< number of primitives of leaves, 0 otherwise
+  int axis;             ///< split axis of inner nodes
+};
+
+struct BuildContext {
+  const BBox *bounds;
+  vector<Vector3D> centroids;
+  uint32_t *order;
+  vector<BuildNode> nodes;
+  uint32_t used; ///< nodes allocated so far
+  size_t maxLeafSize;
+};
+
+struct Bins {
+  BBox box[3][kBins];
+  uint32_t count[3][kBins];
+};
+
+// maps centroids to bins, per axis
+struct Binning {
+  double min[3], scale[3];
+
+  Binning(const BBox &cbox) {
+    for (int a = 0; a < 3; a++) {
+      double e = cbox.max[a] - cbox.min[a];
+      min[a] = cbox.min[a];
+      scale[a] = e > 0 ? kBins * (1 - 1e-9) / e : 0;
+    }
+  }
+
+  inline int bin(const Vector3D &c, int a) const {
+    int b = (int)((c[a] - min[a]) * scale[a]);
+    return std::min(std::max(b, 0), kBins - 1);
+  }
+};
+
+static void rangeBounds(const BuildContext *ctx, size_t begin, size_t end,
+                        BBox *box, BBox *cbox) {
+  size_t n = end - begin;
+  if (n <= kChunk) {
+    for (size_t i = begin; i < end; i++) {
+      uint32_t p = ctx->order[i];
+      box->expand(ctx->bounds[p]);
+      cbox->expand(ctx->centroids[p]);
+    }
+    return;
+  }
+
+  size_t chunks = (n + kChunk - 1) / kChunk;
+  vector<BBox> b(chunks), c(chunks);
+  for (size_t k = 0; k < chunks; k++) {
+    size_t i = begin + k * kChunk;
+#pragma omp task shared(b, c)
+    rangeBounds(ctx, i, min(end, i + kChunk), &b[k], &c[k]);
+  }
+#pragma omp taskwait
+  for (size_t k = 0; k < chunks; k++) {
+    box->expand(b[k]);
+    cbox->expand(c[k]);
+  }
+}
+
+static void binRange(const BuildContext *ctx, const Binning &binning,
+                     size_t begin, size_t end, Bins *bins) {
+  size_t n = end - begin;
+  if (n <= kChunk) {
+    for (int a = 0; a < 3; a++)
+      for (int b = 0; b < kBins; b++) {
+        bins->box[a][b] = BBox();
+        bins->count[a][b] = 0;
+      }
+    for (size_t i = begin; i < end; i++) {
+      uint32_t p = ctx->order[i];
+      for (int a = 0; a < 3; a++) {
+        int b = binning.bin(ctx->centroids[p], a);
+        bins->box[a][b].expand(ctx->bounds[p]);
+        bins->count[a][b]++;
+      }
+    }
+    return;
+  }
+
+  size_t chunks = (n + kChunk - 1) / kChunk;
+  vector<Bins> partial(chunks);
+  for (size_t k = 0; k < chunks; k++) {
+    size_t i = begin + k * kChunk;
+#pragma omp task shared(partial, binning)
+    binRange(ctx, binning, i, min(end, i + kChunk), &partial[k]);
+  }
+#pragma omp taskwait
+  *bins = partial[0];
+  for (size_t k = 1; k < chunks; k++) {
+    for (int a = 0; a < 3; a++)
+      for (int b = 0; b < kBins; b++) {
+        bins->box[a][b].expand(partial[k].box[a][b]);
+        bins->count[a][b] += partial[k].count[a][b];
+      }
+  }
+}
+
+// Finds the SAH split of the bins with the lowest cost. Returns false if
+// there is none (all centroids in one bin on every axis).
+static bool bestSplit(const Bins &bins, int &axis, int &split,
+                      double &cost) {
+  bool found = false;
+  for (int a = 0; a < 3; a++) {
+    // areas and counts of bins [0, b] and [b + 1, kBins)
+    double leftArea[kBins], rightArea[kBins];
+    uint32_t leftCount[kBins], rightCount[kBins];
+    BBox l, r;
+    uint32_t nl = 0, nr = 0;
+    for (int b = 0; b < kBins; b++) {
+      l.expand(bins.box[a][b]);
+      nl += bins.count[a][b];
+      leftArea[b] = l.surfaceArea();
+      leftCount[b] = nl;
+
+      int c = kBins - 1 - b;
+      rightArea[c] = r.surfaceArea();
+      rightCount[c] = nr;
+      r.expand(bins.box[a][c]);
+      nr += bins.count[a][c];
+    }
+
+    for (int b = 0; b < kBins - 1; b++) {
+      if (!leftCount[b] || !rightCount[b]) continue;
+      double c = leftArea[b] * leftCount[b] + rightArea[b] * rightCount[b];
+      if (!found || c < cost) {
+        found = true;
+        cost = c;
+        axis = a;
+        split = b;
+      }
+    }
+  }
+  return found;
+}
+
+static uint32_t buildNode(BuildContext *ctx, size_t begin, size_t end,
+                          int depth) {
+  uint32_t index;
+#pragma omp atomic capture
+  index = ctx->used++;
+
+  size_t n = end - begin;
+  BBox box, cbox;
+  rangeBounds(ctx, begin, end, &box, &cbox);
+
+  BuildNode &node = ctx->nodes[index];
+  node.box = box;
+  node.begin = (uint32_t)begin;
+  node.count = (uint32_t)n;
+  node.axis = 0;
+  if (n == 1) return index;
+
+  size_t mid = begin;
+  int axis = cbox.maxAxis();
+  if (depth < kMaxDepth) {
+    Binning binning(cbox);
+    Bins bins;
+    binRange(ctx, binning, begin, end, &bins);
+    int split = 0;
+    double cost = 0;
+    if (bestSplit(bins, axis, split, cost)) {
+      cost = kTraversalCost + cost / box.surfaceArea();
+      if (n <= ctx->maxLeafSize && cost >= n) return index;
+
+      const vector<Vector3D> &c = ctx->centroids;
+      mid = partition(ctx->order + begin, ctx->order + end,
+                      [&](uint32_t p) {
+                        return binning.bin(c[p], axis) <= split;
+                      }) -
+            ctx->order;
+    } else if (n <= ctx->maxLeafSize) {
+      return index;
+    }
+  }
+
+  if (mid == begin || mid == end) {
+    // median split, along the longest axis of the centroids
+    mid = begin + n / 2;
+    const vector<Vector3D> &c = ctx->centroids;
+    nth_element(ctx->order + begin, ctx->order + mid, ctx->order + end,
+                [&](uint32_t p, uint32_t q) {
+                  return c[p][axis] < c[q][axis];
+                });
+  }
+
+  uint32_t left, right;
+  if (n > kTaskGrain) {
+#pragma omp task shared(left)
+    left = buildNode(ctx, begin, mid, depth + 1);
+    right = buildNode(ctx, mid, end, depth + 1);
+#pragma omp taskwait
+  } else {
+    left = buildNode(ctx, begin, mid, depth + 1);
+    right = buildNode(ctx, mid, end, depth + 1);
+  }
+
+  BuildNode &inner = ctx->nodes[index];
+  inner.left = left;
+  inner.right = right;
+  inner.count = 0;
+  inner.axis = axis;
+  return index;
+}
+
+// float bounds containing the double bounds
+static inline float roundDown(double x) {
+  float f = (float)x;
+  return f > x ? nextafterf(f, -INFINITY) : f;
+}
+
+static inline float roundUp(double x) {
+  float f = (float)x;
+  return f < x ? nextafterf(f, INFINITY) : f;
+}
+
+static inline void setBounds(BVH::Node &node, const BBox &box) {
+  for (int a = 0; a < 3; a++) {
+    node.min[a] = roundDown(box.min[a]);
+    node.max[a] = roundUp(box.max[a]);
+  }
+}
+
+static void flatten(const BuildContext &ctx, uint32_t b,
+                    vector<BVH::Node> &out) {
+  const BuildNode &bn = ctx.nodes[b];
+  uint32_t i = (uint32_t)out.size();
+  out.push_back(BVH::Node());
+
+  BVH::Node node;
+  setBounds(node, bn.box);
+  node.axis = (uint16_t)bn.axis;
+  if (bn.count) {
+    node.offset = bn.begin;
+    node.count = (uint16_t)bn.count;
+  } else {
+    node.count = 0;
+    flatten(ctx, bn.left, out);
+    node.offset = (uint32_t)out.size();
+    flatten(ctx, bn.right, out);
+  }
+  out[i] = node;
+}
+
+void BVH::build(const BBox *bounds, size_t n, size_t maxLeafSize) {
+  tree.clear();
+  order.resize(n);
+  if (!n) return;
+
+  BuildContext ctx;
+  ctx.bounds = bounds;
+  ctx.centroids.resize(n);
+  ctx.order = &order[0];
+  ctx.nodes.resize(2 * n - 1);
+  ctx.used = 0;
+  ctx.maxLeafSize = max((size_t)1, min(maxLeafSize, (size_t)0xFFFF));
+
+#pragma omp parallel for
+  for (long i = 0; i < (long)n; i++) {
+    ctx.centroids[i] = bounds[i].centroid();
+    order[i] = (uint32_t)i;
+  }
+
+  uint32_t root = 0;
+#pragma omp parallel
+#pragma omp single
+  root = buildNode(&ctx, 0, n, 0);
+
+  tree.reserve(ctx.used);
+  flatten(ctx, root, tree);
+}
+
+//------------------------------------------------------------------------------
+// Linear build
+//
+// The binary radix tree over the sorted codes has an inner node for each
+// pair of neighbouring primitives, and each inner node finds its range and
+// split from the keys alone (Karras 2012). The keys are the codes with the
+// sorted position appended, which makes them unique.
+//
+// Subtrees of at most maxLeafSize primitives become leaves, so a subtree
+// with k leaves has 2k - 1 flat nodes. Each inner node marks the first
+// primitive of its children that become leaves, and a prefix sum over the
+// marks then gives the size of any subtree, hence the depth-first
+// position of every node before any node is written. The nodes are then
+// written top down in parallel and bounded on the way back up.
+//------------------------------------------------------------------------------
+
+struct RadixNode {
+  uint32_t first, last; ///< range of sorted primitives
+  uint32_t split;       ///< last primitive of the left child
+  uint32_t axis;
+};
+
+struct LinearContext {
+  const BBox *bounds;
+  const uint32_t *order;
+  vector<uint64_t> keys;
+  vector<RadixNode> nodes;
+  vector<uint32_t> leaves; ///< leaves starting at or before each primitive
+  size_t maxLeafSize;
+};
+
+static inline int leadingZeros(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_clzll(x);
+#else
+  int n = 0;
+  for (; !(x >> 63); x <<= 1) n++;
+  return n;
+#endif
+}
+
+// length of the common prefix of keys i and j, -1 if j is out of range
+static inline int commonPrefix(const vector<uint64_t> &keys, long i, long j) {
+  if (j < 0 || j >= (long)keys.size()) return -1;
+  return leadingZeros(keys[i] ^ keys[j]);
+}
+
+static void radixNode(LinearContext *ctx, long i) {
+  const vector<uint64_t> &k = ctx->keys;
+
+  // direction of the range and its other end j, by exponential then
+  // binary search
+  int d = commonPrefix(k, i, i + 1) > commonPrefix(k, i, i - 1) ? 1 : -1;
+  int minPrefix = commonPrefix(k, i, i - d);
+  long maxLength = 2;
+  while (commonPrefix(k, i, i + maxLength * d) > minPrefix) maxLength *= 2;
+  long length = 0;
+  for (long t = maxLength / 2; t >= 1; t /= 2)
+    if (commonPrefix(k, i, i + (length + t) * d) > minPrefix) length += t;
+  long j = i + length * d;
+
+  // split: the last key sharing more than the common prefix of the range
+  int prefix = commonPrefix(k, i, j);
+  long s = 0;
+  for (long t = length; t > 1;) {
+    t = (t + 1) / 2;
+    if (commonPrefix(k, i, i + (s + t) * d) > prefix) s += t;
+  }
+
+  RadixNode &node = ctx->nodes[i];
+  node.first = (uint32_t)min(i, j);
+  node.last = (uint32_t)max(i, j);
+  node.split = (uint32_t)(i + s * d + min(d, 0));
+
+  // the highest differing bit of the range, if in the code, tells the axis
+  int bit = 63 - prefix;
+  node.axis = bit >= 32 ? 2 - (bit - 32) % 3 : 0;
+
+  // mark the children that become leaves
+  size_t m = ctx->maxLeafSize;
+  if (node.last - node.first < m) return;
+  if (node.split - node.first < m) ctx->leaves[node.first] = 1;
+  if (node.last - node.split <= m) ctx->leaves[node.split + 1] = 1;
+}
+
+// number of flat nodes of the subtree over [first, last]
+static inline uint32_t radixSize(const LinearContext *ctx, uint32_t first,
+                                 uint32_t last) {
+  if (last - first < ctx->maxLeafSize) return 1;
+  uint32_t k = ctx->leaves[last] - (first ? ctx->leaves[first - 1] : 0);
+  return 2 * k - 1;
+}
+
+static void emitRadix(const LinearContext *ctx, uint32_t first,
+                      uint32_t last, uint32_t i, uint32_t pos,
+                      BVH::Node *out) {
+  BVH::Node &flat = out[pos];
+  if (last - first < ctx->maxLeafSize) {
+    BBox box;
+    for (uint32_t k = first; k <= last; k++)
+      box.expand(ctx->bounds[ctx->order[k]]);
+    setBounds(flat, box);
+    flat.offset = first;
+    flat.count = (uint16_t)(last - first + 1);
+    flat.axis = 0;
+    return;
+  }
+
+  // i is the inner node over [first, last]; its children are the inner
+  // nodes numbered like their end on the split, unless single primitives
+  const RadixNode &node = ctx->nodes[i];
+  uint32_t split = node.split;
+  uint32_t right = pos + 1 + radixSize(ctx, first, split);
+  if (last - first >= kTaskGrain) {
+#pragma omp task
+    emitRadix(ctx, first, split, split, pos + 1, out);
+    emitRadix(ctx, split + 1, last, split + 1, right, out);
+#pragma omp taskwait
+  } else {
+    emitRadix(ctx, first, split, split, pos + 1, out);
+    emitRadix(ctx, split + 1, last, split + 1, right, out);
+  }
+
+  const BVH::Node &l = out[pos + 1], &r = out[right];
+  for (int a = 0; a < 3; a++) {
+    flat.min[a] = std::min(l.min[a], r.min[a]);
+    flat.max[a] = std::max(l.max[a], r.max[a]);
+  }
+  flat.offset = right;
+  flat.count = 0;
+  flat.axis = (uint16_t)node.axis;
+}
+
+void BVH::buildLinear(const BBox *bounds, size_t n, size_t maxLeafSize) {
+  tree.clear();
+  order.resize(n);
+  if (!n) return;
+
+  // centroids and their bounds
+  vector<Vector3D> centroids(n);
+  long blocks = (long)((n + kChunk - 1) / kChunk);
+  vector<BBox> partial(blocks);
+#pragma omp parallel for if (blocks > 1)
+  for (long b = 0; b < blocks; b++) {
+    size_t end = min(n, (b + 1) * kChunk);
+    for (size_t i = b * kChunk; i < end; i++) {
+      centroids[i] = bounds[i].centroid();
+      partial[b].expand(centroids[i]);
+      order[i] = (uint32_t)i;
+    }
+  }
+  BBox cbox;
+  for (long b = 0; b < blocks; b++) cbox.expand(partial[b]);
+
+  vector<uint32_t> codes(n);
+  mortonCodes(&centroids[0], n, cbox, &codes[0]);
+  radixSort(&codes[0], &order[0], n);
+
+  LinearContext ctx;
+  ctx.bounds = bounds;
+  ctx.order = &order[0];
+  ctx.maxLeafSize = max((size_t)1, min(maxLeafSize, (size_t)0xFFFF));
+  ctx.keys.resize(n);
+  ctx.nodes.resize(n - 1);
+  ctx.leaves.resize(n);
+
+#pragma omp parallel for if (blocks > 1)
+  for (long i = 0; i < (long)n; i++) {
+    ctx.keys[i] = (uint64_t)codes[i] << 32 | (uint64_t)i;
+    ctx.leaves[i] = 0;
+  }
+
+#pragma omp parallel for if (blocks > 1)
+  for (long i = 0; i < (long)n - 1; i++) radixNode(&ctx, i);
+  if (n <= ctx.maxLeafSize) ctx.leaves[0] = 1;
+
+  // inclusive prefix sum of the marks, by blocks
+  vector<uint32_t> blockSums(blocks + 1, 0);
+#pragma omp parallel for if (blocks > 1)
+  for (long b = 0; b < blocks; b++) {
+    size_t end = min(n, (b + 1) * kChunk);
+    uint32_t sum = 0;
+    for (size_t i = b * kChunk; i < end; i++) sum = ctx.leaves[i] += sum;
+    blockSums[b + 1] = sum;
+  }
+  for (long b = 0; b < blocks; b++) blockSums[b + 1] += blockSums[b];
+#pragma omp parallel for if (blocks > 1)
+  for (long b = 1; b < blocks; b++) {
+    size_t end = min(n, (b + 1) * kChunk);
+    for (size_t i = b * kChunk; i < end; i++) ctx.leaves[i] += blockSums[b];
+  }
+
+  tree.resize(radixSize(&ctx, 0, (uint32_t)n - 1));
+#pragma omp parallel
+#pragma omp single
+  emitRadix(&ctx, 0, (uint32_t)n - 1, 0, 0, &tree[0]);
+}
+
+//------------------------------------------------------------------------------
+// Refit
+//------------------------------------------------------------------------------
+
+// Hierarchies with fewer nodes are refit by one thread.
+static const size_t kRefitGrain = 16384;
+
+void BVH::refit(const BBox *bounds) {
+  long n = (long)tree.size();
+
+#pragma omp parallel for if ((size_t)n > kRefitGrain)
+  for (long i = 0; i < n; i++) {
+    Node &node = tree[i];
+    if (!node.leaf()) continue;
+    BBox box;
+    for (uint32_t k = 0; k < node.count; k++)
+      box.expand(bounds[order[node.offset + k]]);
+    setBounds(node, box);
+  }
+
+  // children come after their parent in depth-first order
+  for (long i = n - 1; i >= 0; i--) {
+    Node &node = tree[i];
+    if (node.leaf()) continue;
+    const Node &l = tree[i + 1], &r = tree[node.offset];
+    for (int a = 0; a < 3; a++) {
+      node.min[a] = std::min(l.min[a], r.min[a]);
+      node.max[a] = std::max(l.max[a], r.max[a]);
+    }
+  }
+}
+
+BBox BVH::bounds(void) const {
+  if (tree.empty()) return BBox();
+  const Node &root = tree[0];
+  return BBox(Vector3D(root.min[0], root.min[1], root.min[2]),
+              Vector3D(root.max[0], root.max[1], root.max[2]));
+}
+
+void triangleBounds(const Vector3D *vertices, const int *indices,
+                    BBox *bounds, size_t n) {
+#pragma omp parallel for if (n > kRefitGrain)
+  for (long i = 0; i < (long)n; i++) {
+    const int *t = indices + 3 * i;
+    BBox box(vertices[t[0]]);
+    box.expand(vertices[t[1]]);
+    box.expand(vertices[t[2]]);
+    bounds[i] = box;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Wide hierarchies
+//------------------------------------------------------------------------------
+
+static inline double surfaceArea(const BVH::Node &n) {
+  double x = n.max[0] - n.min[0], y = n.max[1] - n.min[1];
+  double z = n.max[2] - n.min[2];
+  return 2 * (x * y + y * z + z * x);
+}
+
+template <int W>
+static inline void setChild(typename WideBVH<W>::Node &node, int c,
+                            const float min[3], const float max[3]) {
+  for (int a = 0; a < 3; a++) {
+    node.min[a][c] = min[a];
+    node.max[a][c] = max[a];
+  }
+}
+
+template <int W>
+uint32_t WideBVH<W>::collapse(const BVH &bvh, uint32_t b) {
+  const vector<BVH::Node> &bn = bvh.nodes();
+
+  // children of b, opening the inner child with the largest area until
+  // there are W of them
+  uint32_t c[W];
+  int m = 0;
+  if (bn[b].leaf()) {
+    c[m++] = b;
+  } else {
+    c[m++] = b + 1;
+    c[m++] = bn[b].offset;
+  }
+  while (m < W) {
+    int best = -1;
+    double area = -1;
+    for (int k = 0; k < m; k++) {
+      if (!bn[c[k]].leaf() && surfaceArea(bn[c[k]]) > area) {
+        best = k;
+        area = surfaceArea(bn[c[k]]);
+      }
+    }
+    if (best < 0) break;
+    uint32_t o = c[best];
+    c[best] = o + 1;
+    c[m++] = bn[o].offset;
+  }
+
+  uint32_t i = (uint32_t)tree.size();
+  tree.push_back(Node());
+
+  Node node;
+  const float none[3] = {NAN, NAN, NAN};
+  for (int k = 0; k < W; k++) {
+    if (k >= m) {
+      setChild<W>(node, k, none, none);
+      node.child[k] = kEmpty;
+      node.count[k] = 0;
+      continue;
+    }
+    const BVH::Node &n = bn[c[k]];
+    setChild<W>(node, k, n.min, n.max);
+    node.count[k] = n.count;
+    node.child[k] = n.leaf() ? n.offset : collapse(bvh, c[k]);
+  }
+  tree[i] = node;
+  return i;
+}
+
+template <int W>
+WideBVH<W>::WideBVH(const BVH &bvh) : order(bvh.primitives()) {
+  if (bvh.nodes().empty()) return;
+  tree.reserve(bvh.nodes().size() / (W - 1) + 1);
+  collapse(bvh, 0);
+}
+
+template <int W>
+void WideBVH<W>::refit(const BBox *bounds) {
+  long n = (long)tree.size();
+
+#pragma omp parallel for if ((size_t)n * W > kRefitGrain)
+  for (long i = 0; i < n; i++) {
+    Node &node = tree[i];
+    for (int c = 0; c < W; c++) {
+      if (!node.count[c]) continue;
+      BBox box;
+      for (uint32_t k = 0; k < node.count[c]; k++)
+        box.expand(bounds[order[node.child[c] + k]]);
+      for (int a = 0; a < 3; a++) {
+        node.min[a][c] = roundDown(box.min[a]);
+        node.max[a][c] = roundUp(box.max[a]);
+      }
+    }
+  }
+
+  for (long i = n - 1; i >= 0; i--) {
+    Node &node = tree[i];
+    for (int c = 0; c < W; c++) {
+      if (node.count[c] || node.child[c] == kEmpty) continue;
+      const Node &child = tree[node.child[c]];
+      for (int a = 0; a < 3; a++) {
+        node.min[a][c] = INFINITY;
+        node.max[a][c] = -INFINITY;
+      }
+      for (int k = 0; k < W && child.child[k] != kEmpty; k++) {
+        for (int a = 0; a < 3; a++) {
+          node.min[a][c] = std::min(node.min[a][c], child.min[a][k]);
+          node.max[a][c] = std::max(node.max[a][c], child.max[a][k]);
+        }
+      }
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Wide slab kernels
+//
+// Test one ray against the W children of a node, four per iteration with
+// SSE2 and eight with AVX2. The exit parameter is enlarged and the entry
+// parameter reduced by kSlabTolerance (relative) to make up for the
+// rounding of the single precision computation.
+//
+// The scalar kernel orders its comparisons like minps/maxps, which return
+// the second operand if either is NaN, so that the NaN bounds of unused
+// children never hit at any level.
+//------------------------------------------------------------------------------
+
+static const float kSlabTolerance = 1e-6f;
+
+template <int W>
+static int slab_scalar(const float (&mn)[3][W], const float (&mx)[3][W],
+                       const float o[3], const float invD[3], float t0,
+                       float t1, float *tEnter) {
+  int mask = 0;
+  for (int c = 0; c < W; c++) {
+    float tn = t0, tf = t1;
+    for (int a = 0; a < 3; a++) {
+      float ta = (mn[a][c] - o[a]) * invD[a];
+      float tb = (mx[a][c] - o[a]) * invD[a];
+      float lo = ta < tb ? ta : tb, hi = ta > tb ? ta : tb;
+      tn = tn > lo ? tn : lo;
+      tf = tf < hi ? tf : hi;
+    }
+    if (tn <= tf + fabsf(tf) * kSlabTolerance) {
+      mask |= 1 << c;
+      tEnter[c] = tn - fabsf(tn) * kSlabTolerance;
+    }
+  }
+  return mask;
+}
+
+#ifdef CMU462_SSE2
+template <int W>
+static int slab_sse2(const float (&mn)[3][W], const float (&mx)[3][W],
+                     const float o[3], const float invD[3], float t0,
+                     float t1, float *tEnter) {
+  const __m128 sign = _mm_set1_ps(-0.0f);
+  const __m128 tol = _mm_set1_ps(kSlabTolerance);
+  int mask = 0;
+  for (int g = 0; g + 4 <= W; g += 4) {
+    __m128 tn = _mm_set1_ps(t0), tf = _mm_set1_ps(t1);
+    for (int a = 0; a < 3; a++) {
+      __m128 oa = _mm_set1_ps(o[a]), ia = _mm_set1_ps(invD[a]);
+      __m128 ta = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(mn[a] + g), oa), ia);
+      __m128 tb = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(mx[a] + g), oa), ia);
+      tn = _mm_max_ps(tn, _mm_min_ps(ta, tb));
+      tf = _mm_min_ps(tf, _mm_max_ps(ta, tb));
+    }
+    tf = _mm_add_ps(tf, _mm_mul_ps(_mm_andnot_ps(sign, tf), tol));
+    tn = _mm_sub_ps(tn, _mm_mul_ps(_mm_andnot_ps(sign, tn), tol));
+    _mm_storeu_ps(tEnter + g, tn);
+    mask |= _mm_movemask_ps(_mm_cmple_ps(tn, tf)) << g;
+  }
+  return mask;
+}
+#endif
+
+#ifdef CMU462_AVX2
+template <int W>
+CMU462_TARGET_AVX2 static int
+slab_avx2(const float (&mn)[3][W], const float (&mx)[3][W], const float o[3],
+          const float invD[3], float t0, float t1, float *tEnter) {
+  const __m256 sign = _mm256_set1_ps(-0.0f);
+  const __m256 tol = _mm256_set1_ps(kSlabTolerance);
+  int mask = 0;
+  for (int g = 0; g + 8 <= W; g += 8) {
+    __m256 tn = _mm256_set1_ps(t0), tf = _mm256_set1_ps(t1);
+    for (int a = 0; a < 3; a++) {
+      __m256 oa = _mm256_set1_ps(o[a]), ia = _mm256_set1_ps(invD[a]);
+      __m256 ta =
+          _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(mn[a] + g), oa), ia);
+      __m256 tb =
+          _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(mx[a] + g), oa), ia);
+      tn = _mm256_max_ps(tn, _mm256_min_ps(ta, tb));
+      tf = _mm256_min_ps(tf, _mm256_max_ps(ta, tb));
+    }
+    tf = _mm256_fmadd_ps(_mm256_andnot_ps(sign, tf), tol, tf);
+    tn = _mm256_fnmadd_ps(_mm256_andnot_ps(sign, tn), tol, tn);
+    _mm256_storeu_ps(tEnter + g, tn);
+    mask |= _mm256_movemask_ps(_mm256_cmp_ps(tn, tf, _CMP_LE_OQ)) << g;
+  }
+  return mask;
+}
+#endif
+
+template <int W>
+int WideBVH<W>::hitChildren(const Node &node, const float o[3],
+                            const float invD[3], float t0, float t1,
+                            float tEnter[W]) {
+#ifdef CMU462_AVX2
+  if (W % 8 == 0 && SIMD::hasAVX2())
+    return slab_avx2<W>(node.min, node.max, o, invD, t0, t1, tEnter);
+#endif
+#ifdef CMU462_SSE2
+  if (SIMD::hasSSE2())
+    return slab_sse2<W>(node.min, node.max, o, invD, t0, t1, tEnter);
+#endif
+  return slab_scalar<W>(node.min, node.max, o, invD, t0, t1, tEnter);
+}
+
+template class WideBVH<4>;
+template class WideBVH<8>;
+
+} // namespace CMU462
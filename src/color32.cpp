@@ -0,0 +1,473 @@
+#include "color32.h"
+#include "simd.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+using namespace std;
+
+namespace CMU462 {
+
+static_assert(sizeof(Color32) == 4, "Color32 must be 4 bytes");
+static_assert(sizeof(Color) == 4 * sizeof(float), "Color must be 4 floats");
+
+//------------------------------------------------------------------------------
+// Hex
+//------------------------------------------------------------------------------
+
+Color32 Color32::fromHex(const char *s) {
+  if (!strcmp(s, "none")) return Color32(0, 0, 0, 0);
+  if (s[0] == '#') s++;
+
+  // like the stream in Color::fromHex(), stops at the first non hex digit
+  unsigned long rgb = strtoul(s, NULL, 16);
+  return Color32((rgb >> 16) & 0xFF, (rgb >> 8) & 0xFF, rgb & 0xFF, 255);
+}
+
+string Color32::toHex(void) const {
+  char s[8];
+  snprintf(s, sizeof(s), "#%02x%02x%02x", r, g, b);
+  return s;
+}
+
+//------------------------------------------------------------------------------
+// Conversion kernels
+//
+// Each kernel converts colors [i, n) and leaves the tail to the scalar
+// kernel. Both directions round once, the same way at every level.
+//------------------------------------------------------------------------------
+
+static void c2p_scalar(size_t i, size_t n, const Color *in, Color32 *out) {
+  for (; i < n; i++) out[i] = Color32(in[i]);
+}
+
+static void p2c_scalar(size_t i, size_t n, const Color32 *in, Color *out) {
+  for (; i < n; i++) out[i] = in[i].toColor();
+}
+
+#ifdef CMU462_SSE2
+// one color to channels in 32-bit lanes
+static inline __m128i c2p4_sse2(const Color *c) {
+  __m128 v = _mm_loadu_ps(&c->r);
+  v = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+  return _mm_cvtps_epi32(_mm_mul_ps(v, _mm_set1_ps(255.0f)));
+}
+
+static void c2p_sse2(size_t i, size_t n, const Color *in, Color32 *out) {
+  for (; i + 4 <= n; i += 4) {
+    __m128i a = _mm_packs_epi32(c2p4_sse2(in + i), c2p4_sse2(in + i + 1));
+    __m128i b = _mm_packs_epi32(c2p4_sse2(in + i + 2), c2p4_sse2(in + i + 3));
+    _mm_storeu_si128((__m128i *)(out + i), _mm_packus_epi16(a, b));
+  }
+  c2p_scalar(i, n, in, out);
+}
+
+static void p2c_sse2(size_t i, size_t n, const Color32 *in, Color *out) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128 scale = _mm_set1_ps(255.0f);
+  for (; i + 4 <= n; i += 4) {
+    __m128i p = _mm_loadu_si128((const __m128i *)(in + i));
+    __m128i lo = _mm_unpacklo_epi8(p, zero), hi = _mm_unpackhi_epi8(p, zero);
+    float *o = &out[i].r;
+    _mm_storeu_ps(o, _mm_div_ps(
+        _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), scale));
+    _mm_storeu_ps(o + 4, _mm_div_ps(
+        _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), scale));
+    _mm_storeu_ps(o + 8, _mm_div_ps(
+        _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), scale));
+    _mm_storeu_ps(o + 12, _mm_div_ps(
+        _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), scale));
+  }
+  p2c_scalar(i, n, in, out);
+}
+#endif
+
+#ifdef CMU462_AVX2
+// two colors to channels in 32-bit lanes
+CMU462_TARGET_AVX2
+static inline __m256i c2p8_avx2(const Color *c) {
+  __m256 v = _mm256_loadu_ps(&c->r);
+  v = _mm256_min_ps(_mm256_max_ps(v, _mm256_setzero_ps()),
+                    _mm256_set1_ps(1.0f));
+  return _mm256_cvtps_epi32(_mm256_mul_ps(v, _mm256_set1_ps(255.0f)));
+}
+
+CMU462_TARGET_AVX2
+static void c2p_avx2(size_t i, size_t n, const Color *in, Color32 *out) {
+  for (; i + 8 <= n; i += 8) {
+    // the packs work within 128-bit lanes, the permute restores the order
+    __m256i a = _mm256_packs_epi32(c2p8_avx2(in + i), c2p8_avx2(in + i + 2));
+    __m256i b =
+        _mm256_packs_epi32(c2p8_avx2(in + i + 4), c2p8_avx2(in + i + 6));
+    __m256i p = _mm256_permutevar8x32_epi32(
+        _mm256_packus_epi16(a, b), _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+    _mm256_storeu_si256((__m256i *)(out + i), p);
+  }
+  c2p_scalar(i, n, in, out);
+}
+
+CMU462_TARGET_AVX2
+static void p2c_avx2(size_t i, size_t n, const Color32 *in, Color *out) {
+  const __m256 scale = _mm256_set1_ps(255.0f);
+  for (; i + 2 <= n; i += 2) {
+    __m128i p = _mm_loadl_epi64((const __m128i *)(in + i));
+    __m256 c = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(p));
+    _mm256_storeu_ps(&out[i].r, _mm256_div_ps(c, scale));
+  }
+  p2c_scalar(i, n, in, out);
+}
+#endif
+
+// Colors per block; blocks are converted in parallel.
+static const size_t kColorBlock = 16384;
+
+template <typename In, typename Out>
+static void convert(void (*kernel)(size_t, size_t, const In *, Out *),
+                    const In *in, Out *out, size_t n) {
+  long blocks = (long)((n + kColorBlock - 1) / kColorBlock);
+#pragma omp parallel for if (blocks > 1)
+  for (long b = 0; b < blocks; b++) {
+    size_t i = b * kColorBlock;
+    kernel(i, min(n, i + kColorBlock), in, out);
+  }
+}
+
+void toColor32(const Color *in, Color32 *out, size_t n) {
+  void (*kernel)(size_t, size_t, const Color *, Color32 *) = c2p_scalar;
+#ifdef CMU462_SSE2
+  if (SIMD::hasSSE2()) kernel = c2p_sse2;
+#endif
+#ifdef CMU462_AVX2
+  if (SIMD::hasAVX2()) kernel = c2p_avx2;
+#endif
+  convert(kernel, in, out, n);
+}
+
+void fromColor32(const Color32 *in, Color *out, size_t n) {
+  void (*kernel)(size_t, size_t, const Color32 *, Color *) = p2c_scalar;
+#ifdef CMU462_SSE2
+  if (SIMD::hasSSE2()) kernel = p2c_sse2;
+#endif
+#ifdef CMU462_AVX2
+  if (SIMD::hasAVX2()) kernel = p2c_avx2;
+#endif
+  convert(kernel, in, out, n);
+}
+
+//------------------------------------------------------------------------------
+// Span kernels
+//
+// The vector kernels widen the channels to 16 bits, which hold the
+// products of two channels, and divide by 255 with the same rounding as
+// Color32::mul().
+//------------------------------------------------------------------------------
+
+// u / 255 rounded to nearest, for u <= 255 * 255
+static inline uint8_t div255(uint32_t u) {
+  u += 128;
+  return (uint8_t)((u + (u >> 8)) >> 8);
+}
+
+// x + y saturated to 255
+static inline uint8_t adds(uint32_t x, uint32_t y) {
+  return (uint8_t)min(255u, x + y);
+}
+
+static void fill_scalar(size_t i, size_t n, Color32 c, Color32 *dst) {
+  for (; i < n; i++) dst[i] = c;
+}
+
+static void over_scalar(size_t i, size_t n, const Color32 *src,
+                        Color32 *dst) {
+  for (; i < n; i++) {
+    Color32 s = src[i], &d = dst[i];
+    uint32_t t = 255 - s.a;
+    d.r = div255(s.r * s.a + d.r * t);
+    d.g = div255(s.g * s.a + d.g * t);
+    d.b = div255(s.b * s.a + d.b * t);
+    d.a = div255(255 * s.a + d.a * t);
+  }
+}
+
+static void overPre_scalar(size_t i, size_t n, const Color32 *src,
+                           Color32 *dst) {
+  for (; i < n; i++) {
+    Color32 s = src[i], &d = dst[i];
+    uint32_t t = 255 - s.a;
+    d.r = adds(s.r, div255(d.r * t));
+    d.g = adds(s.g, div255(d.g * t));
+    d.b = adds(s.b, div255(d.b * t));
+    d.a = adds(s.a, div255(d.a * t));
+  }
+}
+
+static void premul_scalar(size_t i, size_t n, Color32 *pixels) {
+  for (; i < n; i++) pixels[i] = pixels[i].premultiplied();
+}
+
+#ifdef CMU462_SSE2
+static inline __m128i div255_sse2(__m128i u) {
+  u = _mm_add_epi16(u, _mm_set1_epi16(128));
+  return _mm_srli_epi16(_mm_add_epi16(u, _mm_srli_epi16(u, 8)), 8);
+}
+
+// the alpha of the two pixels in 16-bit lanes, in all four channels
+static inline __m128i alpha_sse2(__m128i c) {
+  c = _mm_shufflelo_epi16(c, _MM_SHUFFLE(3, 3, 3, 3));
+  return _mm_shufflehi_epi16(c, _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+// s over d for the two pixels in 16-bit lanes; o is s with alpha 255
+static inline __m128i over_sse2(__m128i s, __m128i o, __m128i d) {
+  __m128i a = alpha_sse2(s);
+  __m128i t = _mm_sub_epi16(_mm_set1_epi16(255), a);
+  return div255_sse2(
+      _mm_add_epi16(_mm_mullo_epi16(o, a), _mm_mullo_epi16(d, t)));
+}
+
+static inline __m128i overPre_sse2(__m128i s, __m128i d) {
+  __m128i t = _mm_sub_epi16(_mm_set1_epi16(255), alpha_sse2(s));
+  return div255_sse2(_mm_mullo_epi16(d, t));
+}
+
+static void fill_sse2(size_t i, size_t n, Color32 c, Color32 *dst) {
+  __m128i v = _mm_set1_epi32((int)c.packed());
+  for (; i + 4 <= n; i += 4) _mm_storeu_si128((__m128i *)(dst + i), v);
+  fill_scalar(i, n, c, dst);
+}
+
+static void over_sse2(size_t i, size_t n, const Color32 *src,
+                      Color32 *dst) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i opaque = _mm_set1_epi32((int)0xFF000000);
+  for (; i + 4 <= n; i += 4) {
+    __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+    __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+    __m128i o = _mm_or_si128(s, opaque);
+    __m128i lo = over_sse2(_mm_unpacklo_epi8(s, zero),
+                           _mm_unpacklo_epi8(o, zero),
+                           _mm_unpacklo_epi8(d, zero));
+    __m128i hi = over_sse2(_mm_unpackhi_epi8(s, zero),
+                           _mm_unpackhi_epi8(o, zero),
+                           _mm_unpackhi_epi8(d, zero));
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(lo, hi));
+  }
+  over_scalar(i, n, src, dst);
+}
+
+static void overPre_sse2(size_t i, size_t n, const Color32 *src,
+                         Color32 *dst) {
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 4 <= n; i += 4) {
+    __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+    __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+    __m128i lo = overPre_sse2(_mm_unpacklo_epi8(s, zero),
+                              _mm_unpacklo_epi8(d, zero));
+    __m128i hi = overPre_sse2(_mm_unpackhi_epi8(s, zero),
+                              _mm_unpackhi_epi8(d, zero));
+    d = _mm_adds_epu8(s, _mm_packus_epi16(lo, hi));
+    _mm_storeu_si128((__m128i *)(dst + i), d);
+  }
+  overPre_scalar(i, n, src, dst);
+}
+
+static void premul_sse2(size_t i, size_t n, Color32 *pixels) {
+  const __m128i zero = _mm_setzero_si128();
+  // the alpha channel is multiplied by 255, which keeps it
+  const __m128i keep = _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255);
+  for (; i + 4 <= n; i += 4) {
+    __m128i p = _mm_loadu_si128((const __m128i *)(pixels + i));
+    __m128i lo = _mm_unpacklo_epi8(p, zero), hi = _mm_unpackhi_epi8(p, zero);
+    lo = div255_sse2(
+        _mm_mullo_epi16(lo, _mm_or_si128(alpha_sse2(lo), keep)));
+    hi = div255_sse2(
+        _mm_mullo_epi16(hi, _mm_or_si128(alpha_sse2(hi), keep)));
+    _mm_storeu_si128((__m128i *)(pixels + i), _mm_packus_epi16(lo, hi));
+  }
+  premul_scalar(i, n, pixels);
+}
+#endif
+
+#ifdef CMU462_AVX2
+CMU462_TARGET_AVX2
+static inline __m256i div255_avx2(__m256i u) {
+  u = _mm256_add_epi16(u, _mm256_set1_epi16(128));
+  return _mm256_srli_epi16(_mm256_add_epi16(u, _mm256_srli_epi16(u, 8)), 8);
+}
+
+CMU462_TARGET_AVX2
+static inline __m256i alpha_avx2(__m256i c) {
+  c = _mm256_shufflelo_epi16(c, _MM_SHUFFLE(3, 3, 3, 3));
+  return _mm256_shufflehi_epi16(c, _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+CMU462_TARGET_AVX2
+static inline __m256i over_avx2(__m256i s, __m256i o, __m256i d) {
+  __m256i a = alpha_avx2(s);
+  __m256i t = _mm256_sub_epi16(_mm256_set1_epi16(255), a);
+  return div255_avx2(
+      _mm256_add_epi16(_mm256_mullo_epi16(o, a), _mm256_mullo_epi16(d, t)));
+}
+
+CMU462_TARGET_AVX2
+static inline __m256i overPre_avx2(__m256i s, __m256i d) {
+  __m256i t = _mm256_sub_epi16(_mm256_set1_epi16(255), alpha_avx2(s));
+  return div255_avx2(_mm256_mullo_epi16(d, t));
+}
+
+CMU462_TARGET_AVX2
+static void fill_avx2(size_t i, size_t n, Color32 c, Color32 *dst) {
+  __m256i v = _mm256_set1_epi32((int)c.packed());
+  for (; i + 8 <= n; i += 8) _mm256_storeu_si256((__m256i *)(dst + i), v);
+  fill_scalar(i, n, c, dst);
+}
+
+// The unpacks and packs below work within 128-bit lanes, so they give
+// the pixels back in order.
+
+CMU462_TARGET_AVX2
+static void over_avx2(size_t i, size_t n, const Color32 *src,
+                      Color32 *dst) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i opaque = _mm256_set1_epi32((int)0xFF000000);
+  for (; i + 8 <= n; i += 8) {
+    __m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+    __m256i d = _mm256_loadu_si256((const __m256i *)(dst + i));
+    __m256i o = _mm256_or_si256(s, opaque);
+    __m256i lo = over_avx2(_mm256_unpacklo_epi8(s, zero),
+                           _mm256_unpacklo_epi8(o, zero),
+                           _mm256_unpacklo_epi8(d, zero));
+    __m256i hi = over_avx2(_mm256_unpackhi_epi8(s, zero),
+                           _mm256_unpackhi_epi8(o, zero),
+                           _mm256_unpackhi_epi8(d, zero));
+    _mm256_storeu_si256((__m256i *)(dst + i), _mm256_packus_epi16(lo, hi));
+  }
+  over_scalar(i, n, src, dst);
+}
+
+CMU462_TARGET_AVX2
+static void overPre_avx2(size_t i, size_t n, const Color32 *src,
+                         Color32 *dst) {
+  const __m256i zero = _mm256_setzero_si256();
+  for (; i + 8 <= n; i += 8) {
+    __m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+    __m256i d = _mm256_loadu_si256((const __m256i *)(dst + i));
+    __m256i lo = overPre_avx2(_mm256_unpacklo_epi8(s, zero),
+                              _mm256_unpacklo_epi8(d, zero));
+    __m256i hi = overPre_avx2(_mm256_unpackhi_epi8(s, zero),
+                              _mm256_unpackhi_epi8(d, zero));
+    d = _mm256_adds_epu8(s, _mm256_packus_epi16(lo, hi));
+    _mm256_storeu_si256((__m256i *)(dst + i), d);
+  }
+  overPre_scalar(i, n, src, dst);
+}
+
+CMU462_TARGET_AVX2
+static void premul_avx2(size_t i, size_t n, Color32 *pixels) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i keep = _mm256_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255, 0, 0,
+                                         0, 255, 0, 0, 0, 255);
+  for (; i + 8 <= n; i += 8) {
+    __m256i p = _mm256_loadu_si256((const __m256i *)(pixels + i));
+    __m256i lo = _mm256_unpacklo_epi8(p, zero);
+    __m256i hi = _mm256_unpackhi_epi8(p, zero);
+    lo = div255_avx2(
+        _mm256_mullo_epi16(lo, _mm256_or_si256(alpha_avx2(lo), keep)));
+    hi = div255_avx2(
+        _mm256_mullo_epi16(hi, _mm256_or_si256(alpha_avx2(hi), keep)));
+    _mm256_storeu_si256((__m256i *)(pixels + i), _mm256_packus_epi16(lo, hi));
+  }
+  premul_scalar(i, n, pixels);
+}
+#endif
+
+//------------------------------------------------------------------------------
+// Spans
+//------------------------------------------------------------------------------
+
+typedef void (*BlendKernel)(size_t, size_t, const Color32 *, Color32 *);
+
+// Pixels of the solid color spans handed to the blend kernels at once.
+static const size_t kSolidChunk = 64;
+
+// blends n pixels of a solid color with the span kernel
+static void blendSolid(BlendKernel kernel, Color32 c, Color32 *dst,
+                       size_t n) {
+  Color32 src[kSolidChunk];
+  fill_scalar(0, min(n, kSolidChunk), c, src);
+  for (size_t i = 0; i < n; i += kSolidChunk)
+    kernel(0, min(kSolidChunk, n - i), src, dst + i);
+}
+
+static BlendKernel overKernel(void) {
+  BlendKernel kernel = over_scalar;
+#ifdef CMU462_SSE2
+  if (SIMD::hasSSE2()) kernel = over_sse2;
+#endif
+#ifdef CMU462_AVX2
+  if (SIMD::hasAVX2()) kernel = over_avx2;
+#endif
+  return kernel;
+}
+
+static BlendKernel overPreKernel(void) {
+  BlendKernel kernel = overPre_scalar;
+#ifdef CMU462_SSE2
+  if (SIMD::hasSSE2()) kernel = overPre_sse2;
+#endif
+#ifdef CMU462_AVX2
+  if (SIMD::hasAVX2()) kernel = overPre_avx2;
+#endif
+  return kernel;
+}
+
+void fill(Color32 *dst, size_t n, Color32 c) {
+  void (*kernel)(size_t, size_t, Color32, Color32 *) = fill_scalar;
+#ifdef CMU462_SSE2
+  if (SIMD::hasSSE2()) kernel = fill_sse2;
+#endif
+#ifdef CMU462_AVX2
+  if (SIMD::hasAVX2()) kernel = fill_avx2;
+#endif
+  kernel(0, n, c, dst);
+}
+
+void copySpan(const Color32 *src, Color32 *dst, size_t n) {
+  // the C library already copies with the widest vectors available
+  memmove(dst, src, n * sizeof(Color32));
+}
+
+void blendOver(const Color32 *src, Color32 *dst, size_t n) {
+  overKernel()(0, n, src, dst);
+}
+
+void blendOver(Color32 src, Color32 *dst, size_t n) {
+  // transparent and opaque colors need no blending
+  if (src.a == 0) return;
+  if (src.a == 255) return fill(dst, n, src);
+  blendSolid(overKernel(), src, dst, n);
+}
+
+void blendOverPremultiplied(const Color32 *src, Color32 *dst, size_t n) {
+  overPreKernel()(0, n, src, dst);
+}
+
+void blendOverPremultiplied(Color32 src, Color32 *dst, size_t n) {
+  if (src.a == 255) return fill(dst, n, src);
+  blendSolid(overPreKernel(), src, dst, n);
+}
+
+void premultiply(Color32 *pixels, size_t n) {
+  void (*kernel)(size_t, size_t, Color32 *) = premul_scalar;
+#ifdef CMU462_SSE2
+  if (SIMD::hasSSE2()) kernel = premul_sse2;
+#endif
+#ifdef CMU462_AVX2
+  if (SIMD::hasAVX2()) kernel = premul_avx2;
+#endif
+  kernel(0, n, pixels);
+}
+
+} // namespace CMU462
@@ -0,0 +1,429 @@
+#include "curves.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace CMU462 {
+
+static_assert(sizeof(Vector2D) == 2 * sizeof(double),
+              "Vector2D must be 2 doubles");
+static_assert(sizeof(Vector3D) == 3 * sizeof(double),
+              "Vector3D must be 3 doubles");
+
+// A Bezier curve of degree 2 or 3 in 2 or 3 dimensions, by coordinates.
+struct Curve {
+  int degree, dims;
+  double p[4][3];
+
+  template <typename V> Curve(const V *points, int degree) : degree(degree) {
+    dims = sizeof(V) / sizeof(double);
+    for (int k = 0; k <= degree; k++) {
+      for (int d = 0; d < dims; d++) p[k][d] = (&points[k].x)[d];
+    }
+  }
+};
+
+//------------------------------------------------------------------------------
+// Kernels
+//
+// Each kernel evaluates the parameters [i, n) by de Casteljau's algorithm,
+// one coordinate at a time, and leaves the tail to the scalar kernel. out
+// holds dims coordinates per point.
+//------------------------------------------------------------------------------
+
+static void casteljau_scalar(size_t i, size_t n, const Curve &c,
+                             const double *t, double *out) {
+  for (; i < n; i++) {
+    for (int d = 0; d < c.dims; d++) {
+      double b[4];
+      for (int k = 0; k <= c.degree; k++) b[k] = c.p[k][d];
+      for (int r = c.degree; r > 0; r--) {
+        for (int k = 0; k < r; k++) b[k] = b[k] + t[i] * (b[k + 1] - b[k]);
+      }
+      out[i * c.dims + d] = b[0];
+    }
+  }
+}
+
+#ifdef CMU462_SSE2
+static void casteljau_sse2(size_t i, size_t n, const Curve &c,
+                           const double *t, double *out) {
+  for (; i + 2 <= n; i += 2) {
+    __m128d tv = _mm_loadu_pd(t + i);
+    for (int d = 0; d < c.dims; d++) {
+      __m128d b[4];
+      for (int k = 0; k <= c.degree; k++) b[k] = _mm_set1_pd(c.p[k][d]);
+      for (int r = c.degree; r > 0; r--) {
+        for (int k = 0; k < r; k++) {
+          b[k] = _mm_add_pd(b[k], _mm_mul_pd(tv, _mm_sub_pd(b[k + 1], b[k])));
+        }
+      }
+      _mm_storel_pd(out + i * c.dims + d, b[0]);
+      _mm_storeh_pd(out + (i + 1) * c.dims + d, b[0]);
+    }
+  }
+  casteljau_scalar(i, n, c, t, out);
+}
+#endif
+
+#ifdef CMU462_AVX2
+CMU462_TARGET_AVX2
+static void casteljau_avx2(size_t i, size_t n, const Curve &c,
+                           const double *t, double *out) {
+  for (; i + 4 <= n; i += 4) {
+    __m256d tv = _mm256_loadu_pd(t + i);
+    for (int d = 0; d < c.dims; d++) {
+      __m256d b[4];
+      for (int k = 0; k <= c.degree; k++) b[k] = _mm256_set1_pd(c.p[k][d]);
+      for (int r = c.degree; r > 0; r--) {
+        for (int k = 0; k < r; k++) {
+          b[k] = _mm256_fmadd_pd(tv, _mm256_sub_pd(b[k + 1], b[k]), b[k]);
+        }
+      }
+      double lanes[4];
+      _mm256_storeu_pd(lanes, b[0]);
+      for (int j = 0; j < 4; j++) out[(i + j) * c.dims + d] = lanes[j];
+    }
+  }
+  casteljau_scalar(i, n, c, t, out);
+}
+#endif
+
+// Parameters per block; blocks are evaluated in parallel.
+static const size_t kCurveBlock = 4096;
+
+static void evaluate(const Curve &c, const double *t, double *out,
+                     size_t n) {
+  void (*kernel)(size_t, size_t, const Curve &, const double *, double *) =
+      casteljau_scalar;
+#ifdef CMU462_SSE2
+  if (SIMD::hasSSE2()) kernel = casteljau_sse2;
+#endif
+#ifdef CMU462_AVX2
+  if (SIMD::hasAVX2()) kernel = casteljau_avx2;
+#endif
+
+  long blocks = (long)((n + kCurveBlock - 1) / kCurveBlock);
+#pragma omp parallel for if (blocks > 1)
+  for (long b = 0; b < blocks; b++) {
+    size_t i = b * kCurveBlock;
+    kernel(i, min(n, i + kCurveBlock), c, t, out);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Batch evaluation
+//------------------------------------------------------------------------------
+
+void quadraticBezier(const Vector2D *p, const double *t, Vector2D *out,
+                     size_t n) {
+  evaluate(Curve(p, 2), t, &out->x, n);
+}
+
+void quadraticBezier(const Vector3D *p, const double *t, Vector3D *out,
+                     size_t n) {
+  evaluate(Curve(p, 2), t, &out->x, n);
+}
+
+void cubicBezier(const Vector2D *p, const double *t, Vector2D *out,
+                 size_t n) {
+  evaluate(Curve(p, 3), t, &out->x, n);
+}
+
+void cubicBezier(const Vector3D *p, const double *t, Vector3D *out,
+                 size_t n) {
+  evaluate(Curve(p, 3), t, &out->x, n);
+}
+
+void catmullRom(const Vector2D *p, const double *t, Vector2D *out,
+                size_t n) {
+  Vector2D b[4];
+  catmullRomToBezier(p, b);
+  evaluate(Curve(b, 3), t, &out->x, n);
+}
+
+void catmullRom(const Vector3D *p, const double *t, Vector3D *out,
+                size_t n) {
+  Vector3D b[4];
+  catmullRomToBezier(p, b);
+  evaluate(Curve(b, 3), t, &out->x, n);
+}
+
+//------------------------------------------------------------------------------
+// Uniform evaluation
+//
+// In the power basis, a coordinate is c3 t^3 + c2 t^2 + c1 t + c0
+// (c3 = 0 for quadratics). Its forward differences with step h are a
+// cubic, a quadratic and a constant in t, so each point takes three
+// additions.
+//------------------------------------------------------------------------------
+
+// Points between exact evaluations.
+static const size_t kRestart = 64;
+
+static void uniform(const Curve &c, double *out, size_t n) {
+  if (n < 2) return;
+  double h = 1.0 / (n - 1);
+  for (int d = 0; d < c.dims; d++) {
+    double p0 = c.p[0][d], p1 = c.p[1][d], p2 = c.p[2][d];
+    double c0 = p0, c1, c2, c3;
+    if (c.degree == 2) {
+      c3 = 0;
+      c2 = p0 - 2 * p1 + p2;
+      c1 = 2 * (p1 - p0);
+    } else {
+      double p3 = c.p[3][d];
+      c3 = p3 - p0 + 3 * (p1 - p2);
+      c2 = 3 * (p0 - 2 * p1 + p2);
+      c1 = 3 * (p1 - p0);
+    }
+
+    for (size_t i = 0; i < n; i += kRestart) {
+      double t = i * h;
+      double f = ((c3 * t + c2) * t + c1) * t + c0;
+      double df = c3 * h * (3 * t * t + 3 * t * h + h * h) +
+                  c2 * h * (2 * t + h) + c1 * h;
+      double ddf = c3 * 6 * h * h * (t + h) + c2 * 2 * h * h;
+      double dddf = c3 * 6 * h * h * h;
+      size_t end = min(n, i + kRestart);
+      for (size_t k = i; k < end; k++) {
+        out[k * c.dims + d] = f;
+        f += df;
+        df += ddf;
+        ddf += dddf;
+      }
+    }
+    out[(n - 1) * c.dims + d] = c.p[c.degree][d];
+  }
+}
+
+void quadraticBezierUniform(const Vector2D *p, Vector2D *out, size_t n) {
+  uniform(Curve(p, 2), &out->x, n);
+}
+
+void quadraticBezierUniform(const Vector3D *p, Vector3D *out, size_t n) {
+  uniform(Curve(p, 2), &out->x, n);
+}
+
+void cubicBezierUniform(const Vector2D *p, Vector2D *out, size_t n) {
+  uniform(Curve(p, 3), &out->x, n);
+}
+
+void cubicBezierUniform(const Vector3D *p, Vector3D *out, size_t n) {
+  uniform(Curve(p, 3), &out->x, n);
+}
+
+void catmullRomUniform(const Vector2D *p, Vector2D *out, size_t n) {
+  Vector2D b[4];
+  catmullRomToBezier(p, b);
+  uniform(Curve(b, 3), &out->x, n);
+}
+
+void catmullRomUniform(const Vector3D *p, Vector3D *out, size_t n) {
+  Vector3D b[4];
+  catmullRomToBezier(p, b);
+  uniform(Curve(b, 3), &out->x, n);
+}
+
+//------------------------------------------------------------------------------
+// Flattening
+//
+// Any quadratic is a segment of the parabola y = x^2, scaled, rotated and
+// moved. The number of segments a parabola needs within a tolerance is
+// proportional to the integral of the square root of its curvature, and
+// spacing the vertices evenly in that integral makes the error of every
+// segment about the same. The integral and its inverse have close
+// closed-form approximations.
+//------------------------------------------------------------------------------
+
+// Share of the tolerance held back from the segments of quadratics: the
+// approximate integrals leave some segments a few percent over, and cubics
+// spend half of it on their approximation by quadratics.
+static const double kMargin = 0.1;
+
+static inline double parabolaIntegral(double x) {
+  const double d = 0.67;
+  return x / (1 - d + sqrt(sqrt(d * d * d * d + 0.25 * x * x)));
+}
+
+static inline double parabolaInvIntegral(double x) {
+  const double b = 0.39;
+  return x * (1 - b + sqrt(b * b + 0.25 * x * x));
+}
+
+// where a quadratic lies on its parabola
+struct QuadraticSubdivision {
+  double a0, a2;  ///< integrals at the ends
+  double u0, inv; ///< parameter of the start, 1 / parameter range
+  double count;   ///< segments needed, times 2 sqrt(tolerance)
+
+  QuadraticSubdivision(const Vector2D *q, double sqrtTol) {
+    Vector2D d01 = q[1] - q[0], d12 = q[2] - q[1], dd = d01 - d12;
+    double c = cross(q[2] - q[0], dd);
+    double x0 = dot(d01, dd) / c, x2 = dot(d12, dd) / c;
+    double scale = fabs(c / (dd.norm() * (x2 - x0)));
+    a0 = parabolaIntegral(x0);
+    a2 = parabolaIntegral(x2);
+    count = 0;
+    if (std::isfinite(scale)) {
+      double da = fabs(a2 - a0), s = sqrt(scale);
+      if (signbit(x0) == signbit(x2)) {
+        count = da * s;
+      } else {
+        // the vertex of the parabola is within the curve: the curvature
+        // there is limited by the tolerance
+        count = sqrtTol * da / parabolaIntegral(sqrtTol / s);
+      }
+    }
+    u0 = parabolaInvIntegral(a0);
+    inv = 1 / (parabolaInvIntegral(a2) - u0);
+  }
+
+  // the curve parameter at a fraction x of the integral
+  inline double t(double x) const {
+    return (parabolaInvIntegral(a0 + (a2 - a0) * x) - u0) * inv;
+  }
+};
+
+// Appends the quadratic from the last point of quads through q1 to q2.
+// When the three are on a line, the parabola is degenerate and the curve
+// may turn back along the line: it is split where it turns, so that each
+// part is a straight segment.
+static void addQuadratic(vector<Vector2D> &quads, const Vector2D &q1,
+                         const Vector2D &q2) {
+  Vector2D q0 = quads.back(), d01 = q1 - q0, dd = d01 - (q2 - q1);
+  double t = dot(d01, dd) / dd.norm2();
+  if (cross(q2 - q0, dd) == 0 && t > 0 && t < 1) {
+    quads.push_back(q0 + t * d01);
+    quads.push_back(quadraticBezier(q0, q1, q2, t));
+    quads.push_back(q1 + t * (q2 - q1));
+  } else {
+    quads.push_back(q1);
+  }
+  quads.push_back(q2);
+}
+
+// The range of dot(x - a, w) over the points x of the quadratic q with
+// parameters in [t0, t1].
+static void extent(const Vector2D *q, double t0, double t1,
+                   const Vector2D &a, const Vector2D &w, double &lo,
+                   double &hi) {
+  double f0 = dot(quadraticBezier(q[0], q[1], q[2], t0) - a, w);
+  double f1 = dot(quadraticBezier(q[0], q[1], q[2], t1) - a, w);
+  lo = min(lo, min(f0, f1));
+  hi = max(hi, max(f0, f1));
+  double t = dot(q[0] - q[1], w) / dot(q[0] - 2 * q[1] + q[2], w);
+  if (t > t0 && t < t1) {
+    double f = dot(quadraticBezier(q[0], q[1], q[2], t) - a, w);
+    lo = min(lo, f);
+    hi = max(hi, f);
+  }
+}
+
+// Flattens consecutive quadratics sharing their end points. The segments
+// are counted over all of them at once and spread by the integral, so a
+// segment may span the end of a quadratic; where the density of the two
+// differs enough for it to leave the tolerance, a vertex is added at the
+// end point.
+static size_t flattenQuadratics(const vector<Vector2D> &quads,
+                                double tolerance, vector<Vector2D> &out) {
+  double sqrtTol = sqrt((1 - kMargin) * tolerance);
+  vector<QuadraticSubdivision> subs;
+  double sum = 0;
+  for (size_t j = 0; j + 1 < quads.size(); j += 2) {
+    subs.push_back(QuadraticSubdivision(&quads[j], sqrtTol));
+    sum += subs.back().count;
+  }
+  size_t n = max(1.0, ceil(0.5 * sum / sqrtTol));
+
+  size_t added = 0, j = 0, last = 0;
+  double before = 0, lastT = 0;
+  Vector2D prev = quads[0];
+  for (size_t i = 1; i <= n; i++) {
+    // the next vertex is at parameter t of quadratic j
+    double x = sum * i / n, t = 1;
+    while (j + 1 < subs.size() && (before + subs[j].count < x || i == n)) {
+      before += subs[j++].count;
+    }
+    const Vector2D *q = &quads[2 * j];
+    if (i < n && subs[j].count > 0) {
+      t = subs[j].t((x - before) / subs[j].count);
+    }
+    Vector2D v = i < n ? quadraticBezier(q[0], q[1], q[2], t) : q[2];
+
+    if (last < j) {
+      // bound the distance from the quadratics to the segment by how far
+      // they stray to its sides and beyond its ends
+      Vector2D u = v - prev;
+      double d = u.norm(), err = INFINITY;
+      if (d > 0) {
+        u /= d;
+        Vector2D w(-u.y, u.x);
+        double alongLo = 0, alongHi = 0, acrossLo = 0, acrossHi = 0;
+        for (size_t k = last; k <= j; k++) {
+          double t0 = k == last ? lastT : 0, t1 = k == j ? t : 1;
+          extent(&quads[2 * k], t0, t1, prev, u, alongLo, alongHi);
+          extent(&quads[2 * k], t0, t1, prev, w, acrossLo, acrossHi);
+        }
+        err = max(-acrossLo, acrossHi) +
+              max(0.0, max(-alongLo, alongHi - d));
+      }
+      if (err > (1 - kMargin) * tolerance) {
+        for (size_t k = last; k < j; k++) {
+          out.push_back(quads[2 * k + 2]);
+          added++;
+        }
+      }
+    }
+    out.push_back(v);
+    added++;
+    prev = v;
+    last = j;
+    lastT = t;
+  }
+  return added;
+}
+
+size_t flattenQuadratic(const Vector2D *p, double tolerance,
+                        vector<Vector2D> &out) {
+  vector<Vector2D> quads(1, p[0]);
+  addQuadratic(quads, p[1], p[2]);
+  return flattenQuadratics(quads, tolerance, out);
+}
+
+size_t flattenCubic(const Vector2D *p, double tolerance,
+                    vector<Vector2D> &out) {
+  // enough quadratics to be within a share of the tolerance, each ending
+  // on the cubic and with the derivatives of the cubic at its ends
+  double accuracy = 0.5 * kMargin * tolerance;
+  double err = ((3 * p[2] - p[3]) - (3 * p[1] - p[0])).norm2();
+  size_t m = max(1.0, ceil(pow(err / (432 * accuracy * accuracy), 1 / 6.0)));
+
+  vector<Vector2D> quads(1, p[0]);
+  double h = 1.0 / (3 * m);
+  Vector2D d0 = 3 * (p[1] - p[0]);
+  for (size_t j = 1; j <= m; j++) {
+    double t = (double)j / m, u = 1 - t;
+    Vector2D start = quads.back();
+    Vector2D end = j < m ? cubicBezier(p[0], p[1], p[2], p[3], t) : p[3];
+    Vector2D d1 = 3 * (u * u * (p[1] - p[0]) + 2 * u * t * (p[2] - p[1]) +
+                       t * t * (p[3] - p[2]));
+    Vector2D c1 = start + h * d0, c2 = end - h * d1;
+    addQuadratic(quads, ((3 * c1 - start) + (3 * c2 - end)) * 0.25, end);
+    d0 = d1;
+  }
+
+  return flattenQuadratics(quads, tolerance, out);
+}
+
+size_t flattenCatmullRom(const Vector2D *p, double tolerance,
+                         vector<Vector2D> &out) {
+  Vector2D b[4];
+  catmullRomToBezier(p, b);
+  return flattenCubic(b, tolerance, out);
+}
+
+} // namespace CMU462
@@ -0,0 +1,506 @@
+#include "decomposition.h"
+#include "simd.h"
+
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+
+using namespace std;
+
+namespace CMU462 {
+
+//------------------------------------------------------------------------------
+// Kernels
+//
+// A symmetric matrix is held as its six entries (a00, a11, a22, a01, a02,
+// a12) and other matrices as nine entries in column major order,
+// m[3j + i] = M(i, j), all in double precision. A Jacobi rotation in the
+// plane (p, q) zeroes a_pq; a sweep rotates in the planes (0, 1), (0, 2)
+// and (1, 2). The AVX2 versions hold entry e of four matrices in one
+// register, so the four lanes run the same rotations and a sweep is only
+// skipped once all of them have converged.
+//------------------------------------------------------------------------------
+
+// Sweeps stop when the squared off-diagonal norm is below this fraction of
+// the squared diagonal norm, or after kMaxSweeps (3x3 matrices typically
+// need four or five).
+static const double kTolerance = DBL_EPSILON * DBL_EPSILON;
+static const int kMaxSweeps = 8;
+
+// planes (p, q) of a sweep, with the indices of a_pq, a_rp and a_rq in the
+// symmetric storage (r the third index)
+static const int kPlanes[3][5] = {
+    {0, 1, 3, 4, 5}, {0, 2, 4, 3, 5}, {1, 2, 5, 3, 4}};
+
+// (row, column) of the entries in the symmetric storage
+static const int kSymmetric[6][2] = {
+    {0, 0}, {1, 1}, {2, 2}, {0, 1}, {0, 2}, {1, 2}};
+
+enum Decomposition { EIGEN, SVD, POLAR };
+
+template <typename S>
+static inline void load_scalar(const BasicMatrix3x3<S> &A, double m[9]) {
+  for (int j = 0; j < 3; j++)
+    for (int i = 0; i < 3; i++) m[3 * j + i] = A(i, j);
+}
+
+template <typename S>
+static inline void store_scalar(const double m[9], BasicMatrix3x3<S> &A) {
+  for (int j = 0; j < 3; j++)
+    for (int i = 0; i < 3; i++) A(i, j) = S(m[3 * j + i]);
+}
+
+// jacobi //
+
+// Diagonalizes a in place, accumulating the rotations into v = V.
+static void jacobi_scalar(double a[6], double v[9]) {
+  for (int e = 0; e < 9; e++) v[e] = (e % 4 == 0) ? 1 : 0;
+
+  for (int sweep = 0; sweep < kMaxSweeps; sweep++) {
+    double off = a[3] * a[3] + a[4] * a[4] + a[5] * a[5];
+    double diag = a[0] * a[0] + a[1] * a[1] + a[2] * a[2];
+    if (off <= kTolerance * diag) break;
+
+    for (int k = 0; k < 3; k++) {
+      const int *pl = kPlanes[k];
+      int p = pl[0], q = pl[1];
+
+      // t = tan(angle), the smaller root of t^2 + 2 t theta - 1 = 0 with
+      // theta = (a_qq - a_pp) / 2 a_pq, written to avoid dividing by a_pq
+      double apq = a[pl[2]];
+      double tau = a[q] - a[p];
+      double d = fabs(tau) + sqrt(tau * tau + 4 * apq * apq);
+      double t = d > 0 ? copysign(2.0, tau) * apq / d : 0;
+      double c = 1 / sqrt(t * t + 1), s = t * c;
+
+      a[p] -= t * apq;
+      a[q] += t * apq;
+      a[pl[2]] = 0;
+      double arp = a[pl[3]], arq = a[pl[4]];
+      a[pl[3]] = c * arp - s * arq;
+      a[pl[4]] = s * arp + c * arq;
+
+      for (int i = 0; i < 3; i++) {
+        double vp = v[3 * p + i], vq = v[3 * q + i];
+        v[3 * p + i] = c * vp - s * vq;
+        v[3 * q + i] = s * vp + c * vq;
+      }
+    }
+  }
+}
+
+// Orders l[p], l[q] (decreasingly if dec), swapping columns p and q of v and
+// negating one of them so that v stays a rotation.
+static inline void order_scalar(double l[3], double v[9], int p, int q,
+                                bool dec) {
+  if (dec ? l[p] < l[q] : l[q] < l[p]) {
+    swap(l[p], l[q]);
+    for (int i = 0; i < 3; i++) {
+      double vp = v[3 * p + i];
+      v[3 * p + i] = v[3 * q + i];
+      v[3 * q + i] = -vp;
+    }
+  }
+}
+
+static inline void sort_scalar(double l[3], double v[9], bool dec) {
+  order_scalar(l, v, 0, 1, dec);
+  order_scalar(l, v, 1, 2, dec);
+  order_scalar(l, v, 0, 1, dec);
+}
+
+// svd //
+
+// Applies the Givens rotation of rows p and q of b that zeroes b(q, p),
+// and its transpose to columns p and q of u, so that u b is unchanged.
+static inline void givens_scalar(double b[9], double u[9], int p, int q) {
+  double x = b[3 * p + p], y = b[3 * p + q];
+  double r = sqrt(x * x + y * y);
+  double c = r > 0 ? x / r : 1, s = r > 0 ? y / r : 0;
+
+  for (int j = 0; j < 3; j++) {
+    double bp = b[3 * j + p], bq = b[3 * j + q];
+    b[3 * j + p] = c * bp + s * bq;
+    b[3 * j + q] = c * bq - s * bp;
+  }
+  for (int i = 0; i < 3; i++) {
+    double up = u[3 * p + i], uq = u[3 * q + i];
+    u[3 * p + i] = c * up + s * uq;
+    u[3 * q + i] = c * uq - s * up;
+  }
+}
+
+static void svd_scalar(const double m[9], double u[9], double sigma[3],
+                       double v[9]) {
+  // V diagonalizes m^T m, with decreasing eigenvalues
+  double a[6];
+  for (int k = 0; k < 6; k++) {
+    int p = kSymmetric[k][0], q = kSymmetric[k][1];
+    a[k] = m[3 * p] * m[3 * q] + m[3 * p + 1] * m[3 * q + 1] +
+           m[3 * p + 2] * m[3 * q + 2];
+  }
+  jacobi_scalar(a, v);
+  sort_scalar(a, v, true);
+
+  // QR factorization of m V, whose columns are orthogonal, so R is
+  // diagonal up to rounding
+  double b[9];
+  for (int j = 0; j < 3; j++)
+    for (int i = 0; i < 3; i++)
+      b[3 * j + i] = m[i] * v[3 * j] + m[3 + i] * v[3 * j + 1] +
+                     m[6 + i] * v[3 * j + 2];
+  for (int e = 0; e < 9; e++) u[e] = (e % 4 == 0) ? 1 : 0;
+  givens_scalar(b, u, 0, 1);
+  givens_scalar(b, u, 0, 2);
+  givens_scalar(b, u, 1, 2);
+
+  sigma[0] = b[0];
+  sigma[1] = b[4];
+  sigma[2] = b[8];
+}
+
+// Writes R = U V^T into u and P = V diag(sigma) V^T into v.
+static void polar_scalar(double u[9], const double sigma[3], double v[9]) {
+  double r[9], p[9];
+  for (int j = 0; j < 3; j++) {
+    for (int i = 0; i < 3; i++) {
+      r[3 * j + i] = p[3 * j + i] = 0;
+      for (int k = 0; k < 3; k++) {
+        r[3 * j + i] += u[3 * k + i] * v[3 * k + j];
+        p[3 * j + i] += v[3 * k + i] * sigma[k] * v[3 * k + j];
+      }
+    }
+  }
+  for (int e = 0; e < 9; e++) {
+    u[e] = r[e];
+    v[e] = p[e];
+  }
+}
+
+// Decomposes A[i..n), writing (unless NULL)
+//   EIGEN: lambda into y and V into Z,
+//   SVD:   U into X, sigma into y and V into Z,
+//   POLAR: R into X and P into Z.
+template <typename S>
+static void decompose_scalar(Decomposition mode, size_t i, size_t n,
+                             const BasicMatrix3x3<S> *A,
+                             BasicMatrix3x3<S> *X, BasicVector3D<S> *y,
+                             BasicMatrix3x3<S> *Z) {
+  for (; i < n; i++) {
+    double m[9], u[9], l[3], v[9];
+    load_scalar(A[i], m);
+
+    if (mode == EIGEN) {
+      // upper triangle
+      double a[6];
+      for (int k = 0; k < 6; k++)
+        a[k] = m[3 * kSymmetric[k][1] + kSymmetric[k][0]];
+      jacobi_scalar(a, v);
+      sort_scalar(a, v, false);
+      l[0] = a[0];
+      l[1] = a[1];
+      l[2] = a[2];
+    } else {
+      svd_scalar(m, u, l, v);
+      if (mode == POLAR) polar_scalar(u, l, v);
+    }
+
+    if (X) store_scalar(u, X[i]);
+    if (y && mode != POLAR) y[i] = BasicVector3D<S>(l[0], l[1], l[2]);
+    if (Z) store_scalar(v, Z[i]);
+  }
+}
+
+#ifdef CMU462_AVX2
+template <typename S>
+CMU462_TARGET_AVX2 static inline void load_avx2(const BasicMatrix3x3<S> *A,
+                                                __m256d m[9]) {
+  for (int j = 0; j < 3; j++)
+    for (int i = 0; i < 3; i++)
+      m[3 * j + i] =
+          _mm256_set_pd(A[3](i, j), A[2](i, j), A[1](i, j), A[0](i, j));
+}
+
+template <typename S>
+CMU462_TARGET_AVX2 static inline void store_avx2(const __m256d m[9],
+                                                 BasicMatrix3x3<S> *A) {
+  double t[4];
+  for (int j = 0; j < 3; j++) {
+    for (int i = 0; i < 3; i++) {
+      _mm256_storeu_pd(t, m[3 * j + i]);
+      for (int k = 0; k < 4; k++) A[k](i, j) = S(t[k]);
+    }
+  }
+}
+
+CMU462_TARGET_AVX2
+static inline void identity_avx2(__m256d m[9]) {
+  for (int e = 0; e < 9; e++)
+    m[e] = _mm256_set1_pd((e % 4 == 0) ? 1 : 0);
+}
+
+CMU462_TARGET_AVX2
+static void jacobi_avx2(__m256d a[6], __m256d v[9]) {
+  const __m256d zero = _mm256_setzero_pd(), one = _mm256_set1_pd(1);
+  const __m256d sign = _mm256_set1_pd(-0.0), four = _mm256_set1_pd(4);
+  const __m256d two = _mm256_set1_pd(2), tol = _mm256_set1_pd(kTolerance);
+  identity_avx2(v);
+
+  for (int sweep = 0; sweep < kMaxSweeps; sweep++) {
+    __m256d off = _mm256_mul_pd(a[3], a[3]);
+    off = _mm256_fmadd_pd(a[4], a[4], off);
+    off = _mm256_fmadd_pd(a[5], a[5], off);
+    __m256d diag = _mm256_mul_pd(a[0], a[0]);
+    diag = _mm256_fmadd_pd(a[1], a[1], diag);
+    diag = _mm256_fmadd_pd(a[2], a[2], diag);
+    __m256d busy = _mm256_cmp_pd(off, _mm256_mul_pd(tol, diag), _CMP_GT_OQ);
+    if (!_mm256_movemask_pd(busy)) break;
+
+    for (int k = 0; k < 3; k++) {
+      const int *pl = kPlanes[k];
+      int p = pl[0], q = pl[1];
+
+      __m256d apq = a[pl[2]];
+      __m256d tau = _mm256_sub_pd(a[q], a[p]);
+      __m256d h = _mm256_mul_pd(four, _mm256_mul_pd(apq, apq));
+      h = _mm256_sqrt_pd(_mm256_fmadd_pd(tau, tau, h));
+      __m256d d = _mm256_add_pd(_mm256_andnot_pd(sign, tau), h);
+      __m256d n = _mm256_xor_pd(_mm256_mul_pd(two, apq),
+                                _mm256_and_pd(sign, tau));
+      __m256d t = _mm256_and_pd(_mm256_div_pd(n, d),
+                                _mm256_cmp_pd(d, zero, _CMP_GT_OQ));
+      __m256d c =
+          _mm256_div_pd(one, _mm256_sqrt_pd(_mm256_fmadd_pd(t, t, one)));
+      __m256d s = _mm256_mul_pd(t, c);
+
+      __m256d tapq = _mm256_mul_pd(t, apq);
+      a[p] = _mm256_sub_pd(a[p], tapq);
+      a[q] = _mm256_add_pd(a[q], tapq);
+      a[pl[2]] = zero;
+      __m256d arp = a[pl[3]], arq = a[pl[4]];
+      a[pl[3]] = _mm256_fmsub_pd(c, arp, _mm256_mul_pd(s, arq));
+      a[pl[4]] = _mm256_fmadd_pd(s, arp, _mm256_mul_pd(c, arq));
+
+      for (int i = 0; i < 3; i++) {
+        __m256d vp = v[3 * p + i], vq = v[3 * q + i];
+        v[3 * p + i] = _mm256_fmsub_pd(c, vp, _mm256_mul_pd(s, vq));
+        v[3 * q + i] = _mm256_fmadd_pd(s, vp, _mm256_mul_pd(c, vq));
+      }
+    }
+  }
+}
+
+CMU462_TARGET_AVX2
+static inline void order_avx2(__m256d l[3], __m256d v[9], int p, int q,
+                              bool dec) {
+  __m256d m = dec ? _mm256_cmp_pd(l[p], l[q], _CMP_LT_OQ)
+                  : _mm256_cmp_pd(l[q], l[p], _CMP_LT_OQ);
+  __m256d lp = l[p];
+  l[p] = _mm256_blendv_pd(lp, l[q], m);
+  l[q] = _mm256_blendv_pd(l[q], lp, m);
+
+  const __m256d sign = _mm256_set1_pd(-0.0);
+  for (int i = 0; i < 3; i++) {
+    __m256d vp = v[3 * p + i], vq = v[3 * q + i];
+    v[3 * p + i] = _mm256_blendv_pd(vp, vq, m);
+    v[3 * q + i] = _mm256_blendv_pd(vq, _mm256_xor_pd(vp, sign), m);
+  }
+}
+
+CMU462_TARGET_AVX2
+static inline void sort_avx2(__m256d l[3], __m256d v[9], bool dec) {
+  order_avx2(l, v, 0, 1, dec);
+  order_avx2(l, v, 1, 2, dec);
+  order_avx2(l, v, 0, 1, dec);
+}
+
+CMU462_TARGET_AVX2
+static inline void givens_avx2(__m256d b[9], __m256d u[9], int p, int q) {
+  __m256d x = b[3 * p + p], y = b[3 * p + q];
+  __m256d r = _mm256_sqrt_pd(_mm256_fmadd_pd(x, x, _mm256_mul_pd(y, y)));
+  __m256d nz = _mm256_cmp_pd(r, _mm256_setzero_pd(), _CMP_GT_OQ);
+  __m256d ir = _mm256_div_pd(_mm256_set1_pd(1), r);
+  __m256d c = _mm256_blendv_pd(_mm256_set1_pd(1), _mm256_mul_pd(x, ir), nz);
+  __m256d s = _mm256_and_pd(_mm256_mul_pd(y, ir), nz);
+
+  for (int j = 0; j < 3; j++) {
+    __m256d bp = b[3 * j + p], bq = b[3 * j + q];
+    b[3 * j + p] = _mm256_fmadd_pd(c, bp, _mm256_mul_pd(s, bq));
+    b[3 * j + q] = _mm256_fmsub_pd(c, bq, _mm256_mul_pd(s, bp));
+  }
+  for (int i = 0; i < 3; i++) {
+    __m256d up = u[3 * p + i], uq = u[3 * q + i];
+    u[3 * p + i] = _mm256_fmadd_pd(c, up, _mm256_mul_pd(s, uq));
+    u[3 * q + i] = _mm256_fmsub_pd(c, uq, _mm256_mul_pd(s, up));
+  }
+}
+
+CMU462_TARGET_AVX2
+static void svd_avx2(const __m256d m[9], __m256d u[9], __m256d sigma[3],
+                     __m256d v[9]) {
+  __m256d a[6];
+  for (int k = 0; k < 6; k++) {
+    int p = kSymmetric[k][0], q = kSymmetric[k][1];
+    __m256d d = _mm256_mul_pd(m[3 * p], m[3 * q]);
+    d = _mm256_fmadd_pd(m[3 * p + 1], m[3 * q + 1], d);
+    a[k] = _mm256_fmadd_pd(m[3 * p + 2], m[3 * q + 2], d);
+  }
+  jacobi_avx2(a, v);
+  sort_avx2(a, v, true);
+
+  __m256d b[9];
+  for (int j = 0; j < 3; j++) {
+    for (int i = 0; i < 3; i++) {
+      __m256d d = _mm256_mul_pd(m[i], v[3 * j]);
+      d = _mm256_fmadd_pd(m[3 + i], v[3 * j + 1], d);
+      b[3 * j + i] = _mm256_fmadd_pd(m[6 + i], v[3 * j + 2], d);
+    }
+  }
+  identity_avx2(u);
+  givens_avx2(b, u, 0, 1);
+  givens_avx2(b, u, 0, 2);
+  givens_avx2(b, u, 1, 2);
+
+  sigma[0] = b[0];
+  sigma[1] = b[4];
+  sigma[2] = b[8];
+}
+
+CMU462_TARGET_AVX2
+static void polar_avx2(__m256d u[9], const __m256d sigma[3], __m256d v[9]) {
+  __m256d r[9], p[9];
+  for (int j = 0; j < 3; j++) {
+    for (int i = 0; i < 3; i++) {
+      r[3 * j + i] = p[3 * j + i] = _mm256_setzero_pd();
+      for (int k = 0; k < 3; k++) {
+        r[3 * j + i] =
+            _mm256_fmadd_pd(u[3 * k + i], v[3 * k + j], r[3 * j + i]);
+        p[3 * j + i] = _mm256_fmadd_pd(
+            _mm256_mul_pd(v[3 * k + i], sigma[k]), v[3 * k + j],
+            p[3 * j + i]);
+      }
+    }
+  }
+  for (int e = 0; e < 9; e++) {
+    u[e] = r[e];
+    v[e] = p[e];
+  }
+}
+
+template <typename S>
+CMU462_TARGET_AVX2 static void
+decompose_avx2(Decomposition mode, size_t i, size_t n,
+               const BasicMatrix3x3<S> *A, BasicMatrix3x3<S> *X,
+               BasicVector3D<S> *y, BasicMatrix3x3<S> *Z) {
+  for (; i + 4 <= n; i += 4) {
+    __m256d m[9], u[9], l[3], v[9];
+    load_avx2(A + i, m);
+
+    if (mode == EIGEN) {
+      __m256d a[6];
+      for (int k = 0; k < 6; k++)
+        a[k] = m[3 * kSymmetric[k][1] + kSymmetric[k][0]];
+      jacobi_avx2(a, v);
+      sort_avx2(a, v, false);
+      l[0] = a[0];
+      l[1] = a[1];
+      l[2] = a[2];
+    } else {
+      svd_avx2(m, u, l, v);
+      if (mode == POLAR) polar_avx2(u, l, v);
+    }
+
+    if (X) store_avx2(u, X + i);
+    if (y && mode != POLAR) {
+      double t[3][4];
+      for (int k = 0; k < 3; k++) _mm256_storeu_pd(t[k], l[k]);
+      for (int k = 0; k < 4; k++)
+        y[i + k] = BasicVector3D<S>(t[0][k], t[1][k], t[2][k]);
+    }
+    if (Z) store_avx2(v, Z + i);
+  }
+  decompose_scalar(mode, i, n, A, X, y, Z);
+}
+#endif
+
+// Number of matrices per parallel block.
+static const size_t kDecompositionBlock = 1024;
+
+template <typename S>
+static void decompose(Decomposition mode, const BasicMatrix3x3<S> *A,
+                      BasicMatrix3x3<S> *X, BasicVector3D<S> *y,
+                      BasicMatrix3x3<S> *Z, size_t n) {
+  void (*kernel)(Decomposition, size_t, size_t, const BasicMatrix3x3<S> *,
+                 BasicMatrix3x3<S> *, BasicVector3D<S> *,
+                 BasicMatrix3x3<S> *) = decompose_scalar<S>;
+#ifdef CMU462_AVX2
+  if (SIMD::hasAVX2()) kernel = decompose_avx2<S>;
+#endif
+
+  long blocks = (long)((n + kDecompositionBlock - 1) / kDecompositionBlock);
+#pragma omp parallel for if (blocks > 1)
+  for (long b = 0; b < blocks; b++) {
+    size_t i = b * kDecompositionBlock;
+    kernel(mode, i, min(n, i + kDecompositionBlock), A, X, y, Z);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Decompositions
+//------------------------------------------------------------------------------
+
+template <typename S>
+void eigenSymmetric(const BasicMatrix3x3<S> &A, BasicVector3D<S> &lambda,
+                    BasicMatrix3x3<S> &V) {
+  decompose_scalar<S>(EIGEN, 0, 1, &A, NULL, &lambda, &V);
+}
+
+template <typename S>
+void svd(const BasicMatrix3x3<S> &A, BasicMatrix3x3<S> &U,
+         BasicVector3D<S> &sigma, BasicMatrix3x3<S> &V) {
+  decompose_scalar<S>(SVD, 0, 1, &A, &U, &sigma, &V);
+}
+
+template <typename S>
+void polar(const BasicMatrix3x3<S> &A, BasicMatrix3x3<S> &R,
+           BasicMatrix3x3<S> &P) {
+  decompose_scalar<S>(POLAR, 0, 1, &A, &R, NULL, &P);
+}
+
+template void eigenSymmetric(const Matrix3x3 &, Vector3D &, Matrix3x3 &);
+template void eigenSymmetric(const Matrix3x3f &, Vector3f &, Matrix3x3f &);
+template void svd(const Matrix3x3 &, Matrix3x3 &, Vector3D &, Matrix3x3 &);
+template void svd(const Matrix3x3f &, Matrix3x3f &, Vector3f &,
+                  Matrix3x3f &);
+template void polar(const Matrix3x3 &, Matrix3x3 &, Matrix3x3 &);
+template void polar(const Matrix3x3f &, Matrix3x3f &, Matrix3x3f &);
+
+void eigenSymmetric(const Matrix3x3 *A, Vector3D *lambda, Matrix3x3 *V,
+                    size_t n) {
+  decompose(EIGEN, A, (Matrix3x3 *)NULL, lambda, V, n);
+}
+
+void eigenSymmetric(const Matrix3x3f *A, Vector3f *lambda, Matrix3x3f *V,
+                    size_t n) {
+  decompose(EIGEN, A, (Matrix3x3f *)NULL, lambda, V, n);
+}
+
+void svd(const Matrix3x3 *A, Matrix3x3 *U, Vector3D *sigma, Matrix3x3 *V,
+         size_t n) {
+  decompose(SVD, A, U, sigma, V, n);
+}
+
+void svd(const Matrix3x3f *A, Matrix3x3f *U, Vector3f *sigma, Matrix3x3f *V,
+         size_t n) {
+  decompose(SVD, A, U, sigma, V, n);
+}
+
+void polar(const Matrix3x3 *A, Matrix3x3 *R, Matrix3x3 *P, size_t n) {
+  decompose(POLAR, A, R, (Vector3D *)NULL, P, n);
+}
+
+void polar(const Matrix3x3f *A, Matrix3x3f *R, Matrix3x3f *P, size_t n) {
+  decompose(POLAR, A, R, (Vector3f *)NULL, P, n);
+}
+
+} // namespace CMU462
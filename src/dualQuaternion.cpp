@@ -0,0 +1,19 @@
+#include "dualQuaternion.h"
+
+#include <iostream>
+
+namespace CMU462 {
+
+template <typename T>
+std::ostream &operator<<(std::ostream &os, const BasicDualQuaternion<T> &q) {
+  os << q.real << " + e " << q.dual;
+  return os;
+}
+
+template class BasicDualQuaternion<double>;
+template class BasicDualQuaternion<float>;
+
+template std::ostream &operator<<(std::ostream &os, const DualQuaternion &q);
+template std::ostream &operator<<(std::ostream &os, const DualQuaternionf &q);
+
+} // namespace CMU462
@@ -0,0 +1,428 @@
+#include "encoding.h"
+#include "simd.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace CMU462 {
+
+static_assert(sizeof(Vector3D) == 3 * sizeof(double),
+              "Vector3D must be 3 doubles");
+static_assert(sizeof(Quaternion) == 4 * sizeof(double),
+              "Quaternion must be 4 doubles");
+
+//------------------------------------------------------------------------------
+// Kernels
+//
+// Each kernel processes elements [i, n) and leaves the tail to the scalar
+// kernel. The AVX2 kernels work on four vectors or quaternions at a time,
+// with one register per component, and select between components with
+// blends where the scalar code branches.
+//------------------------------------------------------------------------------
+
+static void encodeOct32_scalar(size_t i, size_t n, const Vector3D *in,
+                               uint32_t *out) {
+  for (; i < n; i++) out[i] = encodeOct32(in[i]);
+}
+
+static void decodeOct32_scalar(size_t i, size_t n, const uint32_t *in,
+                               Vector3D *out) {
+  for (; i < n; i++) out[i] = decodeOct32(in[i]);
+}
+
+static void encodeOct16_scalar(size_t i, size_t n, const Vector3D *in,
+                               uint16_t *out) {
+  for (; i < n; i++) out[i] = encodeOct16(in[i]);
+}
+
+static void decodeOct16_scalar(size_t i, size_t n, const uint16_t *in,
+                               Vector3D *out) {
+  for (; i < n; i++) out[i] = decodeOct16(in[i]);
+}
+
+static void encodeQuat32_scalar(size_t i, size_t n, const Quaternion *in,
+                                uint32_t *out) {
+  for (; i < n; i++) out[i] = encodeQuat32(in[i]);
+}
+
+static void decodeQuat32_scalar(size_t i, size_t n, const uint32_t *in,
+                                Quaternion *out) {
+  for (; i < n; i++) out[i] = decodeQuat32(in[i]);
+}
+
+static void encodeQuat64_scalar(size_t i, size_t n, const Quaternion *in,
+                                uint64_t *out) {
+  for (; i < n; i++) out[i] = encodeQuat64(in[i]);
+}
+
+static void decodeQuat64_scalar(size_t i, size_t n, const uint64_t *in,
+                                Quaternion *out) {
+  for (; i < n; i++) out[i] = decodeQuat64(in[i]);
+}
+
+#ifdef CMU462_AVX2
+// loads the four 3D vectors at v into one register per component
+CMU462_TARGET_AVX2
+static inline void load3_avx2(const double *v, __m256d &x, __m256d &y,
+                              __m256d &z) {
+  const __m256i idx = _mm256_set_epi64x(9, 6, 3, 0);
+  x = _mm256_i64gather_pd(v, idx, 8);
+  y = _mm256_i64gather_pd(v + 1, idx, 8);
+  z = _mm256_i64gather_pd(v + 2, idx, 8);
+}
+
+// stores four 3D vectors held as one register per component at o
+CMU462_TARGET_AVX2
+static inline void store3_avx2(double *o, __m256d x, __m256d y, __m256d z) {
+  __m256d t0 = _mm256_unpacklo_pd(x, y);
+  __m256d t1 = _mm256_unpackhi_pd(x, y);
+  __m256d t2 = _mm256_unpacklo_pd(z, z);
+  __m256d t3 = _mm256_unpackhi_pd(z, z);
+  __m256d v0 = _mm256_permute2f128_pd(t0, t2, 0x20);
+  __m256d v1 = _mm256_permute2f128_pd(t1, t3, 0x20);
+  __m256d v2 = _mm256_permute2f128_pd(t0, t2, 0x31);
+  __m256d v3 = _mm256_permute2f128_pd(t1, t3, 0x31);
+  _mm_storeu_pd(o, _mm256_castpd256_pd128(v0));
+  _mm_store_sd(o + 2, _mm256_extractf128_pd(v0, 1));
+  _mm_storeu_pd(o + 3, _mm256_castpd256_pd128(v1));
+  _mm_store_sd(o + 5, _mm256_extractf128_pd(v1, 1));
+  _mm_storeu_pd(o + 6, _mm256_castpd256_pd128(v2));
+  _mm_store_sd(o + 8, _mm256_extractf128_pd(v2, 1));
+  _mm_storeu_pd(o + 9, _mm256_castpd256_pd128(v3));
+  _mm_store_sd(o + 11, _mm256_extractf128_pd(v3, 1));
+}
+
+// transposes the 4x4 block held in a, b, c, d
+CMU462_TARGET_AVX2
+static inline void transpose_avx2(__m256d &a, __m256d &b, __m256d &c,
+                                  __m256d &d) {
+  __m256d t0 = _mm256_unpacklo_pd(a, b);
+  __m256d t1 = _mm256_unpackhi_pd(a, b);
+  __m256d t2 = _mm256_unpacklo_pd(c, d);
+  __m256d t3 = _mm256_unpackhi_pd(c, d);
+  a = _mm256_permute2f128_pd(t0, t2, 0x20);
+  b = _mm256_permute2f128_pd(t1, t3, 0x20);
+  c = _mm256_permute2f128_pd(t0, t2, 0x31);
+  d = _mm256_permute2f128_pd(t1, t3, 0x31);
+}
+
+// (1 - |a|) with the sign of b, the fold of the lower hemisphere
+CMU462_TARGET_AVX2
+static inline __m256d fold_avx2(__m256d a, __m256d b) {
+  const __m256d sign = _mm256_set1_pd(-0.0);
+  __m256d m = _mm256_sub_pd(_mm256_set1_pd(1.0), _mm256_andnot_pd(sign, a));
+  return _mm256_or_pd(m, _mm256_and_pd(sign, b));
+}
+
+// octQuantize() of the four vectors at v
+CMU462_TARGET_AVX2
+static inline void octQuantize_avx2(const double *v, double scale,
+                                    __m128i &qx, __m128i &qy) {
+  const __m256d sign = _mm256_set1_pd(-0.0);
+  const __m256d zero = _mm256_setzero_pd();
+  __m256d x, y, z;
+  load3_avx2(v, x, y, z);
+  __m256d s = _mm256_add_pd(_mm256_add_pd(_mm256_andnot_pd(sign, x),
+                                          _mm256_andnot_pd(sign, y)),
+                            _mm256_andnot_pd(sign, z));
+  s = _mm256_blendv_pd(s, _mm256_set1_pd(1.0),
+                       _mm256_cmp_pd(s, zero, _CMP_EQ_OQ));
+  __m256d px = _mm256_div_pd(x, s), py = _mm256_div_pd(y, s);
+  __m256d lower = _mm256_cmp_pd(z, zero, _CMP_LT_OQ);
+  __m256d fx = fold_avx2(py, px), fy = fold_avx2(px, py);
+  px = _mm256_blendv_pd(px, fx, lower);
+  py = _mm256_blendv_pd(py, fy, lower);
+  qx = _mm256_cvtpd_epi32(_mm256_mul_pd(px, _mm256_set1_pd(scale)));
+  qy = _mm256_cvtpd_epi32(_mm256_mul_pd(py, _mm256_set1_pd(scale)));
+}
+
+// octDirection() of four coordinate pairs, stored at o
+CMU462_TARGET_AVX2
+static inline void octDirection_avx2(__m128i qx, __m128i qy, double scale,
+                                     double *o) {
+  const __m256d sign = _mm256_set1_pd(-0.0);
+  const __m256d one = _mm256_set1_pd(1.0);
+  const __m256d inv = _mm256_set1_pd(1 / scale);
+  __m256d px = _mm256_mul_pd(_mm256_cvtepi32_pd(qx), inv);
+  __m256d py = _mm256_mul_pd(_mm256_cvtepi32_pd(qy), inv);
+  __m256d pz = _mm256_sub_pd(_mm256_sub_pd(one, _mm256_andnot_pd(sign, px)),
+                             _mm256_andnot_pd(sign, py));
+  __m256d lower = _mm256_cmp_pd(pz, _mm256_setzero_pd(), _CMP_LT_OQ);
+  __m256d fx = fold_avx2(py, px), fy = fold_avx2(px, py);
+  px = _mm256_blendv_pd(px, fx, lower);
+  py = _mm256_blendv_pd(py, fy, lower);
+  __m256d n2 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(px, px),
+                                           _mm256_mul_pd(py, py)),
+                             _mm256_mul_pd(pz, pz));
+  __m256d r = _mm256_div_pd(one, _mm256_sqrt_pd(n2));
+  store3_avx2(o, _mm256_mul_pd(px, r), _mm256_mul_pd(py, r),
+              _mm256_mul_pd(pz, r));
+}
+
+CMU462_TARGET_AVX2
+static void encodeOct32_avx2(size_t i, size_t n, const Vector3D *in,
+                             uint32_t *out) {
+  const __m128i low = _mm_set1_epi32(0xFFFF);
+  for (; i + 4 <= n; i += 4) {
+    __m128i x, y;
+    octQuantize_avx2((const double *)(in + i), 32767, x, y);
+    __m128i code = _mm_or_si128(_mm_and_si128(x, low),
+                                _mm_slli_epi32(y, 16));
+    _mm_storeu_si128((__m128i *)(out + i), code);
+  }
+  encodeOct32_scalar(i, n, in, out);
+}
+
+CMU462_TARGET_AVX2
+static void decodeOct32_avx2(size_t i, size_t n, const uint32_t *in,
+                             Vector3D *out) {
+  for (; i + 4 <= n; i += 4) {
+    __m128i code = _mm_loadu_si128((const __m128i *)(in + i));
+    __m128i x = _mm_srai_epi32(_mm_slli_epi32(code, 16), 16);
+    __m128i y = _mm_srai_epi32(code, 16);
+    octDirection_avx2(x, y, 32767, (double *)(out + i));
+  }
+  decodeOct32_scalar(i, n, in, out);
+}
+
+CMU462_TARGET_AVX2
+static void encodeOct16_avx2(size_t i, size_t n, const Vector3D *in,
+                             uint16_t *out) {
+  const __m128i low = _mm_set1_epi32(0xFF);
+  for (; i + 4 <= n; i += 4) {
+    __m128i x, y;
+    octQuantize_avx2((const double *)(in + i), 127, x, y);
+    __m128i code = _mm_or_si128(_mm_and_si128(x, low),
+                                _mm_slli_epi32(_mm_and_si128(y, low), 8));
+    _mm_storel_epi64((__m128i *)(out + i), _mm_packus_epi32(code, code));
+  }
+  encodeOct16_scalar(i, n, in, out);
+}
+
+CMU462_TARGET_AVX2
+static void decodeOct16_avx2(size_t i, size_t n, const uint16_t *in,
+                             Vector3D *out) {
+  for (; i + 4 <= n; i += 4) {
+    __m128i code = _mm_cvtepu16_epi32(
+        _mm_loadl_epi64((const __m128i *)(in + i)));
+    __m128i x = _mm_srai_epi32(_mm_slli_epi32(code, 24), 24);
+    __m128i y = _mm_srai_epi32(_mm_slli_epi32(code, 16), 24);
+    octDirection_avx2(x, y, 127, (double *)(out + i));
+  }
+  decodeOct16_scalar(i, n, in, out);
+}
+
+// quatQuantize() of the four quaternions at q: the index of the largest
+// component and the other three
+CMU462_TARGET_AVX2
+static inline void quatQuantize_avx2(const double *q, double scale,
+                                     __m128i &largest, __m128i c[3]) {
+  const __m256d sign = _mm256_set1_pd(-0.0);
+  __m256d x = _mm256_loadu_pd(q);
+  __m256d y = _mm256_loadu_pd(q + 4);
+  __m256d z = _mm256_loadu_pd(q + 8);
+  __m256d w = _mm256_loadu_pd(q + 12);
+  transpose_avx2(x, y, z, w);
+
+  // first component of largest magnitude, as in the scalar scan
+  __m256d comp[4] = {x, y, z, w};
+  __m256d best = _mm256_andnot_pd(sign, x), index = _mm256_setzero_pd();
+  __m256d value = x;
+  for (int k = 1; k < 4; k++) {
+    __m256d a = _mm256_andnot_pd(sign, comp[k]);
+    __m256d m = _mm256_cmp_pd(a, best, _CMP_GT_OQ);
+    best = _mm256_blendv_pd(best, a, m);
+    index = _mm256_blendv_pd(index, _mm256_set1_pd(k), m);
+    value = _mm256_blendv_pd(value, comp[k], m);
+  }
+
+  __m256d n2 = _mm256_add_pd(
+      _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(x, x), _mm256_mul_pd(y, y)),
+                    _mm256_mul_pd(z, z)),
+      _mm256_mul_pd(w, w));
+  __m256d f = _mm256_div_pd(_mm256_set1_pd(M_SQRT2 * scale),
+                            _mm256_sqrt_pd(n2));
+  f = _mm256_or_pd(f, _mm256_and_pd(sign, value));
+
+  // the components other than the largest, by increasing index
+  __m256d kept[3] = {
+      _mm256_blendv_pd(
+          x, y, _mm256_cmp_pd(index, _mm256_set1_pd(0), _CMP_EQ_OQ)),
+      _mm256_blendv_pd(
+          y, z, _mm256_cmp_pd(index, _mm256_set1_pd(1), _CMP_LE_OQ)),
+      _mm256_blendv_pd(
+          z, w, _mm256_cmp_pd(index, _mm256_set1_pd(2), _CMP_LE_OQ))};
+  const __m128i offset = _mm_set1_epi32((int)scale);
+  for (int k = 0; k < 3; k++) {
+    c[k] = _mm_add_epi32(_mm256_cvtpd_epi32(_mm256_mul_pd(kept[k], f)),
+                         offset);
+  }
+  largest = _mm256_cvtpd_epi32(index);
+}
+
+// quatDirection() of four quaternions, stored at o
+CMU462_TARGET_AVX2
+static inline void quatDirection_avx2(__m128i largest, const __m128i c[3],
+                                      double scale, double *o) {
+  __m256d v[3];
+  __m256d sum = _mm256_set1_pd(1.0);
+  for (int k = 0; k < 3; k++) {
+    v[k] = _mm256_mul_pd(_mm256_sub_pd(_mm256_cvtepi32_pd(c[k]),
+                                       _mm256_set1_pd(scale)),
+                         _mm256_set1_pd(M_SQRT1_2 / scale));
+    sum = _mm256_sub_pd(sum, _mm256_mul_pd(v[k], v[k]));
+  }
+  __m256d d = _mm256_sqrt_pd(_mm256_max_pd(sum, _mm256_setzero_pd()));
+
+  __m256d index = _mm256_cvtepi32_pd(largest);
+  __m256d is[4];
+  for (int k = 0; k < 4; k++)
+    is[k] = _mm256_cmp_pd(index, _mm256_set1_pd(k), _CMP_EQ_OQ);
+  __m256d upTo1 = _mm256_cmp_pd(index, _mm256_set1_pd(1), _CMP_LE_OQ);
+
+  __m256d x = _mm256_blendv_pd(v[0], d, is[0]);
+  __m256d y = _mm256_blendv_pd(_mm256_blendv_pd(v[1], d, is[1]), v[0], is[0]);
+  __m256d z = _mm256_blendv_pd(_mm256_blendv_pd(v[2], d, is[2]), v[1], upTo1);
+  __m256d w = _mm256_blendv_pd(v[2], d, is[3]);
+  transpose_avx2(x, y, z, w);
+  _mm256_storeu_pd(o, x);
+  _mm256_storeu_pd(o + 4, y);
+  _mm256_storeu_pd(o + 8, z);
+  _mm256_storeu_pd(o + 12, w);
+}
+
+CMU462_TARGET_AVX2
+static void encodeQuat32_avx2(size_t i, size_t n, const Quaternion *in,
+                              uint32_t *out) {
+  for (; i + 4 <= n; i += 4) {
+    __m128i largest, c[3];
+    quatQuantize_avx2((const double *)(in + i), 511, largest, c);
+    __m128i code = _mm_or_si128(_mm_slli_epi32(largest, 30),
+                                _mm_slli_epi32(c[0], 20));
+    code = _mm_or_si128(code, _mm_slli_epi32(c[1], 10));
+    _mm_storeu_si128((__m128i *)(out + i), _mm_or_si128(code, c[2]));
+  }
+  encodeQuat32_scalar(i, n, in, out);
+}
+
+CMU462_TARGET_AVX2
+static void decodeQuat32_avx2(size_t i, size_t n, const uint32_t *in,
+                              Quaternion *out) {
+  const __m128i mask = _mm_set1_epi32(0x3FF);
+  for (; i + 4 <= n; i += 4) {
+    __m128i code = _mm_loadu_si128((const __m128i *)(in + i));
+    __m128i c[3] = {_mm_and_si128(_mm_srli_epi32(code, 20), mask),
+                    _mm_and_si128(_mm_srli_epi32(code, 10), mask),
+                    _mm_and_si128(code, mask)};
+    quatDirection_avx2(_mm_srli_epi32(code, 30), c, 511,
+                       (double *)(out + i));
+  }
+  decodeQuat32_scalar(i, n, in, out);
+}
+
+CMU462_TARGET_AVX2
+static void encodeQuat64_avx2(size_t i, size_t n, const Quaternion *in,
+                              uint64_t *out) {
+  for (; i + 4 <= n; i += 4) {
+    __m128i largest, c[3];
+    quatQuantize_avx2((const double *)(in + i), 524287, largest, c);
+    __m256i code = _mm256_slli_epi64(_mm256_cvtepi32_epi64(largest), 60);
+    code = _mm256_or_si256(
+        code, _mm256_slli_epi64(_mm256_cvtepi32_epi64(c[0]), 40));
+    code = _mm256_or_si256(
+        code, _mm256_slli_epi64(_mm256_cvtepi32_epi64(c[1]), 20));
+    code = _mm256_or_si256(code, _mm256_cvtepi32_epi64(c[2]));
+    _mm256_storeu_si256((__m256i *)(out + i), code);
+  }
+  encodeQuat64_scalar(i, n, in, out);
+}
+
+// the low halves of the four 64-bit lanes of v
+CMU462_TARGET_AVX2
+static inline __m128i low32_avx2(__m256i v) {
+  const __m256i even = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+  return _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(v, even));
+}
+
+CMU462_TARGET_AVX2
+static void decodeQuat64_avx2(size_t i, size_t n, const uint64_t *in,
+                              Quaternion *out) {
+  const __m256i mask = _mm256_set1_epi64x(0xFFFFF);
+  for (; i + 4 <= n; i += 4) {
+    __m256i code = _mm256_loadu_si256((const __m256i *)(in + i));
+    __m128i c[3] = {
+        low32_avx2(_mm256_and_si256(_mm256_srli_epi64(code, 40), mask)),
+        low32_avx2(_mm256_and_si256(_mm256_srli_epi64(code, 20), mask)),
+        low32_avx2(_mm256_and_si256(code, mask))};
+    __m128i largest = low32_avx2(
+        _mm256_and_si256(_mm256_srli_epi64(code, 60), _mm256_set1_epi64x(3)));
+    quatDirection_avx2(largest, c, 524287, (double *)(out + i));
+  }
+  decodeQuat64_scalar(i, n, in, out);
+}
+#endif
+
+// drivers //
+
+// Elements per block; blocks are processed in parallel.
+static const size_t kEncodeBlock = 16384;
+
+template <typename In, typename Out>
+static void convert(void (*kernel)(size_t, size_t, const In *, Out *),
+                    const In *in, Out *out, size_t n) {
+  long blocks = (long)((n + kEncodeBlock - 1) / kEncodeBlock);
+#pragma omp parallel for if (blocks > 1)
+  for (long b = 0; b < blocks; b++) {
+    size_t i = b * kEncodeBlock;
+    kernel(i, min(n, i + kEncodeBlock), in, out);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Bulk encoding
+//------------------------------------------------------------------------------
+
+// the AVX2 kernel if available, else the scalar one
+#ifdef CMU462_AVX2
+#define CMU462_ENCODING_KERNEL(name) \
+  (SIMD::hasAVX2() ? name##_avx2 : name##_scalar)
+#else
+#define CMU462_ENCODING_KERNEL(name) name##_scalar
+#endif
+
+void encodeOct32(const Vector3D *in, uint32_t *out, size_t n) {
+  convert(CMU462_ENCODING_KERNEL(encodeOct32), in, out, n);
+}
+
+void decodeOct32(const uint32_t *in, Vector3D *out, size_t n) {
+  convert(CMU462_ENCODING_KERNEL(decodeOct32), in, out, n);
+}
+
+void encodeOct16(const Vector3D *in, uint16_t *out, size_t n) {
+  convert(CMU462_ENCODING_KERNEL(encodeOct16), in, out, n);
+}
+
+void decodeOct16(const uint16_t *in, Vector3D *out, size_t n) {
+  convert(CMU462_ENCODING_KERNEL(decodeOct16), in, out, n);
+}
+
+void encodeQuat32(const Quaternion *in, uint32_t *out, size_t n) {
+  convert(CMU462_ENCODING_KERNEL(encodeQuat32), in, out, n);
+}
+
+void decodeQuat32(const uint32_t *in, Quaternion *out, size_t n) {
+  convert(CMU462_ENCODING_KERNEL(decodeQuat32), in, out, n);
+}
+
+void encodeQuat64(const Quaternion *in, uint64_t *out, size_t n) {
+  convert(CMU462_ENCODING_KERNEL(encodeQuat64), in, out, n);
+}
+
+void decodeQuat64(const uint64_t *in, Quaternion *out, size_t n) {
+  convert(CMU462_ENCODING_KERNEL(decodeQuat64), in, out, n);
+}
+
+#undef CMU462_ENCODING_KERNEL
+
+} // namespace CMU462
@@ -0,0 +1,458 @@
+#include "fft.h"
+#include "simd.h"
+
+#include <string.h>
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+
+namespace CMU462 {
+
+//------------------------------------------------------------------------------
+// Kernels
+//
+// Complex values are handled as interleaved (re, im) doubles. A stage with
+// radix p, m butterflies per group and stride s reads the p inputs
+//   x[q + s (j + r m)],  r = 0..p-1
+// for each j < m and q < s, computes their DFT of size p, multiplies output
+// k by the twiddle w^jk of the current length and writes it to
+//   y[q + s (p j + k)].
+// This is the self-sorting Stockham formulation: no bit reversal is needed
+// and any sequence of radices works. Radix 4 has SSE2 and AVX2 versions,
+// which vectorize over q (or over j in the first stage, where s = 1).
+//------------------------------------------------------------------------------
+
+// radix 2 //
+
+static void radix2_scalar(const double *x, double *y, size_t m, size_t s,
+                          const double *tw) {
+  for (size_t j = 0; j < m; j++) {
+    double wr = tw[2 * j], wi = tw[2 * j + 1];
+    for (size_t q = 0; q < s; q++) {
+      const double *a = x + 2 * (q + s * j);
+      const double *b = x + 2 * (q + s * (j + m));
+      double *o0 = y + 2 * (q + s * 2 * j);
+      double *o1 = y + 2 * (q + s * (2 * j + 1));
+      double dr = a[0] - b[0], di = a[1] - b[1];
+      o0[0] = a[0] + b[0];
+      o0[1] = a[1] + b[1];
+      o1[0] = dr * wr - di * wi;
+      o1[1] = dr * wi + di * wr;
+    }
+  }
+}
+
+// radix p (any) //
+
+static void radixp_scalar(const double *x, double *y, size_t p, size_t m,
+                          size_t s, const double *tw, const double *roots) {
+  vector<double> a(2 * p);
+  for (size_t j = 0; j < m; j++) {
+    for (size_t q = 0; q < s; q++) {
+      for (size_t r = 0; r < p; r++) {
+        a[2 * r] = x[2 * (q + s * (j + r * m))];
+        a[2 * r + 1] = x[2 * (q + s * (j + r * m)) + 1];
+      }
+      for (size_t k = 0; k < p; k++) {
+        double br = 0, bi = 0;
+        for (size_t r = 0, e = 0; r < p; r++, e = (e + k) % p) {
+          br += a[2 * r] * roots[2 * e] - a[2 * r + 1] * roots[2 * e + 1];
+          bi += a[2 * r] * roots[2 * e + 1] + a[2 * r + 1] * roots[2 * e];
+        }
+        double *o = y + 2 * (q + s * (p * j + k));
+        if (k) {
+          double wr = tw[2 * ((k - 1) * m + j)];
+          double wi = tw[2 * ((k - 1) * m + j) + 1];
+          o[0] = br * wr - bi * wi;
+          o[1] = br * wi + bi * wr;
+        } else {
+          o[0] = br;
+          o[1] = bi;
+        }
+      }
+    }
+  }
+}
+
+// radix 4 //
+
+static void radix4_scalar(const double *x, double *y, size_t m, size_t s,
+                          const double *tw) {
+  for (size_t j = 0; j < m; j++) {
+    const double *w1 = tw + 2 * j;
+    const double *w2 = tw + 2 * (m + j);
+    const double *w3 = tw + 2 * (2 * m + j);
+    for (size_t q = 0; q < s; q++) {
+      const double *a0 = x + 2 * (q + s * j);
+      const double *a1 = x + 2 * (q + s * (j + m));
+      const double *a2 = x + 2 * (q + s * (j + 2 * m));
+      const double *a3 = x + 2 * (q + s * (j + 3 * m));
+
+      double t0r = a0[0] + a2[0], t0i = a0[1] + a2[1];
+      double t1r = a0[0] - a2[0], t1i = a0[1] - a2[1];
+      double t2r = a1[0] + a3[0], t2i = a1[1] + a3[1];
+      // (a1 - a3) * -i
+      double t3r = a1[1] - a3[1], t3i = a3[0] - a1[0];
+
+      double b1r = t1r + t3r, b1i = t1i + t3i;
+      double b2r = t0r - t2r, b2i = t0i - t2i;
+      double b3r = t1r - t3r, b3i = t1i - t3i;
+
+      double *o = y + 2 * (q + s * 4 * j);
+      double *o1 = o + 2 * s, *o2 = o + 4 * s, *o3 = o + 6 * s;
+      o[0] = t0r + t2r;
+      o[1] = t0i + t2i;
+      o1[0] = b1r * w1[0] - b1i * w1[1];
+      o1[1] = b1r * w1[1] + b1i * w1[0];
+      o2[0] = b2r * w2[0] - b2i * w2[1];
+      o2[1] = b2r * w2[1] + b2i * w2[0];
+      o3[0] = b3r * w3[0] - b3i * w3[1];
+      o3[1] = b3r * w3[1] + b3i * w3[0];
+    }
+  }
+}
+
+#ifdef CMU462_SSE2
+// complex product a w
+static inline __m128d cmul_sse2(__m128d a, __m128d w) {
+  const __m128d neg = _mm_set_pd(0.0, -0.0);
+  __m128d wr = _mm_unpacklo_pd(w, w), wi = _mm_unpackhi_pd(w, w);
+  __m128d as = _mm_shuffle_pd(a, a, 1);
+  return _mm_add_pd(_mm_mul_pd(a, wr), _mm_xor_pd(_mm_mul_pd(as, wi), neg));
+}
+
+// complex product a (-i)
+static inline __m128d mulmi_sse2(__m128d a) {
+  return _mm_xor_pd(_mm_shuffle_pd(a, a, 1), _mm_set_pd(-0.0, 0.0));
+}
+
+static void radix4_sse2(const double *x, double *y, size_t m, size_t s,
+                        const double *tw) {
+  for (size_t j = 0; j < m; j++) {
+    __m128d w1 = _mm_loadu_pd(tw + 2 * j);
+    __m128d w2 = _mm_loadu_pd(tw + 2 * (m + j));
+    __m128d w3 = _mm_loadu_pd(tw + 2 * (2 * m + j));
+    for (size_t q = 0; q < s; q++) {
+      __m128d a0 = _mm_loadu_pd(x + 2 * (q + s * j));
+      __m128d a1 = _mm_loadu_pd(x + 2 * (q + s * (j + m)));
+      __m128d a2 = _mm_loadu_pd(x + 2 * (q + s * (j + 2 * m)));
+      __m128d a3 = _mm_loadu_pd(x + 2 * (q + s * (j + 3 * m)));
+
+      __m128d t0 = _mm_add_pd(a0, a2), t1 = _mm_sub_pd(a0, a2);
+      __m128d t2 = _mm_add_pd(a1, a3);
+      __m128d t3 = mulmi_sse2(_mm_sub_pd(a1, a3));
+
+      double *o = y + 2 * (q + s * 4 * j);
+      _mm_storeu_pd(o, _mm_add_pd(t0, t2));
+      _mm_storeu_pd(o + 2 * s, cmul_sse2(_mm_add_pd(t1, t3), w1));
+      _mm_storeu_pd(o + 4 * s, cmul_sse2(_mm_sub_pd(t0, t2), w2));
+      _mm_storeu_pd(o + 6 * s, cmul_sse2(_mm_sub_pd(t1, t3), w3));
+    }
+  }
+}
+#endif
+
+#ifdef CMU462_AVX2
+// complex products a w of two pairs
+CMU462_TARGET_AVX2
+static inline __m256d cmul_avx2(__m256d a, __m256d w) {
+  __m256d wr = _mm256_movedup_pd(w), wi = _mm256_permute_pd(w, 0xF);
+  __m256d as = _mm256_permute_pd(a, 0x5);
+  return _mm256_fmaddsub_pd(a, wr, _mm256_mul_pd(as, wi));
+}
+
+// complex products a (-i) of two values
+CMU462_TARGET_AVX2
+static inline __m256d mulmi_avx2(__m256d a) {
+  return _mm256_xor_pd(_mm256_permute_pd(a, 0x5),
+                       _mm256_set_pd(-0.0, 0.0, -0.0, 0.0));
+}
+
+// two radix-4 butterflies, without the twiddles
+CMU462_TARGET_AVX2
+static inline void butterfly4_avx2(__m256d a0, __m256d a1, __m256d a2,
+                                   __m256d a3, __m256d &b0, __m256d &b1,
+                                   __m256d &b2, __m256d &b3) {
+  __m256d t0 = _mm256_add_pd(a0, a2), t1 = _mm256_sub_pd(a0, a2);
+  __m256d t2 = _mm256_add_pd(a1, a3);
+  __m256d t3 = mulmi_avx2(_mm256_sub_pd(a1, a3));
+  b0 = _mm256_add_pd(t0, t2);
+  b1 = _mm256_add_pd(t1, t3);
+  b2 = _mm256_sub_pd(t0, t2);
+  b3 = _mm256_sub_pd(t1, t3);
+}
+
+// REQUIRES: s even, or s = 1 and m even
+CMU462_TARGET_AVX2
+static void radix4_avx2(const double *x, double *y, size_t m, size_t s,
+                        const double *tw) {
+  __m256d b0, b1, b2, b3;
+  if (s == 1) {
+    // pairs of neighboring j, whose inputs and twiddles are contiguous
+    for (size_t j = 0; j < m; j += 2) {
+      butterfly4_avx2(_mm256_loadu_pd(x + 2 * j),
+                      _mm256_loadu_pd(x + 2 * (j + m)),
+                      _mm256_loadu_pd(x + 2 * (j + 2 * m)),
+                      _mm256_loadu_pd(x + 2 * (j + 3 * m)), b0, b1, b2, b3);
+      b1 = cmul_avx2(b1, _mm256_loadu_pd(tw + 2 * j));
+      b2 = cmul_avx2(b2, _mm256_loadu_pd(tw + 2 * (m + j)));
+      b3 = cmul_avx2(b3, _mm256_loadu_pd(tw + 2 * (2 * m + j)));
+
+      // outputs 4j + k and 4(j + 1) + k
+      double *o = y + 8 * j;
+      _mm_storeu_pd(o, _mm256_castpd256_pd128(b0));
+      _mm_storeu_pd(o + 2, _mm256_castpd256_pd128(b1));
+      _mm_storeu_pd(o + 4, _mm256_castpd256_pd128(b2));
+      _mm_storeu_pd(o + 6, _mm256_castpd256_pd128(b3));
+      _mm_storeu_pd(o + 8, _mm256_extractf128_pd(b0, 1));
+      _mm_storeu_pd(o + 10, _mm256_extractf128_pd(b1, 1));
+      _mm_storeu_pd(o + 12, _mm256_extractf128_pd(b2, 1));
+      _mm_storeu_pd(o + 14, _mm256_extractf128_pd(b3, 1));
+    }
+    return;
+  }
+
+  // pairs of neighboring q, which share the twiddles
+  for (size_t j = 0; j < m; j++) {
+    __m256d w1 = _mm256_broadcast_pd((const __m128d *)(tw + 2 * j));
+    __m256d w2 = _mm256_broadcast_pd((const __m128d *)(tw + 2 * (m + j)));
+    __m256d w3 =
+        _mm256_broadcast_pd((const __m128d *)(tw + 2 * (2 * m + j)));
+    const double *a = x + 2 * s * j;
+    double *o = y + 8 * s * j;
+    for (size_t q = 0; q < s; q += 2) {
+      butterfly4_avx2(_mm256_loadu_pd(a + 2 * q),
+                      _mm256_loadu_pd(a + 2 * (q + s * m)),
+                      _mm256_loadu_pd(a + 2 * (q + 2 * s * m)),
+                      _mm256_loadu_pd(a + 2 * (q + 3 * s * m)), b0, b1, b2,
+                      b3);
+      _mm256_storeu_pd(o + 2 * q, b0);
+      _mm256_storeu_pd(o + 2 * (q + s), cmul_avx2(b1, w1));
+      _mm256_storeu_pd(o + 2 * (q + 2 * s), cmul_avx2(b2, w2));
+      _mm256_storeu_pd(o + 2 * (q + 3 * s), cmul_avx2(b3, w3));
+    }
+  }
+}
+#endif
+
+static void radix4(const double *x, double *y, size_t m, size_t s,
+                   const double *tw) {
+#ifdef CMU462_AVX2
+  if (SIMD::hasAVX2() && (s % 2 == 0 || m % 2 == 0)) {
+    radix4_avx2(x, y, m, s, tw);
+    return;
+  }
+#endif
+#ifdef CMU462_SSE2
+  if (SIMD::hasSSE2()) {
+    radix4_sse2(x, y, m, s, tw);
+    return;
+  }
+#endif
+  radix4_scalar(x, y, m, s, tw);
+}
+
+//------------------------------------------------------------------------------
+// FFTPlan
+//------------------------------------------------------------------------------
+
+FFTPlan::FFTPlan(size_t n) : n(n) {
+  // factor n, largest radices first
+  vector<size_t> radices;
+  size_t r = n;
+  while (r % 4 == 0) {
+    radices.push_back(4);
+    r /= 4;
+  }
+  if (r % 2 == 0) {
+    radices.push_back(2);
+    r /= 2;
+  }
+  for (size_t p = 3; r > 1; p += 2) {
+    if (p * p > r) p = r; // r is prime
+    while (r % p == 0) {
+      radices.push_back(p);
+      r /= p;
+    }
+  }
+
+  size_t length = n, stride = 1;
+  for (size_t i = 0; i < radices.size(); i++) {
+    Stage st;
+    st.radix = radices[i];
+    st.m = length / st.radix;
+    st.stride = stride;
+
+    // w^jk for k = 1..p-1, j = 0..m-1, with w = exp(-2 pi i/length)
+    st.twiddle = twiddles.size();
+    for (size_t k = 1; k < st.radix; k++) {
+      for (size_t j = 0; j < st.m; j++) {
+        double a = -2.0 * M_PI * (double)(j * k) / (double)length;
+        twiddles.push_back(Complex(cos(a), sin(a)));
+      }
+    }
+
+    // exp(-2 pi i t/p) for t = 0..p-1, for the generic butterfly
+    st.roots = twiddles.size();
+    if (st.radix != 2 && st.radix != 4) {
+      for (size_t t = 0; t < st.radix; t++) {
+        double a = -2.0 * M_PI * (double)t / (double)st.radix;
+        twiddles.push_back(Complex(cos(a), sin(a)));
+      }
+    }
+
+    stages.push_back(st);
+    length = st.m;
+    stride *= st.radix;
+  }
+}
+
+void FFTPlan::run(double *x, double *y) const {
+  if (stages.empty()) return; // n = 1
+
+  const double *tw = (const double *)&twiddles[0];
+  double *data = x;
+
+  for (size_t i = 0; i < stages.size(); i++) {
+    const Stage &st = stages[i];
+    switch (st.radix) {
+    case 4: radix4(x, y, st.m, st.stride, tw + 2 * st.twiddle); break;
+    case 2: radix2_scalar(x, y, st.m, st.stride, tw + 2 * st.twiddle); break;
+    default:
+      radixp_scalar(x, y, st.radix, st.m, st.stride, tw + 2 * st.twiddle,
+                    tw + 2 * st.roots);
+    }
+    swap(x, y);
+  }
+
+  // after an odd number of stages the result is in the scratch buffer
+  if (x != data) memcpy(data, x, n * sizeof(Complex));
+}
+
+void FFTPlan::forward(Complex *data, Complex *scratch) const {
+  run((double *)data, (double *)scratch);
+}
+
+void FFTPlan::inverse(Complex *data, Complex *scratch) const {
+  // inverse(x) = conj(forward(conj(x))) / n
+  for (size_t i = 0; i < n; i++) data[i].y = -data[i].y;
+  run((double *)data, (double *)scratch);
+
+  double r = 1.0 / n;
+  for (size_t i = 0; i < n; i++) {
+    data[i].x *= r;
+    data[i].y *= -r;
+  }
+}
+
+void FFTPlan::forward(Complex *data) const {
+  vector<Complex> scratch(n);
+  forward(data, &scratch[0]);
+}
+
+void FFTPlan::inverse(Complex *data) const {
+  vector<Complex> scratch(n);
+  inverse(data, &scratch[0]);
+}
+
+//------------------------------------------------------------------------------
+// RealFFTPlan
+//------------------------------------------------------------------------------
+
+RealFFTPlan::RealFFTPlan(size_t n) : n(n), half(n / 2) {
+  for (size_t k = 0; k <= n / 2; k++) {
+    double a = -2.0 * M_PI * (double)k / (double)n;
+    twiddles.push_back(Complex(cos(a), sin(a)));
+  }
+}
+
+void RealFFTPlan::forward(const double *in, Complex *out) const {
+  // Z = FFT(x[2j] + i x[2j+1]) holds the transforms E and O of the even
+  // and odd samples, Z[k] = E[k] + i O[k], and X[k] = E[k] + w^k O[k].
+  size_t h = n / 2;
+  vector<Complex> z(h), scratch(h);
+  for (size_t j = 0; j < h; j++) z[j] = Complex(in[2 * j], in[2 * j + 1]);
+  half.forward(&z[0], &scratch[0]);
+
+  for (size_t k = 0; k <= h; k++) {
+    Complex a = z[k % h], b = z[(h - k) % h].conj();
+    Complex e = 0.5 * (a + b);
+    Complex o = Complex(0.5 * (a - b)) * Complex(0, -1);
+    out[k] = e + twiddles[k] * o;
+  }
+}
+
+void RealFFTPlan::inverse(const Complex *in, double *out) const {
+  // E[k] = (X[k] + conj(X[h-k])) / 2, O[k] = (X[k] - conj(X[h-k])) / 2w^k
+  size_t h = n / 2;
+  vector<Complex> z(h), scratch(h);
+  for (size_t k = 0; k < h; k++) {
+    Complex a = in[k], b = in[h - k].conj();
+    Complex e = 0.5 * (a + b);
+    Complex o = Complex(0.5 * (a - b)) * twiddles[k].conj();
+    z[k] = e + Complex(0, 1) * o;
+  }
+  half.inverse(&z[0], &scratch[0]);
+  for (size_t j = 0; j < h; j++) {
+    out[2 * j] = z[j].x;
+    out[2 * j + 1] = z[j].y;
+  }
+}
+
+//------------------------------------------------------------------------------
+// FFTPlan2D
+//------------------------------------------------------------------------------
+
+FFTPlan2D::FFTPlan2D(size_t width, size_t height)
+    : rows(width), columns(height) {}
+
+// transforms count sequences of plan.size() values in parallel
+static void transformRows(const FFTPlan &plan, Complex *data, size_t count,
+                          bool inverse) {
+  size_t len = plan.size();
+#pragma omp parallel
+  {
+    vector<Complex> scratch(len);
+#pragma omp for
+    for (long r = 0; r < (long)count; r++) {
+      if (inverse) plan.inverse(data + r * len, &scratch[0]);
+      else plan.forward(data + r * len, &scratch[0]);
+    }
+  }
+}
+
+void FFTPlan2D::run(Complex *data, bool inverse) const {
+  size_t w = width(), h = height();
+  vector<Complex> t(w * h);
+
+  transformRows(rows, data, h, inverse);
+  transpose(data, &t[0], h, w);
+  transformRows(columns, &t[0], w, inverse);
+  transpose(&t[0], data, w, h);
+}
+
+void FFTPlan2D::forward(Complex *data) const { run(data, false); }
+
+void FFTPlan2D::inverse(Complex *data) const { run(data, true); }
+
+// Side of the square blocks of the transpose, 32 x 32 values = 16KB.
+static const size_t kTransposeBlock = 32;
+
+void transpose(const Complex *in, Complex *out, size_t rows, size_t cols) {
+  const size_t B = kTransposeBlock;
+#pragma omp parallel for
+  for (long i0 = 0; i0 < (long)rows; i0 += B) {
+    size_t i1 = min(rows, (size_t)i0 + B);
+    for (size_t j0 = 0; j0 < cols; j0 += B) {
+      size_t j1 = min(cols, j0 + B);
+      for (size_t i = i0; i < i1; i++) {
+        for (size_t j = j0; j < j1; j++) {
+          out[j * rows + i] = in[i * cols + j];
+        }
+      }
+    }
+  }
+}
+
+} // namespace CMU462
@@ -0,0 +1,269 @@
+#include "half.h"
+#include "simd.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace CMU462 {
+
+static_assert(sizeof(half) == 2, "half must be 2 bytes");
+static_assert(sizeof(Vector3h) == 6, "Vector3h must be 3 halves");
+static_assert(sizeof(Color4h) == 8, "Color4h must be 4 halves");
+static_assert(sizeof(Spectrum) == 3 * sizeof(float),
+              "Spectrum must be 3 floats");
+static_assert(sizeof(Color) == 4 * sizeof(float), "Color must be 4 floats");
+
+//------------------------------------------------------------------------------
+// Kernels
+//
+// Each kernel converts elements [i, n) and leaves the tail to the scalar
+// kernel. The SSE2 kernels are vector versions of floatToHalf() and
+// halfToFloat(), so they give the same results.
+//------------------------------------------------------------------------------
+
+static void f2h_scalar(size_t i, size_t n, const float *in, uint16_t *out) {
+  for (; i < n; i++) out[i] = floatToHalf(in[i]);
+}
+
+static void d2h_scalar(size_t i, size_t n, const double *in, uint16_t *out) {
+  for (; i < n; i++) out[i] = floatToHalf((float)in[i]);
+}
+
+static void h2f_scalar(size_t i, size_t n, const uint16_t *in, float *out) {
+  for (; i < n; i++) out[i] = halfToFloat(in[i]);
+}
+
+static void h2d_scalar(size_t i, size_t n, const uint16_t *in, double *out) {
+  for (; i < n; i++) out[i] = halfToFloat(in[i]);
+}
+
+#ifdef CMU462_SSE2
+// four floats to halves, in the low 16 bits of 32-bit lanes (sign
+// extended, for _mm_packs_epi32)
+static inline __m128i f2h4_sse2(__m128 f) {
+  const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+  const __m128i magic = _mm_set1_epi32(0x3F000000);
+
+  __m128 sign = _mm_and_ps(f, signMask);
+  __m128 absf = _mm_xor_ps(f, sign);
+  __m128i u = _mm_castps_si128(absf);
+
+  // infinity, or NaN
+  __m128i regular = _mm_cmpgt_epi32(_mm_set1_epi32(0x47800000), u);
+  __m128i nan = _mm_castps_si128(_mm_cmpunord_ps(absf, absf));
+  __m128i special = _mm_or_si128(_mm_set1_epi32(0x7C00),
+                                 _mm_and_si128(nan, _mm_set1_epi32(0x200)));
+
+  // subnormal
+  __m128i subnormal = _mm_cmpgt_epi32(_mm_set1_epi32(0x38800000), u);
+  __m128i s = _mm_sub_epi32(
+      _mm_castps_si128(_mm_add_ps(absf, _mm_castsi128_ps(magic))), magic);
+
+  // normal
+  __m128i odd = _mm_srli_epi32(_mm_slli_epi32(u, 18), 31);
+  __m128i h = _mm_add_epi32(u, _mm_set1_epi32(0xC8000FFF));
+  h = _mm_srli_epi32(_mm_add_epi32(h, odd), 13);
+
+  h = _mm_or_si128(_mm_and_si128(subnormal, s),
+                   _mm_andnot_si128(subnormal, h));
+  h = _mm_or_si128(_mm_and_si128(regular, h),
+                   _mm_andnot_si128(regular, special));
+  return _mm_or_si128(h, _mm_srai_epi32(_mm_castps_si128(sign), 16));
+}
+
+// four halves, in the low 16 bits of 32-bit lanes, to floats
+static inline __m128 h2f4_sse2(__m128i h) {
+  __m128i expMant = _mm_and_si128(h, _mm_set1_epi32(0x7FFF));
+  __m128i sign = _mm_slli_epi32(_mm_xor_si128(h, expMant), 16);
+  __m128 f = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(expMant, 13)),
+                        _mm_set1_ps(5.192296858534828e+33f));
+  __m128i infNaN = _mm_cmpgt_epi32(expMant, _mm_set1_epi32(0x7BFF));
+  infNaN = _mm_and_si128(infNaN, _mm_set1_epi32(0x7F800000));
+  return _mm_or_ps(f, _mm_castsi128_ps(_mm_or_si128(sign, infNaN)));
+}
+
+static void f2h_sse2(size_t i, size_t n, const float *in, uint16_t *out) {
+  for (; i + 8 <= n; i += 8) {
+    __m128i lo = f2h4_sse2(_mm_loadu_ps(in + i));
+    __m128i hi = f2h4_sse2(_mm_loadu_ps(in + i + 4));
+    _mm_storeu_si128((__m128i *)(out + i), _mm_packs_epi32(lo, hi));
+  }
+  f2h_scalar(i, n, in, out);
+}
+
+static void d2h_sse2(size_t i, size_t n, const double *in, uint16_t *out) {
+  for (; i + 8 <= n; i += 8) {
+    __m128 f[2];
+    for (int k = 0; k < 2; k++) {
+      const double *p = in + i + 4 * k;
+      f[k] = _mm_movelh_ps(_mm_cvtpd_ps(_mm_loadu_pd(p)),
+                           _mm_cvtpd_ps(_mm_loadu_pd(p + 2)));
+    }
+    _mm_storeu_si128((__m128i *)(out + i),
+                     _mm_packs_epi32(f2h4_sse2(f[0]), f2h4_sse2(f[1])));
+  }
+  d2h_scalar(i, n, in, out);
+}
+
+static void h2f_sse2(size_t i, size_t n, const uint16_t *in, float *out) {
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 8 <= n; i += 8) {
+    __m128i h = _mm_loadu_si128((const __m128i *)(in + i));
+    _mm_storeu_ps(out + i, h2f4_sse2(_mm_unpacklo_epi16(h, zero)));
+    _mm_storeu_ps(out + i + 4, h2f4_sse2(_mm_unpackhi_epi16(h, zero)));
+  }
+  h2f_scalar(i, n, in, out);
+}
+
+static void h2d_sse2(size_t i, size_t n, const uint16_t *in, double *out) {
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 8 <= n; i += 8) {
+    __m128i h = _mm_loadu_si128((const __m128i *)(in + i));
+    __m128 f[2] = {h2f4_sse2(_mm_unpacklo_epi16(h, zero)),
+                   h2f4_sse2(_mm_unpackhi_epi16(h, zero))};
+    for (int k = 0; k < 2; k++) {
+      double *p = out + i + 4 * k;
+      _mm_storeu_pd(p, _mm_cvtps_pd(f[k]));
+      _mm_storeu_pd(p + 2, _mm_cvtps_pd(_mm_movehl_ps(f[k], f[k])));
+    }
+  }
+  h2d_scalar(i, n, in, out);
+}
+#endif
+
+#ifdef CMU462_AVX2
+CMU462_TARGET_AVX2
+static void f2h_avx2(size_t i, size_t n, const float *in, uint16_t *out) {
+  for (; i + 8 <= n; i += 8) {
+    __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(in + i),
+                                _MM_FROUND_TO_NEAREST_INT);
+    _mm_storeu_si128((__m128i *)(out + i), h);
+  }
+  f2h_scalar(i, n, in, out);
+}
+
+CMU462_TARGET_AVX2
+static void d2h_avx2(size_t i, size_t n, const double *in, uint16_t *out) {
+  for (; i + 8 <= n; i += 8) {
+    __m128 lo = _mm256_cvtpd_ps(_mm256_loadu_pd(in + i));
+    __m128 hi = _mm256_cvtpd_ps(_mm256_loadu_pd(in + i + 4));
+    __m256 f = _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+    _mm_storeu_si128((__m128i *)(out + i),
+                     _mm256_cvtps_ph(f, _MM_FROUND_TO_NEAREST_INT));
+  }
+  d2h_scalar(i, n, in, out);
+}
+
+CMU462_TARGET_AVX2
+static void h2f_avx2(size_t i, size_t n, const uint16_t *in, float *out) {
+  for (; i + 8 <= n; i += 8) {
+    __m128i h = _mm_loadu_si128((const __m128i *)(in + i));
+    _mm256_storeu_ps(out + i, _mm256_cvtph_ps(h));
+  }
+  h2f_scalar(i, n, in, out);
+}
+
+CMU462_TARGET_AVX2
+static void h2d_avx2(size_t i, size_t n, const uint16_t *in, double *out) {
+  for (; i + 8 <= n; i += 8) {
+    __m256 f = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(in + i)));
+    _mm256_storeu_pd(out + i, _mm256_cvtps_pd(_mm256_castps256_ps128(f)));
+    _mm256_storeu_pd(out + i + 4,
+                     _mm256_cvtps_pd(_mm256_extractf128_ps(f, 1)));
+  }
+  h2d_scalar(i, n, in, out);
+}
+#endif
+
+// drivers //
+
+// Values per block; blocks are converted in parallel.
+static const size_t kHalfBlock = 16384;
+
+template <typename In, typename Out>
+static void convert(void (*kernel)(size_t, size_t, const In *, Out *),
+                    const In *in, Out *out, size_t n) {
+  long blocks = (long)((n + kHalfBlock - 1) / kHalfBlock);
+#pragma omp parallel for if (blocks > 1)
+  for (long b = 0; b < blocks; b++) {
+    size_t i = b * kHalfBlock;
+    kernel(i, min(n, i + kHalfBlock), in, out);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Conversions
+//------------------------------------------------------------------------------
+
+void toHalf(const float *in, half *out, size_t n) {
+  void (*kernel)(size_t, size_t, const float *, uint16_t *) = f2h_scalar;
+#ifdef CMU462_SSE2
+  if (SIMD::hasSSE2()) kernel = f2h_sse2;
+#endif
+#ifdef CMU462_AVX2
+  if (SIMD::hasAVX2()) kernel = f2h_avx2;
+#endif
+  convert(kernel, in, (uint16_t *)out, n);
+}
+
+void toHalf(const double *in, half *out, size_t n) {
+  void (*kernel)(size_t, size_t, const double *, uint16_t *) = d2h_scalar;
+#ifdef CMU462_SSE2
+  if (SIMD::hasSSE2()) kernel = d2h_sse2;
+#endif
+#ifdef CMU462_AVX2
+  if (SIMD::hasAVX2()) kernel = d2h_avx2;
+#endif
+  convert(kernel, in, (uint16_t *)out, n);
+}
+
+void fromHalf(const half *in, float *out, size_t n) {
+  void (*kernel)(size_t, size_t, const uint16_t *, float *) = h2f_scalar;
+#ifdef CMU462_SSE2
+  if (SIMD::hasSSE2()) kernel = h2f_sse2;
+#endif
+#ifdef CMU462_AVX2
+  if (SIMD::hasAVX2()) kernel = h2f_avx2;
+#endif
+  convert(kernel, (const uint16_t *)in, out, n);
+}
+
+void fromHalf(const half *in, double *out, size_t n) {
+  void (*kernel)(size_t, size_t, const uint16_t *, double *) = h2d_scalar;
+#ifdef CMU462_SSE2
+  if (SIMD::hasSSE2()) kernel = h2d_sse2;
+#endif
+#ifdef CMU462_AVX2
+  if (SIMD::hasAVX2()) kernel = h2d_avx2;
+#endif
+  convert(kernel, (const uint16_t *)in, out, n);
+}
+
+// vectors and colors are arrays of their components
+
+void toHalf(const Vector3D *in, Vector3h *out, size_t n) {
+  toHalf((const double *)in, (half *)out, 3 * n);
+}
+
+void fromHalf(const Vector3h *in, Vector3D *out, size_t n) {
+  fromHalf((const half *)in, (double *)out, 3 * n);
+}
+
+void toHalf(const Spectrum *in, Vector3h *out, size_t n) {
+  toHalf((const float *)in, (half *)out, 3 * n);
+}
+
+void fromHalf(const Vector3h *in, Spectrum *out, size_t n) {
+  fromHalf((const half *)in, (float *)out, 3 * n);
+}
+
+void toHalf(const Color *in, Color4h *out, size_t n) {
+  toHalf((const float *)in, (half *)out, 4 * n);
+}
+
+void fromHalf(const Color4h *in, Color *out, size_t n) {
+  fromHalf((const half *)in, (float *)out, 4 * n);
+}
+
+} // namespace CMU462
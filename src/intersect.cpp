@@ -0,0 +1,302 @@
+#include "intersect.h"
+#include "simd.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace CMU462 {
+
+//------------------------------------------------------------------------------
+// Kernels
+//
+// Each kernel tests the N rays of a packet, two per iteration with SSE2
+// and four with AVX2, and sets bit k of the returned mask if ray k hits.
+// The box or triangle is broadcast across the lanes. Outputs are written
+// for hits only, after all loads, so t may alias r.maxT.
+//------------------------------------------------------------------------------
+
+// slab //
+
+template <int N>
+static int slab_scalar(const BBox &b, const RayPacket<N> &r,
+                       double *tEnter) {
+  int mask = 0;
+  for (int k = 0; k < N; k++) {
+    double tn = r.minT[k], tf = r.maxT[k];
+    for (int a = 0; a < 3; a++) {
+      double ta = (b.min[a] - r.o[a][k]) * r.invD[a][k];
+      double tb = (b.max[a] - r.o[a][k]) * r.invD[a][k];
+      tn = max(tn, min(ta, tb));
+      tf = min(tf, max(ta, tb));
+    }
+    if (tn <= tf) {
+      mask |= 1 << k;
+      if (tEnter) tEnter[k] = tn;
+    }
+  }
+  return mask;
+}
+
+// triangle //
+
+template <int N>
+static int triangle_scalar(const RayPacket<N> &r, const Vector3D &p0,
+                           const Vector3D &p1, const Vector3D &p2, double *t,
+                           double *u, double *v) {
+  int mask = 0;
+  for (int k = 0; k < N; k++) {
+    Ray rk(Vector3D(r.o[0][k], r.o[1][k], r.o[2][k]),
+           Vector3D(r.d[0][k], r.d[1][k], r.d[2][k]), r.minT[k], r.maxT[k]);
+    double hu, hv, ht;
+    if (intersectTriangle(rk, p0, p1, p2, ht, hu, hv)) {
+      mask |= 1 << k;
+      t[k] = ht;
+      if (u) u[k] = hu;
+      if (v) v[k] = hv;
+    }
+  }
+  return mask;
+}
+
+#ifdef CMU462_SSE2
+template <int N>
+static int slab_sse2(const BBox &b, const RayPacket<N> &r, double *tEnter) {
+  int mask = 0;
+  for (int k = 0; k < N; k += 2) {
+    __m128d tn = _mm_loadu_pd(r.minT + k), tf = _mm_loadu_pd(r.maxT + k);
+    for (int a = 0; a < 3; a++) {
+      __m128d o = _mm_loadu_pd(r.o[a] + k), id = _mm_loadu_pd(r.invD[a] + k);
+      __m128d ta = _mm_mul_pd(_mm_sub_pd(_mm_set1_pd(b.min[a]), o), id);
+      __m128d tb = _mm_mul_pd(_mm_sub_pd(_mm_set1_pd(b.max[a]), o), id);
+      tn = _mm_max_pd(_mm_min_pd(ta, tb), tn);
+      tf = _mm_min_pd(_mm_max_pd(ta, tb), tf);
+    }
+    int hit = _mm_movemask_pd(_mm_cmple_pd(tn, tf));
+    if (tEnter) {
+      if (hit & 1) _mm_storel_pd(tEnter + k, tn);
+      if (hit & 2) _mm_storeh_pd(tEnter + k + 1, tn);
+    }
+    mask |= hit << k;
+  }
+  return mask;
+}
+
+template <int N>
+static int triangle_sse2(const RayPacket<N> &r, const Vector3D &p0,
+                         const Vector3D &p1, const Vector3D &p2, double *t,
+                         double *u, double *v) {
+  Vector3D e1 = p1 - p0, e2 = p2 - p0;
+  const __m128d zero = _mm_setzero_pd(), one = _mm_set1_pd(1);
+  __m128d e1x = _mm_set1_pd(e1.x), e1y = _mm_set1_pd(e1.y);
+  __m128d e1z = _mm_set1_pd(e1.z), e2x = _mm_set1_pd(e2.x);
+  __m128d e2y = _mm_set1_pd(e2.y), e2z = _mm_set1_pd(e2.z);
+
+  int mask = 0;
+  for (int k = 0; k < N; k += 2) {
+    __m128d dx = _mm_loadu_pd(r.d[0] + k), dy = _mm_loadu_pd(r.d[1] + k);
+    __m128d dz = _mm_loadu_pd(r.d[2] + k);
+
+    // p = d x e2, det = e1 . p
+    __m128d px = _mm_sub_pd(_mm_mul_pd(dy, e2z), _mm_mul_pd(dz, e2y));
+    __m128d py = _mm_sub_pd(_mm_mul_pd(dz, e2x), _mm_mul_pd(dx, e2z));
+    __m128d pz = _mm_sub_pd(_mm_mul_pd(dx, e2y), _mm_mul_pd(dy, e2x));
+    __m128d det = _mm_add_pd(
+        _mm_add_pd(_mm_mul_pd(e1x, px), _mm_mul_pd(e1y, py)),
+        _mm_mul_pd(e1z, pz));
+    __m128d inv = _mm_div_pd(one, det);
+
+    // s = o - p0, u = s . p / det
+    __m128d sx = _mm_sub_pd(_mm_loadu_pd(r.o[0] + k), _mm_set1_pd(p0.x));
+    __m128d sy = _mm_sub_pd(_mm_loadu_pd(r.o[1] + k), _mm_set1_pd(p0.y));
+    __m128d sz = _mm_sub_pd(_mm_loadu_pd(r.o[2] + k), _mm_set1_pd(p0.z));
+    __m128d hu = _mm_mul_pd(
+        _mm_add_pd(_mm_add_pd(_mm_mul_pd(sx, px), _mm_mul_pd(sy, py)),
+                   _mm_mul_pd(sz, pz)),
+        inv);
+
+    // q = s x e1, v = d . q / det, t = e2 . q / det
+    __m128d qx = _mm_sub_pd(_mm_mul_pd(sy, e1z), _mm_mul_pd(sz, e1y));
+    __m128d qy = _mm_sub_pd(_mm_mul_pd(sz, e1x), _mm_mul_pd(sx, e1z));
+    __m128d qz = _mm_sub_pd(_mm_mul_pd(sx, e1y), _mm_mul_pd(sy, e1x));
+    __m128d hv = _mm_mul_pd(
+        _mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, qx), _mm_mul_pd(dy, qy)),
+                   _mm_mul_pd(dz, qz)),
+        inv);
+    __m128d ht = _mm_mul_pd(
+        _mm_add_pd(_mm_add_pd(_mm_mul_pd(e2x, qx), _mm_mul_pd(e2y, qy)),
+                   _mm_mul_pd(e2z, qz)),
+        inv);
+
+    __m128d ok = _mm_cmpneq_pd(det, zero);
+    ok = _mm_and_pd(ok, _mm_cmpge_pd(hu, zero));
+    ok = _mm_and_pd(ok, _mm_cmpge_pd(hv, zero));
+    ok = _mm_and_pd(ok, _mm_cmple_pd(_mm_add_pd(hu, hv), one));
+    ok = _mm_and_pd(ok, _mm_cmpge_pd(ht, _mm_loadu_pd(r.minT + k)));
+    ok = _mm_and_pd(ok, _mm_cmple_pd(ht, _mm_loadu_pd(r.maxT + k)));
+
+    int hit = _mm_movemask_pd(ok);
+    for (int l = 0; l < 2; l++) {
+      if (!(hit & (1 << l))) continue;
+      _mm_storel_pd(t + k + l, l ? _mm_unpackhi_pd(ht, ht) : ht);
+      if (u) _mm_storel_pd(u + k + l, l ? _mm_unpackhi_pd(hu, hu) : hu);
+      if (v) _mm_storel_pd(v + k + l, l ? _mm_unpackhi_pd(hv, hv) : hv);
+    }
+    mask |= hit << k;
+  }
+  return mask;
+}
+#endif
+
+#ifdef CMU462_AVX2
+// stores the lanes of x selected by the 4-bit mask hit to out[0..3]
+CMU462_TARGET_AVX2
+static inline void storeMasked_avx2(double *out, __m256d x, int hit) {
+  double tmp[4];
+  _mm256_storeu_pd(tmp, x);
+  for (int l = 0; l < 4; l++)
+    if (hit & (1 << l)) out[l] = tmp[l];
+}
+
+template <int N>
+CMU462_TARGET_AVX2 static int slab_avx2(const BBox &b, const RayPacket<N> &r,
+                                        double *tEnter) {
+  int mask = 0;
+  for (int k = 0; k < N; k += 4) {
+    __m256d tn = _mm256_loadu_pd(r.minT + k);
+    __m256d tf = _mm256_loadu_pd(r.maxT + k);
+    for (int a = 0; a < 3; a++) {
+      __m256d o = _mm256_loadu_pd(r.o[a] + k);
+      __m256d id = _mm256_loadu_pd(r.invD[a] + k);
+      __m256d ta = _mm256_mul_pd(_mm256_sub_pd(_mm256_set1_pd(b.min[a]), o),
+                                 id);
+      __m256d tb = _mm256_mul_pd(_mm256_sub_pd(_mm256_set1_pd(b.max[a]), o),
+                                 id);
+      tn = _mm256_max_pd(_mm256_min_pd(ta, tb), tn);
+      tf = _mm256_min_pd(_mm256_max_pd(ta, tb), tf);
+    }
+    int hit = _mm256_movemask_pd(_mm256_cmp_pd(tn, tf, _CMP_LE_OQ));
+    if (tEnter && hit) storeMasked_avx2(tEnter + k, tn, hit);
+    mask |= hit << k;
+  }
+  return mask;
+}
+
+template <int N>
+CMU462_TARGET_AVX2 static int
+triangle_avx2(const RayPacket<N> &r, const Vector3D &p0, const Vector3D &p1,
+              const Vector3D &p2, double *t, double *u, double *v) {
+  Vector3D e1 = p1 - p0, e2 = p2 - p0;
+  const __m256d zero = _mm256_setzero_pd(), one = _mm256_set1_pd(1);
+  __m256d e1x = _mm256_set1_pd(e1.x), e1y = _mm256_set1_pd(e1.y);
+  __m256d e1z = _mm256_set1_pd(e1.z), e2x = _mm256_set1_pd(e2.x);
+  __m256d e2y = _mm256_set1_pd(e2.y), e2z = _mm256_set1_pd(e2.z);
+
+  int mask = 0;
+  for (int k = 0; k < N; k += 4) {
+    __m256d dx = _mm256_loadu_pd(r.d[0] + k);
+    __m256d dy = _mm256_loadu_pd(r.d[1] + k);
+    __m256d dz = _mm256_loadu_pd(r.d[2] + k);
+
+    // p = d x e2, det = e1 . p
+    __m256d px = _mm256_fmsub_pd(dy, e2z, _mm256_mul_pd(dz, e2y));
+    __m256d py = _mm256_fmsub_pd(dz, e2x, _mm256_mul_pd(dx, e2z));
+    __m256d pz = _mm256_fmsub_pd(dx, e2y, _mm256_mul_pd(dy, e2x));
+    __m256d det = _mm256_fmadd_pd(
+        e1x, px, _mm256_fmadd_pd(e1y, py, _mm256_mul_pd(e1z, pz)));
+    __m256d inv = _mm256_div_pd(one, det);
+
+    // s = o - p0, u = s . p / det
+    __m256d sx = _mm256_sub_pd(_mm256_loadu_pd(r.o[0] + k),
+                               _mm256_set1_pd(p0.x));
+    __m256d sy = _mm256_sub_pd(_mm256_loadu_pd(r.o[1] + k),
+                               _mm256_set1_pd(p0.y));
+    __m256d sz = _mm256_sub_pd(_mm256_loadu_pd(r.o[2] + k),
+                               _mm256_set1_pd(p0.z));
+    __m256d hu = _mm256_mul_pd(
+        _mm256_fmadd_pd(sx, px, _mm256_fmadd_pd(sy, py, _mm256_mul_pd(sz, pz))),
+        inv);
+
+    // q = s x e1, v = d . q / det, t = e2 . q / det
+    __m256d qx = _mm256_fmsub_pd(sy, e1z, _mm256_mul_pd(sz, e1y));
+    __m256d qy = _mm256_fmsub_pd(sz, e1x, _mm256_mul_pd(sx, e1z));
+    __m256d qz = _mm256_fmsub_pd(sx, e1y, _mm256_mul_pd(sy, e1x));
+    __m256d hv = _mm256_mul_pd(
+        _mm256_fmadd_pd(dx, qx, _mm256_fmadd_pd(dy, qy, _mm256_mul_pd(dz, qz))),
+        inv);
+    __m256d ht = _mm256_mul_pd(
+        _mm256_fmadd_pd(e2x, qx,
+                        _mm256_fmadd_pd(e2y, qy, _mm256_mul_pd(e2z, qz))),
+        inv);
+
+    __m256d ok = _mm256_cmp_pd(det, zero, _CMP_NEQ_OQ);
+    ok = _mm256_and_pd(ok, _mm256_cmp_pd(hu, zero, _CMP_GE_OQ));
+    ok = _mm256_and_pd(ok, _mm256_cmp_pd(hv, zero, _CMP_GE_OQ));
+    ok = _mm256_and_pd(
+        ok, _mm256_cmp_pd(_mm256_add_pd(hu, hv), one, _CMP_LE_OQ));
+    ok = _mm256_and_pd(
+        ok, _mm256_cmp_pd(ht, _mm256_loadu_pd(r.minT + k), _CMP_GE_OQ));
+    ok = _mm256_and_pd(
+        ok, _mm256_cmp_pd(ht, _mm256_loadu_pd(r.maxT + k), _CMP_LE_OQ));
+
+    int hit = _mm256_movemask_pd(ok);
+    if (hit) {
+      storeMasked_avx2(t + k, ht, hit);
+      if (u) storeMasked_avx2(u + k, hu, hit);
+      if (v) storeMasked_avx2(v + k, hv, hit);
+    }
+    mask |= hit << k;
+  }
+  return mask;
+}
+#endif
+
+template <int N>
+static int slab(const BBox &b, const RayPacket<N> &r, double *tEnter) {
+#ifdef CMU462_AVX2
+  if (SIMD::hasAVX2()) return slab_avx2(b, r, tEnter);
+#endif
+#ifdef CMU462_SSE2
+  if (SIMD::hasSSE2()) return slab_sse2(b, r, tEnter);
+#endif
+  return slab_scalar(b, r, tEnter);
+}
+
+template <int N>
+static int triangle(const RayPacket<N> &r, const Vector3D &p0,
+                    const Vector3D &p1, const Vector3D &p2, double *t,
+                    double *u, double *v) {
+#ifdef CMU462_AVX2
+  if (SIMD::hasAVX2()) return triangle_avx2(r, p0, p1, p2, t, u, v);
+#endif
+#ifdef CMU462_SSE2
+  if (SIMD::hasSSE2()) return triangle_sse2(r, p0, p1, p2, t, u, v);
+#endif
+  return triangle_scalar(r, p0, p1, p2, t, u, v);
+}
+
+//------------------------------------------------------------------------------
+// Packet intersection
+//------------------------------------------------------------------------------
+
+int intersect(const BBox &b, const RayPacket4 &r, double *tEnter) {
+  return slab(b, r, tEnter);
+}
+
+int intersect(const BBox &b, const RayPacket8 &r, double *tEnter) {
+  return slab(b, r, tEnter);
+}
+
+int intersectTriangle(const RayPacket4 &r, const Vector3D &p0,
+                      const Vector3D &p1, const Vector3D &p2, double *t,
+                      double *u, double *v) {
+  return triangle(r, p0, p1, p2, t, u, v);
+}
+
+int intersectTriangle(const RayPacket8 &r, const Vector3D &p0,
+                      const Vector3D &p1, const Vector3D &p2, double *t,
+                      double *u, double *v) {
+  return triangle(r, p0, p1, p2, t, u, v);
+}
+
+} // namespace CMU462
@@ -0,0 +1,260 @@
+#include "kdTree.h"
+#include "bbox.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace CMU462 {
+
+// Ranges of at most this many points are leaves.
+static const size_t kLeafSize = 8;
+
+// Ranges of more points are split as parallel tasks.
+static const size_t kTaskGrain = 16384;
+
+// Points per block of the parallel loops, queries per block of the
+// batched queries.
+static const size_t kPointBlock = 65536;
+static const size_t kQueryBlock = 256;
+
+//------------------------------------------------------------------------------
+// Build
+//------------------------------------------------------------------------------
+
+struct KdEntry {
+  Vector3D p;
+  uint32_t index;
+};
+
+static void buildRange(KdEntry *e, uint8_t *axes, size_t begin, size_t end,
+                       BBox cell) {
+  size_t n = end - begin;
+  if (n <= kLeafSize) return;
+
+  int a = cell.maxAxis();
+  size_t m = begin + n / 2;
+  nth_element(e + begin, e + m, e + end,
+              [a](const KdEntry &p, const KdEntry &q) {
+                return p.p[a] < q.p[a];
+              });
+  axes[m] = (uint8_t)a;
+
+  BBox lo = cell, hi = cell;
+  lo.max[a] = hi.min[a] = e[m].p[a];
+  if (n > kTaskGrain) {
+#pragma omp task
+    buildRange(e, axes, begin, m, lo);
+    buildRange(e, axes, m + 1, end, hi);
+#pragma omp taskwait
+  } else {
+    buildRange(e, axes, begin, m, lo);
+    buildRange(e, axes, m + 1, end, hi);
+  }
+}
+
+void KdTree::build(const Vector3D *points, size_t n) {
+  long blocks = (long)((n + kPointBlock - 1) / kPointBlock);
+  vector<KdEntry> entries(n);
+  vector<BBox> partial(blocks);
+#pragma omp parallel for if (blocks > 1)
+  for (long b = 0; b < blocks; b++) {
+    size_t end = min(n, (b + 1) * kPointBlock);
+    for (size_t i = b * kPointBlock; i < end; i++) {
+      entries[i].p = points[i];
+      entries[i].index = (uint32_t)i;
+      partial[b].expand(points[i]);
+    }
+  }
+  BBox cell;
+  for (long b = 0; b < blocks; b++) cell.expand(partial[b]);
+
+  axes.assign(n, 0);
+  if (n) {
+#pragma omp parallel
+#pragma omp single
+    buildRange(&entries[0], &axes[0], 0, n, cell);
+  }
+
+  pts.resize(n);
+  ids.resize(n);
+#pragma omp parallel for if (blocks > 1)
+  for (long b = 0; b < blocks; b++) {
+    size_t end = min(n, (b + 1) * kPointBlock);
+    for (size_t i = b * kPointBlock; i < end; i++) {
+      pts[i] = entries[i].p;
+      ids[i] = entries[i].index;
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Queries
+//
+// The query descends to the child on q's side of the median first, then
+// visits the other child only if its cell is closer than the current
+// search radius (shrunk by 1 + eps for approximate searches). The
+// distance to the cell is updated incrementally (Arya and Mount, 1993).
+//------------------------------------------------------------------------------
+
+struct KdView {
+  const Vector3D *pts;
+  const uint32_t *ids;
+  const uint8_t *axes;
+};
+
+// the k closest points so far, sorted by distance
+struct KnnState {
+  Vector3D q;
+  size_t k, count;
+  uint32_t *indices;
+  double *dist2;
+  double worst; ///< search radius squared
+  double scale; ///< (1 + eps)^2
+
+  inline void offer(const KdView &t, size_t i) {
+    double d = (t.pts[i] - q).norm2();
+    if (count == k ? d >= worst : d > worst) return;
+
+    size_t j = count < k ? count++ : k - 1;
+    for (; j > 0 && dist2[j - 1] > d; j--) {
+      dist2[j] = dist2[j - 1];
+      indices[j] = indices[j - 1];
+    }
+    dist2[j] = d;
+    indices[j] = t.ids[i];
+    if (count == k) worst = dist2[k - 1];
+  }
+};
+
+static void knnRange(const KdView &t, KnnState &s, size_t begin, size_t end,
+                     double rd, double off[3]) {
+  if (end - begin <= kLeafSize) {
+    for (size_t i = begin; i < end; i++) s.offer(t, i);
+    return;
+  }
+
+  size_t m = begin + (end - begin) / 2;
+  int a = t.axes[m];
+  double d = s.q[a] - t.pts[m][a];
+  s.offer(t, m);
+
+  // rd is the squared distance from q to the cell of the range, tracked
+  // through the offsets to the cell along each axis
+  bool left = d < 0;
+  knnRange(t, s, left ? begin : m + 1, left ? m : end, rd, off);
+  double old = off[a];
+  rd += d * d - old * old;
+  if (rd * s.scale <= s.worst) {
+    off[a] = d;
+    knnRange(t, s, left ? m + 1 : begin, left ? end : m, rd, off);
+    off[a] = old;
+  }
+}
+
+static void radiusRange(const KdView &t, const Vector3D &q, double r2,
+                        size_t begin, size_t end, double rd, double off[3],
+                        vector<uint32_t> &out) {
+  if (end - begin <= kLeafSize) {
+    for (size_t i = begin; i < end; i++)
+      if ((t.pts[i] - q).norm2() <= r2) out.push_back(t.ids[i]);
+    return;
+  }
+
+  size_t m = begin + (end - begin) / 2;
+  int a = t.axes[m];
+  double d = q[a] - t.pts[m][a];
+  if ((t.pts[m] - q).norm2() <= r2) out.push_back(t.ids[m]);
+
+  bool left = d < 0;
+  radiusRange(t, q, r2, left ? begin : m + 1, left ? m : end, rd, off, out);
+  double old = off[a];
+  rd += d * d - old * old;
+  if (rd <= r2) {
+    off[a] = d;
+    radiusRange(t, q, r2, left ? m + 1 : begin, left ? end : m, rd, off,
+                out);
+    off[a] = old;
+  }
+}
+
+size_t KdTree::knn(const Vector3D &q, size_t k, uint32_t *indices,
+                   double *dist2, double maxDist2, double eps) const {
+  if (pts.empty() || !k) return 0;
+  KdView t = {&pts[0], &ids[0], &axes[0]};
+  KnnState s = {q, k, 0, indices, dist2, maxDist2, (1 + eps) * (1 + eps)};
+  double off[3] = {0, 0, 0};
+  knnRange(t, s, 0, pts.size(), 0, off);
+  return s.count;
+}
+
+uint32_t KdTree::nearest(const Vector3D &q, double *dist2, double eps) const {
+  uint32_t i = kNone;
+  double d = INFINITY;
+  knn(q, 1, &i, &d, INFINITY, eps);
+  if (dist2) *dist2 = d;
+  return i;
+}
+
+size_t KdTree::radius(const Vector3D &q, double r,
+                      vector<uint32_t> &indices) const {
+  indices.clear();
+  if (pts.empty()) return 0;
+  KdView t = {&pts[0], &ids[0], &axes[0]};
+  double off[3] = {0, 0, 0};
+  radiusRange(t, q, r * r, 0, pts.size(), 0, off, indices);
+  return indices.size();
+}
+
+void KdTree::knn(const Vector3D *queries, size_t m, size_t k,
+                 uint32_t *indices, double *dist2, double maxDist2,
+                 double eps) const {
+  if (!k) return;
+  long blocks = (long)((m + kQueryBlock - 1) / kQueryBlock);
+#pragma omp parallel if (blocks > 1)
+  {
+    vector<double> scratch(dist2 ? 0 : k);
+#pragma omp for
+    for (long b = 0; b < blocks; b++) {
+      size_t end = min(m, (b + 1) * kQueryBlock);
+      for (size_t i = b * kQueryBlock; i < end; i++) {
+        uint32_t *id = indices + i * k;
+        double *d2 = dist2 ? dist2 + i * k : scratch.data();
+        size_t found = knn(queries[i], k, id, d2, maxDist2, eps);
+        fill(id + found, id + k, (uint32_t)kNone);
+        fill(d2 + found, d2 + k, (double)INFINITY);
+      }
+    }
+  }
+}
+
+void KdTree::radius(const Vector3D *queries, size_t m, double r,
+                    vector<size_t> &offsets,
+                    vector<uint32_t> &indices) const {
+  // each block gathers its neighbors, which are then concatenated
+  long blocks = (long)((m + kQueryBlock - 1) / kQueryBlock);
+  vector<vector<uint32_t> > found(blocks);
+  offsets.assign(m + 1, 0);
+#pragma omp parallel if (blocks > 1)
+  {
+    vector<uint32_t> neighbors;
+#pragma omp for
+    for (long b = 0; b < blocks; b++) {
+      size_t end = min(m, (b + 1) * kQueryBlock);
+      for (size_t i = b * kQueryBlock; i < end; i++) {
+        offsets[i + 1] = radius(queries[i], r, neighbors);
+        found[b].insert(found[b].end(), neighbors.begin(), neighbors.end());
+      }
+    }
+  }
+
+  for (size_t i = 0; i < m; i++) offsets[i + 1] += offsets[i];
+  indices.resize(offsets[m]);
+#pragma omp parallel for if (blocks > 1)
+  for (long b = 0; b < blocks; b++) {
+    copy(found[b].begin(), found[b].end(),
+         indices.begin() + offsets[b * kQueryBlock]);
+  }
+}
+
+} // namespace CMU462
@@ -7,159 +7,25 @@ using namespace std;
 
 namespace CMU462 {
 
-double &Matrix3x3::operator()(int i, int j) { return entries[j][i]; }
-
-const double &Matrix3x3::operator()(int i, int j) const {
-  return entries[j][i];
-}
-
-Vector3D &Matrix3x3::operator[](int j) { return entries[j]; }
-
-const Vector3D &Matrix3x3::operator[](int j) const { return entries[j]; }
-
-void Matrix3x3::zero(double val) {
-  // sets all elements to val
-  entries[0] = entries[1] = entries[2] = Vector3D(val, val, val);
-}
-
-double Matrix3x3::det(void) const {
-  const Matrix3x3 &A(*this);
+template <typename S>
+S BasicMatrix3x3<S>::det(void) const {
+  const BasicMatrix3x3<S> &A(*this);
 
   return -A(0, 2) * A(1, 1) * A(2, 0) + A(0, 1) * A(1, 2) * A(2, 0) +
          A(0, 2) * A(1, 0) * A(2, 1) - A(0, 0) * A(1, 2) * A(2, 1) -
          A(0, 1) * A(1, 0) * A(2, 2) + A(0, 0) * A(1, 1) * A(2, 2);
 }
 
-double Matrix3x3::norm(void) const {
-  return sqrt(entries[0].norm2() + entries[1].norm2() + entries[2].norm2());
-}
-
-Matrix3x3 Matrix3x3::operator-(void) const {
-
-  // returns -A
-  const Matrix3x3 &A(*this);
-  Matrix3x3 B;
-
-  B(0, 0) = -A(0, 0);
-  B(0, 1) = -A(0, 1);
-  B(0, 2) = -A(0, 2);
-  B(1, 0) = -A(1, 0);
-  B(1, 1) = -A(1, 1);
-  B(1, 2) = -A(1, 2);
-  B(2, 0) = -A(2, 0);
-  B(2, 1) = -A(2, 1);
-  B(2, 2) = -A(2, 2);
-
-  return B;
-}
-
-void Matrix3x3::operator+=(const Matrix3x3 &B) {
-
-  Matrix3x3 &A(*this);
-  double *Aij = (double *)&A;
-  const double *Bij = (const double *)&B;
-
-  *Aij++ += *Bij++;
-  *Aij++ += *Bij++;
-  *Aij++ += *Bij++;
-  *Aij++ += *Bij++;
-  *Aij++ += *Bij++;
-  *Aij++ += *Bij++;
-  *Aij++ += *Bij++;
-  *Aij++ += *Bij++;
-  *Aij++ += *Bij++;
-}
-
-Matrix3x3 Matrix3x3::operator+(const Matrix3x3 &B) const {
-  const Matrix3x3 &A(*this);
-  Matrix3x3 C;
-
-  for (int i = 0; i < 3; i++)
-    for (int j = 0; j < 3; j++) {
-      C(i, j) = A(i, j) + B(i, j);
-    }
-
-  return C;
-}
-
-Matrix3x3 Matrix3x3::operator-(const Matrix3x3 &B) const {
-  const Matrix3x3 &A(*this);
-  Matrix3x3 C;
-
-  for (int i = 0; i < 3; i++)
-    for (int j = 0; j < 3; j++) {
-      C(i, j) = A(i, j) - B(i, j);
-    }
-
-  return C;
+template <typename S>
+S BasicMatrix3x3<S>::norm(void) const {
+  return std::sqrt(entries[0].norm2() + entries[1].norm2() +
+                   entries[2].norm2());
 }
 
-Matrix3x3 Matrix3x3::operator*(double c) const {
-  const Matrix3x3 &A(*this);
-  Matrix3x3 B;
-
-  for (int i = 0; i < 3; i++)
-    for (int j = 0; j < 3; j++) {
-      B(i, j) = c * A(i, j);
-    }
-
-  return B;
-}
-
-Matrix3x3 operator*(double c, const Matrix3x3 &A) {
-
-  Matrix3x3 cA;
-  const double *Aij = (const double *)&A;
-  double *cAij = (double *)&cA;
-
-  *cAij++ = c *(*Aij++);
-  *cAij++ = c *(*Aij++);
-  *cAij++ = c *(*Aij++);
-  *cAij++ = c *(*Aij++);
-  *cAij++ = c *(*Aij++);
-  *cAij++ = c *(*Aij++);
-  *cAij++ = c *(*Aij++);
-  *cAij++ = c *(*Aij++);
-  *cAij++ = c *(*Aij++);
-
-  return cA;
-}
-
-Matrix3x3 Matrix3x3::operator*(const Matrix3x3 &B) const {
-  const Matrix3x3 &A(*this);
-  Matrix3x3 C;
-
-  for (int i = 0; i < 3; i++)
-    for (int j = 0; j < 3; j++) {
-      C(i, j) = 0.;
-
-      for (int k = 0; k < 3; k++) {
-        C(i, j) += A(i, k) * B(k, j);
-      }
-    }
-
-  return C;
-}
-
-Vector3D Matrix3x3::operator*(const Vector3D &x) const {
-  return x[0] * entries[0] + x[1] * entries[1] + x[2] * entries[2];
-}
-
-Matrix3x3 Matrix3x3::T(void) const {
-  const Matrix3x3 &A(*this);
-  Matrix3x3 B;
-
-  for (int i = 0; i < 3; i++)
-    for (int j = 0; j < 3; j++) {
-      B(i, j) = A(j, i);
-    }
-
-  return B;
-}
-
-Matrix3x3 Matrix3x3::inv(void) const {
-  const Matrix3x3 &A(*this);
-  Matrix3x3 B;
+template <typename S>
+BasicMatrix3x3<S> BasicMatrix3x3<S>::inv(void) const {
+  const BasicMatrix3x3<S> &A(*this);
+  BasicMatrix3x3<S> B;
 
   B(0, 0) = -A(1, 2) * A(2, 1) + A(1, 1) * A(2, 2);
   B(0, 1) = A(0, 2) * A(2, 1) - A(0, 1) * A(2, 2);
@@ -176,40 +42,15 @@ Matrix3x3 Matrix3x3::inv(void) const {
   return B;
 }
 
-void Matrix3x3::operator/=(double x) {
-  Matrix3x3 &A(*this);
-  double rx = 1. / x;
-
-  for (int i = 0; i < 3; i++)
-    for (int j = 0; j < 3; j++) {
-      A(i, j) *= rx;
-    }
-}
-
-Matrix3x3 Matrix3x3::identity(void) {
-  Matrix3x3 B;
+template <typename S>
+BasicMatrix3x3<S> BasicMatrix3x3<S>::rotation(S theta) {
+  BasicMatrix3x3<S> B;
 
-  B(0, 0) = 1.;
-  B(0, 1) = 0.;
-  B(0, 2) = 0.;
-  B(1, 0) = 0.;
-  B(1, 1) = 1.;
-  B(1, 2) = 0.;
-  B(2, 0) = 0.;
-  B(2, 1) = 0.;
-  B(2, 2) = 1.;
-
-  return B;
-}
-
-Matrix3x3 Matrix3x3::rotation(double theta) {
-  Matrix3x3 B;
-
-  B(0, 0) = cos(theta);
-  B(0, 1) = sin(theta);
+  B(0, 0) = std::cos(theta);
+  B(0, 1) = std::sin(theta);
   B(0, 2) = 0.;
-  B(1, 0) = -sin(theta);
-  B(1, 1) = cos(theta);
+  B(1, 0) = -std::sin(theta);
+  B(1, 1) = std::cos(theta);
   B(1, 2) = 0.;
   B(2, 0) = 0.;
   B(2, 1) = 0.;
@@ -218,8 +59,9 @@ Matrix3x3 Matrix3x3::rotation(double theta) {
   return B;
 }
 
-Matrix3x3 Matrix3x3::translation(Vector2D t) {
-  Matrix3x3 B;
+template <typename S>
+BasicMatrix3x3<S> BasicMatrix3x3<S>::translation(BasicVector2D<S> t) {
+  BasicMatrix3x3<S> B;
 
   B(0, 0) = 1.;
   B(0, 1) = 0.;
@@ -234,15 +76,17 @@ Matrix3x3 Matrix3x3::translation(Vector2D t) {
   return B;
 }
 
-double Matrix3x3::getRotation(void) const {
-  double aCosTheta = entries[0][0];
-  double aSinTheta = entries[1][0];
+template <typename S>
+S BasicMatrix3x3<S>::getRotation(void) const {
+  S aCosTheta = entries[0][0];
+  S aSinTheta = entries[1][0];
 
-  return atan2(aSinTheta, aCosTheta);
+  return std::atan2(aSinTheta, aCosTheta);
 }
 
-Matrix3x3 Matrix3x3::crossProduct(const Vector3D &u) {
-  Matrix3x3 B;
+template <typename S>
+BasicMatrix3x3<S> BasicMatrix3x3<S>::crossProduct(const BasicVector3D<S> &u) {
+  BasicMatrix3x3<S> B;
 
   B(0, 0) = 0.;
   B(0, 1) = -u.z;
@@ -257,24 +101,8 @@ Matrix3x3 Matrix3x3::crossProduct(const Vector3D &u) {
   return B;
 }
 
-Matrix3x3 outer(const Vector3D &u, const Vector3D &v) {
-  Matrix3x3 B;
-  double *Bij = (double *)&B;
-
-  *Bij++ = u.x *v.x;
-  *Bij++ = u.y *v.x;
-  *Bij++ = u.z *v.x;
-  *Bij++ = u.x *v.y;
-  *Bij++ = u.y *v.y;
-  *Bij++ = u.z *v.y;
-  *Bij++ = u.x *v.z;
-  *Bij++ = u.y *v.z;
-  *Bij++ = u.z *v.z;
-
-  return B;
-}
-
-std::ostream &operator<<(std::ostream &os, const Matrix3x3 &A) {
+template <typename S>
+std::ostream &operator<<(std::ostream &os, const BasicMatrix3x3<S> &A) {
   for (int i = 0; i < 3; i++) {
     os << "[ ";
 
@@ -288,7 +116,10 @@ std::ostream &operator<<(std::ostream &os, const Matrix3x3 &A) {
   return os;
 }
 
-Vector3D &Matrix3x3::column(int i) { return entries[i]; }
+template class BasicMatrix3x3<double>;
+template class BasicMatrix3x3<float>;
 
-const Vector3D &Matrix3x3::column(int i) const { return entries[i]; }
-}
+template std::ostream &operator<<(std::ostream &os, const Matrix3x3 &A);
+template std::ostream &operator<<(std::ostream &os, const Matrix3x3f &A);
+
+} // namespace CMU462
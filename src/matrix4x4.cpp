@@ -1,317 +1,723 @@
 #include "matrix4x4.h"
+#include "matrix3x3.h"
+#include "simd.h"
 
 #include <iostream>
 #include <cmath>
+#include <algorithm>
 
 using namespace std;
 
 namespace CMU462 {
 
-double &Matrix4x4::operator()(int i, int j) { return entries[j][i]; }
-
-const double &Matrix4x4::operator()(int i, int j) const {
-  return entries[j][i];
-}
-
-Vector4D &Matrix4x4::operator[](int j) { return entries[j]; }
-
-const Vector4D &Matrix4x4::operator[](int j) const { return entries[j]; }
-
-void Matrix4x4::zero(double val) {
-  // sets all elements to val
-  entries[0] = entries[1] = entries[2] = entries[3] =
-      Vector4D(val, val, val, val);
-}
-
-double Matrix4x4::det(void) const {
-  const Matrix4x4 &A(*this);
-
-  return A(0, 3) * A(1, 2) * A(2, 1) * A(3, 0) -
-         A(0, 2) * A(1, 3) * A(2, 1) * A(3, 0) -
-         A(0, 3) * A(1, 1) * A(2, 2) * A(3, 0) +
-         A(0, 1) * A(1, 3) * A(2, 2) * A(3, 0) +
-         A(0, 2) * A(1, 1) * A(2, 3) * A(3, 0) -
-         A(0, 1) * A(1, 2) * A(2, 3) * A(3, 0) -
-         A(0, 3) * A(1, 2) * A(2, 0) * A(3, 1) +
-         A(0, 2) * A(1, 3) * A(2, 0) * A(3, 1) +
-         A(0, 3) * A(1, 0) * A(2, 2) * A(3, 1) -
-         A(0, 0) * A(1, 3) * A(2, 2) * A(3, 1) -
-         A(0, 2) * A(1, 0) * A(2, 3) * A(3, 1) +
-         A(0, 0) * A(1, 2) * A(2, 3) * A(3, 1) +
-         A(0, 3) * A(1, 1) * A(2, 0) * A(3, 2) -
-         A(0, 1) * A(1, 3) * A(2, 0) * A(3, 2) -
-         A(0, 3) * A(1, 0) * A(2, 1) * A(3, 2) +
-         A(0, 0) * A(1, 3) * A(2, 1) * A(3, 2) +
-         A(0, 1) * A(1, 0) * A(2, 3) * A(3, 2) -
-         A(0, 0) * A(1, 1) * A(2, 3) * A(3, 2) -
-         A(0, 2) * A(1, 1) * A(2, 0) * A(3, 3) +
-         A(0, 1) * A(1, 2) * A(2, 0) * A(3, 3) +
-         A(0, 2) * A(1, 0) * A(2, 1) * A(3, 3) -
-         A(0, 0) * A(1, 2) * A(2, 1) * A(3, 3) -
-         A(0, 1) * A(1, 0) * A(2, 2) * A(3, 3) +
-         A(0, 0) * A(1, 1) * A(2, 2) * A(3, 3);
-}
-
-double Matrix4x4::norm(void) const {
-  return sqrt(entries[0].norm2() + entries[1].norm2() + entries[2].norm2() +
-              entries[3].norm2());
-}
-
-Matrix4x4 Matrix4x4::operator-(void) const {
-
-  // returns -A (Negation).
-  const Matrix4x4 &A(*this);
-  Matrix4x4 B;
-
-  B(0, 0) = -A(0, 0);
-  B(0, 1) = -A(0, 1);
-  B(0, 2) = -A(0, 2);
-  B(0, 3) = -A(0, 3);
-  B(1, 0) = -A(1, 0);
-  B(1, 1) = -A(1, 1);
-  B(1, 2) = -A(1, 2);
-  B(1, 3) = -A(1, 3);
-  B(2, 0) = -A(2, 0);
-  B(2, 1) = -A(2, 1);
-  B(2, 2) = -A(2, 2);
-  B(2, 3) = -A(2, 3);
-  B(3, 0) = -A(3, 0);
-  B(3, 1) = -A(3, 1);
-  B(3, 2) = -A(3, 2);
-  B(3, 3) = -A(3, 3);
+//------------------------------------------------------------------------------
+// Kernels
+//
+// All kernels work on the raw column major storage of the matrices (16
+// contiguous scalars, element (i,j) at index 4*j+i) and have a scalar,
+// an SSE2 and, where it pays off, an AVX2 version, selected at runtime.
+// Inputs are fully loaded before any output is written, so the output may
+// alias an input. Matrices are not assumed to be aligned.
+//------------------------------------------------------------------------------
+
+// inverse and determinant //
+
+// Computes the determinant and, if b is not NULL, the inverse of a.
+//
+// Both come from the same twelve 2x2 minors: s0..s5 of the first two rows
+// and c0..c5 of the last two rows. The determinant is their Laplace
+// expansion and the adjugate entries are 3-term combinations of them, so
+// the inverse no longer recomputes products for the determinant.
+template <typename S>
+static void inverse_scalar(const S *a, S *b, S *det) {
+  // a(i,j) = a[4*j+i]
+  S a00 = a[0], a10 = a[1], a20 = a[2], a30 = a[3];
+  S a01 = a[4], a11 = a[5], a21 = a[6], a31 = a[7];
+  S a02 = a[8], a12 = a[9], a22 = a[10], a32 = a[11];
+  S a03 = a[12], a13 = a[13], a23 = a[14], a33 = a[15];
+
+  S s0 = a00 * a11 - a10 * a01;
+  S s1 = a00 * a12 - a10 * a02;
+  S s2 = a00 * a13 - a10 * a03;
+  S s3 = a01 * a12 - a11 * a02;
+  S s4 = a01 * a13 - a11 * a03;
+  S s5 = a02 * a13 - a12 * a03;
+
+  S c0 = a20 * a31 - a30 * a21;
+  S c1 = a20 * a32 - a30 * a22;
+  S c2 = a20 * a33 - a30 * a23;
+  S c3 = a21 * a32 - a31 * a22;
+  S c4 = a21 * a33 - a31 * a23;
+  S c5 = a22 * a33 - a32 * a23;
+
+  S d = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+  *det = d;
+  if (!b) return;
 
-  return B;
+  // Invertable iff the determinant is not equal to zero.
+  S r = S(1) / d;
+
+  S b00 = (a11 * c5 - a12 * c4 + a13 * c3) * r;
+  S b10 = (-a10 * c5 + a12 * c2 - a13 * c1) * r;
+  S b20 = (a10 * c4 - a11 * c2 + a13 * c0) * r;
+  S b30 = (-a10 * c3 + a11 * c1 - a12 * c0) * r;
+
+  S b01 = (-a01 * c5 + a02 * c4 - a03 * c3) * r;
+  S b11 = (a00 * c5 - a02 * c2 + a03 * c1) * r;
+  S b21 = (-a00 * c4 + a01 * c2 - a03 * c0) * r;
+  S b31 = (a00 * c3 - a01 * c1 + a02 * c0) * r;
+
+  S b02 = (a31 * s5 - a32 * s4 + a33 * s3) * r;
+  S b12 = (-a30 * s5 + a32 * s2 - a33 * s1) * r;
+  S b22 = (a30 * s4 - a31 * s2 + a33 * s0) * r;
+  S b32 = (-a30 * s3 + a31 * s1 - a32 * s0) * r;
+
+  S b03 = (-a21 * s5 + a22 * s4 - a23 * s3) * r;
+  S b13 = (a20 * s5 - a22 * s2 + a23 * s1) * r;
+  S b23 = (-a20 * s4 + a21 * s2 - a23 * s0) * r;
+  S b33 = (a20 * s3 - a21 * s1 + a22 * s0) * r;
+
+  b[0] = b00; b[1] = b10; b[2] = b20; b[3] = b30;
+  b[4] = b01; b[5] = b11; b[6] = b21; b[7] = b31;
+  b[8] = b02; b[9] = b12; b[10] = b22; b[11] = b32;
+  b[12] = b03; b[13] = b13; b[14] = b23; b[15] = b33;
 }
 
-void Matrix4x4::operator+=(const Matrix4x4 &B) {
+#ifdef CMU462_AVX2
+// Same minors as inverse_scalar, four at a time. With the columns in
+// registers, col_j * swap(col_k) holds (a0j*a1k, a1j*a0k, a2j*a3k, a3j*a2k)
+// and a horizontal subtract of two such products yields the s and c minors
+// of two column pairs at once:
+//   H1 = (s0, s1, c0, c1), H2 = (s2, s3, c2, c3), H3 = (s4, s5, c4, c5).
+// Each column of the adjugate is then a row of a (permuted) times three
+// signed coefficient vectors built from the minors.
+CMU462_TARGET_AVX2
+static void inverse_avx2(const double *a, double *b, double *det) {
+  __m256d col0 = _mm256_loadu_pd(a);
+  __m256d col1 = _mm256_loadu_pd(a + 4);
+  __m256d col2 = _mm256_loadu_pd(a + 8);
+  __m256d col3 = _mm256_loadu_pd(a + 12);
+
+  // swap the elements within each pair: (1,0,3,2)
+  __m256d sw1 = _mm256_permute_pd(col1, 0x5);
+  __m256d sw2 = _mm256_permute_pd(col2, 0x5);
+  __m256d sw3 = _mm256_permute_pd(col3, 0x5);
+
+  __m256d H1 = _mm256_hsub_pd(_mm256_mul_pd(col0, sw1),
+                              _mm256_mul_pd(col0, sw2));
+  __m256d H2 = _mm256_hsub_pd(_mm256_mul_pd(col0, sw3),
+                              _mm256_mul_pd(col1, sw2));
+  __m256d H3 = _mm256_hsub_pd(_mm256_mul_pd(col1, sw3),
+                              _mm256_mul_pd(col2, sw3));
+
+  if (!b) {
+    // det = s0*c5 - s1*c4 + s5*c0 - s4*c1 + s2*c3 + s3*c2
+    __m256d p = _mm256_mul_pd(H1, _mm256_permute4x64_pd(H3, 0x1B));
+    __m256d q = _mm256_mul_pd(H2, _mm256_permute4x64_pd(H2, 0x1B));
+    double lp[4], lq[4];
+    _mm256_storeu_pd(lp, p);
+    _mm256_storeu_pd(lq, q);
+    *det = (lp[0] - lp[1]) + (lp[2] - lp[3]) + (lq[0] + lq[1]);
+    return;
+  }
+
+  // coefficient vectors, with C = c0..c5 (K) or s0..s5 (L):
+  //   K1 = ( C5, -C5,  C4, -C3)
+  //   K2 = (-C4,  C2, -C2,  C1)
+  //   K3 = ( C3, -C1,  C0, -C0)
+  const __m256d pmpm = _mm256_set_pd(-0.0, 0.0, -0.0, 0.0);
+  const __m256d mpmp = _mm256_set_pd(0.0, -0.0, 0.0, -0.0);
+
+  // c's live in the upper halves of H1..H3, s's in the lower halves
+  __m256d K1 = _mm256_blend_pd(_mm256_permute4x64_pd(H3, 0xAF), // c5 c5 c4 .
+                               _mm256_permute4x64_pd(H2, 0xFF), 0x8);
+  __m256d K2 = _mm256_blend_pd(_mm256_permute4x64_pd(H3, 0x02), // c4 . . .
+                               _mm256_permute4x64_pd(H2, 0xAA), 0x6);
+  K2 = _mm256_blend_pd(K2, _mm256_permute4x64_pd(H1, 0xFF), 0x8);
+  __m256d K3 = _mm256_blend_pd(_mm256_permute4x64_pd(H2, 0x03), // c3 . . .
+                               _mm256_permute4x64_pd(H1, 0xAF), 0xE);
+  K1 = _mm256_xor_pd(K1, pmpm);
+  K2 = _mm256_xor_pd(K2, mpmp);
+  K3 = _mm256_xor_pd(K3, pmpm);
+
+  __m256d L1 = _mm256_blend_pd(_mm256_permute4x64_pd(H3, 0x05), // s5 s5 s4 .
+                               _mm256_permute4x64_pd(H2, 0x55), 0x8);
+  __m256d L2 = _mm256_blend_pd(_mm256_permute4x64_pd(H3, 0x00), // s4 . . .
+                               _mm256_permute4x64_pd(H2, 0x00), 0x6);
+  L2 = _mm256_blend_pd(L2, _mm256_permute4x64_pd(H1, 0x55), 0x8);
+  __m256d L3 = _mm256_blend_pd(_mm256_permute4x64_pd(H2, 0x01), // s3 . . .
+                               _mm256_permute4x64_pd(H1, 0x05), 0xE);
+  L1 = _mm256_xor_pd(L1, pmpm);
+  L2 = _mm256_xor_pd(L2, mpmp);
+  L3 = _mm256_xor_pd(L3, pmpm);
+
+  // rows of a
+  __m256d t0 = _mm256_unpacklo_pd(col0, col1);
+  __m256d t1 = _mm256_unpackhi_pd(col0, col1);
+  __m256d t2 = _mm256_unpacklo_pd(col2, col3);
+  __m256d t3 = _mm256_unpackhi_pd(col2, col3);
+  __m256d row0 = _mm256_permute2f128_pd(t0, t2, 0x20);
+  __m256d row1 = _mm256_permute2f128_pd(t1, t3, 0x20);
+  __m256d row2 = _mm256_permute2f128_pd(t0, t2, 0x31);
+  __m256d row3 = _mm256_permute2f128_pd(t1, t3, 0x31);
+
+  // adjugate column j uses the row elements (1,0,0,0), (2,2,1,1), (3,3,3,2)
+#define CMU462_ADJ_COLUMN(row, X1, X2, X3)                                   \
+  _mm256_fmadd_pd(                                                         \
+      _mm256_permute4x64_pd(row, 0x01), X1,                                \
+      _mm256_fmadd_pd(_mm256_permute4x64_pd(row, 0x5A), X2,                \
+                      _mm256_mul_pd(_mm256_permute4x64_pd(row, 0xBF), X3)))
+
+  const __m256d sign = _mm256_set1_pd(-0.0);
+  __m256d adj0 = CMU462_ADJ_COLUMN(row1, K1, K2, K3);
+  __m256d adj1 = _mm256_xor_pd(CMU462_ADJ_COLUMN(row0, K1, K2, K3), sign);
+  __m256d adj2 = CMU462_ADJ_COLUMN(row3, L1, L2, L3);
+  __m256d adj3 = _mm256_xor_pd(CMU462_ADJ_COLUMN(row2, L1, L2, L3), sign);
+
+#undef CMU462_ADJ_COLUMN
+
+  // Laplace expansion along the first row
+  double l[4];
+  _mm256_storeu_pd(l, _mm256_mul_pd(row0, adj0));
+  double d = (l[0] + l[1]) + (l[2] + l[3]);
+  *det = d;
 
-  Matrix4x4 &A(*this);
-  double *Aij = (double *)&A;
-  const double *Bij = (const double *)&B;
+  // Invertable iff the determinant is not equal to zero.
+  __m256d r = _mm256_set1_pd(1.0 / d);
+  _mm256_storeu_pd(b, _mm256_mul_pd(adj0, r));
+  _mm256_storeu_pd(b + 4, _mm256_mul_pd(adj1, r));
+  _mm256_storeu_pd(b + 8, _mm256_mul_pd(adj2, r));
+  _mm256_storeu_pd(b + 12, _mm256_mul_pd(adj3, r));
+}
 
-  // Add the 16 contigous vector packed double values.
-  *Aij++ += *Bij++;
-  *Aij++ += *Bij++;
-  *Aij++ += *Bij++;
-  *Aij++ += *Bij++;
-  *Aij++ += *Bij++;
-  *Aij++ += *Bij++;
-  *Aij++ += *Bij++;
-  *Aij++ += *Bij++;
-  *Aij++ += *Bij++;
-  *Aij++ += *Bij++;
-  *Aij++ += *Bij++;
-  *Aij++ += *Bij++;
-  *Aij++ += *Bij++;
-  *Aij++ += *Bij++;
-  *Aij++ += *Bij++;
-  *Aij++ += *Bij++;
+// Single precision goes through the double kernel: the conversions are one
+// instruction per column and the result is more accurate.
+CMU462_TARGET_AVX2
+static void inverse_avx2(const float *a, float *b, float *det) {
+  double ad[16], bd[16], dd;
+  for (int j = 0; j < 16; j += 4) {
+    _mm256_storeu_pd(ad + j, _mm256_cvtps_pd(_mm_loadu_ps(a + j)));
+  }
+  inverse_avx2(ad, b ? bd : NULL, &dd);
+  *det = (float)dd;
+  if (!b) return;
+  for (int j = 0; j < 16; j += 4) {
+    _mm_storeu_ps(b + j, _mm256_cvtpd_ps(_mm256_loadu_pd(bd + j)));
+  }
+}
+#endif
+
+template <typename S>
+static inline void inverse4x4(const S *a, S *b, S *det) {
+#ifdef CMU462_AVX2
+  if (SIMD::hasAVX2()) {
+    inverse_avx2(a, b, det);
+    return;
+  }
+#endif
+  inverse_scalar(a, b, det);
 }
 
-Matrix4x4 Matrix4x4::operator+(const Matrix4x4 &B) const {
-  const Matrix4x4 &A(*this);
-  Matrix4x4 C;
+// multiply //
 
-  for (int i = 0; i < 4; i++)
-    for (int j = 0; j < 4; j++) {
-      C(i, j) = A(i, j) + B(i, j);
+template <typename S>
+static inline void multiply_scalar(const S *a, const S *b, S *c) {
+  S r[16];
+  for (int j = 0; j < 4; j++) {
+    for (int i = 0; i < 4; i++) {
+      r[4 * j + i] = a[i] * b[4 * j] + a[4 + i] * b[4 * j + 1] +
+                     a[8 + i] * b[4 * j + 2] + a[12 + i] * b[4 * j + 3];
     }
-
-  return C;
+  }
+  for (int k = 0; k < 16; k++) c[k] = r[k];
 }
 
-Matrix4x4 Matrix4x4::operator-(const Matrix4x4 &B) const {
-  const Matrix4x4 &A(*this);
-  Matrix4x4 C;
+#ifdef CMU462_SSE2
+static inline void multiply_sse2(const double *a, const double *b,
+                                 double *c) {
+  // columns of a as (rows 0-1, rows 2-3) pairs
+  __m128d alo[4], ahi[4], blo[4], bhi[4];
+  for (int k = 0; k < 4; k++) {
+    alo[k] = _mm_loadu_pd(a + 4 * k);
+    ahi[k] = _mm_loadu_pd(a + 4 * k + 2);
+    blo[k] = _mm_loadu_pd(b + 4 * k);
+    bhi[k] = _mm_loadu_pd(b + 4 * k + 2);
+  }
+  for (int j = 0; j < 4; j++) {
+    __m128d b0 = _mm_unpacklo_pd(blo[j], blo[j]);
+    __m128d b1 = _mm_unpackhi_pd(blo[j], blo[j]);
+    __m128d b2 = _mm_unpacklo_pd(bhi[j], bhi[j]);
+    __m128d b3 = _mm_unpackhi_pd(bhi[j], bhi[j]);
+    __m128d lo = _mm_add_pd(
+        _mm_add_pd(_mm_mul_pd(alo[0], b0), _mm_mul_pd(alo[1], b1)),
+        _mm_add_pd(_mm_mul_pd(alo[2], b2), _mm_mul_pd(alo[3], b3)));
+    __m128d hi = _mm_add_pd(
+        _mm_add_pd(_mm_mul_pd(ahi[0], b0), _mm_mul_pd(ahi[1], b1)),
+        _mm_add_pd(_mm_mul_pd(ahi[2], b2), _mm_mul_pd(ahi[3], b3)));
+    _mm_storeu_pd(c + 4 * j, lo);
+    _mm_storeu_pd(c + 4 * j + 2, hi);
+  }
+}
 
-  for (int i = 0; i < 4; i++)
-    for (int j = 0; j < 4; j++) {
-      C(i, j) = A(i, j) - B(i, j);
-    }
+static inline void multiply_sse2(const float *a, const float *b, float *c) {
+  __m128 A[4], B[4];
+  for (int k = 0; k < 4; k++) {
+    A[k] = _mm_loadu_ps(a + 4 * k);
+    B[k] = _mm_loadu_ps(b + 4 * k);
+  }
+  for (int j = 0; j < 4; j++) {
+    __m128 b0 = _mm_shuffle_ps(B[j], B[j], 0x00);
+    __m128 b1 = _mm_shuffle_ps(B[j], B[j], 0x55);
+    __m128 b2 = _mm_shuffle_ps(B[j], B[j], 0xAA);
+    __m128 b3 = _mm_shuffle_ps(B[j], B[j], 0xFF);
+    __m128 r =
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(A[0], b0), _mm_mul_ps(A[1], b1)),
+                   _mm_add_ps(_mm_mul_ps(A[2], b2), _mm_mul_ps(A[3], b3)));
+    _mm_storeu_ps(c + 4 * j, r);
+  }
+}
+#endif
+
+#ifdef CMU462_AVX2
+CMU462_TARGET_AVX2
+static inline void multiply_avx2(const double *a, const double *b,
+                                 double *c) {
+  __m256d A0 = _mm256_loadu_pd(a), A1 = _mm256_loadu_pd(a + 4);
+  __m256d A2 = _mm256_loadu_pd(a + 8), A3 = _mm256_loadu_pd(a + 12);
+  __m256d B[4];
+  for (int j = 0; j < 4; j++) B[j] = _mm256_loadu_pd(b + 4 * j);
+  for (int j = 0; j < 4; j++) {
+    __m256d r = _mm256_mul_pd(A0, _mm256_permute4x64_pd(B[j], 0x00));
+    r = _mm256_fmadd_pd(A1, _mm256_permute4x64_pd(B[j], 0x55), r);
+    r = _mm256_fmadd_pd(A2, _mm256_permute4x64_pd(B[j], 0xAA), r);
+    r = _mm256_fmadd_pd(A3, _mm256_permute4x64_pd(B[j], 0xFF), r);
+    _mm256_storeu_pd(c + 4 * j, r);
+  }
+}
 
-  return C;
+// two columns of the result per 256-bit register
+CMU462_TARGET_AVX2
+static inline void multiply_avx2(const float *a, const float *b, float *c) {
+  __m256 A0 = _mm256_broadcast_ps((const __m128 *)a);
+  __m256 A1 = _mm256_broadcast_ps((const __m128 *)(a + 4));
+  __m256 A2 = _mm256_broadcast_ps((const __m128 *)(a + 8));
+  __m256 A3 = _mm256_broadcast_ps((const __m128 *)(a + 12));
+  __m256 B01 = _mm256_loadu_ps(b), B23 = _mm256_loadu_ps(b + 8);
+  for (int h = 0; h < 2; h++) {
+    __m256 Bh = h ? B23 : B01;
+    __m256 r = _mm256_mul_ps(A0, _mm256_shuffle_ps(Bh, Bh, 0x00));
+    r = _mm256_fmadd_ps(A1, _mm256_shuffle_ps(Bh, Bh, 0x55), r);
+    r = _mm256_fmadd_ps(A2, _mm256_shuffle_ps(Bh, Bh, 0xAA), r);
+    r = _mm256_fmadd_ps(A3, _mm256_shuffle_ps(Bh, Bh, 0xFF), r);
+    if (h) B23 = r;
+    else B01 = r;
+  }
+  _mm256_storeu_ps(c, B01);
+  _mm256_storeu_ps(c + 8, B23);
 }
+#endif
 
-Matrix4x4 Matrix4x4::operator*(double c) const {
-  const Matrix4x4 &A(*this);
-  Matrix4x4 B;
+// transpose //
 
+template <typename S>
+static inline void transpose_scalar(const S *a, S *b) {
+  S r[16];
   for (int i = 0; i < 4; i++)
-    for (int j = 0; j < 4; j++) {
-      B(i, j) = c * A(i, j);
-    }
+    for (int j = 0; j < 4; j++) r[4 * i + j] = a[4 * j + i];
+  for (int k = 0; k < 16; k++) b[k] = r[k];
+}
 
-  return B;
+#ifdef CMU462_SSE2
+static inline void transpose_sse2(const double *a, double *b) {
+  // 2x2 blocks: (rows 0-1 | rows 2-3) x (columns 0-1 | columns 2-3)
+  __m128d c0lo = _mm_loadu_pd(a), c0hi = _mm_loadu_pd(a + 2);
+  __m128d c1lo = _mm_loadu_pd(a + 4), c1hi = _mm_loadu_pd(a + 6);
+  __m128d c2lo = _mm_loadu_pd(a + 8), c2hi = _mm_loadu_pd(a + 10);
+  __m128d c3lo = _mm_loadu_pd(a + 12), c3hi = _mm_loadu_pd(a + 14);
+  _mm_storeu_pd(b, _mm_unpacklo_pd(c0lo, c1lo));
+  _mm_storeu_pd(b + 2, _mm_unpacklo_pd(c2lo, c3lo));
+  _mm_storeu_pd(b + 4, _mm_unpackhi_pd(c0lo, c1lo));
+  _mm_storeu_pd(b + 6, _mm_unpackhi_pd(c2lo, c3lo));
+  _mm_storeu_pd(b + 8, _mm_unpacklo_pd(c0hi, c1hi));
+  _mm_storeu_pd(b + 10, _mm_unpacklo_pd(c2hi, c3hi));
+  _mm_storeu_pd(b + 12, _mm_unpackhi_pd(c0hi, c1hi));
+  _mm_storeu_pd(b + 14, _mm_unpackhi_pd(c2hi, c3hi));
+}
+
+static inline void transpose_sse2(const float *a, float *b) {
+  __m128 c0 = _mm_loadu_ps(a), c1 = _mm_loadu_ps(a + 4);
+  __m128 c2 = _mm_loadu_ps(a + 8), c3 = _mm_loadu_ps(a + 12);
+  _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+  _mm_storeu_ps(b, c0);
+  _mm_storeu_ps(b + 4, c1);
+  _mm_storeu_ps(b + 8, c2);
+  _mm_storeu_ps(b + 12, c3);
+}
+#endif
+
+#ifdef CMU462_AVX2
+CMU462_TARGET_AVX2
+static inline void transpose_avx2(const double *a, double *b) {
+  __m256d c0 = _mm256_loadu_pd(a), c1 = _mm256_loadu_pd(a + 4);
+  __m256d c2 = _mm256_loadu_pd(a + 8), c3 = _mm256_loadu_pd(a + 12);
+  __m256d t0 = _mm256_unpacklo_pd(c0, c1);
+  __m256d t1 = _mm256_unpackhi_pd(c0, c1);
+  __m256d t2 = _mm256_unpacklo_pd(c2, c3);
+  __m256d t3 = _mm256_unpackhi_pd(c2, c3);
+  _mm256_storeu_pd(b, _mm256_permute2f128_pd(t0, t2, 0x20));
+  _mm256_storeu_pd(b + 4, _mm256_permute2f128_pd(t1, t3, 0x20));
+  _mm256_storeu_pd(b + 8, _mm256_permute2f128_pd(t0, t2, 0x31));
+  _mm256_storeu_pd(b + 12, _mm256_permute2f128_pd(t1, t3, 0x31));
 }
 
-// Returns c*A.
-Matrix4x4 operator*(double c, const Matrix4x4 &A) {
-
-  Matrix4x4 cA;
-  const double *Aij = (const double *)&A;
-  double *cAij = (double *)&cA;
-
-  *cAij++ = c *(*Aij++);
-  *cAij++ = c *(*Aij++);
-  *cAij++ = c *(*Aij++);
-  *cAij++ = c *(*Aij++);
-  *cAij++ = c *(*Aij++);
-  *cAij++ = c *(*Aij++);
-  *cAij++ = c *(*Aij++);
-  *cAij++ = c *(*Aij++);
-  *cAij++ = c *(*Aij++);
-  *cAij++ = c *(*Aij++);
-  *cAij++ = c *(*Aij++);
-  *cAij++ = c *(*Aij++);
-  *cAij++ = c *(*Aij++);
-  *cAij++ = c *(*Aij++);
-  *cAij++ = c *(*Aij++);
-  *cAij++ = c *(*Aij++);
-  return cA;
-}
-
-// Tradiational Grade School Multiplication. N^3
-Matrix4x4 Matrix4x4::operator*(const Matrix4x4 &B) const {
-  const Matrix4x4 &A(*this);
-  Matrix4x4 C;
+// a float column already fills an SSE register
+static inline void transpose_avx2(const float *a, float *b) {
+  transpose_sse2(a, b);
+}
+#endif
 
-  for (int i = 0; i < 4; i++)
-    for (int j = 0; j < 4; j++) {
-      C(i, j) = 0.;
+// batch drivers //
+
+// Runs kernel over n matrices, i.e. kernel(a + 16*k, b + 16*k, c + 16*k).
+#define CMU462_BATCH3(kernel, a, b, c, n)                                    \
+  for (size_t k = 0; k < (n); k++) {                                         \
+    kernel((a) + 16 * k, (b) + 16 * k, (c) + 16 * k);                        \
+  }
+
+template <typename S>
+static void multiply_batch(const S *a, const S *b, S *c, size_t n) {
+#ifdef CMU462_AVX2
+  if (SIMD::hasAVX2()) {
+    CMU462_BATCH3(multiply_avx2, a, b, c, n);
+    return;
+  }
+#endif
+#ifdef CMU462_SSE2
+  if (SIMD::hasSSE2()) {
+    CMU462_BATCH3(multiply_sse2, a, b, c, n);
+    return;
+  }
+#endif
+  CMU462_BATCH3(multiply_scalar, a, b, c, n);
+}
+
+template <typename S>
+static void transpose_batch(const S *a, S *b, size_t n) {
+#ifdef CMU462_AVX2
+  if (SIMD::hasAVX2()) {
+    for (size_t k = 0; k < n; k++) transpose_avx2(a + 16 * k, b + 16 * k);
+    return;
+  }
+#endif
+#ifdef CMU462_SSE2
+  if (SIMD::hasSSE2()) {
+    for (size_t k = 0; k < n; k++) transpose_sse2(a + 16 * k, b + 16 * k);
+    return;
+  }
+#endif
+  for (size_t k = 0; k < n; k++) transpose_scalar(a + 16 * k, b + 16 * k);
+}
 
-      for (int k = 0; k < 4; k++) {
-        C(i, j) += A(i, k) * B(k, j);
-      }
+template <typename S>
+static void inverse_batch(const S *a, S *b, S *det, size_t n) {
+  S d;
+#ifdef CMU462_AVX2
+  if (SIMD::hasAVX2()) {
+    for (size_t k = 0; k < n; k++) {
+      inverse_avx2(a + 16 * k, b ? b + 16 * k : NULL, det ? det + k : &d);
     }
+    return;
+  }
+#endif
+  for (size_t k = 0; k < n; k++) {
+    inverse_scalar(a + 16 * k, b ? b + 16 * k : NULL, det ? det + k : &d);
+  }
+}
+
+#undef CMU462_BATCH3
+
+// transform //
+
+// The transform kernels map the elements [i, n) of an array of 3D vectors
+// (stride 3, with homogeneous coordinate w) or 4D vectors (stride 4)
+// through the column major matrix m. Each element is fully loaded before
+// it is stored, so in may be the same as out.
 
-  return C;
+template <typename S>
+static void transform3_scalar(size_t i, size_t n, const S *m, const S *in,
+                              S *out, S w) {
+  for (; i < n; i++) {
+    S x = in[3 * i], y = in[3 * i + 1], z = in[3 * i + 2];
+    out[3 * i] = m[0] * x + m[4] * y + m[8] * z + m[12] * w;
+    out[3 * i + 1] = m[1] * x + m[5] * y + m[9] * z + m[13] * w;
+    out[3 * i + 2] = m[2] * x + m[6] * y + m[10] * z + m[14] * w;
+  }
 }
 
-Vector4D Matrix4x4::operator*(const Vector4D &x) const {
-  return x[0] * entries[0] + // Add up products for each matrix column.
-         x[1] * entries[1] + x[2] * entries[2] + x[3] * entries[3];
+template <typename S>
+static void transform4_scalar(size_t i, size_t n, const S *m, const S *in,
+                              S *out, bool divide) {
+  for (; i < n; i++) {
+    S x = in[4 * i], y = in[4 * i + 1], z = in[4 * i + 2], w = in[4 * i + 3];
+    S rx = m[0] * x + m[4] * y + m[8] * z + m[12] * w;
+    S ry = m[1] * x + m[5] * y + m[9] * z + m[13] * w;
+    S rz = m[2] * x + m[6] * y + m[10] * z + m[14] * w;
+    S rw = m[3] * x + m[7] * y + m[11] * z + m[15] * w;
+    if (divide) {
+      S r = S(1) / rw;
+      rx *= r;
+      ry *= r;
+      rz *= r;
+    }
+    out[4 * i] = rx;
+    out[4 * i + 1] = ry;
+    out[4 * i + 2] = rz;
+    out[4 * i + 3] = rw;
+  }
 }
 
-// Naive Transposition.
-Matrix4x4 Matrix4x4::T(void) const {
-  const Matrix4x4 &A(*this);
-  Matrix4x4 B;
+#ifdef CMU462_SSE2
+static void transform3_sse2(size_t i, size_t n, const double *m,
+                            const double *in, double *out, double w) {
+  // rows 0-1 and row 2 of each column, translation scaled by w
+  __m128d c0 = _mm_loadu_pd(m), c1 = _mm_loadu_pd(m + 4);
+  __m128d c2 = _mm_loadu_pd(m + 8);
+  __m128d t = _mm_mul_pd(_mm_loadu_pd(m + 12), _mm_set1_pd(w));
+  __m128d d0 = _mm_load_sd(m + 2), d1 = _mm_load_sd(m + 6);
+  __m128d d2 = _mm_load_sd(m + 10);
+  __m128d u = _mm_set_sd(m[14] * w);
+  for (; i < n; i++) {
+    const double *p = in + 3 * i;
+    __m128d x = _mm_load1_pd(p), y = _mm_load1_pd(p + 1);
+    __m128d z = _mm_load1_pd(p + 2);
+    __m128d lo = _mm_add_pd(
+        _mm_add_pd(_mm_mul_pd(c0, x), _mm_mul_pd(c1, y)),
+        _mm_add_pd(_mm_mul_pd(c2, z), t));
+    __m128d hi = _mm_add_sd(
+        _mm_add_sd(_mm_mul_sd(d0, x), _mm_mul_sd(d1, y)),
+        _mm_add_sd(_mm_mul_sd(d2, z), u));
+    _mm_storeu_pd(out + 3 * i, lo);
+    _mm_store_sd(out + 3 * i + 2, hi);
+  }
+}
 
-  for (int i = 0; i < 4; i++)
-    for (int j = 0; j < 4; j++) {
-      B(i, j) = A(j, i);
+static void transform4_sse2(size_t i, size_t n, const double *m,
+                            const double *in, double *out, bool divide) {
+  __m128d lo[4], hi[4];
+  for (int k = 0; k < 4; k++) {
+    lo[k] = _mm_loadu_pd(m + 4 * k);
+    hi[k] = _mm_loadu_pd(m + 4 * k + 2);
+  }
+  const __m128d one = _mm_set1_pd(1.0);
+  for (; i < n; i++) {
+    const double *p = in + 4 * i;
+    __m128d x = _mm_load1_pd(p), y = _mm_load1_pd(p + 1);
+    __m128d z = _mm_load1_pd(p + 2), w = _mm_load1_pd(p + 3);
+    __m128d rlo = _mm_add_pd(
+        _mm_add_pd(_mm_mul_pd(lo[0], x), _mm_mul_pd(lo[1], y)),
+        _mm_add_pd(_mm_mul_pd(lo[2], z), _mm_mul_pd(lo[3], w)));
+    __m128d rhi = _mm_add_pd(
+        _mm_add_pd(_mm_mul_pd(hi[0], x), _mm_mul_pd(hi[1], y)),
+        _mm_add_pd(_mm_mul_pd(hi[2], z), _mm_mul_pd(hi[3], w)));
+    if (divide) {
+      __m128d r = _mm_div_pd(one, _mm_unpackhi_pd(rhi, rhi));
+      rlo = _mm_mul_pd(rlo, r);
+      rhi = _mm_move_sd(rhi, _mm_mul_pd(rhi, r)); // keeps w
     }
+    _mm_storeu_pd(out + 4 * i, rlo);
+    _mm_storeu_pd(out + 4 * i + 2, rhi);
+  }
+}
 
-  return B;
+static void transform3_sse2(size_t i, size_t n, const float *m,
+                            const float *in, float *out, float w) {
+  __m128 c0 = _mm_loadu_ps(m), c1 = _mm_loadu_ps(m + 4);
+  __m128 c2 = _mm_loadu_ps(m + 8);
+  __m128 t = _mm_mul_ps(_mm_loadu_ps(m + 12), _mm_set1_ps(w));
+  for (; i < n; i++) {
+    const float *p = in + 3 * i;
+    __m128 r = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(p[0])),
+                   _mm_mul_ps(c1, _mm_set1_ps(p[1]))),
+        _mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(p[2])), t));
+    _mm_storel_pi((__m64 *)(out + 3 * i), r);
+    _mm_store_ss(out + 3 * i + 2, _mm_movehl_ps(r, r));
+  }
 }
 
-Matrix4x4 Matrix4x4::inv(void) const {
-  const Matrix4x4 &A(*this);
-  Matrix4x4 B;
-
-  // Hardcoded in Fully Symbolic computation.
-
-  B(0, 0) = A(1, 2) * A(2, 3) * A(3, 1) - A(1, 3) * A(2, 2) * A(3, 1) +
-            A(1, 3) * A(2, 1) * A(3, 2) - A(1, 1) * A(2, 3) * A(3, 2) -
-            A(1, 2) * A(2, 1) * A(3, 3) + A(1, 1) * A(2, 2) * A(3, 3);
-  B(0, 1) = A(0, 3) * A(2, 2) * A(3, 1) - A(0, 2) * A(2, 3) * A(3, 1) -
-            A(0, 3) * A(2, 1) * A(3, 2) + A(0, 1) * A(2, 3) * A(3, 2) +
-            A(0, 2) * A(2, 1) * A(3, 3) - A(0, 1) * A(2, 2) * A(3, 3);
-  B(0, 2) = A(0, 2) * A(1, 3) * A(3, 1) - A(0, 3) * A(1, 2) * A(3, 1) +
-            A(0, 3) * A(1, 1) * A(3, 2) - A(0, 1) * A(1, 3) * A(3, 2) -
-            A(0, 2) * A(1, 1) * A(3, 3) + A(0, 1) * A(1, 2) * A(3, 3);
-  B(0, 3) = A(0, 3) * A(1, 2) * A(2, 1) - A(0, 2) * A(1, 3) * A(2, 1) -
-            A(0, 3) * A(1, 1) * A(2, 2) + A(0, 1) * A(1, 3) * A(2, 2) +
-            A(0, 2) * A(1, 1) * A(2, 3) - A(0, 1) * A(1, 2) * A(2, 3);
-  B(1, 0) = A(1, 3) * A(2, 2) * A(3, 0) - A(1, 2) * A(2, 3) * A(3, 0) -
-            A(1, 3) * A(2, 0) * A(3, 2) + A(1, 0) * A(2, 3) * A(3, 2) +
-            A(1, 2) * A(2, 0) * A(3, 3) - A(1, 0) * A(2, 2) * A(3, 3);
-  B(1, 1) = A(0, 2) * A(2, 3) * A(3, 0) - A(0, 3) * A(2, 2) * A(3, 0) +
-            A(0, 3) * A(2, 0) * A(3, 2) - A(0, 0) * A(2, 3) * A(3, 2) -
-            A(0, 2) * A(2, 0) * A(3, 3) + A(0, 0) * A(2, 2) * A(3, 3);
-  B(1, 2) = A(0, 3) * A(1, 2) * A(3, 0) - A(0, 2) * A(1, 3) * A(3, 0) -
-            A(0, 3) * A(1, 0) * A(3, 2) + A(0, 0) * A(1, 3) * A(3, 2) +
-            A(0, 2) * A(1, 0) * A(3, 3) - A(0, 0) * A(1, 2) * A(3, 3);
-  B(1, 3) = A(0, 2) * A(1, 3) * A(2, 0) - A(0, 3) * A(1, 2) * A(2, 0) +
-            A(0, 3) * A(1, 0) * A(2, 2) - A(0, 0) * A(1, 3) * A(2, 2) -
-            A(0, 2) * A(1, 0) * A(2, 3) + A(0, 0) * A(1, 2) * A(2, 3);
-  B(2, 0) = A(1, 1) * A(2, 3) * A(3, 0) - A(1, 3) * A(2, 1) * A(3, 0) +
-            A(1, 3) * A(2, 0) * A(3, 1) - A(1, 0) * A(2, 3) * A(3, 1) -
-            A(1, 1) * A(2, 0) * A(3, 3) + A(1, 0) * A(2, 1) * A(3, 3);
-  B(2, 1) = A(0, 3) * A(2, 1) * A(3, 0) - A(0, 1) * A(2, 3) * A(3, 0) -
-            A(0, 3) * A(2, 0) * A(3, 1) + A(0, 0) * A(2, 3) * A(3, 1) +
-            A(0, 1) * A(2, 0) * A(3, 3) - A(0, 0) * A(2, 1) * A(3, 3);
-  B(2, 2) = A(0, 1) * A(1, 3) * A(3, 0) - A(0, 3) * A(1, 1) * A(3, 0) +
-            A(0, 3) * A(1, 0) * A(3, 1) - A(0, 0) * A(1, 3) * A(3, 1) -
-            A(0, 1) * A(1, 0) * A(3, 3) + A(0, 0) * A(1, 1) * A(3, 3);
-  B(2, 3) = A(0, 3) * A(1, 1) * A(2, 0) - A(0, 1) * A(1, 3) * A(2, 0) -
-            A(0, 3) * A(1, 0) * A(2, 1) + A(0, 0) * A(1, 3) * A(2, 1) +
-            A(0, 1) * A(1, 0) * A(2, 3) - A(0, 0) * A(1, 1) * A(2, 3);
-  B(3, 0) = A(1, 2) * A(2, 1) * A(3, 0) - A(1, 1) * A(2, 2) * A(3, 0) -
-            A(1, 2) * A(2, 0) * A(3, 1) + A(1, 0) * A(2, 2) * A(3, 1) +
-            A(1, 1) * A(2, 0) * A(3, 2) - A(1, 0) * A(2, 1) * A(3, 2);
-  B(3, 1) = A(0, 1) * A(2, 2) * A(3, 0) - A(0, 2) * A(2, 1) * A(3, 0) +
-            A(0, 2) * A(2, 0) * A(3, 1) - A(0, 0) * A(2, 2) * A(3, 1) -
-            A(0, 1) * A(2, 0) * A(3, 2) + A(0, 0) * A(2, 1) * A(3, 2);
-  B(3, 2) = A(0, 2) * A(1, 1) * A(3, 0) - A(0, 1) * A(1, 2) * A(3, 0) -
-            A(0, 2) * A(1, 0) * A(3, 1) + A(0, 0) * A(1, 2) * A(3, 1) +
-            A(0, 1) * A(1, 0) * A(3, 2) - A(0, 0) * A(1, 1) * A(3, 2);
-  B(3, 3) = A(0, 1) * A(1, 2) * A(2, 0) - A(0, 2) * A(1, 1) * A(2, 0) +
-            A(0, 2) * A(1, 0) * A(2, 1) - A(0, 0) * A(1, 2) * A(2, 1) -
-            A(0, 1) * A(1, 0) * A(2, 2) + A(0, 0) * A(1, 1) * A(2, 2);
+static void transform4_sse2(size_t i, size_t n, const float *m,
+                            const float *in, float *out, bool divide) {
+  __m128 c0 = _mm_loadu_ps(m), c1 = _mm_loadu_ps(m + 4);
+  __m128 c2 = _mm_loadu_ps(m + 8), c3 = _mm_loadu_ps(m + 12);
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 xyz = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+  for (; i < n; i++) {
+    __m128 p = _mm_loadu_ps(in + 4 * i);
+    __m128 r = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(c0, _mm_shuffle_ps(p, p, 0x00)),
+                   _mm_mul_ps(c1, _mm_shuffle_ps(p, p, 0x55))),
+        _mm_add_ps(_mm_mul_ps(c2, _mm_shuffle_ps(p, p, 0xAA)),
+                   _mm_mul_ps(c3, _mm_shuffle_ps(p, p, 0xFF))));
+    if (divide) {
+      __m128 d = _mm_mul_ps(r, _mm_div_ps(one, _mm_shuffle_ps(r, r, 0xFF)));
+      r = _mm_or_ps(_mm_and_ps(xyz, d), _mm_andnot_ps(xyz, r)); // keeps w
+    }
+    _mm_storeu_ps(out + 4 * i, r);
+  }
+}
+#endif
+
+#ifdef CMU462_AVX2
+CMU462_TARGET_AVX2
+static void transform3_avx2(size_t i, size_t n, const double *m,
+                            const double *in, double *out, double w) {
+  __m256d c0 = _mm256_loadu_pd(m), c1 = _mm256_loadu_pd(m + 4);
+  __m256d c2 = _mm256_loadu_pd(m + 8);
+  __m256d t = _mm256_mul_pd(_mm256_loadu_pd(m + 12), _mm256_set1_pd(w));
+  for (; i < n; i++) {
+    const double *p = in + 3 * i;
+    __m256d r = _mm256_fmadd_pd(c0, _mm256_broadcast_sd(p), t);
+    r = _mm256_fmadd_pd(c1, _mm256_broadcast_sd(p + 1), r);
+    r = _mm256_fmadd_pd(c2, _mm256_broadcast_sd(p + 2), r);
+    _mm_storeu_pd(out + 3 * i, _mm256_castpd256_pd128(r));
+    _mm_store_sd(out + 3 * i + 2, _mm256_extractf128_pd(r, 1));
+  }
+}
 
-  // Invertable iff the determinant is not equal to zero.
-  B /= det();
+CMU462_TARGET_AVX2
+static void transform4_avx2(size_t i, size_t n, const double *m,
+                            const double *in, double *out, bool divide) {
+  __m256d c0 = _mm256_loadu_pd(m), c1 = _mm256_loadu_pd(m + 4);
+  __m256d c2 = _mm256_loadu_pd(m + 8), c3 = _mm256_loadu_pd(m + 12);
+  const __m256d one = _mm256_set1_pd(1.0);
+  for (; i < n; i++) {
+    const double *p = in + 4 * i;
+    __m256d r = _mm256_mul_pd(c0, _mm256_broadcast_sd(p));
+    r = _mm256_fmadd_pd(c1, _mm256_broadcast_sd(p + 1), r);
+    r = _mm256_fmadd_pd(c2, _mm256_broadcast_sd(p + 2), r);
+    r = _mm256_fmadd_pd(c3, _mm256_broadcast_sd(p + 3), r);
+    if (divide) {
+      __m256d rw = _mm256_div_pd(one, _mm256_permute4x64_pd(r, 0xFF));
+      r = _mm256_blend_pd(_mm256_mul_pd(r, rw), r, 0x8); // keeps w
+    }
+    _mm256_storeu_pd(out + 4 * i, r);
+  }
+}
 
-  return B;
+// a float column already fills an SSE register
+static inline void transform3_avx2(size_t i, size_t n, const float *m,
+                                   const float *in, float *out, float w) {
+  transform3_sse2(i, n, m, in, out, w);
 }
 
-void Matrix4x4::operator/=(double x) {
-  Matrix4x4 &A(*this);
-  double rx = 1. / x;
+static inline void transform4_avx2(size_t i, size_t n, const float *m,
+                                   const float *in, float *out, bool divide) {
+  transform4_sse2(i, n, m, in, out, divide);
+}
+#endif
+
+// Transforms in the vectors [i, n) with the widest kernel available.
+template <typename S>
+static void transform3_range(size_t i, size_t n, const S *m, const S *in,
+                             S *out, S w) {
+#ifdef CMU462_AVX2
+  if (SIMD::hasAVX2()) {
+    transform3_avx2(i, n, m, in, out, w);
+    return;
+  }
+#endif
+#ifdef CMU462_SSE2
+  if (SIMD::hasSSE2()) {
+    transform3_sse2(i, n, m, in, out, w);
+    return;
+  }
+#endif
+  transform3_scalar(i, n, m, in, out, w);
+}
 
-  for (int i = 0; i < 4; i++)
-    for (int j = 0; j < 4; j++) {
-      A(i, j) *= rx;
-    }
+template <typename S>
+static void transform4_range(size_t i, size_t n, const S *m, const S *in,
+                             S *out, bool divide) {
+#ifdef CMU462_AVX2
+  if (SIMD::hasAVX2()) {
+    transform4_avx2(i, n, m, in, out, divide);
+    return;
+  }
+#endif
+#ifdef CMU462_SSE2
+  if (SIMD::hasSSE2()) {
+    transform4_sse2(i, n, m, in, out, divide);
+    return;
+  }
+#endif
+  transform4_scalar(i, n, m, in, out, divide);
 }
 
-Matrix4x4 Matrix4x4::identity(void) {
-  Matrix4x4 B;
-
-  B(0, 0) = 1.;
-  B(0, 1) = 0.;
-  B(0, 2) = 0.;
-  B(0, 3) = 0.;
-  B(1, 0) = 0.;
-  B(1, 1) = 1.;
-  B(1, 2) = 0.;
-  B(1, 3) = 0.;
-  B(2, 0) = 0.;
-  B(2, 1) = 0.;
-  B(2, 2) = 1.;
-  B(2, 3) = 0.;
-  B(3, 0) = 0.;
-  B(3, 1) = 0.;
-  B(3, 2) = 0.;
-  B(3, 3) = 1.;
+// Arrays longer than this are split into blocks of this many vectors that
+// are transformed in parallel (when built with OpenMP).
+static const size_t kTransformBlock = 16384;
+
+template <typename S>
+static void transform3(const S *m, const S *in, S *out, size_t n, S w) {
+  long blocks = (long)((n + kTransformBlock - 1) / kTransformBlock);
+#pragma omp parallel for if (blocks > 1)
+  for (long b = 0; b < blocks; b++) {
+    size_t i = b * kTransformBlock;
+    transform3_range(i, min(n, i + kTransformBlock), m, in, out, w);
+  }
+}
 
-  return B;
+template <typename S>
+static void transform4(const S *m, const S *in, S *out, size_t n,
+                       bool divide) {
+  long blocks = (long)((n + kTransformBlock - 1) / kTransformBlock);
+#pragma omp parallel for if (blocks > 1)
+  for (long b = 0; b < blocks; b++) {
+    size_t i = b * kTransformBlock;
+    transform4_range(i, min(n, i + kTransformBlock), m, in, out, divide);
+  }
+}
+
+// Normals transform by the inverse transpose of the upper left 3x3 block,
+// embedded in a 4x4 matrix without translation.
+template <typename S>
+static void normalMatrix(const BasicMatrix4x4<S> &M, S *m) {
+  BasicMatrix3x3<S> A;
+  for (int i = 0; i < 3; i++)
+    for (int j = 0; j < 3; j++) A(i, j) = M(i, j);
+  BasicMatrix3x3<S> N = A.inv().T();
+  for (int j = 0; j < 4; j++)
+    for (int i = 0; i < 4; i++)
+      m[4 * j + i] = (i < 3 && j < 3) ? N(i, j) : S(i == j);
 }
 
-Matrix4x4 outer(const Vector4D &u, const Vector4D &v) {
-  Matrix4x4 B;
+//------------------------------------------------------------------------------
+// Members
+//------------------------------------------------------------------------------
 
-  // Opposite of an inner product.
-  for (int i = 0; i < 4; i++)
-    for (int j = 0; j < 4; j++) {
-      B(i, j) = u[i] * v[j];
-    }
+template <typename S>
+S BasicMatrix4x4<S>::det(void) const {
+  S d;
+  inverse4x4((const S *)entries, (S *)NULL, &d);
+  return d;
+}
+
+template <typename S>
+S BasicMatrix4x4<S>::norm(void) const {
+  return std::sqrt(entries[0].norm2() + entries[1].norm2() +
+                   entries[2].norm2() + entries[3].norm2());
+}
 
+template <typename S>
+BasicMatrix4x4<S> BasicMatrix4x4<S>::inv(void) const {
+  BasicMatrix4x4<S> B;
+  S d;
+  inverse4x4((const S *)entries, (S *)B.entries, &d);
   return B;
 }
 
-std::ostream &operator<<(std::ostream &os, const Matrix4x4 &A) {
+template <typename S>
+std::ostream &operator<<(std::ostream &os, const BasicMatrix4x4<S> &A) {
   for (int i = 0; i < 4; i++) {
     os << "[ ";
 
@@ -325,7 +731,93 @@ std::ostream &operator<<(std::ostream &os, const Matrix4x4 &A) {
   return os;
 }
 
-Vector4D &Matrix4x4::column(int i) { return entries[i]; }
+//------------------------------------------------------------------------------
+// Batch operations
+//------------------------------------------------------------------------------
+
+void multiply(const Matrix4x4 *A, const Matrix4x4 *B, Matrix4x4 *C, size_t n) {
+  multiply_batch((const double *)A, (const double *)B, (double *)C, n);
+}
+
+void multiply(const Matrix4x4f *A, const Matrix4x4f *B, Matrix4x4f *C,
+              size_t n) {
+  multiply_batch((const float *)A, (const float *)B, (float *)C, n);
+}
+
+void transpose(const Matrix4x4 *A, Matrix4x4 *B, size_t n) {
+  transpose_batch((const double *)A, (double *)B, n);
+}
+
+void transpose(const Matrix4x4f *A, Matrix4x4f *B, size_t n) {
+  transpose_batch((const float *)A, (float *)B, n);
+}
+
+void inverse(const Matrix4x4 *A, Matrix4x4 *B, size_t n, double *det) {
+  inverse_batch((const double *)A, (double *)B, det, n);
+}
+
+void inverse(const Matrix4x4f *A, Matrix4x4f *B, size_t n, float *det) {
+  inverse_batch((const float *)A, (float *)B, det, n);
+}
+
+void det(const Matrix4x4 *A, double *det, size_t n) {
+  inverse_batch((const double *)A, (double *)NULL, det, n);
+}
+
+void det(const Matrix4x4f *A, float *det, size_t n) {
+  inverse_batch((const float *)A, (float *)NULL, det, n);
+}
+
+void transformPoints(const Matrix4x4 &M, const Vector3D *in, Vector3D *out,
+                     size_t n) {
+  transform3((const double *)&M, (const double *)in, (double *)out, n, 1.0);
+}
+
+void transformPoints(const Matrix4x4f &M, const Vector3f *in, Vector3f *out,
+                     size_t n) {
+  transform3((const float *)&M, (const float *)in, (float *)out, n, 1.0f);
+}
+
+void transformVectors(const Matrix4x4 &M, const Vector3D *in, Vector3D *out,
+                      size_t n) {
+  transform3((const double *)&M, (const double *)in, (double *)out, n, 0.0);
+}
+
+void transformVectors(const Matrix4x4f &M, const Vector3f *in, Vector3f *out,
+                      size_t n) {
+  transform3((const float *)&M, (const float *)in, (float *)out, n, 0.0f);
+}
+
+void transformNormals(const Matrix4x4 &M, const Vector3D *in, Vector3D *out,
+                      size_t n) {
+  double m[16];
+  normalMatrix(M, m);
+  transform3(m, (const double *)in, (double *)out, n, 0.0);
+}
+
+void transformNormals(const Matrix4x4f &M, const Vector3f *in, Vector3f *out,
+                      size_t n) {
+  float m[16];
+  normalMatrix(M, m);
+  transform3(m, (const float *)in, (float *)out, n, 0.0f);
+}
+
+void transform(const Matrix4x4 &M, const Vector4D *in, Vector4D *out,
+               size_t n, bool perspectiveDivide) {
+  transform4((const double *)&M, (const double *)in, (double *)out, n,
+             perspectiveDivide);
+}
 
-const Vector4D &Matrix4x4::column(int i) const { return entries[i]; }
+void transform(const Matrix4x4f &M, const Vector4f *in, Vector4f *out,
+               size_t n, bool perspectiveDivide) {
+  transform4((const float *)&M, (const float *)in, (float *)out, n,
+             perspectiveDivide);
 }
+
+template class BasicMatrix4x4<double>;
+template class BasicMatrix4x4<float>;
+
+template std::ostream &operator<<(std::ostream &os, const Matrix4x4 &A);
+template std::ostream &operator<<(std::ostream &os, const Matrix4x4f &A);
+
+} // namespace CMU462
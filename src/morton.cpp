@@ -0,0 +1,124 @@
+#include "morton.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+
+namespace CMU462 {
+
+// Points (and keys) per parallel block.
+static const size_t kMortonBlock = 65536;
+
+// maps bounds to [0, 1]^3
+static inline void unitScale(const BBox &bounds, Vector3D &scale) {
+  Vector3D e = bounds.extent();
+  for (int a = 0; a < 3; a++) scale[a] = e[a] > 0 ? 1 / e[a] : 0;
+}
+
+void mortonCodes(const Vector3D *points, size_t n, const BBox &bounds,
+                 uint32_t *codes) {
+  Vector3D scale;
+  unitScale(bounds, scale);
+#pragma omp parallel for if (n > kMortonBlock)
+  for (long i = 0; i < (long)n; i++) {
+    Vector3D p = points[i] - bounds.min;
+    codes[i] = morton30(Vector3D(p.x * scale.x, p.y * scale.y, p.z * scale.z));
+  }
+}
+
+void mortonCodes(const Vector3D *points, size_t n, const BBox &bounds,
+                 uint64_t *codes) {
+  Vector3D scale;
+  unitScale(bounds, scale);
+#pragma omp parallel for if (n > kMortonBlock)
+  for (long i = 0; i < (long)n; i++) {
+    Vector3D p = points[i] - bounds.min;
+    codes[i] = morton63(Vector3D(p.x * scale.x, p.y * scale.y, p.z * scale.z));
+  }
+}
+
+//------------------------------------------------------------------------------
+// Radix sort
+//
+// Each pass counts the digits of every block, turns the counts into
+// starting offsets ordered by digit and then by block, and lets every
+// block scatter its keys from its own offsets. Keys of a block keep their
+// order and blocks are laid out in order, so each pass is stable.
+//------------------------------------------------------------------------------
+
+static const int kRadix = 256;
+
+template <typename K>
+static void radixSortKeys(K *keys, uint32_t *values, size_t n) {
+  if (n < 2) return;
+
+  long blocks = (long)((n + kMortonBlock - 1) / kMortonBlock);
+  vector<K> keyBuffer(n);
+  vector<uint32_t> valueBuffer(n);
+  vector<size_t> offsets(blocks * kRadix);
+
+  K *srcK = keys, *dstK = &keyBuffer[0];
+  uint32_t *srcV = values, *dstV = &valueBuffer[0];
+  for (int shift = 0; shift < (int)(8 * sizeof(K)); shift += 8) {
+#pragma omp parallel for if (blocks > 1)
+    for (long b = 0; b < blocks; b++) {
+      size_t *count = &offsets[b * kRadix];
+      fill(count, count + kRadix, 0);
+      size_t end = min(n, (b + 1) * kMortonBlock);
+      for (size_t i = b * kMortonBlock; i < end; i++)
+        count[(srcK[i] >> shift) & (kRadix - 1)]++;
+    }
+
+    // all keys share this digit
+    bool trivial = false;
+    for (int d = 0; d < kRadix && !trivial; d++) {
+      size_t total = 0;
+      for (long b = 0; b < blocks; b++) total += offsets[b * kRadix + d];
+      trivial = total == n;
+    }
+    if (trivial) continue;
+
+    size_t sum = 0;
+    for (int d = 0; d < kRadix; d++) {
+      for (long b = 0; b < blocks; b++) {
+        size_t c = offsets[b * kRadix + d];
+        offsets[b * kRadix + d] = sum;
+        sum += c;
+      }
+    }
+
+#pragma omp parallel for if (blocks > 1)
+    for (long b = 0; b < blocks; b++) {
+      size_t *next = &offsets[b * kRadix];
+      size_t end = min(n, (b + 1) * kMortonBlock);
+      for (size_t i = b * kMortonBlock; i < end; i++) {
+        size_t j = next[(srcK[i] >> shift) & (kRadix - 1)]++;
+        dstK[j] = srcK[i];
+        dstV[j] = srcV[i];
+      }
+    }
+
+    swap(srcK, dstK);
+    swap(srcV, dstV);
+  }
+
+  if (srcK != keys) {
+#pragma omp parallel for if (blocks > 1)
+    for (long b = 0; b < blocks; b++) {
+      size_t begin = b * kMortonBlock, end = min(n, begin + kMortonBlock);
+      copy(srcK + begin, srcK + end, keys + begin);
+      copy(srcV + begin, srcV + end, values + begin);
+    }
+  }
+}
+
+void radixSort(uint32_t *keys, uint32_t *values, size_t n) {
+  radixSortKeys(keys, values, n);
+}
+
+void radixSort(uint64_t *keys, uint32_t *values, size_t n) {
+  radixSortKeys(keys, values, n);
+}
+
+} // namespace CMU462
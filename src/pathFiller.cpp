@@ -0,0 +1,227 @@
+#include "pathFiller.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace CMU462 {
+
+//------------------------------------------------------------------------------
+// Paths
+//------------------------------------------------------------------------------
+
+void PathFiller::clear(void) {
+  edges.clear();
+  open = false;
+}
+
+void PathFiller::moveTo(const Vector2D &p) {
+  close();
+  first = last = p;
+  open = true;
+}
+
+void PathFiller::lineTo(const Vector2D &p) {
+  // horizontal segments cover nothing
+  if (p.y != last.y) {
+    Edge e = {last.x, last.y, p.x, p.y};
+    edges.push_back(e);
+  }
+  last = p;
+}
+
+void PathFiller::close(void) {
+  if (!open) return;
+  lineTo(first);
+  open = false;
+}
+
+void PathFiller::addPolygon(const Vector2D *points, size_t n) {
+  if (!n) return;
+  moveTo(points[0]);
+  for (size_t i = 1; i < n; i++) lineTo(points[i]);
+  close();
+}
+
+//------------------------------------------------------------------------------
+// Coverage
+//
+// The part of an edge within a row, going down by d (negative when it goes
+// up), adds d times the fraction of each pixel to its right to the winding
+// number integrated over that pixel. Each cell receives the difference
+// between the contributions to its pixel and to the previous one, so the
+// running sum of the cells along the row gives the integrated winding
+// numbers, and the cells right of an edge need no update.
+//------------------------------------------------------------------------------
+
+// Accumulates a segment spanning x0 to x1, within [0, width], into the
+// cells, and widens the range [lo, hi] of cells touched.
+static void accumulate(float *cells, double x0, double x1, double d,
+                       size_t &lo, size_t &hi) {
+  if (x0 > x1) swap(x0, x1);
+  size_t i0 = (size_t)x0;
+
+  // within one pixel: the area right of the segment is a trapezoid
+  if (x1 <= i0 + 1) {
+    double m = (x0 + x1) * 0.5 - i0;
+    cells[i0] += (float)(d * (1 - m));
+    cells[i0 + 1] += (float)(d * m);
+    lo = min(lo, i0);
+    hi = max(hi, i0 + 1);
+    return;
+  }
+
+  // across pixels: a triangle in the first and last, and the same share
+  // of d for every pixel crossed in between
+  double s = 1 / (x1 - x0);
+  size_t i1 = (size_t)ceil(x1);
+  double f0 = x0 - i0, f1 = x1 - i1 + 1;
+  double a0 = 0.5 * s * (1 - f0) * (1 - f0), am = 0.5 * s * f1 * f1;
+  cells[i0] += (float)(d * a0);
+  if (i1 == i0 + 2) {
+    cells[i0 + 1] += (float)(d * (1 - a0 - am));
+  } else {
+    double a1 = s * (1.5 - f0);
+    cells[i0 + 1] += (float)(d * (a1 - a0));
+    for (size_t i = i0 + 2; i + 1 < i1; i++) cells[i] += (float)(d * s);
+    double a2 = a1 + (i1 - i0 - 3) * s;
+    cells[i1 - 1] += (float)(d * (1 - a2 - am));
+  }
+  cells[i1] += (float)(d * am);
+  lo = min(lo, i0);
+  hi = max(hi, i1);
+}
+
+// Accumulates a segment from x0 to x1 going down by d, clipped to
+// [0, width]: parts left of the image become vertical at x = 0, and parts
+// right of it are dropped, since the pixels they cover are not in the
+// image either.
+static void accumulateClipped(float *cells, size_t width, double x0,
+                              double x1, double d, size_t &lo, size_t &hi) {
+  double w = (double)width;
+  if (x0 >= 0 && x1 >= 0 && x0 <= w && x1 <= w) {
+    return accumulate(cells, x0, x1, d, lo, hi);
+  }
+
+  // split where the segment crosses the sides
+  double t[4] = {0, 1, 1, 1};
+  int n = 1;
+  if (x0 != x1) {
+    double u = -x0 / (x1 - x0), v = (w - x0) / (x1 - x0);
+    if (u > 0 && u < 1) t[n++] = u;
+    if (v > 0 && v < 1) t[n++] = v;
+  }
+  if (n == 3 && t[1] > t[2]) swap(t[1], t[2]);
+  t[n] = 1;
+  for (int k = 0; k < n; k++) {
+    double dk = d * (t[k + 1] - t[k]);
+    if (dk == 0) continue;
+    double xa = x0 + (x1 - x0) * t[k], xb = x0 + (x1 - x0) * t[k + 1];
+    double mid = (xa + xb) * 0.5;
+    if (mid > w) continue;
+    if (mid < 0) {
+      accumulate(cells, 0, 0, dk, lo, hi);
+    } else {
+      accumulate(cells, max(0.0, min(w, xa)), max(0.0, min(w, xb)), dk, lo,
+                 hi);
+    }
+  }
+}
+
+// the coverage of a pixel from its integrated winding number
+static inline float coverage(double winding, PathFiller::FillRule rule) {
+  double c = fabs(winding);
+  if (rule == PathFiller::EVEN_ODD) {
+    c = fmod(c, 2.0);
+    if (c > 1) c = 2 - c;
+  } else if (c > 1) {
+    c = 1;
+  }
+  // rounding leaves tiny areas where coverage is 0 or 1
+  if (c < 1e-6) return 0;
+  if (c > 1 - 1e-6) return 1;
+  return (float)c;
+}
+
+// composites color over n pixels with the given coverage
+static void blendSpan(Color *dst, size_t n, const Color &color, float c) {
+  float alpha = color.a * c;
+  if (alpha >= 1) {
+    std::fill(dst, dst + n, color);
+    return;
+  }
+  float r = color.r * alpha, g = color.g * alpha, b = color.b * alpha;
+  float t = 1 - alpha;
+  for (size_t i = 0; i < n; i++) {
+    dst[i].r = r + dst[i].r * t;
+    dst[i].g = g + dst[i].g * t;
+    dst[i].b = b + dst[i].b * t;
+    dst[i].a = alpha + dst[i].a * t;
+  }
+}
+
+void PathFiller::fill(Color *image, size_t width, size_t height,
+                      const Color &color, FillRule rule) {
+  close();
+  if (!width || !height || edges.empty()) return;
+
+  auto top = [](const Edge *e) { return min(e->y0, e->y1); };
+  auto bottom = [](const Edge *e) { return max(e->y0, e->y1); };
+
+  // the edge table, by top
+  sorted.resize(edges.size());
+  for (size_t k = 0; k < edges.size(); k++) sorted[k] = &edges[k];
+  sort(sorted.begin(), sorted.end(),
+       [&](const Edge *a, const Edge *b) { return top(a) < top(b); });
+  active.clear();
+  cells.assign(width + 2, 0.0f);
+  float *cell = &cells[0];
+
+  size_t next = 0;
+  double y = max(0.0, floor(top(sorted[0])));
+  for (; y < height; y++) {
+    // update the active edges, skipping rows without any
+    if (active.empty()) {
+      if (next == sorted.size()) break;
+      y = max(y, floor(top(sorted[next])));
+      if (y >= height) break;
+    }
+    while (next < sorted.size() && top(sorted[next]) < y + 1) {
+      active.push_back(sorted[next++]);
+    }
+    active.erase(remove_if(active.begin(), active.end(),
+                           [&](const Edge *e) { return bottom(e) <= y; }),
+                 active.end());
+
+    // the part of every active edge within the row
+    size_t lo = width + 1, hi = 0;
+    for (size_t k = 0; k < active.size(); k++) {
+      const Edge &e = *active[k];
+      double ya = max(y, top(&e)), yb = min(y + 1, bottom(&e));
+      if (ya >= yb) continue;
+      double slope = (e.x1 - e.x0) / (e.y1 - e.y0);
+      double xa = e.x0 + (ya - e.y0) * slope;
+      double xb = e.x0 + (yb - e.y0) * slope;
+      double d = e.y1 > e.y0 ? yb - ya : ya - yb;
+      accumulateClipped(cell, width, xa, xb, d, lo, hi);
+    }
+    if (lo > hi) continue;
+
+    // running sum; runs of empty cells have the coverage of the pixel
+    // before them, as does the rest of the row after the last cell
+    Color *row = image + (size_t)y * width;
+    double winding = 0;
+    for (size_t x = lo; x < width && x <= hi;) {
+      winding += cell[x];
+      size_t end = x + 1;
+      while (end < width && (end > hi || cell[end] == 0)) end++;
+      float c = coverage(winding, rule);
+      if (c > 0) blendSpan(row + x, end - x, color, c);
+      x = end;
+    }
+    std::fill(cell + lo, cell + hi + 1, 0.0f);
+  }
+}
+
+} // namespace CMU462
@@ -2,9 +2,13 @@
 
 namespace CMU462 {
 
-std::ostream &operator<<(std::ostream &os, const Quaternion &v) {
+template <typename T>
+std::ostream &operator<<(std::ostream &os, const BasicQuaternion<T> &v) {
   os << "{ " << v.x << "i, " << v.y << "j, " << v.z << "k, " << v.w << " }";
   return os;
 }
 
+template std::ostream &operator<<(std::ostream &os, const Quaternion &v);
+template std::ostream &operator<<(std::ostream &os, const Quaternionf &v);
+
 } // namespace CMU462
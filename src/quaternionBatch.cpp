@@ -0,0 +1,419 @@
+#include "quaternionBatch.h"
+#include "matrix4x4.h"
+#include "simd.h"
+
+#include <cmath>
+
+using namespace std;
+
+namespace CMU462 {
+
+//------------------------------------------------------------------------------
+// Kernels
+//
+// Quaternions are stored as (x, y, z, w) and vectors as (x, y, z). The
+// vector kernels load four elements, transpose them into one register per
+// component, and transpose back before storing; the scalar versions work on
+// [i, n) and also handle the tails. Double precision is vectorized with
+// AVX2 and single precision with SSE2 (four floats per register), the
+// other combinations use the scalar code.
+//------------------------------------------------------------------------------
+
+// The nlerp parameter that approximates slerp by t between quaternions
+// with |dot| = d. This is the polynomial fit from A. Kapoulkine,
+// "Approximating slerp" (2015).
+template <typename T>
+static inline T slerpCorrection(T t, T d) {
+  T A = T(1.0904) + d * (T(-3.2452) + d * (T(3.55645) - d * T(1.43519)));
+  T B = T(0.848013) + d * (T(-1.06021) + d * T(0.215638));
+  T h = t - T(0.5);
+  T k = A * h * h + B;
+  return t + t * h * (t - T(1)) * k;
+}
+
+// rotate //
+
+template <typename T>
+static void rotate_scalar(size_t i, size_t n, const T *q, const T *in,
+                          T *out) {
+  for (; i < n; i++) {
+    T qx = q[4 * i], qy = q[4 * i + 1], qz = q[4 * i + 2], qw = q[4 * i + 3];
+    T vx = in[3 * i], vy = in[3 * i + 1], vz = in[3 * i + 2];
+
+    T tx = 2 * (qy * vz - qz * vy);
+    T ty = 2 * (qz * vx - qx * vz);
+    T tz = 2 * (qx * vy - qy * vx);
+
+    out[3 * i] = vx + qw * tx + (qy * tz - qz * ty);
+    out[3 * i + 1] = vy + qw * ty + (qz * tx - qx * tz);
+    out[3 * i + 2] = vz + qw * tz + (qx * ty - qy * tx);
+  }
+}
+
+// blend //
+
+template <typename T>
+static void blend_scalar(size_t i, size_t n, const T *q0, const T *q1, T t,
+                         T *out, bool approx) {
+  for (; i < n; i++) {
+    const T *a = q0 + 4 * i, *b = q1 + 4 * i;
+    T d = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+
+    // shorter arc
+    T s = d < 0 ? T(-1) : T(1);
+    T u = approx ? slerpCorrection(t, s * d) : t;
+
+    T x = a[0] + u * (s * b[0] - a[0]);
+    T y = a[1] + u * (s * b[1] - a[1]);
+    T z = a[2] + u * (s * b[2] - a[2]);
+    T w = a[3] + u * (s * b[3] - a[3]);
+
+    T r = T(1) / std::sqrt(x * x + y * y + z * z + w * w);
+    out[4 * i] = x * r;
+    out[4 * i + 1] = y * r;
+    out[4 * i + 2] = z * r;
+    out[4 * i + 3] = w * r;
+  }
+}
+
+#ifdef CMU462_SSE2
+static inline __m128 slerpCorrection_sse2(__m128 t, __m128 d) {
+  __m128 A = _mm_sub_ps(_mm_set1_ps(3.55645f),
+                        _mm_mul_ps(d, _mm_set1_ps(1.43519f)));
+  A = _mm_add_ps(_mm_set1_ps(-3.2452f), _mm_mul_ps(d, A));
+  A = _mm_add_ps(_mm_set1_ps(1.0904f), _mm_mul_ps(d, A));
+  __m128 B = _mm_add_ps(_mm_set1_ps(-1.06021f),
+                        _mm_mul_ps(d, _mm_set1_ps(0.215638f)));
+  B = _mm_add_ps(_mm_set1_ps(0.848013f), _mm_mul_ps(d, B));
+  __m128 h = _mm_sub_ps(t, _mm_set1_ps(0.5f));
+  __m128 k = _mm_add_ps(_mm_mul_ps(A, _mm_mul_ps(h, h)), B);
+  __m128 c = _mm_mul_ps(_mm_mul_ps(t, h), _mm_sub_ps(t, _mm_set1_ps(1.0f)));
+  return _mm_add_ps(t, _mm_mul_ps(c, k));
+}
+
+static void rotate_sse2(size_t n, const float *q, const float *in,
+                        float *out) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const float *p = in + 3 * i;
+    __m128 qx = _mm_loadu_ps(q + 4 * i), qy = _mm_loadu_ps(q + 4 * i + 4);
+    __m128 qz = _mm_loadu_ps(q + 4 * i + 8), qw = _mm_loadu_ps(q + 4 * i + 12);
+    _MM_TRANSPOSE4_PS(qx, qy, qz, qw);
+    __m128 vx = _mm_set_ps(p[9], p[6], p[3], p[0]);
+    __m128 vy = _mm_set_ps(p[10], p[7], p[4], p[1]);
+    __m128 vz = _mm_set_ps(p[11], p[8], p[5], p[2]);
+
+    __m128 tx = _mm_sub_ps(_mm_mul_ps(qy, vz), _mm_mul_ps(qz, vy));
+    __m128 ty = _mm_sub_ps(_mm_mul_ps(qz, vx), _mm_mul_ps(qx, vz));
+    __m128 tz = _mm_sub_ps(_mm_mul_ps(qx, vy), _mm_mul_ps(qy, vx));
+    tx = _mm_add_ps(tx, tx);
+    ty = _mm_add_ps(ty, ty);
+    tz = _mm_add_ps(tz, tz);
+
+    __m128 ox = _mm_add_ps(_mm_add_ps(vx, _mm_mul_ps(qw, tx)),
+                           _mm_sub_ps(_mm_mul_ps(qy, tz), _mm_mul_ps(qz, ty)));
+    __m128 oy = _mm_add_ps(_mm_add_ps(vy, _mm_mul_ps(qw, ty)),
+                           _mm_sub_ps(_mm_mul_ps(qz, tx), _mm_mul_ps(qx, tz)));
+    __m128 oz = _mm_add_ps(_mm_add_ps(vz, _mm_mul_ps(qw, tz)),
+                           _mm_sub_ps(_mm_mul_ps(qx, ty), _mm_mul_ps(qy, tx)));
+    __m128 ow = _mm_setzero_ps();
+    _MM_TRANSPOSE4_PS(ox, oy, oz, ow);
+
+    float *o = out + 3 * i;
+    _mm_storel_pi((__m64 *)o, ox);
+    _mm_store_ss(o + 2, _mm_movehl_ps(ox, ox));
+    _mm_storel_pi((__m64 *)(o + 3), oy);
+    _mm_store_ss(o + 5, _mm_movehl_ps(oy, oy));
+    _mm_storel_pi((__m64 *)(o + 6), oz);
+    _mm_store_ss(o + 8, _mm_movehl_ps(oz, oz));
+    _mm_storel_pi((__m64 *)(o + 9), ow);
+    _mm_store_ss(o + 11, _mm_movehl_ps(ow, ow));
+  }
+  rotate_scalar(i, n, q, in, out);
+}
+
+static void blend_sse2(size_t n, const float *q0, const float *q1, float t,
+                       float *out, bool approx) {
+  const __m128 sign = _mm_set1_ps(-0.0f);
+  const __m128 vt = _mm_set1_ps(t);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const float *a = q0 + 4 * i, *b = q1 + 4 * i;
+    __m128 ax = _mm_loadu_ps(a), ay = _mm_loadu_ps(a + 4);
+    __m128 az = _mm_loadu_ps(a + 8), aw = _mm_loadu_ps(a + 12);
+    __m128 bx = _mm_loadu_ps(b), by = _mm_loadu_ps(b + 4);
+    __m128 bz = _mm_loadu_ps(b + 8), bw = _mm_loadu_ps(b + 12);
+    _MM_TRANSPOSE4_PS(ax, ay, az, aw);
+    _MM_TRANSPOSE4_PS(bx, by, bz, bw);
+
+    __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)),
+                          _mm_add_ps(_mm_mul_ps(az, bz), _mm_mul_ps(aw, bw)));
+
+    // shorter arc: flip the sign of b where d < 0
+    __m128 s = _mm_and_ps(d, sign);
+    bx = _mm_xor_ps(bx, s);
+    by = _mm_xor_ps(by, s);
+    bz = _mm_xor_ps(bz, s);
+    bw = _mm_xor_ps(bw, s);
+    __m128 u = approx ? slerpCorrection_sse2(vt, _mm_xor_ps(d, s)) : vt;
+
+    __m128 x = _mm_add_ps(ax, _mm_mul_ps(u, _mm_sub_ps(bx, ax)));
+    __m128 y = _mm_add_ps(ay, _mm_mul_ps(u, _mm_sub_ps(by, ay)));
+    __m128 z = _mm_add_ps(az, _mm_mul_ps(u, _mm_sub_ps(bz, az)));
+    __m128 w = _mm_add_ps(aw, _mm_mul_ps(u, _mm_sub_ps(bw, aw)));
+
+    __m128 l = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)),
+                          _mm_add_ps(_mm_mul_ps(z, z), _mm_mul_ps(w, w)));
+    __m128 r = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(l));
+    x = _mm_mul_ps(x, r);
+    y = _mm_mul_ps(y, r);
+    z = _mm_mul_ps(z, r);
+    w = _mm_mul_ps(w, r);
+    _MM_TRANSPOSE4_PS(x, y, z, w);
+
+    float *o = out + 4 * i;
+    _mm_storeu_ps(o, x);
+    _mm_storeu_ps(o + 4, y);
+    _mm_storeu_ps(o + 8, z);
+    _mm_storeu_ps(o + 12, w);
+  }
+  blend_scalar(i, n, q0, q1, t, out, approx);
+}
+#endif
+
+#ifdef CMU462_AVX2
+// transposes the 4x4 block held in a, b, c, d
+CMU462_TARGET_AVX2
+static inline void transpose_avx2(__m256d &a, __m256d &b, __m256d &c,
+                                  __m256d &d) {
+  __m256d t0 = _mm256_unpacklo_pd(a, b);
+  __m256d t1 = _mm256_unpackhi_pd(a, b);
+  __m256d t2 = _mm256_unpacklo_pd(c, d);
+  __m256d t3 = _mm256_unpackhi_pd(c, d);
+  a = _mm256_permute2f128_pd(t0, t2, 0x20);
+  b = _mm256_permute2f128_pd(t1, t3, 0x20);
+  c = _mm256_permute2f128_pd(t0, t2, 0x31);
+  d = _mm256_permute2f128_pd(t1, t3, 0x31);
+}
+
+CMU462_TARGET_AVX2
+static inline __m256d slerpCorrection_avx2(__m256d t, __m256d d) {
+  __m256d A = _mm256_fnmadd_pd(d, _mm256_set1_pd(1.43519),
+                               _mm256_set1_pd(3.55645));
+  A = _mm256_fmadd_pd(d, A, _mm256_set1_pd(-3.2452));
+  A = _mm256_fmadd_pd(d, A, _mm256_set1_pd(1.0904));
+  __m256d B = _mm256_fmadd_pd(d, _mm256_set1_pd(0.215638),
+                              _mm256_set1_pd(-1.06021));
+  B = _mm256_fmadd_pd(d, B, _mm256_set1_pd(0.848013));
+  __m256d h = _mm256_sub_pd(t, _mm256_set1_pd(0.5));
+  __m256d k = _mm256_fmadd_pd(A, _mm256_mul_pd(h, h), B);
+  __m256d c = _mm256_mul_pd(_mm256_mul_pd(t, h),
+                            _mm256_sub_pd(t, _mm256_set1_pd(1.0)));
+  return _mm256_fmadd_pd(c, k, t);
+}
+
+CMU462_TARGET_AVX2
+static void rotate_avx2(size_t n, const double *q, const double *in,
+                        double *out) {
+  const __m256i idx = _mm256_set_epi64x(9, 6, 3, 0);
+  const __m256d two = _mm256_set1_pd(2.0);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const double *p = in + 3 * i;
+    __m256d qx = _mm256_loadu_pd(q + 4 * i);
+    __m256d qy = _mm256_loadu_pd(q + 4 * i + 4);
+    __m256d qz = _mm256_loadu_pd(q + 4 * i + 8);
+    __m256d qw = _mm256_loadu_pd(q + 4 * i + 12);
+    transpose_avx2(qx, qy, qz, qw);
+    __m256d vx = _mm256_i64gather_pd(p, idx, 8);
+    __m256d vy = _mm256_i64gather_pd(p + 1, idx, 8);
+    __m256d vz = _mm256_i64gather_pd(p + 2, idx, 8);
+
+    __m256d tx = _mm256_mul_pd(two, _mm256_fmsub_pd(qy, vz,
+                                                    _mm256_mul_pd(qz, vy)));
+    __m256d ty = _mm256_mul_pd(two, _mm256_fmsub_pd(qz, vx,
+                                                    _mm256_mul_pd(qx, vz)));
+    __m256d tz = _mm256_mul_pd(two, _mm256_fmsub_pd(qx, vy,
+                                                    _mm256_mul_pd(qy, vx)));
+
+    __m256d ox = _mm256_add_pd(_mm256_fmadd_pd(qw, tx, vx),
+                               _mm256_fmsub_pd(qy, tz, _mm256_mul_pd(qz, ty)));
+    __m256d oy = _mm256_add_pd(_mm256_fmadd_pd(qw, ty, vy),
+                               _mm256_fmsub_pd(qz, tx, _mm256_mul_pd(qx, tz)));
+    __m256d oz = _mm256_add_pd(_mm256_fmadd_pd(qw, tz, vz),
+                               _mm256_fmsub_pd(qx, ty, _mm256_mul_pd(qy, tx)));
+    __m256d ow = _mm256_setzero_pd();
+    transpose_avx2(ox, oy, oz, ow);
+
+    double *o = out + 3 * i;
+    _mm_storeu_pd(o, _mm256_castpd256_pd128(ox));
+    _mm_store_sd(o + 2, _mm256_extractf128_pd(ox, 1));
+    _mm_storeu_pd(o + 3, _mm256_castpd256_pd128(oy));
+    _mm_store_sd(o + 5, _mm256_extractf128_pd(oy, 1));
+    _mm_storeu_pd(o + 6, _mm256_castpd256_pd128(oz));
+    _mm_store_sd(o + 8, _mm256_extractf128_pd(oz, 1));
+    _mm_storeu_pd(o + 9, _mm256_castpd256_pd128(ow));
+    _mm_store_sd(o + 11, _mm256_extractf128_pd(ow, 1));
+  }
+  rotate_scalar(i, n, q, in, out);
+}
+
+CMU462_TARGET_AVX2
+static void blend_avx2(size_t n, const double *q0, const double *q1,
+                       double t, double *out, bool approx) {
+  const __m256d sign = _mm256_set1_pd(-0.0);
+  const __m256d vt = _mm256_set1_pd(t);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const double *a = q0 + 4 * i, *b = q1 + 4 * i;
+    __m256d ax = _mm256_loadu_pd(a), ay = _mm256_loadu_pd(a + 4);
+    __m256d az = _mm256_loadu_pd(a + 8), aw = _mm256_loadu_pd(a + 12);
+    __m256d bx = _mm256_loadu_pd(b), by = _mm256_loadu_pd(b + 4);
+    __m256d bz = _mm256_loadu_pd(b + 8), bw = _mm256_loadu_pd(b + 12);
+    transpose_avx2(ax, ay, az, aw);
+    transpose_avx2(bx, by, bz, bw);
+
+    __m256d d = _mm256_mul_pd(ax, bx);
+    d = _mm256_fmadd_pd(ay, by, d);
+    d = _mm256_fmadd_pd(az, bz, d);
+    d = _mm256_fmadd_pd(aw, bw, d);
+
+    // shorter arc: flip the sign of b where d < 0
+    __m256d s = _mm256_and_pd(d, sign);
+    bx = _mm256_xor_pd(bx, s);
+    by = _mm256_xor_pd(by, s);
+    bz = _mm256_xor_pd(bz, s);
+    bw = _mm256_xor_pd(bw, s);
+    __m256d u = approx ? slerpCorrection_avx2(vt, _mm256_xor_pd(d, s)) : vt;
+
+    __m256d x = _mm256_fmadd_pd(u, _mm256_sub_pd(bx, ax), ax);
+    __m256d y = _mm256_fmadd_pd(u, _mm256_sub_pd(by, ay), ay);
+    __m256d z = _mm256_fmadd_pd(u, _mm256_sub_pd(bz, az), az);
+    __m256d w = _mm256_fmadd_pd(u, _mm256_sub_pd(bw, aw), aw);
+
+    __m256d l = _mm256_mul_pd(x, x);
+    l = _mm256_fmadd_pd(y, y, l);
+    l = _mm256_fmadd_pd(z, z, l);
+    l = _mm256_fmadd_pd(w, w, l);
+    __m256d r = _mm256_div_pd(_mm256_set1_pd(1.0), _mm256_sqrt_pd(l));
+    x = _mm256_mul_pd(x, r);
+    y = _mm256_mul_pd(y, r);
+    z = _mm256_mul_pd(z, r);
+    w = _mm256_mul_pd(w, r);
+    transpose_avx2(x, y, z, w);
+
+    double *o = out + 4 * i;
+    _mm256_storeu_pd(o, x);
+    _mm256_storeu_pd(o + 4, y);
+    _mm256_storeu_pd(o + 8, z);
+    _mm256_storeu_pd(o + 12, w);
+  }
+  blend_scalar(i, n, q0, q1, t, out, approx);
+}
+#endif
+
+// dispatch //
+
+static void rotate_dispatch(const double *q, const double *in, double *out,
+                            size_t n) {
+#ifdef CMU462_AVX2
+  if (SIMD::hasAVX2()) {
+    rotate_avx2(n, q, in, out);
+    return;
+  }
+#endif
+  rotate_scalar(0, n, q, in, out);
+}
+
+static void rotate_dispatch(const float *q, const float *in, float *out,
+                            size_t n) {
+#ifdef CMU462_SSE2
+  if (SIMD::hasSSE2()) {
+    rotate_sse2(n, q, in, out);
+    return;
+  }
+#endif
+  rotate_scalar(0, n, q, in, out);
+}
+
+static void blend_dispatch(const double *q0, const double *q1, double t,
+                           double *out, size_t n, bool approx) {
+#ifdef CMU462_AVX2
+  if (SIMD::hasAVX2()) {
+    blend_avx2(n, q0, q1, t, out, approx);
+    return;
+  }
+#endif
+  blend_scalar(0, n, q0, q1, t, out, approx);
+}
+
+static void blend_dispatch(const float *q0, const float *q1, float t,
+                           float *out, size_t n, bool approx) {
+#ifdef CMU462_SSE2
+  if (SIMD::hasSSE2()) {
+    blend_sse2(n, q0, q1, t, out, approx);
+    return;
+  }
+#endif
+  blend_scalar(0, n, q0, q1, t, out, approx);
+}
+
+// the rotation matrix of q as a 4x4 matrix without translation
+template <typename T>
+static BasicMatrix4x4<T> rotationMatrix4x4(const BasicQuaternion<T> &q) {
+  BasicMatrix3x3<T> R = q.rotationMatrix();
+  return BasicMatrix4x4<T>(BasicVector4D<T>(R[0].x, R[0].y, R[0].z, 0),
+                           BasicVector4D<T>(R[1].x, R[1].y, R[1].z, 0),
+                           BasicVector4D<T>(R[2].x, R[2].y, R[2].z, 0),
+                           BasicVector4D<T>(0, 0, 0, 1));
+}
+
+//------------------------------------------------------------------------------
+// Batch operations
+//------------------------------------------------------------------------------
+
+void rotate(const Quaternion &q, const Vector3D *in, Vector3D *out,
+            size_t n) {
+  transformVectors(rotationMatrix4x4(q), in, out, n);
+}
+
+void rotate(const Quaternionf &q, const Vector3f *in, Vector3f *out,
+            size_t n) {
+  transformVectors(rotationMatrix4x4(q), in, out, n);
+}
+
+void rotate(const Quaternion *q, const Vector3D *in, Vector3D *out,
+            size_t n) {
+  rotate_dispatch((const double *)q, (const double *)in, (double *)out, n);
+}
+
+void rotate(const Quaternionf *q, const Vector3f *in, Vector3f *out,
+            size_t n) {
+  rotate_dispatch((const float *)q, (const float *)in, (float *)out, n);
+}
+
+void nlerp(const Quaternion *q0, const Quaternion *q1, double t,
+           Quaternion *out, size_t n) {
+  blend_dispatch((const double *)q0, (const double *)q1, t, (double *)out, n,
+                 false);
+}
+
+void nlerp(const Quaternionf *q0, const Quaternionf *q1, float t,
+           Quaternionf *out, size_t n) {
+  blend_dispatch((const float *)q0, (const float *)q1, t, (float *)out, n,
+                 false);
+}
+
+void slerpApprox(const Quaternion *q0, const Quaternion *q1, double t,
+                 Quaternion *out, size_t n) {
+  blend_dispatch((const double *)q0, (const double *)q1, t, (double *)out, n,
+                 true);
+}
+
+void slerpApprox(const Quaternionf *q0, const Quaternionf *q1, float t,
+                 Quaternionf *out, size_t n) {
+  blend_dispatch((const float *)q0, (const float *)q1, t, (float *)out, n,
+                 true);
+}
+
+} // namespace CMU462
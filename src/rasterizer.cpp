@@ -0,0 +1,529 @@
+#include "rasterizer.h"
+#include "simd.h"
+#include "lodepng.h"
+
+#include <string.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace CMU462 {
+
+// Size of the tiles in pixels, along x and y.
+static const size_t kTileSize = 32;
+
+// Longest span of samples in a tile row.
+static const size_t kSpan = kTileSize * 4;
+
+// Vertices are snapped to 1 / kSubpixel of a sample.
+static const double kSubpixel = 16;
+
+// Clipping keeps vertices within about this many samples of the image, so
+// the edge functions stay exact in double precision.
+static const double kGuardBand = 1 << 20;
+
+//------------------------------------------------------------------------------
+// Kernels
+//
+// A triangle covers a sample where its three edge functions are positive.
+// Sample centers are at half integers and vertices at multiples of
+// 1 / 16, so every edge function value is a multiple of 1 / 256 well below
+// 2^53 / 512 in magnitude, which doubles hold exactly whatever the order
+// of the operations. The edge kernels evaluate the samples [i, n) of a
+// row and record the coverage and the edge functions, which the shading
+// kernels turn into barycentric coordinates to test the depth and
+// interpolate the colors. Each kernel leaves the tail to the scalar one.
+//------------------------------------------------------------------------------
+
+// edge functions of a span of samples
+struct Span {
+  float e[3][kSpan];
+  uint8_t mask[kSpan];
+};
+
+// what the shading kernels need of a triangle
+struct Shading {
+  float invArea;
+  float z[3], q[3];
+  Color cq[3];
+};
+
+// Evaluates the edge functions a[k] x + row[k] at x = x0 + i, ...,
+// x0 + n - 1, and returns the number of samples covered.
+static size_t edges_scalar(size_t i, size_t n, const double *a,
+                           const double *row, double x0, Span &s) {
+  size_t covered = 0;
+  for (; i < n; i++) {
+    double x = x0 + i;
+    double e0 = a[0] * x + row[0];
+    double e1 = a[1] * x + row[1];
+    double e2 = a[2] * x + row[2];
+    s.e[0][i] = (float)e0;
+    s.e[1][i] = (float)e1;
+    s.e[2][i] = (float)e2;
+    s.mask[i] = e0 > 0 && e1 > 0 && e2 > 0;
+    covered += s.mask[i];
+  }
+  return covered;
+}
+
+static void shade_scalar(size_t i, size_t n, const Span &s, const Shading &p,
+                         float *depth, Color *color) {
+  for (; i < n; i++) {
+    if (!s.mask[i]) continue;
+    float b0 = s.e[0][i] * p.invArea;
+    float b1 = s.e[1][i] * p.invArea;
+    float b2 = s.e[2][i] * p.invArea;
+    float z = b0 * p.z[0] + b1 * p.z[1] + b2 * p.z[2];
+    if (!(z < depth[i])) continue;
+    depth[i] = z;
+
+    // perspective correct: the colors over w, divided by 1 / w
+    float iq = 1 / (b0 * p.q[0] + b1 * p.q[1] + b2 * p.q[2]);
+    const Color *c = p.cq;
+    color[i].r = (b0 * c[0].r + b1 * c[1].r + b2 * c[2].r) * iq;
+    color[i].g = (b0 * c[0].g + b1 * c[1].g + b2 * c[2].g) * iq;
+    color[i].b = (b0 * c[0].b + b1 * c[1].b + b2 * c[2].b) * iq;
+    color[i].a = (b0 * c[0].a + b1 * c[1].a + b2 * c[2].a) * iq;
+  }
+}
+
+#ifdef CMU462_SSE2
+static size_t edges_sse2(size_t i, size_t n, const double *a,
+                         const double *row, double x0, Span &s) {
+  const __m128d zero = _mm_setzero_pd(), step = _mm_setr_pd(0, 1);
+  const __m128d a0 = _mm_set1_pd(a[0]), a1 = _mm_set1_pd(a[1]);
+  const __m128d a2 = _mm_set1_pd(a[2]);
+  const __m128d r0 = _mm_set1_pd(row[0]), r1 = _mm_set1_pd(row[1]);
+  const __m128d r2 = _mm_set1_pd(row[2]);
+  size_t covered = 0;
+  for (; i + 2 <= n; i += 2) {
+    __m128d x = _mm_add_pd(_mm_set1_pd(x0 + i), step);
+    __m128d e0 = _mm_add_pd(_mm_mul_pd(a0, x), r0);
+    __m128d e1 = _mm_add_pd(_mm_mul_pd(a1, x), r1);
+    __m128d e2 = _mm_add_pd(_mm_mul_pd(a2, x), r2);
+    _mm_storel_pi((__m64 *)(s.e[0] + i), _mm_cvtpd_ps(e0));
+    _mm_storel_pi((__m64 *)(s.e[1] + i), _mm_cvtpd_ps(e1));
+    _mm_storel_pi((__m64 *)(s.e[2] + i), _mm_cvtpd_ps(e2));
+    __m128d in = _mm_and_pd(_mm_and_pd(_mm_cmpgt_pd(e0, zero),
+                                       _mm_cmpgt_pd(e1, zero)),
+                            _mm_cmpgt_pd(e2, zero));
+    int m = _mm_movemask_pd(in);
+    s.mask[i] = m & 1;
+    s.mask[i + 1] = m >> 1;
+    covered += s.mask[i] + s.mask[i + 1];
+  }
+  return covered + edges_scalar(i, n, a, row, x0, s);
+}
+
+static void shade_sse2(size_t i, size_t n, const Span &s, const Shading &p,
+                       float *depth, Color *color) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128 inv = _mm_set1_ps(p.invArea);
+  for (; i + 4 <= n; i += 4) {
+    int m;
+    memcpy(&m, s.mask + i, 4);
+    if (!m) continue;
+    __m128 b0 = _mm_mul_ps(_mm_loadu_ps(s.e[0] + i), inv);
+    __m128 b1 = _mm_mul_ps(_mm_loadu_ps(s.e[1] + i), inv);
+    __m128 b2 = _mm_mul_ps(_mm_loadu_ps(s.e[2] + i), inv);
+    __m128 z = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(b0, _mm_set1_ps(p.z[0])),
+                   _mm_mul_ps(b1, _mm_set1_ps(p.z[1]))),
+        _mm_mul_ps(b2, _mm_set1_ps(p.z[2])));
+
+    // the mask bytes (0 or 1) widened to 32-bit lanes
+    __m128i cover = _mm_cvtsi32_si128(m);
+    cover = _mm_unpacklo_epi16(_mm_unpacklo_epi8(cover, zero), zero);
+    cover = _mm_cmpgt_epi32(cover, zero);
+    __m128 d = _mm_loadu_ps(depth + i);
+    __m128 pass = _mm_and_ps(_mm_castsi128_ps(cover), _mm_cmplt_ps(z, d));
+    int bits = _mm_movemask_ps(pass);
+    if (!bits) continue;
+    _mm_storeu_ps(depth + i, _mm_or_ps(_mm_and_ps(pass, z),
+                                       _mm_andnot_ps(pass, d)));
+
+    __m128 q = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(b0, _mm_set1_ps(p.q[0])),
+                   _mm_mul_ps(b1, _mm_set1_ps(p.q[1]))),
+        _mm_mul_ps(b2, _mm_set1_ps(p.q[2])));
+    __m128 iq = _mm_div_ps(_mm_set1_ps(1.0f), q);
+    __m128 ch[4];
+    for (int k = 0; k < 4; k++) {
+      const float *c0 = &p.cq[0].r, *c1 = &p.cq[1].r, *c2 = &p.cq[2].r;
+      __m128 v = _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(b0, _mm_set1_ps(c0[k])),
+                     _mm_mul_ps(b1, _mm_set1_ps(c1[k]))),
+          _mm_mul_ps(b2, _mm_set1_ps(c2[k])));
+      ch[k] = _mm_mul_ps(v, iq);
+    }
+    _MM_TRANSPOSE4_PS(ch[0], ch[1], ch[2], ch[3]);
+    for (int k = 0; k < 4; k++) {
+      if (bits >> k & 1) _mm_storeu_ps(&color[i + k].r, ch[k]);
+    }
+  }
+  shade_scalar(i, n, s, p, depth, color);
+}
+#endif
+
+#ifdef CMU462_AVX2
+CMU462_TARGET_AVX2
+static size_t edges_avx2(size_t i, size_t n, const double *a,
+                         const double *row, double x0, Span &s) {
+  const __m256d zero = _mm256_setzero_pd();
+  const __m256d step = _mm256_setr_pd(0, 1, 2, 3);
+  const __m256d a0 = _mm256_set1_pd(a[0]), a1 = _mm256_set1_pd(a[1]);
+  const __m256d a2 = _mm256_set1_pd(a[2]);
+  const __m256d r0 = _mm256_set1_pd(row[0]), r1 = _mm256_set1_pd(row[1]);
+  const __m256d r2 = _mm256_set1_pd(row[2]);
+  size_t covered = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256d x = _mm256_add_pd(_mm256_set1_pd(x0 + i), step);
+    __m256d e0 = _mm256_fmadd_pd(a0, x, r0);
+    __m256d e1 = _mm256_fmadd_pd(a1, x, r1);
+    __m256d e2 = _mm256_fmadd_pd(a2, x, r2);
+    _mm_storeu_ps(s.e[0] + i, _mm256_cvtpd_ps(e0));
+    _mm_storeu_ps(s.e[1] + i, _mm256_cvtpd_ps(e1));
+    _mm_storeu_ps(s.e[2] + i, _mm256_cvtpd_ps(e2));
+    __m256d in = _mm256_and_pd(
+        _mm256_and_pd(_mm256_cmp_pd(e0, zero, _CMP_GT_OQ),
+                      _mm256_cmp_pd(e1, zero, _CMP_GT_OQ)),
+        _mm256_cmp_pd(e2, zero, _CMP_GT_OQ));
+    int m = _mm256_movemask_pd(in);
+    for (int k = 0; k < 4; k++) s.mask[i + k] = m >> k & 1;
+    covered += (m & 1) + (m >> 1 & 1) + (m >> 2 & 1) + (m >> 3);
+  }
+  return covered + edges_scalar(i, n, a, row, x0, s);
+}
+#endif
+
+//------------------------------------------------------------------------------
+// Setup
+//------------------------------------------------------------------------------
+
+Rasterizer::Rasterizer(size_t width, size_t height, int supersample)
+    : transform(Matrix4x4::identity()) {
+  resize(width, height, supersample);
+}
+
+void Rasterizer::resize(size_t width, size_t height, int supersample) {
+  w = width;
+  h = height;
+  ss = supersample;
+  tilesX = (w + kTileSize - 1) / kTileSize;
+  tilesY = (h + kTileSize - 1) / kTileSize;
+  size_t t = kTileSize * ss;
+  depths.resize(tilesX * tilesY * t * t);
+  colors.resize(depths.size());
+  bins.assign(tilesX * tilesY, vector<uint32_t>());
+  clear();
+}
+
+void Rasterizer::clear(const Color &c) {
+  triangles.clear();
+  for (size_t t = 0; t < bins.size(); t++) bins[t].clear();
+
+  size_t t = kTileSize * ss;
+  long tiles = (long)bins.size();
+#pragma omp parallel for if (tiles > 1)
+  for (long k = 0; k < tiles; k++) {
+    std::fill(depths.begin() + k * t * t, depths.begin() + (k + 1) * t * t,
+              INFINITY);
+    std::fill(colors.begin() + k * t * t, colors.begin() + (k + 1) * t * t,
+              c);
+  }
+}
+
+void Rasterizer::drawTriangle(const Vector3D &p0, const Vector3D &p1,
+                              const Vector3D &p2, const Color &c0,
+                              const Color &c1, const Color &c2) {
+  Vector4D v[3] = {transform * Vector4D(p0.x, p0.y, p0.z, 1),
+                   transform * Vector4D(p1.x, p1.y, p1.z, 1),
+                   transform * Vector4D(p2.x, p2.y, p2.z, 1)};
+  Color c[3] = {c0, c1, c2};
+  clipAndQueue(v, c);
+}
+
+void Rasterizer::drawTriangle(const Vector3D &p0, const Vector3D &p1,
+                              const Vector3D &p2, const Spectrum &c0,
+                              const Spectrum &c1, const Spectrum &c2) {
+  drawTriangle(p0, p1, p2, Color(c0.r, c0.g, c0.b), Color(c1.r, c1.g, c1.b),
+               Color(c2.r, c2.g, c2.b));
+}
+
+void Rasterizer::drawTriangles(const Vector3D *positions,
+                               const Color *colors, const uint32_t *indices,
+                               size_t triangles) {
+  for (size_t t = 0; t < triangles; t++) {
+    const uint32_t *i = indices + 3 * t;
+    drawTriangle(positions[i[0]], positions[i[1]], positions[i[2]],
+                 colors[i[0]], colors[i[1]], colors[i[2]]);
+  }
+}
+
+void Rasterizer::drawTriangles(const Vector3D *positions,
+                               const Spectrum *colors,
+                               const uint32_t *indices, size_t triangles) {
+  for (size_t t = 0; t < triangles; t++) {
+    const uint32_t *i = indices + 3 * t;
+    drawTriangle(positions[i[0]], positions[i[1]], positions[i[2]],
+                 colors[i[0]], colors[i[1]], colors[i[2]]);
+  }
+}
+
+void Rasterizer::clipAndQueue(const Vector4D *v, const Color *c) {
+  // the near plane, and the guard band around the image
+  double gx = 2 * kGuardBand / ((double)w * ss) - 1;
+  double gy = 2 * kGuardBand / ((double)h * ss) - 1;
+  const Vector4D planes[5] = {Vector4D(0, 0, 1, 1), Vector4D(-1, 0, 0, gx),
+                              Vector4D(1, 0, 0, gx), Vector4D(0, -1, 0, gy),
+                              Vector4D(0, 1, 0, gy)};
+
+  // most triangles need no clipping
+  bool inside = true;
+  for (int k = 0; k < 5 && inside; k++) {
+    for (int j = 0; j < 3; j++) inside = inside && dot(planes[k], v[j]) >= 0;
+  }
+  if (inside) return queue(v, c);
+
+  // Sutherland-Hodgman: each plane adds at most one vertex
+  Vector4D pv[2][8];
+  Color pc[2][8];
+  int m = 3;
+  for (int j = 0; j < 3; j++) {
+    pv[0][j] = v[j];
+    pc[0][j] = c[j];
+  }
+  for (int k = 0; k < 5; k++) {
+    const Vector4D *iv = pv[k & 1];
+    const Color *ic = pc[k & 1];
+    Vector4D *ov = pv[~k & 1];
+    Color *oc = pc[~k & 1];
+    int o = 0;
+    for (int j = 0; j < m; j++) {
+      int l = (j + 1) % m;
+      double dj = dot(planes[k], iv[j]), dl = dot(planes[k], iv[l]);
+      if (dj >= 0) {
+        ov[o] = iv[j];
+        oc[o++] = ic[j];
+      }
+      if ((dj >= 0) != (dl >= 0)) {
+        double t = dj / (dj - dl);
+        ov[o] = iv[j] * (1 - t) + iv[l] * t;
+        oc[o++] = ic[j] * (float)(1 - t) + ic[l] * (float)t;
+      }
+    }
+    m = o;
+    if (m < 3) return;
+  }
+
+  // the clipped polygon is convex: triangulate it as a fan
+  const Vector4D *fv = pv[5 & 1];
+  const Color *fc = pc[5 & 1];
+  for (int j = 1; j + 1 < m; j++) {
+    Vector4D tv[3] = {fv[0], fv[j], fv[j + 1]};
+    Color tc[3] = {fc[0], fc[j], fc[j + 1]};
+    queue(tv, tc);
+  }
+}
+
+void Rasterizer::queue(const Vector4D *v, const Color *c) {
+  Triangle t;
+  double x[3], y[3];
+  double sw = (double)w * ss, sh = (double)h * ss;
+  for (int k = 0; k < 3; k++) {
+    double iw = 1 / v[k].w;
+    x[k] = nearbyint((v[k].x * iw + 1) * 0.5 * sw * kSubpixel) / kSubpixel;
+    y[k] = nearbyint((1 - v[k].y * iw) * 0.5 * sh * kSubpixel) / kSubpixel;
+    t.z[k] = (float)(v[k].z * iw);
+    t.q[k] = (float)iw;
+    t.cq[k] = c[k] * t.q[k];
+  }
+
+  // edge k is opposite vertex k, and positive on its side
+  double area = 0;
+  for (int k = 0; k < 3; k++) {
+    int i = (k + 1) % 3, j = (k + 2) % 3;
+    t.a[k] = y[i] - y[j];
+    t.b[k] = x[j] - x[i];
+    t.c[k] = x[i] * y[j] - x[j] * y[i];
+    area += t.c[k];
+  }
+  if (area == 0) return;
+  for (int k = 0; area < 0 && k < 3; k++) {
+    t.a[k] = -t.a[k];
+    t.b[k] = -t.b[k];
+    t.c[k] = -t.c[k];
+  }
+  t.invArea = (float)(1 / fabs(area));
+
+  // top-left rule: samples on a top or left edge are covered, which for
+  // multiples of 1 / 256 is the same as shifting the edge by 1 / 512
+  for (int k = 0; k < 3; k++) {
+    if (t.a[k] > 0 || (t.a[k] == 0 && t.b[k] > 0)) t.c[k] += 1.0 / 512;
+  }
+
+  // the samples whose centers fall in the bounding box
+  double x0 = min(x[0], min(x[1], x[2])), x1 = max(x[0], max(x[1], x[2]));
+  double y0 = min(y[0], min(y[1], y[2])), y1 = max(y[0], max(y[1], y[2]));
+  t.x0 = (int)max(0.0, ceil(x0 - 0.5));
+  t.y0 = (int)max(0.0, ceil(y0 - 0.5));
+  t.x1 = (int)min(sw - 1, floor(x1 - 0.5));
+  t.y1 = (int)min(sh - 1, floor(y1 - 0.5));
+  if (t.x0 > t.x1 || t.y0 > t.y1) return;
+
+  triangles.push_back(t);
+}
+
+//------------------------------------------------------------------------------
+// Rasterization
+//------------------------------------------------------------------------------
+
+void Rasterizer::flush(void) {
+  if (triangles.empty()) return;
+
+  // bins, in drawing order; tiles where an edge function is negative at
+  // every corner are left out
+  int t = (int)(kTileSize * ss);
+  for (size_t k = 0; k < triangles.size(); k++) {
+    const Triangle &tri = triangles[k];
+    for (int ty = tri.y0 / t; ty <= tri.y1 / t; ty++) {
+      for (int tx = tri.x0 / t; tx <= tri.x1 / t; tx++) {
+        bool outside = false;
+        for (int j = 0; j < 3 && !outside; j++) {
+          double cx = tx * t + (tri.a[j] > 0 ? t - 0.5 : 0.5);
+          double cy = ty * t + (tri.b[j] > 0 ? t - 0.5 : 0.5);
+          outside = tri.a[j] * cx + tri.b[j] * cy + tri.c[j] <= 0;
+        }
+        if (!outside) bins[ty * tilesX + tx].push_back((uint32_t)k);
+      }
+    }
+  }
+
+  long tiles = (long)bins.size();
+#pragma omp parallel for schedule(dynamic) if (tiles > 1)
+  for (long k = 0; k < tiles; k++) {
+    if (!bins[k].empty()) rasterizeTile(k);
+  }
+
+  triangles.clear();
+  for (size_t k = 0; k < bins.size(); k++) bins[k].clear();
+}
+
+void Rasterizer::rasterizeTile(size_t tile) {
+  size_t (*edges)(size_t, size_t, const double *, const double *, double,
+                  Span &) = edges_scalar;
+  void (*shade)(size_t, size_t, const Span &, const Shading &, float *,
+                Color *) = shade_scalar;
+#ifdef CMU462_SSE2
+  if (SIMD::hasSSE2()) {
+    edges = edges_sse2;
+    shade = shade_sse2;
+  }
+#endif
+#ifdef CMU462_AVX2
+  if (SIMD::hasAVX2()) edges = edges_avx2;
+#endif
+
+  int t = (int)(kTileSize * ss);
+  int ox = (int)(tile % tilesX) * t, oy = (int)(tile / tilesX) * t;
+  float *depth = &depths[tile * t * t];
+  Color *color = &colors[tile * t * t];
+
+  Span s;
+  const vector<uint32_t> &bin = bins[tile];
+  for (size_t k = 0; k < bin.size(); k++) {
+    const Triangle &tri = triangles[bin[k]];
+    Shading p;
+    p.invArea = tri.invArea;
+    for (int j = 0; j < 3; j++) {
+      p.z[j] = tri.z[j];
+      p.q[j] = tri.q[j];
+      p.cq[j] = tri.cq[j];
+    }
+
+    int x0 = max(tri.x0, ox), x1 = min(tri.x1, ox + t - 1);
+    int y0 = max(tri.y0, oy), y1 = min(tri.y1, oy + t - 1);
+    for (int y = y0; y <= y1; y++) {
+      double py = y + 0.5, row[3];
+      for (int j = 0; j < 3; j++) row[j] = tri.b[j] * py + tri.c[j];
+
+      // the samples of the row between the edges, widened by one sample
+      // for rounding, which the edge kernels then test exactly
+      double lo = x0, hi = x1;
+      for (int j = 0; j < 3; j++) {
+        double cross = -row[j] / tri.a[j] - 0.5;
+        if (tri.a[j] > 0) lo = max(lo, floor(cross) - 1);
+        else if (tri.a[j] < 0) hi = min(hi, ceil(cross) + 1);
+        else if (row[j] <= 0) hi = lo - 1;
+      }
+      if (lo > hi) continue;
+
+      int xs = (int)lo;
+      size_t n = (size_t)(hi - lo) + 1;
+      if (!edges(0, n, tri.a, row, xs + 0.5, s)) continue;
+      size_t offset = (y - oy) * t + (xs - ox);
+      shade(0, n, s, p, depth + offset, color + offset);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Resolve
+//------------------------------------------------------------------------------
+
+void Rasterizer::resolveRow(size_t y, Color *out) const {
+  size_t t = kTileSize * ss;
+  size_t ty = y / kTileSize, sy = (y % kTileSize) * ss;
+  float scale = 1.0f / (ss * ss);
+  for (size_t x = 0; x < w; x++) {
+    size_t tile = ty * tilesX + x / kTileSize, sx = (x % kTileSize) * ss;
+    const Color *c = &colors[tile * t * t + sy * t + sx];
+    Color sum(0, 0, 0, 0);
+    for (int j = 0; j < ss; j++) {
+      for (int i = 0; i < ss; i++) sum += c[j * t + i];
+    }
+    out[x] = sum * scale;
+  }
+}
+
+void Rasterizer::resolve(Color *out) {
+  flush();
+  long rows = (long)h;
+#pragma omp parallel for if (rows > 1)
+  for (long y = 0; y < rows; y++) resolveRow(y, out + y * w);
+}
+
+void Rasterizer::resolve(Spectrum *out) {
+  flush();
+  long rows = (long)h;
+#pragma omp parallel for if (rows > 1)
+  for (long y = 0; y < rows; y++) {
+    vector<Color> row(w);
+    resolveRow(y, row.data());
+    for (size_t x = 0; x < w; x++)
+      out[y * w + x] = Spectrum(row[x].r, row[x].g, row[x].b);
+  }
+}
+
+void Rasterizer::resolve(Color32 *out) {
+  flush();
+  long rows = (long)h;
+#pragma omp parallel for if (rows > 1)
+  for (long y = 0; y < rows; y++) {
+    vector<Color> row(w);
+    resolveRow(y, row.data());
+    for (size_t x = 0; x < w; x++) out[y * w + x] = Color32(row[x]);
+  }
+}
+
+bool Rasterizer::savePNG(const char *filename) {
+  if (!w || !h) return false;
+  vector<Color32> image(w * h);
+  resolve(&image[0]);
+  return !lodepng::encode(filename, (const unsigned char *)&image[0],
+                          (unsigned)w, (unsigned)h);
+}
+
+} // namespace CMU462
@@ -0,0 +1,92 @@
+#include "simd.h"
+
+#include <stdlib.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <malloc.h>
+#elif defined(CMU462_SSE2)
+#include <cpuid.h>
+#endif
+
+namespace CMU462 {
+namespace SIMD {
+
+static Level detect(void) {
+#if !defined(CMU462_SSE2)
+  return SCALAR;
+#else
+  unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  unsigned int maxLeaf = info[0];
+  __cpuid(info, 1);
+  ecx = info[2];
+#else
+  unsigned int maxLeaf = __get_cpuid_max(0, 0);
+  __get_cpuid(1, &eax, &ebx, &ecx, &edx);
+#endif
+
+  // AVX2 needs CPU support plus OS support for saving the YMM registers.
+  bool osxsave = (ecx & (1u << 27)) != 0;
+  bool avx = (ecx & (1u << 28)) != 0;
+  bool fma = (ecx & (1u << 12)) != 0;
+  bool f16c = (ecx & (1u << 29)) != 0;
+  if (!osxsave || !avx || !fma || !f16c || maxLeaf < 7) return SSE2;
+
+#if defined(_MSC_VER)
+  unsigned long long xcr0 = _xgetbv(0);
+  __cpuidex(info, 7, 0);
+  ebx = info[1];
+#else
+  unsigned int xcr0lo, xcr0hi;
+  __asm__("xgetbv" : "=a"(xcr0lo), "=d"(xcr0hi) : "c"(0));
+  unsigned long long xcr0 = xcr0lo;
+  __cpuid_count(7, 0, eax, ebx, ecx, edx);
+#endif
+
+  if ((xcr0 & 0x6) != 0x6) return SSE2;
+  if (!(ebx & (1u << 5))) return SSE2;
+
+#if defined(CMU462_AVX2)
+  return AVX2;
+#else
+  return SSE2;
+#endif
+
+#endif // CMU462_SSE2
+}
+
+static int detected = -1;
+static Level cap = AVX2;
+
+Level level(void) {
+  if (detected < 0) detected = detect();
+  return detected < cap ? (Level)detected : cap;
+}
+
+void setLevel(Level max) { cap = max; }
+
+void *alignedAlloc(size_t size, size_t alignment) {
+  if (size == 0) size = alignment;
+#if defined(_MSC_VER) || defined(__MINGW32__)
+  return _aligned_malloc(size, alignment);
+#else
+  void *ptr = NULL;
+  if (posix_memalign(&ptr, alignment, size)) return NULL;
+  return ptr;
+#endif
+}
+
+void alignedFree(void *ptr) {
+#if defined(_MSC_VER) || defined(__MINGW32__)
+  _aligned_free(ptr);
+#else
+  free(ptr);
+#endif
+}
+
+} // namespace SIMD
+} // namespace CMU462
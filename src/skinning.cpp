@@ -0,0 +1,333 @@
+#include "skinning.h"
+#include "simd.h"
+
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+
+namespace CMU462 {
+
+//------------------------------------------------------------------------------
+// Kernels
+//
+// The palettes are read as raw doubles: a DualQuaternion is the real part
+// (x, y, z, w) followed by the dual part, eight doubles, and a Matrix4x4 is
+// sixteen doubles in column major order. Each kernel skins the vertices
+// [i, n); the AVX2 versions do four vertices per iteration, gathering the
+// bone data by index, and leave the tail to the scalar versions.
+//------------------------------------------------------------------------------
+
+// dual quaternion //
+
+static void dq_scalar(size_t i, size_t n, const double *pal,
+                      const SkinInfluences &f, const double *p,
+                      const double *nrm, double *op, double *on) {
+  for (; i < n; i++) {
+    const double *q0 = pal + 8 * f.index[0][i];
+    double b[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    for (int k = 0; k < 4; k++) {
+      const double *q = pal + 8 * f.index[k][i];
+      double w = f.weight[k][i];
+
+      // blend in the hemisphere of the first influence
+      if (q[0] * q0[0] + q[1] * q0[1] + q[2] * q0[2] + q[3] * q0[3] < 0) {
+        w = -w;
+      }
+      for (int c = 0; c < 8; c++) b[c] += w * q[c];
+    }
+
+    double r = 1.0 / sqrt(b[0] * b[0] + b[1] * b[1] + b[2] * b[2] +
+                          b[3] * b[3]);
+    double rx = b[0] * r, ry = b[1] * r, rz = b[2] * r, rw = b[3] * r;
+    double dx = b[4] * r, dy = b[5] * r, dz = b[6] * r, dw = b[7] * r;
+
+    // translation, 2 d r*
+    double tx = 2 * (rw * dx - dw * rx + ry * dz - rz * dy);
+    double ty = 2 * (rw * dy - dw * ry + rz * dx - rx * dz);
+    double tz = 2 * (rw * dz - dw * rz + rx * dy - ry * dx);
+
+    // rotation, v + w u + r x u with u = 2 r x v
+    for (int s = 0; s < 2; s++) {
+      const double *v = s ? nrm : p;
+      double *o = s ? on : op;
+      if (!v) continue;
+
+      double vx = v[3 * i], vy = v[3 * i + 1], vz = v[3 * i + 2];
+      double ux = 2 * (ry * vz - rz * vy);
+      double uy = 2 * (rz * vx - rx * vz);
+      double uz = 2 * (rx * vy - ry * vx);
+      o[3 * i] = vx + rw * ux + (ry * uz - rz * uy);
+      o[3 * i + 1] = vy + rw * uy + (rz * ux - rx * uz);
+      o[3 * i + 2] = vz + rw * uz + (rx * uy - ry * ux);
+      if (!s) {
+        o[3 * i] += tx;
+        o[3 * i + 1] += ty;
+        o[3 * i + 2] += tz;
+      }
+    }
+  }
+}
+
+// linear blend //
+
+static void lbs_scalar(size_t i, size_t n, const double *pal,
+                       const SkinInfluences &f, const double *p,
+                       const double *nrm, double *op, double *on) {
+  for (; i < n; i++) {
+    // rows 0-2 of the blended matrix, column major
+    double m[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    for (int k = 0; k < 4; k++) {
+      const double *M = pal + 16 * f.index[k][i];
+      double w = f.weight[k][i];
+      for (int j = 0; j < 4; j++) {
+        m[3 * j] += w * M[4 * j];
+        m[3 * j + 1] += w * M[4 * j + 1];
+        m[3 * j + 2] += w * M[4 * j + 2];
+      }
+    }
+
+    if (p) {
+      double x = p[3 * i], y = p[3 * i + 1], z = p[3 * i + 2];
+      op[3 * i] = m[0] * x + m[3] * y + m[6] * z + m[9];
+      op[3 * i + 1] = m[1] * x + m[4] * y + m[7] * z + m[10];
+      op[3 * i + 2] = m[2] * x + m[5] * y + m[8] * z + m[11];
+    }
+    if (nrm) {
+      double x = nrm[3 * i], y = nrm[3 * i + 1], z = nrm[3 * i + 2];
+      on[3 * i] = m[0] * x + m[3] * y + m[6] * z;
+      on[3 * i + 1] = m[1] * x + m[4] * y + m[7] * z;
+      on[3 * i + 2] = m[2] * x + m[5] * y + m[8] * z;
+    }
+  }
+}
+
+#ifdef CMU462_AVX2
+// gathers base[idx[0..3]]; the masked form has a defined pass-through
+// value, which spares GCC's uninitialized warning for the plain one
+CMU462_TARGET_AVX2
+static inline __m256d gather_avx2(const double *base, __m128i idx) {
+  const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+  return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), base, idx, all, 8);
+}
+
+// loads the four 3D vectors at v into one register per component
+CMU462_TARGET_AVX2
+static inline void load3_avx2(const double *v, __m256d &x, __m256d &y,
+                              __m256d &z) {
+  const __m256i idx = _mm256_set_epi64x(9, 6, 3, 0);
+  x = _mm256_i64gather_pd(v, idx, 8);
+  y = _mm256_i64gather_pd(v + 1, idx, 8);
+  z = _mm256_i64gather_pd(v + 2, idx, 8);
+}
+
+// stores four 3D vectors held as one register per component at o
+CMU462_TARGET_AVX2
+static inline void store3_avx2(double *o, __m256d x, __m256d y, __m256d z) {
+  __m256d t0 = _mm256_unpacklo_pd(x, y);
+  __m256d t1 = _mm256_unpackhi_pd(x, y);
+  __m256d t2 = _mm256_unpacklo_pd(z, z);
+  __m256d t3 = _mm256_unpackhi_pd(z, z);
+  __m256d v0 = _mm256_permute2f128_pd(t0, t2, 0x20);
+  __m256d v1 = _mm256_permute2f128_pd(t1, t3, 0x20);
+  __m256d v2 = _mm256_permute2f128_pd(t0, t2, 0x31);
+  __m256d v3 = _mm256_permute2f128_pd(t1, t3, 0x31);
+  _mm_storeu_pd(o, _mm256_castpd256_pd128(v0));
+  _mm_store_sd(o + 2, _mm256_extractf128_pd(v0, 1));
+  _mm_storeu_pd(o + 3, _mm256_castpd256_pd128(v1));
+  _mm_store_sd(o + 5, _mm256_extractf128_pd(v1, 1));
+  _mm_storeu_pd(o + 6, _mm256_castpd256_pd128(v2));
+  _mm_store_sd(o + 8, _mm256_extractf128_pd(v2, 1));
+  _mm_storeu_pd(o + 9, _mm256_castpd256_pd128(v3));
+  _mm_store_sd(o + 11, _mm256_extractf128_pd(v3, 1));
+}
+
+// rotates (vx, vy, vz) by the unit quaternion (rx, ry, rz, rw)
+CMU462_TARGET_AVX2
+static inline void rotate_avx2(__m256d rx, __m256d ry, __m256d rz,
+                               __m256d rw, __m256d &vx, __m256d &vy,
+                               __m256d &vz) {
+  const __m256d two = _mm256_set1_pd(2.0);
+  __m256d ux = _mm256_mul_pd(two, _mm256_fmsub_pd(ry, vz,
+                                                  _mm256_mul_pd(rz, vy)));
+  __m256d uy = _mm256_mul_pd(two, _mm256_fmsub_pd(rz, vx,
+                                                  _mm256_mul_pd(rx, vz)));
+  __m256d uz = _mm256_mul_pd(two, _mm256_fmsub_pd(rx, vy,
+                                                  _mm256_mul_pd(ry, vx)));
+  vx = _mm256_add_pd(_mm256_fmadd_pd(rw, ux, vx),
+                     _mm256_fmsub_pd(ry, uz, _mm256_mul_pd(rz, uy)));
+  vy = _mm256_add_pd(_mm256_fmadd_pd(rw, uy, vy),
+                     _mm256_fmsub_pd(rz, ux, _mm256_mul_pd(rx, uz)));
+  vz = _mm256_add_pd(_mm256_fmadd_pd(rw, uz, vz),
+                     _mm256_fmsub_pd(rx, uy, _mm256_mul_pd(ry, ux)));
+}
+
+CMU462_TARGET_AVX2
+static void dq_avx2(size_t i, size_t n, const double *pal,
+                    const SkinInfluences &f, const double *p,
+                    const double *nrm, double *op, double *on) {
+  const __m256d sign = _mm256_set1_pd(-0.0);
+  const __m256d two = _mm256_set1_pd(2.0);
+  for (; i + 4 <= n; i += 4) {
+    __m256d b[8], q0[4];
+    for (int k = 0; k < 4; k++) {
+      // offsets of the four dual quaternions, in doubles
+      __m128i idx = _mm_slli_epi32(
+          _mm_loadu_si128((const __m128i *)(f.index[k] + i)), 3);
+      __m256d w = _mm256_loadu_pd(f.weight[k] + i);
+
+      __m256d q[8];
+      for (int c = 0; c < 8; c++) q[c] = gather_avx2(pal + c, idx);
+
+      if (k == 0) {
+        for (int c = 0; c < 4; c++) q0[c] = q[c];
+      } else {
+        // blend in the hemisphere of the first influence
+        __m256d d = _mm256_mul_pd(q[0], q0[0]);
+        d = _mm256_fmadd_pd(q[1], q0[1], d);
+        d = _mm256_fmadd_pd(q[2], q0[2], d);
+        d = _mm256_fmadd_pd(q[3], q0[3], d);
+        w = _mm256_xor_pd(w, _mm256_and_pd(d, sign));
+      }
+
+      for (int c = 0; c < 8; c++) {
+        b[c] = k ? _mm256_fmadd_pd(w, q[c], b[c]) : _mm256_mul_pd(w, q[c]);
+      }
+    }
+
+    __m256d l = _mm256_mul_pd(b[0], b[0]);
+    l = _mm256_fmadd_pd(b[1], b[1], l);
+    l = _mm256_fmadd_pd(b[2], b[2], l);
+    l = _mm256_fmadd_pd(b[3], b[3], l);
+    __m256d r = _mm256_div_pd(_mm256_set1_pd(1.0), _mm256_sqrt_pd(l));
+    for (int c = 0; c < 8; c++) b[c] = _mm256_mul_pd(b[c], r);
+
+    if (nrm) {
+      __m256d x, y, z;
+      load3_avx2(nrm + 3 * i, x, y, z);
+      rotate_avx2(b[0], b[1], b[2], b[3], x, y, z);
+      store3_avx2(on + 3 * i, x, y, z);
+    }
+
+    if (p) {
+      // translation, 2 d r*
+      __m256d tx = _mm256_fmsub_pd(b[3], b[4], _mm256_mul_pd(b[7], b[0]));
+      __m256d ty = _mm256_fmsub_pd(b[3], b[5], _mm256_mul_pd(b[7], b[1]));
+      __m256d tz = _mm256_fmsub_pd(b[3], b[6], _mm256_mul_pd(b[7], b[2]));
+      tx = _mm256_add_pd(tx, _mm256_fmsub_pd(b[1], b[6],
+                                             _mm256_mul_pd(b[2], b[5])));
+      ty = _mm256_add_pd(ty, _mm256_fmsub_pd(b[2], b[4],
+                                             _mm256_mul_pd(b[0], b[6])));
+      tz = _mm256_add_pd(tz, _mm256_fmsub_pd(b[0], b[5],
+                                             _mm256_mul_pd(b[1], b[4])));
+
+      __m256d x, y, z;
+      load3_avx2(p + 3 * i, x, y, z);
+      rotate_avx2(b[0], b[1], b[2], b[3], x, y, z);
+      store3_avx2(op + 3 * i, _mm256_fmadd_pd(two, tx, x),
+                  _mm256_fmadd_pd(two, ty, y), _mm256_fmadd_pd(two, tz, z));
+    }
+  }
+  dq_scalar(i, n, pal, f, p, nrm, op, on);
+}
+
+CMU462_TARGET_AVX2
+static void lbs_avx2(size_t i, size_t n, const double *pal,
+                     const SkinInfluences &f, const double *p,
+                     const double *nrm, double *op, double *on) {
+  for (; i + 4 <= n; i += 4) {
+    // rows 0-2 of the blended matrices, column major
+    __m256d m[12];
+    for (int k = 0; k < 4; k++) {
+      // offsets of the four matrices, in doubles
+      __m128i idx = _mm_slli_epi32(
+          _mm_loadu_si128((const __m128i *)(f.index[k] + i)), 4);
+      __m256d w = _mm256_loadu_pd(f.weight[k] + i);
+      for (int j = 0; j < 4; j++) {
+        for (int r = 0; r < 3; r++) {
+          __m256d e = gather_avx2(pal + 4 * j + r, idx);
+          m[3 * j + r] =
+              k ? _mm256_fmadd_pd(w, e, m[3 * j + r]) : _mm256_mul_pd(w, e);
+        }
+      }
+    }
+
+    __m256d x, y, z;
+    if (p) {
+      load3_avx2(p + 3 * i, x, y, z);
+      __m256d ox = _mm256_fmadd_pd(m[0], x, m[9]);
+      __m256d oy = _mm256_fmadd_pd(m[1], x, m[10]);
+      __m256d oz = _mm256_fmadd_pd(m[2], x, m[11]);
+      ox = _mm256_fmadd_pd(m[3], y, _mm256_fmadd_pd(m[6], z, ox));
+      oy = _mm256_fmadd_pd(m[4], y, _mm256_fmadd_pd(m[7], z, oy));
+      oz = _mm256_fmadd_pd(m[5], y, _mm256_fmadd_pd(m[8], z, oz));
+      store3_avx2(op + 3 * i, ox, oy, oz);
+    }
+    if (nrm) {
+      load3_avx2(nrm + 3 * i, x, y, z);
+      __m256d ox = _mm256_mul_pd(m[0], x);
+      __m256d oy = _mm256_mul_pd(m[1], x);
+      __m256d oz = _mm256_mul_pd(m[2], x);
+      ox = _mm256_fmadd_pd(m[3], y, _mm256_fmadd_pd(m[6], z, ox));
+      oy = _mm256_fmadd_pd(m[4], y, _mm256_fmadd_pd(m[7], z, oy));
+      oz = _mm256_fmadd_pd(m[5], y, _mm256_fmadd_pd(m[8], z, oz));
+      store3_avx2(on + 3 * i, ox, oy, oz);
+    }
+  }
+  lbs_scalar(i, n, pal, f, p, nrm, op, on);
+}
+#endif
+
+// drivers //
+
+typedef void (*SkinKernel)(size_t i, size_t n, const double *pal,
+                           const SkinInfluences &f, const double *p,
+                           const double *nrm, double *op, double *on);
+
+// Vertices per block; blocks are skinned in parallel.
+static const size_t kSkinBlock = 4096;
+
+static void skin(SkinKernel kernel, const double *pal,
+                 const SkinInfluences &f, const Vector3D *points,
+                 const Vector3D *normals, Vector3D *outPoints,
+                 Vector3D *outNormals, size_t n) {
+  const double *p = (const double *)points;
+  const double *nrm = outNormals ? (const double *)normals : NULL;
+
+  long blocks = (long)((n + kSkinBlock - 1) / kSkinBlock);
+#pragma omp parallel for if (blocks > 1)
+  for (long b = 0; b < blocks; b++) {
+    size_t i = b * kSkinBlock;
+    kernel(i, min(n, i + kSkinBlock), pal, f, p, nrm, (double *)outPoints,
+           (double *)outNormals);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Skinning
+//------------------------------------------------------------------------------
+
+void skinDualQuaternion(const DualQuaternion *palette,
+                        const SkinInfluences &influences,
+                        const Vector3D *points, const Vector3D *normals,
+                        Vector3D *outPoints, Vector3D *outNormals, size_t n) {
+  SkinKernel kernel = dq_scalar;
+#ifdef CMU462_AVX2
+  if (SIMD::hasAVX2()) kernel = dq_avx2;
+#endif
+  skin(kernel, (const double *)palette, influences, points, normals,
+       outPoints, outNormals, n);
+}
+
+void skinLinear(const Matrix4x4 *palette, const SkinInfluences &influences,
+                const Vector3D *points, const Vector3D *normals,
+                Vector3D *outPoints, Vector3D *outNormals, size_t n) {
+  SkinKernel kernel = lbs_scalar;
+#ifdef CMU462_AVX2
+  if (SIMD::hasAVX2()) kernel = lbs_avx2;
+#endif
+  skin(kernel, (const double *)palette, influences, points, normals,
+       outPoints, outNormals, n);
+}
+
+} // namespace CMU462
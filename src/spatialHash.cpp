@@ -0,0 +1,159 @@
+#include "spatialHash.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace CMU462 {
+
+// Particles (or buckets) per block of the parallel loops.
+static const size_t kParticleBlock = 16384;
+
+// inclusive prefix sum of a, by blocks
+template <typename T>
+static void prefixSum(T *a, size_t n) {
+  long blocks = (long)((n + kParticleBlock - 1) / kParticleBlock);
+  vector<T> sums(blocks + 1, 0);
+#pragma omp parallel for if (blocks > 1)
+  for (long b = 0; b < blocks; b++) {
+    size_t end = min(n, (b + 1) * kParticleBlock);
+    T sum = 0;
+    for (size_t i = b * kParticleBlock; i < end; i++) sum = a[i] += sum;
+    sums[b + 1] = sum;
+  }
+  for (long b = 0; b < blocks; b++) sums[b + 1] += sums[b];
+#pragma omp parallel for if (blocks > 1)
+  for (long b = 1; b < blocks; b++) {
+    size_t end = min(n, (b + 1) * kParticleBlock);
+    for (size_t i = b * kParticleBlock; i < end; i++) a[i] += sums[b];
+  }
+}
+
+//------------------------------------------------------------------------------
+// Build
+//
+// Counting sort: each particle takes the next rank in its bucket, the
+// counts become bucket offsets through a prefix sum, and each particle
+// goes to the offset of its bucket plus its rank. The ranks depend on the
+// order in which threads reach a bucket, so each bucket is then sorted by
+// particle index.
+//------------------------------------------------------------------------------
+
+void SpatialHash::build(const Vector3D *positions, size_t n) {
+  bits = 1;
+  while (((size_t)1 << bits) < 2 * n) bits++;
+  size_t buckets = (size_t)1 << bits;
+
+  start.assign(buckets + 1, 0);
+  order.resize(n);
+  slot.resize(n);
+  sorted.resize(n);
+  cells.resize(n);
+
+  // count into start[b + 1], ranks into slot
+#pragma omp parallel for if (n > kParticleBlock)
+  for (long i = 0; i < (long)n; i++) {
+    size_t b = bucket(cellKey(positions[i]));
+    uint32_t rank;
+#pragma omp atomic capture
+    rank = start[b + 1]++;
+    slot[i] = rank;
+  }
+
+  prefixSum(&start[1], buckets);
+
+#pragma omp parallel for if (n > kParticleBlock)
+  for (long i = 0; i < (long)n; i++) {
+    size_t b = bucket(cellKey(positions[i]));
+    order[start[b] + slot[i]] = (uint32_t)i;
+  }
+
+#pragma omp parallel for if (buckets > kParticleBlock)
+  for (long b = 0; b < (long)buckets; b++) {
+    if (start[b + 1] - start[b] > 1)
+      sort(order.begin() + start[b], order.begin() + start[b + 1]);
+  }
+
+#pragma omp parallel for if (n > kParticleBlock)
+  for (long s = 0; s < (long)n; s++) {
+    uint32_t i = order[s];
+    slot[i] = (uint32_t)s;
+    sorted[s] = positions[i];
+    cells[s] = cellKey(positions[i]);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Queries
+//
+// The lists are filled in two passes, counting and then writing, so that
+// they need no memory beyond the output.
+//------------------------------------------------------------------------------
+
+size_t SpatialHash::neighbors(const Vector3D &q, double r,
+                              vector<uint32_t> &indices) const {
+  indices.clear();
+  forEachNeighbor(q, r, [&](uint32_t j, double) { indices.push_back(j); });
+  return indices.size();
+}
+
+void SpatialHash::neighborLists(double r, vector<size_t> &offsets,
+                                vector<uint32_t> &indices) const {
+  size_t n = order.size();
+  offsets.assign(n + 1, 0);
+
+  // visit the particles in slot order, cell by cell
+#pragma omp parallel for if (n > kParticleBlock)
+  for (long s = 0; s < (long)n; s++) {
+    uint32_t i = order[s];
+    size_t count = 0;
+    forEachNeighbor(sorted[s], r, [&](uint32_t j, double) {
+      if (j != i) count++;
+    });
+    offsets[i + 1] = count;
+  }
+
+  prefixSum(&offsets[1], n);
+  indices.resize(offsets[n]);
+
+#pragma omp parallel for if (n > kParticleBlock)
+  for (long s = 0; s < (long)n; s++) {
+    uint32_t i = order[s];
+    size_t k = offsets[i];
+    forEachNeighbor(sorted[s], r, [&](uint32_t j, double) {
+      if (j != i) indices[k++] = j;
+    });
+  }
+}
+
+void SpatialHash::pairs(double r, vector<uint32_t> &pairs) const {
+  size_t n = order.size();
+  vector<size_t> offsets(n + 1, 0);
+
+#pragma omp parallel for if (n > kParticleBlock)
+  for (long s = 0; s < (long)n; s++) {
+    uint32_t i = order[s];
+    size_t count = 0;
+    forEachNeighbor(sorted[s], r, [&](uint32_t j, double) {
+      if (j > i) count++;
+    });
+    offsets[i + 1] = count;
+  }
+
+  prefixSum(&offsets[1], n);
+  pairs.resize(2 * offsets[n]);
+
+#pragma omp parallel for if (n > kParticleBlock)
+  for (long s = 0; s < (long)n; s++) {
+    uint32_t i = order[s];
+    size_t k = 2 * offsets[i];
+    forEachNeighbor(sorted[s], r, [&](uint32_t j, double) {
+      if (j > i) {
+        pairs[k++] = i;
+        pairs[k++] = j;
+      }
+    });
+  }
+}
+
+} // namespace CMU462
@@ -0,0 +1,807 @@
+#include "tonemap.h"
+#include "simd.h"
+
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+
+namespace CMU462 {
+
+static_assert(sizeof(Spectrum) == 3 * sizeof(float),
+              "Spectrum must be 3 floats");
+static_assert(sizeof(Color) == 4 * sizeof(float), "Color must be 4 floats");
+
+//------------------------------------------------------------------------------
+// Approximations
+//
+// log2 splits off the exponent and evaluates the series of
+// 2 atanh((m - 1) / (m + 1)) / ln 2 for the mantissa m in [sqrt(1/2),
+// sqrt(2)); exp2 splits off the nearest integer and evaluates the Taylor
+// series of 2^f for |f| <= 1/2. Both are accurate to a few float ulps,
+// and the vector versions below perform the same operations.
+//------------------------------------------------------------------------------
+
+static const float kLog2C1 = 2.8853900817779268f; // 2 / ln 2
+static const float kLog2C3 = 0.9617966939259756f; // 2 / (3 ln 2)
+static const float kLog2C5 = 0.5770780163555854f; // 2 / (5 ln 2)
+static const float kLog2C7 = 0.4121985831111324f; // 2 / (7 ln 2)
+
+static const float kExp2C1 = 0.6931471805599453f; // ln 2^k / k!
+static const float kExp2C2 = 0.2402265069591007f;
+static const float kExp2C3 = 0.0555041086648216f;
+static const float kExp2C4 = 0.0096181291076285f;
+static const float kExp2C5 = 0.0013333558146428f;
+static const float kExp2C6 = 0.0001540353039338f;
+
+// log2(x) for normal x > 0
+static inline float log2Approx(float x) {
+  uint32_t bits;
+  memcpy(&bits, &x, 4);
+  int e = (int)(bits >> 23) - 127;
+  bits = (bits & 0x7FFFFF) | 0x3F800000;
+  float m;
+  memcpy(&m, &bits, 4);
+  if (m > 1.41421356f) {
+    m *= 0.5f;
+    e++;
+  }
+  float t = (m - 1) / (m + 1), t2 = t * t;
+  float p = ((kLog2C7 * t2 + kLog2C5) * t2 + kLog2C3) * t2 + kLog2C1;
+  return (float)e + t * p;
+}
+
+// 2^y for -126 <= y <= 127
+static inline float exp2Approx(float y) {
+  int i = (int)lrintf(y);
+  float f = y - (float)i;
+  float p = ((((kExp2C6 * f + kExp2C5) * f + kExp2C4) * f + kExp2C3) * f +
+             kExp2C2) * f + kExp2C1;
+  p = p * f + 1;
+  uint32_t bits;
+  memcpy(&bits, &p, 4);
+  bits += (uint32_t)i << 23;
+  memcpy(&p, &bits, 4);
+  return p;
+}
+
+static inline float encodeApprox(float c) {
+  if (c <= 0.0031308f) return 12.92f * c;
+  return 1.055f * exp2Approx(log2Approx(c) * (1 / 2.4f)) - 0.055f;
+}
+
+static inline float decodeApprox(float c) {
+  if (c <= 0.04045f) return c * (1 / 12.92f);
+  return exp2Approx(log2Approx((c + 0.055f) * (1 / 1.055f)) * 2.4f);
+}
+
+#ifdef CMU462_SSE2
+static inline __m128 log2_sse2(__m128 x) {
+  const __m128 one = _mm_set1_ps(1.0f);
+  __m128i bits = _mm_castps_si128(x);
+  __m128i e = _mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127));
+  __m128 m = _mm_castsi128_ps(
+      _mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x7FFFFF)),
+                   _mm_set1_epi32(0x3F800000)));
+  __m128 big = _mm_cmpgt_ps(m, _mm_set1_ps(1.41421356f));
+  m = _mm_or_ps(_mm_and_ps(big, _mm_mul_ps(m, _mm_set1_ps(0.5f))),
+                _mm_andnot_ps(big, m));
+  e = _mm_sub_epi32(e, _mm_castps_si128(big));
+  __m128 t = _mm_div_ps(_mm_sub_ps(m, one), _mm_add_ps(m, one));
+  __m128 t2 = _mm_mul_ps(t, t);
+  __m128 p = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(kLog2C7), t2),
+                        _mm_set1_ps(kLog2C5));
+  p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(kLog2C3));
+  p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(kLog2C1));
+  return _mm_add_ps(_mm_cvtepi32_ps(e), _mm_mul_ps(t, p));
+}
+
+static inline __m128 exp2_sse2(__m128 y) {
+  __m128i i = _mm_cvtps_epi32(y);
+  __m128 f = _mm_sub_ps(y, _mm_cvtepi32_ps(i));
+  __m128 p = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(kExp2C6), f),
+                        _mm_set1_ps(kExp2C5));
+  p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(kExp2C4));
+  p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(kExp2C3));
+  p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(kExp2C2));
+  p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(kExp2C1));
+  p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.0f));
+  return _mm_castsi128_ps(
+      _mm_add_epi32(_mm_castps_si128(p), _mm_slli_epi32(i, 23)));
+}
+
+static inline __m128 encode_sse2(__m128 c) {
+  __m128 lin = _mm_mul_ps(c, _mm_set1_ps(12.92f));
+  __m128 p = exp2_sse2(_mm_mul_ps(log2_sse2(c), _mm_set1_ps(1 / 2.4f)));
+  p = _mm_sub_ps(_mm_mul_ps(p, _mm_set1_ps(1.055f)), _mm_set1_ps(0.055f));
+  __m128 low = _mm_cmple_ps(c, _mm_set1_ps(0.0031308f));
+  return _mm_or_ps(_mm_and_ps(low, lin), _mm_andnot_ps(low, p));
+}
+
+static inline __m128 decode_sse2(__m128 c) {
+  __m128 lin = _mm_mul_ps(c, _mm_set1_ps(1 / 12.92f));
+  __m128 x = _mm_mul_ps(_mm_add_ps(c, _mm_set1_ps(0.055f)),
+                        _mm_set1_ps(1 / 1.055f));
+  __m128 p = exp2_sse2(_mm_mul_ps(log2_sse2(x), _mm_set1_ps(2.4f)));
+  __m128 low = _mm_cmple_ps(c, _mm_set1_ps(0.04045f));
+  return _mm_or_ps(_mm_and_ps(low, lin), _mm_andnot_ps(low, p));
+}
+#endif
+
+#ifdef CMU462_AVX2
+CMU462_TARGET_AVX2
+static inline __m256 log2_avx2(__m256 x) {
+  const __m256 one = _mm256_set1_ps(1.0f);
+  __m256i bits = _mm256_castps_si256(x);
+  __m256i e = _mm256_sub_epi32(_mm256_srli_epi32(bits, 23),
+                               _mm256_set1_epi32(127));
+  __m256 m = _mm256_castsi256_ps(
+      _mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x7FFFFF)),
+                      _mm256_set1_epi32(0x3F800000)));
+  __m256 big = _mm256_cmp_ps(m, _mm256_set1_ps(1.41421356f), _CMP_GT_OQ);
+  m = _mm256_blendv_ps(m, _mm256_mul_ps(m, _mm256_set1_ps(0.5f)), big);
+  e = _mm256_sub_epi32(e, _mm256_castps_si256(big));
+  __m256 t = _mm256_div_ps(_mm256_sub_ps(m, one), _mm256_add_ps(m, one));
+  __m256 t2 = _mm256_mul_ps(t, t);
+  __m256 p = _mm256_fmadd_ps(_mm256_set1_ps(kLog2C7), t2,
+                             _mm256_set1_ps(kLog2C5));
+  p = _mm256_fmadd_ps(p, t2, _mm256_set1_ps(kLog2C3));
+  p = _mm256_fmadd_ps(p, t2, _mm256_set1_ps(kLog2C1));
+  return _mm256_fmadd_ps(t, p, _mm256_cvtepi32_ps(e));
+}
+
+CMU462_TARGET_AVX2
+static inline __m256 exp2_avx2(__m256 y) {
+  __m256i i = _mm256_cvtps_epi32(y);
+  __m256 f = _mm256_sub_ps(y, _mm256_cvtepi32_ps(i));
+  __m256 p = _mm256_fmadd_ps(_mm256_set1_ps(kExp2C6), f,
+                             _mm256_set1_ps(kExp2C5));
+  p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(kExp2C4));
+  p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(kExp2C3));
+  p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(kExp2C2));
+  p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(kExp2C1));
+  p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(1.0f));
+  return _mm256_castsi256_ps(
+      _mm256_add_epi32(_mm256_castps_si256(p), _mm256_slli_epi32(i, 23)));
+}
+
+CMU462_TARGET_AVX2
+static inline __m256 encode_avx2(__m256 c) {
+  __m256 lin = _mm256_mul_ps(c, _mm256_set1_ps(12.92f));
+  __m256 p = exp2_avx2(_mm256_mul_ps(log2_avx2(c), _mm256_set1_ps(1 / 2.4f)));
+  p = _mm256_fmsub_ps(p, _mm256_set1_ps(1.055f), _mm256_set1_ps(0.055f));
+  __m256 low = _mm256_cmp_ps(c, _mm256_set1_ps(0.0031308f), _CMP_LE_OQ);
+  return _mm256_blendv_ps(p, lin, low);
+}
+
+CMU462_TARGET_AVX2
+static inline __m256 decode_avx2(__m256 c) {
+  __m256 lin = _mm256_mul_ps(c, _mm256_set1_ps(1 / 12.92f));
+  __m256 x = _mm256_mul_ps(_mm256_add_ps(c, _mm256_set1_ps(0.055f)),
+                           _mm256_set1_ps(1 / 1.055f));
+  __m256 p = exp2_avx2(_mm256_mul_ps(log2_avx2(x), _mm256_set1_ps(2.4f)));
+  __m256 low = _mm256_cmp_ps(c, _mm256_set1_ps(0.04045f), _CMP_LE_OQ);
+  return _mm256_blendv_ps(p, lin, low);
+}
+#endif
+
+//------------------------------------------------------------------------------
+// 8-bit encoding
+//
+// The 8-bit encodings interpolate a table instead: a float in [2^-13, 1)
+// falls in the segment given by its exponent and the top kSegmentBits bits
+// of its mantissa, and the remaining bits are the offset within it, on
+// which 255 times the encoding is nearly linear. Below 2^-13 the encoding
+// is linear and computed directly.
+//------------------------------------------------------------------------------
+
+static const int kSegmentBits = 7;
+static const int kOffsetBits = 23 - kSegmentBits;
+static const uint32_t kOffsetMask = (1u << kOffsetBits) - 1;
+static const int kSegments = 13 << kSegmentBits;
+static const uint32_t kTableMinBits = 0x39000000; // 2^-13
+static const uint32_t kBelowOneBits = 0x3F7FFFFF; // largest float below 1
+static const float kTableMin = 1.0f / 8192;
+static const float kLinearScale = 12.92f * 255;
+
+// 255 times the encoding of c, exactly
+static double encodeScaledExact(double c) {
+  return 255 * (c <= 0.0031308 ? 12.92 * c : 1.055 * pow(c, 1 / 2.4) - 0.055);
+}
+
+// the line of each segment, 255 times the encoding at offset u being
+// bias + scale * u
+struct SrgbEncodeTable {
+  float bias[kSegments], scale[kSegments];
+
+  SrgbEncodeTable() {
+    const int samples = 16;
+    for (int i = 0; i < kSegments; i++) {
+      int e = (i >> kSegmentBits) - 13, m = i & ((1 << kSegmentBits) - 1);
+      double lo = ldexp(1 + ldexp(m, -kSegmentBits), e);
+      double ulp = ldexp(1, e - 23);
+      double f0 = encodeScaledExact(lo);
+      double slope =
+          (encodeScaledExact(lo + ulp * (1 << kOffsetBits)) - f0) /
+          (1 << kOffsetBits);
+      // the curve is concave, so the chord lies below it: raise the line
+      // by half the largest gap
+      double gap = 0;
+      for (int k = 1; k < samples; k++) {
+        double u = (double)k / samples * (1 << kOffsetBits);
+        gap = max(gap, encodeScaledExact(lo + ulp * u) - (f0 + slope * u));
+      }
+      bias[i] = (float)(f0 + gap / 2);
+      scale[i] = (float)slope;
+    }
+  }
+};
+
+static const SrgbEncodeTable &encodeTable() {
+  static const SrgbEncodeTable table;
+  return table;
+}
+
+// 255 times the encoding of c clamped to [0, 1]
+static inline float encodeScaled(float c, const SrgbEncodeTable &t) {
+  c = c > 0 ? c : 0;
+  uint32_t bits;
+  memcpy(&bits, &c, 4);
+  bits = bits < kBelowOneBits ? bits : kBelowOneBits;
+  if (bits < kTableMinBits) return c * kLinearScale;
+  uint32_t i = (bits - kTableMinBits) >> kOffsetBits;
+  return t.bias[i] + t.scale[i] * (float)(int)(bits & kOffsetMask);
+}
+
+#ifdef CMU462_SSE2
+static inline __m128 encodeScaled_sse2(__m128 c, const SrgbEncodeTable &t) {
+  c = _mm_min_ps(_mm_max_ps(c, _mm_setzero_ps()),
+                 _mm_castsi128_ps(_mm_set1_epi32(kBelowOneBits)));
+  __m128i bits = _mm_castps_si128(c);
+  __m128 low = _mm_cmplt_ps(c, _mm_set1_ps(kTableMin));
+  __m128i i = _mm_srli_epi32(
+      _mm_sub_epi32(bits, _mm_set1_epi32(kTableMinBits)), kOffsetBits);
+  i = _mm_andnot_si128(_mm_castps_si128(low), i);
+
+  // no gather before AVX2: the segments are read one by one
+  uint32_t k[4];
+  _mm_storeu_si128((__m128i *)k, i);
+  __m128 bias = _mm_setr_ps(t.bias[k[0]], t.bias[k[1]], t.bias[k[2]],
+                            t.bias[k[3]]);
+  __m128 scale = _mm_setr_ps(t.scale[k[0]], t.scale[k[1]], t.scale[k[2]],
+                             t.scale[k[3]]);
+  __m128 u = _mm_cvtepi32_ps(_mm_and_si128(bits, _mm_set1_epi32(kOffsetMask)));
+  __m128 v = _mm_add_ps(bias, _mm_mul_ps(scale, u));
+  __m128 lin = _mm_mul_ps(c, _mm_set1_ps(kLinearScale));
+  return _mm_or_ps(_mm_and_ps(low, lin), _mm_andnot_ps(low, v));
+}
+#endif
+
+#ifdef CMU462_AVX2
+CMU462_TARGET_AVX2
+static inline __m256 encodeScaled_avx2(__m256 c, const SrgbEncodeTable &t) {
+  c = _mm256_min_ps(_mm256_max_ps(c, _mm256_setzero_ps()),
+                    _mm256_castsi256_ps(_mm256_set1_epi32(kBelowOneBits)));
+  __m256i bits = _mm256_castps_si256(c);
+  __m256i i = _mm256_max_epi32(bits, _mm256_set1_epi32(kTableMinBits));
+  i = _mm256_srli_epi32(_mm256_sub_epi32(i, _mm256_set1_epi32(kTableMinBits)),
+                        kOffsetBits);
+  __m256 bias = _mm256_i32gather_ps(t.bias, i, 4);
+  __m256 scale = _mm256_i32gather_ps(t.scale, i, 4);
+  __m256 u = _mm256_cvtepi32_ps(
+      _mm256_and_si256(bits, _mm256_set1_epi32(kOffsetMask)));
+  __m256 v = _mm256_add_ps(bias, _mm256_mul_ps(scale, u));
+  __m256 lin = _mm256_mul_ps(c, _mm256_set1_ps(kLinearScale));
+  __m256 low = _mm256_cmp_ps(c, _mm256_set1_ps(kTableMin), _CMP_LT_OQ);
+  return _mm256_blendv_ps(v, lin, low);
+}
+#endif
+
+//------------------------------------------------------------------------------
+// Conversion kernels
+//
+// Each kernel converts components [i, n) and leaves the tail to the
+// scalar kernel.
+//------------------------------------------------------------------------------
+
+static void decode_scalar(size_t i, size_t n, const float *in, float *out) {
+  for (; i < n; i++) out[i] = decodeApprox(in[i]);
+}
+
+static void encode_scalar(size_t i, size_t n, const float *in, float *out) {
+  for (; i < n; i++) out[i] = encodeApprox(in[i]);
+}
+
+static void encode8_scalar(size_t i, size_t n, const float *in,
+                           uint8_t *out) {
+  const SrgbEncodeTable &t = encodeTable();
+  for (; i < n; i++) out[i] = (uint8_t)(int)(encodeScaled(in[i], t) + 0.5f);
+}
+
+#ifdef CMU462_SSE2
+static void decode_sse2(size_t i, size_t n, const float *in, float *out) {
+  for (; i + 4 <= n; i += 4)
+    _mm_storeu_ps(out + i, decode_sse2(_mm_loadu_ps(in + i)));
+  decode_scalar(i, n, in, out);
+}
+
+static void encode_sse2(size_t i, size_t n, const float *in, float *out) {
+  for (; i + 4 <= n; i += 4)
+    _mm_storeu_ps(out + i, encode_sse2(_mm_loadu_ps(in + i)));
+  encode_scalar(i, n, in, out);
+}
+
+// four components to 8 bits, in the low byte of 32-bit lanes
+static inline __m128i encode8_sse2(__m128 c, __m128 threshold,
+                                   const SrgbEncodeTable &t) {
+  return _mm_cvttps_epi32(_mm_add_ps(encodeScaled_sse2(c, t), threshold));
+}
+
+static void encode8_sse2(size_t i, size_t n, const float *in, uint8_t *out) {
+  const SrgbEncodeTable &t = encodeTable();
+  const __m128 half = _mm_set1_ps(0.5f);
+  for (; i + 16 <= n; i += 16) {
+    __m128i a = encode8_sse2(_mm_loadu_ps(in + i), half, t);
+    __m128i b = encode8_sse2(_mm_loadu_ps(in + i + 4), half, t);
+    __m128i c = encode8_sse2(_mm_loadu_ps(in + i + 8), half, t);
+    __m128i d = encode8_sse2(_mm_loadu_ps(in + i + 12), half, t);
+    __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(a, b),
+                                     _mm_packs_epi32(c, d));
+    _mm_storeu_si128((__m128i *)(out + i), bytes);
+  }
+  encode8_scalar(i, n, in, out);
+}
+#endif
+
+#ifdef CMU462_AVX2
+CMU462_TARGET_AVX2
+static void decode_avx2(size_t i, size_t n, const float *in, float *out) {
+  for (; i + 8 <= n; i += 8)
+    _mm256_storeu_ps(out + i, decode_avx2(_mm256_loadu_ps(in + i)));
+  decode_scalar(i, n, in, out);
+}
+
+CMU462_TARGET_AVX2
+static void encode_avx2(size_t i, size_t n, const float *in, float *out) {
+  for (; i + 8 <= n; i += 8)
+    _mm256_storeu_ps(out + i, encode_avx2(_mm256_loadu_ps(in + i)));
+  encode_scalar(i, n, in, out);
+}
+
+// eight components to 8 bits, in the low byte of 32-bit lanes
+CMU462_TARGET_AVX2
+static inline __m256i encode8_avx2(__m256 c, __m256 threshold,
+                                   const SrgbEncodeTable &t) {
+  return _mm256_cvttps_epi32(
+      _mm256_add_ps(encodeScaled_avx2(c, t), threshold));
+}
+
+CMU462_TARGET_AVX2
+static void encode8_avx2(size_t i, size_t n, const float *in, uint8_t *out) {
+  const SrgbEncodeTable &t = encodeTable();
+  const __m256 half = _mm256_set1_ps(0.5f);
+  for (; i + 32 <= n; i += 32) {
+    __m256i a = encode8_avx2(_mm256_loadu_ps(in + i), half, t);
+    __m256i b = encode8_avx2(_mm256_loadu_ps(in + i + 8), half, t);
+    __m256i c = encode8_avx2(_mm256_loadu_ps(in + i + 16), half, t);
+    __m256i d = encode8_avx2(_mm256_loadu_ps(in + i + 24), half, t);
+    // the packs work within 128-bit lanes, the permute restores the order
+    __m256i bytes = _mm256_packus_epi16(_mm256_packs_epi32(a, b),
+                                        _mm256_packs_epi32(c, d));
+    bytes = _mm256_permutevar8x32_epi32(
+        bytes, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+    _mm256_storeu_si256((__m256i *)(out + i), bytes);
+  }
+  encode8_scalar(i, n, in, out);
+}
+#endif
+
+// drivers //
+
+// Components per block; blocks are converted in parallel.
+static const size_t kSrgbBlock = 16384;
+
+template <typename In, typename Out>
+static void convert(void (*kernel)(size_t, size_t, const In *, Out *),
+                    const In *in, Out *out, size_t n) {
+  long blocks = (long)((n + kSrgbBlock - 1) / kSrgbBlock);
+#pragma omp parallel for if (blocks > 1)
+  for (long b = 0; b < blocks; b++) {
+    size_t i = b * kSrgbBlock;
+    kernel(i, min(n, i + kSrgbBlock), in, out);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Conversions
+//------------------------------------------------------------------------------
+
+void srgbToLinear(const float *in, float *out, size_t n) {
+  void (*kernel)(size_t, size_t, const float *, float *) = decode_scalar;
+#ifdef CMU462_SSE2
+  if (SIMD::hasSSE2()) kernel = decode_sse2;
+#endif
+#ifdef CMU462_AVX2
+  if (SIMD::hasAVX2()) kernel = decode_avx2;
+#endif
+  convert(kernel, in, out, n);
+}
+
+void linearToSrgb(const float *in, float *out, size_t n) {
+  void (*kernel)(size_t, size_t, const float *, float *) = encode_scalar;
+#ifdef CMU462_SSE2
+  if (SIMD::hasSSE2()) kernel = encode_sse2;
+#endif
+#ifdef CMU462_AVX2
+  if (SIMD::hasAVX2()) kernel = encode_avx2;
+#endif
+  convert(kernel, in, out, n);
+}
+
+// the linear value of every 8-bit sRGB code
+struct SrgbTable {
+  float linear[256];
+
+  SrgbTable() {
+    for (int i = 0; i < 256; i++) linear[i] = srgbToLinear(i / 255.0f);
+  }
+};
+
+void srgbToLinear(const uint8_t *in, float *out, size_t n) {
+  static const SrgbTable table;
+  long blocks = (long)((n + kSrgbBlock - 1) / kSrgbBlock);
+#pragma omp parallel for if (blocks > 1)
+  for (long b = 0; b < blocks; b++) {
+    size_t end = min(n, (b + 1) * kSrgbBlock);
+    for (size_t i = b * kSrgbBlock; i < end; i++)
+      out[i] = table.linear[in[i]];
+  }
+}
+
+void linearToSrgb(const float *in, uint8_t *out, size_t n) {
+  void (*kernel)(size_t, size_t, const float *, uint8_t *) = encode8_scalar;
+#ifdef CMU462_SSE2
+  if (SIMD::hasSSE2()) kernel = encode8_sse2;
+#endif
+#ifdef CMU462_AVX2
+  if (SIMD::hasAVX2()) kernel = encode8_avx2;
+#endif
+  convert(kernel, in, out, n);
+}
+
+//------------------------------------------------------------------------------
+// Log-average illumination
+//------------------------------------------------------------------------------
+
+// Pixels per chunk, whose logarithms are summed in float.
+static const size_t kLogChunk = 256;
+
+static float log2Sum_scalar(const float *v, size_t n) {
+  float sum = 0;
+  for (size_t i = 0; i < n; i++) sum += log2Approx(v[i]);
+  return sum;
+}
+
+#ifdef CMU462_SSE2
+static float log2Sum_sse2(const float *v, size_t n) {
+  __m128 sum = _mm_setzero_ps();
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    sum = _mm_add_ps(sum, log2_sse2(_mm_loadu_ps(v + i)));
+  float lanes[4];
+  _mm_storeu_ps(lanes, sum);
+  return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) +
+         log2Sum_scalar(v + i, n - i);
+}
+#endif
+
+#ifdef CMU462_AVX2
+CMU462_TARGET_AVX2
+static float log2Sum_avx2(const float *v, size_t n) {
+  __m256 sum = _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+    sum = _mm256_add_ps(sum, log2_avx2(_mm256_loadu_ps(v + i)));
+  float lanes[8];
+  _mm256_storeu_ps(lanes, sum);
+  return ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) +
+         ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7])) +
+         log2Sum_scalar(v + i, n - i);
+}
+#endif
+
+float logAverageIllum(const Spectrum *in, size_t n, float delta) {
+  if (!n) return delta;
+
+  float (*kernel)(const float *, size_t) = log2Sum_scalar;
+#ifdef CMU462_SSE2
+  if (SIMD::hasSSE2()) kernel = log2Sum_sse2;
+#endif
+#ifdef CMU462_AVX2
+  if (SIMD::hasAVX2()) kernel = log2Sum_avx2;
+#endif
+
+  // the blocks sum in double, and are added in order, so the result does
+  // not depend on the number of threads
+  long blocks = (long)((n + kSrgbBlock - 1) / kSrgbBlock);
+  vector<double> partial(blocks, 0.0);
+#pragma omp parallel for if (blocks > 1)
+  for (long b = 0; b < blocks; b++) {
+    size_t end = min(n, (b + 1) * kSrgbBlock);
+    float illum[kLogChunk];
+    for (size_t i = b * kSrgbBlock; i < end; i += kLogChunk) {
+      size_t m = min(kLogChunk, end - i);
+      for (size_t k = 0; k < m; k++) {
+        float y = in[i + k].illum();
+        illum[k] = delta + (y > 0 ? y : 0);
+      }
+      partial[b] += kernel(illum, m);
+    }
+  }
+
+  double sum = 0;
+  for (long b = 0; b < blocks; b++) sum += partial[b];
+  return (float)exp2(sum / n);
+}
+
+//------------------------------------------------------------------------------
+// Tone mapping
+//
+// Rows are independent, and processed in parallel. The vector kernels
+// load a group of pixels into one register per channel, so the dither
+// thresholds of a row (8 pixels wide) line up with the lanes, and store
+// them as one 32-bit RGBA value per lane.
+//------------------------------------------------------------------------------
+
+// Ordered dithering thresholds, in 64ths.
+static const int kBayer[8][8] = {
+    {0, 32, 8, 40, 2, 34, 10, 42},  {48, 16, 56, 24, 50, 18, 58, 26},
+    {12, 44, 4, 36, 14, 46, 6, 38}, {60, 28, 52, 20, 62, 30, 54, 22},
+    {3, 35, 11, 43, 1, 33, 9, 41},  {51, 19, 59, 27, 49, 17, 57, 25},
+    {15, 47, 7, 39, 13, 45, 5, 37}, {63, 31, 55, 23, 61, 29, 53, 21}};
+
+// Rows per block; blocks are tone mapped in parallel.
+static const size_t kToneBlock = 16;
+
+// the tone curve of one linear component, with the exposure, in [0, 1]
+static inline float toneCurve(float x, const ToneMapping &p) {
+  x *= p.exposure;
+  x = x > 0 ? x : 0;
+  switch (p.op) {
+  case ToneMapping::REINHARD:
+    x = x / (1 + x);
+    break;
+  case ToneMapping::ACES:
+    x = x * (2.51f * x + 0.03f) / (x * (2.43f * x + 0.59f) + 0.14f);
+    break;
+  default:
+    break;
+  }
+  return x < 1 ? x : 1;
+}
+
+static inline uint8_t alphaByte(float a) {
+  a = a > 0 ? a : 0;
+  a = a < 1 ? a : 1;
+  return (uint8_t)(int)(a * 255 + 0.5f);
+}
+
+// Tone maps pixels [x, w) of a row with the given number of channels (3
+// for Spectrum, 4 for Color) and the dither thresholds of the row.
+static void toneRow_scalar(const float *in, int channels, size_t x, size_t w,
+                           uint8_t *out, const ToneMapping &p,
+                           const float *threshold) {
+  const SrgbEncodeTable &table = encodeTable();
+  for (; x < w; x++) {
+    const float *c = in + channels * x;
+    uint8_t *o = out + 4 * x;
+    float t = threshold[x & 7];
+    for (int k = 0; k < 3; k++)
+      o[k] = (uint8_t)(int)(encodeScaled(toneCurve(c[k], p), table) + t);
+    o[3] = channels == 4 ? alphaByte(c[3]) : 255;
+  }
+}
+
+#ifdef CMU462_SSE2
+static inline __m128 toneCurve_sse2(__m128 x, const ToneMapping &p) {
+  const __m128 one = _mm_set1_ps(1.0f);
+  x = _mm_max_ps(_mm_mul_ps(x, _mm_set1_ps(p.exposure)), _mm_setzero_ps());
+  switch (p.op) {
+  case ToneMapping::REINHARD:
+    x = _mm_div_ps(x, _mm_add_ps(one, x));
+    break;
+  case ToneMapping::ACES: {
+    __m128 num = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.51f), x),
+                            _mm_set1_ps(0.03f));
+    __m128 den = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.43f), x),
+                            _mm_set1_ps(0.59f));
+    den = _mm_add_ps(_mm_mul_ps(x, den), _mm_set1_ps(0.14f));
+    x = _mm_div_ps(_mm_mul_ps(x, num), den);
+    break;
+  }
+  default:
+    break;
+  }
+  return _mm_min_ps(x, one);
+}
+
+static void toneRow_sse2(const float *in, int channels, size_t x, size_t w,
+                         uint8_t *out, const ToneMapping &p,
+                         const float *threshold) {
+  const SrgbEncodeTable &table = encodeTable();
+  for (; x + 4 <= w; x += 4) {
+    const float *c = in + channels * x;
+    __m128 r, g, b, a = _mm_set1_ps(1.0f);
+    if (channels == 3) {
+      // (r0 g0 b0 r1) (g1 b1 r2 g2) (b2 r3 g3 b3)
+      __m128 u = _mm_loadu_ps(c), v = _mm_loadu_ps(c + 4);
+      __m128 d = _mm_loadu_ps(c + 8);
+      r = _mm_shuffle_ps(_mm_shuffle_ps(u, v, _MM_SHUFFLE(2, 2, 3, 0)),
+                         _mm_shuffle_ps(v, d, _MM_SHUFFLE(1, 1, 2, 2)),
+                         _MM_SHUFFLE(2, 0, 1, 0));
+      g = _mm_shuffle_ps(_mm_shuffle_ps(u, v, _MM_SHUFFLE(0, 0, 0, 1)),
+                         _mm_shuffle_ps(v, d, _MM_SHUFFLE(2, 2, 3, 3)),
+                         _MM_SHUFFLE(2, 0, 2, 0));
+      b = _mm_shuffle_ps(_mm_shuffle_ps(u, v, _MM_SHUFFLE(1, 1, 2, 2)),
+                         _mm_shuffle_ps(d, d, _MM_SHUFFLE(3, 3, 0, 0)),
+                         _MM_SHUFFLE(2, 0, 2, 0));
+    } else {
+      r = _mm_loadu_ps(c);
+      g = _mm_loadu_ps(c + 4);
+      b = _mm_loadu_ps(c + 8);
+      a = _mm_loadu_ps(c + 12);
+      _MM_TRANSPOSE4_PS(r, g, b, a);
+    }
+
+    __m128 t = _mm_loadu_ps(threshold + (x & 7));
+    __m128i rgba = encode8_sse2(toneCurve_sse2(r, p), t, table);
+    rgba = _mm_or_si128(
+        rgba, _mm_slli_epi32(encode8_sse2(toneCurve_sse2(g, p), t, table), 8));
+    rgba = _mm_or_si128(
+        rgba,
+        _mm_slli_epi32(encode8_sse2(toneCurve_sse2(b, p), t, table), 16));
+    __m128 alpha = _mm_min_ps(_mm_max_ps(a, _mm_setzero_ps()),
+                              _mm_set1_ps(1.0f));
+    alpha = _mm_add_ps(_mm_mul_ps(alpha, _mm_set1_ps(255.0f)),
+                       _mm_set1_ps(0.5f));
+    rgba = _mm_or_si128(rgba, _mm_slli_epi32(_mm_cvttps_epi32(alpha), 24));
+    _mm_storeu_si128((__m128i *)(out + 4 * x), rgba);
+  }
+  toneRow_scalar(in, channels, x, w, out, p, threshold);
+}
+#endif
+
+#ifdef CMU462_AVX2
+CMU462_TARGET_AVX2
+static inline __m256 toneCurve_avx2(__m256 x, const ToneMapping &p) {
+  const __m256 one = _mm256_set1_ps(1.0f);
+  x = _mm256_max_ps(_mm256_mul_ps(x, _mm256_set1_ps(p.exposure)),
+                    _mm256_setzero_ps());
+  switch (p.op) {
+  case ToneMapping::REINHARD:
+    x = _mm256_div_ps(x, _mm256_add_ps(one, x));
+    break;
+  case ToneMapping::ACES: {
+    __m256 num = _mm256_fmadd_ps(_mm256_set1_ps(2.51f), x,
+                                 _mm256_set1_ps(0.03f));
+    __m256 den = _mm256_fmadd_ps(_mm256_set1_ps(2.43f), x,
+                                 _mm256_set1_ps(0.59f));
+    den = _mm256_fmadd_ps(x, den, _mm256_set1_ps(0.14f));
+    x = _mm256_div_ps(_mm256_mul_ps(x, num), den);
+    break;
+  }
+  default:
+    break;
+  }
+  return _mm256_min_ps(x, one);
+}
+
+// the four floats at lo and the four at hi
+CMU462_TARGET_AVX2
+static inline __m256 loadPixels_avx2(const float *lo, const float *hi) {
+  return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(lo)),
+                              _mm_loadu_ps(hi), 1);
+}
+
+CMU462_TARGET_AVX2
+static void toneRow_avx2(const float *in, int channels, size_t x, size_t w,
+                         uint8_t *out, const ToneMapping &p,
+                         const float *threshold) {
+  const __m256i permR = _mm256_setr_epi32(0, 3, 6, 1, 4, 7, 2, 5);
+  const __m256i permG = _mm256_setr_epi32(1, 4, 7, 2, 5, 0, 3, 6);
+  const __m256i permB = _mm256_setr_epi32(2, 5, 0, 3, 6, 1, 4, 7);
+  const __m256 t = _mm256_loadu_ps(threshold);
+  const SrgbEncodeTable &table = encodeTable();
+  for (; x + 8 <= w; x += 8) {
+    const float *c = in + channels * x;
+    __m256 r, g, b, a = _mm256_set1_ps(1.0f);
+    if (channels == 3) {
+      // lane k of u, v, d holds component k, k + 8, k + 16: the blends
+      // take each channel from the right register, and the permutes put
+      // it in pixel order
+      __m256 u = _mm256_loadu_ps(c), v = _mm256_loadu_ps(c + 8);
+      __m256 d = _mm256_loadu_ps(c + 16);
+      r = _mm256_blend_ps(_mm256_blend_ps(u, v, 0x92), d, 0x24);
+      g = _mm256_blend_ps(_mm256_blend_ps(u, v, 0x24), d, 0x49);
+      b = _mm256_blend_ps(_mm256_blend_ps(u, v, 0x49), d, 0x92);
+      r = _mm256_permutevar8x32_ps(r, permR);
+      g = _mm256_permutevar8x32_ps(g, permG);
+      b = _mm256_permutevar8x32_ps(b, permB);
+    } else {
+      // pixels k and k + 4 in each register, then a 4x4 transpose per
+      // 128-bit lane
+      __m256 p0 = loadPixels_avx2(c, c + 16);
+      __m256 p1 = loadPixels_avx2(c + 4, c + 20);
+      __m256 p2 = loadPixels_avx2(c + 8, c + 24);
+      __m256 p3 = loadPixels_avx2(c + 12, c + 28);
+      __m256 rg01 = _mm256_unpacklo_ps(p0, p1);
+      __m256 ba01 = _mm256_unpackhi_ps(p0, p1);
+      __m256 rg23 = _mm256_unpacklo_ps(p2, p3);
+      __m256 ba23 = _mm256_unpackhi_ps(p2, p3);
+      r = _mm256_shuffle_ps(rg01, rg23, _MM_SHUFFLE(1, 0, 1, 0));
+      g = _mm256_shuffle_ps(rg01, rg23, _MM_SHUFFLE(3, 2, 3, 2));
+      b = _mm256_shuffle_ps(ba01, ba23, _MM_SHUFFLE(1, 0, 1, 0));
+      a = _mm256_shuffle_ps(ba01, ba23, _MM_SHUFFLE(3, 2, 3, 2));
+    }
+
+    __m256i rgba = encode8_avx2(toneCurve_avx2(r, p), t, table);
+    rgba = _mm256_or_si256(
+        rgba,
+        _mm256_slli_epi32(encode8_avx2(toneCurve_avx2(g, p), t, table), 8));
+    rgba = _mm256_or_si256(
+        rgba,
+        _mm256_slli_epi32(encode8_avx2(toneCurve_avx2(b, p), t, table), 16));
+    __m256 alpha = _mm256_min_ps(_mm256_max_ps(a, _mm256_setzero_ps()),
+                                 _mm256_set1_ps(1.0f));
+    alpha = _mm256_fmadd_ps(alpha, _mm256_set1_ps(255.0f),
+                            _mm256_set1_ps(0.5f));
+    rgba = _mm256_or_si256(rgba,
+                           _mm256_slli_epi32(_mm256_cvttps_epi32(alpha), 24));
+    _mm256_storeu_si256((__m256i *)(out + 4 * x), rgba);
+  }
+  toneRow_scalar(in, channels, x, w, out, p, threshold);
+}
+#endif
+
+static void tonemapImage(const float *in, int channels, size_t width,
+                         size_t height, uint8_t *rgba,
+                         const ToneMapping &p) {
+  void (*kernel)(const float *, int, size_t, size_t, uint8_t *,
+                 const ToneMapping &, const float *) = toneRow_scalar;
+#ifdef CMU462_SSE2
+  if (SIMD::hasSSE2()) kernel = toneRow_sse2;
+#endif
+#ifdef CMU462_AVX2
+  if (SIMD::hasAVX2()) kernel = toneRow_avx2;
+#endif
+
+  // the thresholds of each row, repeated so that any 8 consecutive
+  // pixels can be read from one offset
+  float thresholds[8][16];
+  for (int y = 0; y < 8; y++)
+    for (int x = 0; x < 16; x++)
+      thresholds[y][x] = p.dither ? (kBayer[y][x & 7] + 0.5f) / 64 : 0.5f;
+
+  long blocks = (long)((height + kToneBlock - 1) / kToneBlock);
+#pragma omp parallel for if (blocks > 1 && width * height > 65536)
+  for (long b = 0; b < blocks; b++) {
+    size_t end = min(height, (b + 1) * kToneBlock);
+    for (size_t y = b * kToneBlock; y < end; y++) {
+      kernel(in + channels * width * y, channels, 0, width,
+             rgba + 4 * width * y, p, thresholds[y & 7]);
+    }
+  }
+}
+
+void tonemap(const Spectrum *in, size_t width, size_t height, uint8_t *rgba,
+             const ToneMapping &params) {
+  tonemapImage((const float *)in, 3, width, height, rgba, params);
+}
+
+void tonemap(const Color *in, size_t width, size_t height, uint8_t *rgba,
+             const ToneMapping &params) {
+  tonemapImage((const float *)in, 4, width, height, rgba, params);
+}
+
+} // namespace CMU462
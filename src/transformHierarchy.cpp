@@ -0,0 +1,224 @@
+#include "transformHierarchy.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace CMU462 {
+
+// Subtrees of at most this many nodes are updated by one task.
+static const size_t kTaskGrain = 4096;
+
+//------------------------------------------------------------------------------
+// Structure
+//------------------------------------------------------------------------------
+
+uint32_t TransformHierarchy::add(uint32_t parent, const Affine3 &local) {
+  // the node goes at the end of the arrays until the next relayout
+  uint32_t node = (uint32_t)parents.size();
+  parents.push_back(parent);
+  slots.push_back(node);
+  marked.push_back(1);
+  nodes.push_back(node);
+  up.push_back(parent == kNone ? (uint32_t)kNone : slots[parent]);
+  ends.push_back(node + 1);
+  locals.push_back(local);
+  worlds.push_back(Affine3::identity());
+  inverses.push_back(Affine3::identity());
+  changed.push_back(node);
+  stale = true;
+  return node;
+}
+
+void TransformHierarchy::clear(void) {
+  parents.clear();
+  slots.clear();
+  marked.clear();
+  nodes.clear();
+  up.clear();
+  ends.clear();
+  locals.clear();
+  worlds.clear();
+  inverses.clear();
+  changed.clear();
+  stale = false;
+}
+
+void TransformHierarchy::setParent(uint32_t node, uint32_t parent) {
+  if (parents[node] == parent) return;
+  parents[node] = parent;
+  if (!marked[node]) {
+    marked[node] = 1;
+    changed.push_back(node);
+  }
+  stale = true;
+}
+
+void TransformHierarchy::setLocal(uint32_t node, const Affine3 &local) {
+  locals[slots[node]] = local;
+  if (!marked[node]) {
+    marked[node] = 1;
+    changed.push_back(node);
+  }
+}
+
+void TransformHierarchy::relayout(void) {
+  size_t n = parents.size();
+
+  // children of each node, by increasing index, and the roots
+  vector<uint32_t> first(n + 1, 0), children, roots;
+  for (size_t v = 0; v < n; v++) {
+    if (parents[v] == kNone) roots.push_back((uint32_t)v);
+    else first[parents[v] + 1]++;
+  }
+  for (size_t v = 0; v < n; v++) first[v + 1] += first[v];
+  children.resize(first[n]);
+  vector<uint32_t> next(first.begin(), first.end() - 1);
+  for (size_t v = 0; v < n; v++) {
+    if (parents[v] != kNone) children[next[parents[v]]++] = (uint32_t)v;
+  }
+
+  // depth-first order, children in increasing index
+  vector<uint32_t> order(n), stack;
+  size_t k = 0;
+  for (size_t r = roots.size(); r-- > 0;) stack.push_back(roots[r]);
+  while (!stack.empty()) {
+    uint32_t v = stack.back();
+    stack.pop_back();
+    order[k++] = v;
+    for (uint32_t c = first[v + 1]; c-- > first[v];)
+      stack.push_back(children[c]);
+  }
+
+  // move the transforms to their new positions
+  vector<Affine3> newLocals(n), newWorlds(n), newInverses(n);
+  for (size_t s = 0; s < n; s++) {
+    uint32_t v = order[s], old = slots[v];
+    newLocals[s] = locals[old];
+    newWorlds[s] = worlds[old];
+    newInverses[s] = inverses[old];
+  }
+  locals.swap(newLocals);
+  worlds.swap(newWorlds);
+  inverses.swap(newInverses);
+
+  for (size_t s = 0; s < n; s++) slots[order[s]] = (uint32_t)s;
+  nodes.swap(order);
+  for (size_t s = 0; s < n; s++) {
+    uint32_t p = parents[nodes[s]];
+    up[s] = p == kNone ? (uint32_t)kNone : slots[p];
+  }
+
+  // subtree sizes, accumulated from the leaves up
+  for (size_t s = 0; s < n; s++) ends[s] = 1;
+  for (size_t s = n; s-- > 0;) {
+    if (up[s] != kNone) ends[up[s]] += ends[s];
+  }
+  for (size_t s = 0; s < n; s++) ends[s] += (uint32_t)s;
+
+  stale = false;
+}
+
+//------------------------------------------------------------------------------
+// Update
+//
+// The subtree of a dirty node is the range [s, ends[s]) of positions, in
+// which every parent precedes its children, so one pass over the range
+// updates it. Large subtrees are split into the subtrees of their
+// children, which are independent and run as parallel tasks.
+//------------------------------------------------------------------------------
+
+struct HierarchyView {
+  const uint32_t *up, *ends;
+  const Affine3 *locals;
+  Affine3 *worlds, *inverses;
+
+  inline void updateNode(uint32_t s) const {
+    uint32_t p = up[s];
+    worlds[s] = p == TransformHierarchy::kNone ? locals[s]
+                                               : worlds[p] * locals[s];
+    inverses[s] = worlds[s].inv();
+  }
+
+  inline void updateRange(uint32_t begin, uint32_t end) const {
+    for (uint32_t s = begin; s < end; s++) updateNode(s);
+  }
+};
+
+static void updateSubtree(const HierarchyView &t, uint32_t s) {
+  while (t.ends[s] - s > kTaskGrain) {
+    t.updateNode(s);
+
+    // small child subtrees are updated in place, large ones as tasks but
+    // for the last, which this loop descends into
+    uint32_t large = TransformHierarchy::kNone;
+    for (uint32_t c = s + 1; c < t.ends[s]; c = t.ends[c]) {
+      if (t.ends[c] - c <= kTaskGrain) {
+        t.updateRange(c, t.ends[c]);
+        continue;
+      }
+      if (large != TransformHierarchy::kNone) {
+#pragma omp task firstprivate(large)
+        updateSubtree(t, large);
+      }
+      large = c;
+    }
+    if (large == TransformHierarchy::kNone) return;
+    s = large;
+  }
+  t.updateRange(s, t.ends[s]);
+}
+
+void TransformHierarchy::update(void) {
+  if (stale) relayout();
+  if (changed.empty()) return;
+
+  // the dirty subtrees, without those inside another one
+  vector<uint32_t> pending(changed.size());
+  for (size_t k = 0; k < changed.size(); k++) {
+    pending[k] = slots[changed[k]];
+    marked[changed[k]] = 0;
+  }
+  changed.clear();
+  sort(pending.begin(), pending.end());
+  size_t m = 0, work = 0;
+  for (size_t k = 0; k < pending.size(); k++) {
+    if (m && pending[k] < ends[pending[m - 1]]) continue;
+    pending[m++] = pending[k];
+    work += ends[pending[k]] - pending[k];
+  }
+
+  HierarchyView t = {&up[0], &ends[0], &locals[0], &worlds[0], &inverses[0]};
+  if (work <= kTaskGrain) {
+    for (size_t k = 0; k < m; k++) t.updateRange(pending[k], ends[pending[k]]);
+    return;
+  }
+
+  // small subtrees are grouped into tasks of about kTaskGrain nodes
+#pragma omp parallel
+#pragma omp single
+  {
+    size_t begin = 0, size = 0;
+    for (size_t k = 0; k < m; k++) {
+      uint32_t s = pending[k];
+      if (ends[s] - s > kTaskGrain) {
+#pragma omp task firstprivate(s)
+        updateSubtree(t, s);
+      } else {
+        size += ends[s] - s;
+      }
+      if (size >= kTaskGrain || (size && k + 1 == m)) {
+        const uint32_t *d = &pending[0];
+#pragma omp task firstprivate(begin, k, d)
+        for (size_t j = begin; j <= k; j++) {
+          if (t.ends[d[j]] - d[j] <= kTaskGrain)
+            t.updateRange(d[j], t.ends[d[j]]);
+        }
+        begin = k + 1;
+        size = 0;
+      }
+    }
+  }
+}
+
+} // namespace CMU462
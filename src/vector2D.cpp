@@ -2,9 +2,13 @@
 
 namespace CMU462 {
 
-std::ostream &operator<<(std::ostream &os, const Vector2D &v) {
+template <typename T>
+std::ostream &operator<<(std::ostream &os, const BasicVector2D<T> &v) {
   os << "(" << v.x << "," << v.y << ")";
   return os;
 }
 
+template std::ostream &operator<<(std::ostream &os, const Vector2D &v);
+template std::ostream &operator<<(std::ostream &os, const Vector2f &v);
+
 } // namespace CMU462
@@ -2,9 +2,13 @@
 
 namespace CMU462 {
 
-std::ostream &operator<<(std::ostream &os, const Vector3D &v) {
+template <typename T>
+std::ostream &operator<<(std::ostream &os, const BasicVector3D<T> &v) {
   os << "(" << v.x << "," << v.y << "," << v.z << ")";
   return os;
 }
 
+template std::ostream &operator<<(std::ostream &os, const Vector3D &v);
+template std::ostream &operator<<(std::ostream &os, const Vector3f &v);
+
 } // namespace CMU462
@@ -0,0 +1,515 @@
+#include "vector3DArray.h"
+#include "simd.h"
+
+#include <string.h>
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+
+namespace CMU462 {
+
+// Component arrays are padded to a multiple of four doubles (one AVX
+// register) so that each of them starts on a 32-byte boundary.
+static inline size_t padded(size_t n) { return (n + 3) & ~(size_t)3; }
+
+Vector3DArray::Vector3DArray(size_t n) : n(0), cap(0), data(NULL) {
+  resize(n);
+}
+
+Vector3DArray::Vector3DArray(const Vector3D *v, size_t n)
+    : n(0), cap(0), data(NULL) {
+  gather(v, n);
+}
+
+Vector3DArray::Vector3DArray(const Vector3DArray &a)
+    : n(0), cap(0), data(NULL) {
+  *this = a;
+}
+
+Vector3DArray::~Vector3DArray() { SIMD::alignedFree(data); }
+
+Vector3DArray &Vector3DArray::operator=(const Vector3DArray &a) {
+  if (this == &a) return *this;
+
+  n = 0;
+  reserve(a.n);
+  memcpy(x(), a.x(), a.n * sizeof(double));
+  memcpy(y(), a.y(), a.n * sizeof(double));
+  memcpy(z(), a.z(), a.n * sizeof(double));
+  n = a.n;
+
+  return *this;
+}
+
+void Vector3DArray::reserve(size_t m) {
+  if (m <= cap) return;
+
+  size_t newCap = padded(m);
+  double *newData =
+      (double *)SIMD::alignedAlloc(3 * newCap * sizeof(double), 32);
+
+  if (n) {
+    memcpy(newData, x(), n * sizeof(double));
+    memcpy(newData + newCap, y(), n * sizeof(double));
+    memcpy(newData + 2 * newCap, z(), n * sizeof(double));
+  }
+
+  SIMD::alignedFree(data);
+  data = newData;
+  cap = newCap;
+}
+
+void Vector3DArray::resize(size_t m) {
+  reserve(m);
+
+  if (m > n) {
+    memset(x() + n, 0, (m - n) * sizeof(double));
+    memset(y() + n, 0, (m - n) * sizeof(double));
+    memset(z() + n, 0, (m - n) * sizeof(double));
+  }
+
+  n = m;
+}
+
+void Vector3DArray::push_back(const Vector3D &v) {
+  if (n == cap) reserve(cap ? 2 * cap : 16);
+  set(n++, v);
+}
+
+void Vector3DArray::gather(const Vector3D *v, size_t m) {
+  n = 0;
+  reserve(m);
+
+  double *X = x(), *Y = y(), *Z = z();
+  for (size_t i = 0; i < m; i++) {
+    X[i] = v[i].x;
+    Y[i] = v[i].y;
+    Z[i] = v[i].z;
+  }
+
+  n = m;
+}
+
+void Vector3DArray::scatter(Vector3D *v) const {
+  const double *X = x(), *Y = y(), *Z = z();
+  for (size_t i = 0; i < n; i++) {
+    v[i].x = X[i];
+    v[i].y = Y[i];
+    v[i].z = Z[i];
+  }
+}
+
+//------------------------------------------------------------------------------
+// Kernels
+//
+// Each operation has a scalar version working on [i, n), which also handles
+// the tail of the vector versions, and SSE2/AVX2 versions that process two
+// or four vectors per iteration. Component arrays are aligned, output
+// pointers supplied by the caller are not assumed to be.
+//------------------------------------------------------------------------------
+
+// dot //
+
+static void dot_scalar(size_t i, size_t n, const double *ux, const double *uy,
+                       const double *uz, const double *vx, const double *vy,
+                       const double *vz, double *out) {
+  for (; i < n; i++) {
+    out[i] = ux[i] * vx[i] + uy[i] * vy[i] + uz[i] * vz[i];
+  }
+}
+
+#ifdef CMU462_SSE2
+static void dot_sse2(size_t n, const double *ux, const double *uy,
+                     const double *uz, const double *vx, const double *vy,
+                     const double *vz, double *out) {
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    __m128d d = _mm_mul_pd(_mm_load_pd(ux + i), _mm_load_pd(vx + i));
+    d = _mm_add_pd(d, _mm_mul_pd(_mm_load_pd(uy + i), _mm_load_pd(vy + i)));
+    d = _mm_add_pd(d, _mm_mul_pd(_mm_load_pd(uz + i), _mm_load_pd(vz + i)));
+    _mm_storeu_pd(out + i, d);
+  }
+  dot_scalar(i, n, ux, uy, uz, vx, vy, vz, out);
+}
+#endif
+
+#ifdef CMU462_AVX2
+CMU462_TARGET_AVX2
+static void dot_avx2(size_t n, const double *ux, const double *uy,
+                     const double *uz, const double *vx, const double *vy,
+                     const double *vz, double *out) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256d d = _mm256_mul_pd(_mm256_load_pd(ux + i), _mm256_load_pd(vx + i));
+    d = _mm256_fmadd_pd(_mm256_load_pd(uy + i), _mm256_load_pd(vy + i), d);
+    d = _mm256_fmadd_pd(_mm256_load_pd(uz + i), _mm256_load_pd(vz + i), d);
+    _mm256_storeu_pd(out + i, d);
+  }
+  dot_scalar(i, n, ux, uy, uz, vx, vy, vz, out);
+}
+#endif
+
+void dot(const Vector3DArray &u, const Vector3DArray &v, double *out) {
+  size_t n = u.size();
+#ifdef CMU462_AVX2
+  if (SIMD::hasAVX2()) {
+    dot_avx2(n, u.x(), u.y(), u.z(), v.x(), v.y(), v.z(), out);
+    return;
+  }
+#endif
+#ifdef CMU462_SSE2
+  if (SIMD::hasSSE2()) {
+    dot_sse2(n, u.x(), u.y(), u.z(), v.x(), v.y(), v.z(), out);
+    return;
+  }
+#endif
+  dot_scalar(0, n, u.x(), u.y(), u.z(), v.x(), v.y(), v.z(), out);
+}
+
+// cross //
+
+static void cross_scalar(size_t i, size_t n, const double *ux,
+                         const double *uy, const double *uz, const double *vx,
+                         const double *vy, const double *vz, double *ox,
+                         double *oy, double *oz) {
+  for (; i < n; i++) {
+    double ax = ux[i], ay = uy[i], az = uz[i];
+    double bx = vx[i], by = vy[i], bz = vz[i];
+    ox[i] = ay * bz - az * by;
+    oy[i] = az * bx - ax * bz;
+    oz[i] = ax * by - ay * bx;
+  }
+}
+
+#ifdef CMU462_SSE2
+static void cross_sse2(size_t n, const double *ux, const double *uy,
+                       const double *uz, const double *vx, const double *vy,
+                       const double *vz, double *ox, double *oy, double *oz) {
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    __m128d ax = _mm_load_pd(ux + i), ay = _mm_load_pd(uy + i);
+    __m128d az = _mm_load_pd(uz + i);
+    __m128d bx = _mm_load_pd(vx + i), by = _mm_load_pd(vy + i);
+    __m128d bz = _mm_load_pd(vz + i);
+    _mm_store_pd(ox + i, _mm_sub_pd(_mm_mul_pd(ay, bz), _mm_mul_pd(az, by)));
+    _mm_store_pd(oy + i, _mm_sub_pd(_mm_mul_pd(az, bx), _mm_mul_pd(ax, bz)));
+    _mm_store_pd(oz + i, _mm_sub_pd(_mm_mul_pd(ax, by), _mm_mul_pd(ay, bx)));
+  }
+  cross_scalar(i, n, ux, uy, uz, vx, vy, vz, ox, oy, oz);
+}
+#endif
+
+#ifdef CMU462_AVX2
+CMU462_TARGET_AVX2
+static void cross_avx2(size_t n, const double *ux, const double *uy,
+                       const double *uz, const double *vx, const double *vy,
+                       const double *vz, double *ox, double *oy, double *oz) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256d ax = _mm256_load_pd(ux + i), ay = _mm256_load_pd(uy + i);
+    __m256d az = _mm256_load_pd(uz + i);
+    __m256d bx = _mm256_load_pd(vx + i), by = _mm256_load_pd(vy + i);
+    __m256d bz = _mm256_load_pd(vz + i);
+    _mm256_store_pd(ox + i, _mm256_fmsub_pd(ay, bz, _mm256_mul_pd(az, by)));
+    _mm256_store_pd(oy + i, _mm256_fmsub_pd(az, bx, _mm256_mul_pd(ax, bz)));
+    _mm256_store_pd(oz + i, _mm256_fmsub_pd(ax, by, _mm256_mul_pd(ay, bx)));
+  }
+  cross_scalar(i, n, ux, uy, uz, vx, vy, vz, ox, oy, oz);
+}
+#endif
+
+void cross(const Vector3DArray &u, const Vector3DArray &v,
+           Vector3DArray &out) {
+  size_t n = u.size();
+  out.resize(n);
+#ifdef CMU462_AVX2
+  if (SIMD::hasAVX2()) {
+    cross_avx2(n, u.x(), u.y(), u.z(), v.x(), v.y(), v.z(), out.x(), out.y(),
+               out.z());
+    return;
+  }
+#endif
+#ifdef CMU462_SSE2
+  if (SIMD::hasSSE2()) {
+    cross_sse2(n, u.x(), u.y(), u.z(), v.x(), v.y(), v.z(), out.x(), out.y(),
+               out.z());
+    return;
+  }
+#endif
+  cross_scalar(0, n, u.x(), u.y(), u.z(), v.x(), v.y(), v.z(), out.x(),
+               out.y(), out.z());
+}
+
+// norm and norm2 //
+
+static void norm2_scalar(size_t i, size_t n, const double *x, const double *y,
+                         const double *z, double *out) {
+  for (; i < n; i++) {
+    out[i] = x[i] * x[i] + y[i] * y[i] + z[i] * z[i];
+  }
+}
+
+static void norm_scalar(size_t i, size_t n, const double *x, const double *y,
+                        const double *z, double *out) {
+  for (; i < n; i++) {
+    out[i] = sqrt(x[i] * x[i] + y[i] * y[i] + z[i] * z[i]);
+  }
+}
+
+#ifdef CMU462_SSE2
+static inline __m128d norm2_sse2(const double *x, const double *y,
+                                 const double *z, size_t i) {
+  __m128d a = _mm_load_pd(x + i), b = _mm_load_pd(y + i);
+  __m128d c = _mm_load_pd(z + i);
+  return _mm_add_pd(_mm_add_pd(_mm_mul_pd(a, a), _mm_mul_pd(b, b)),
+                    _mm_mul_pd(c, c));
+}
+
+static void norm_sse2(size_t n, const double *x, const double *y,
+                      const double *z, double *out, bool root) {
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    __m128d d = norm2_sse2(x, y, z, i);
+    _mm_storeu_pd(out + i, root ? _mm_sqrt_pd(d) : d);
+  }
+  if (root) norm_scalar(i, n, x, y, z, out);
+  else norm2_scalar(i, n, x, y, z, out);
+}
+#endif
+
+#ifdef CMU462_AVX2
+CMU462_TARGET_AVX2
+static inline __m256d norm2_avx2(const double *x, const double *y,
+                                 const double *z, size_t i) {
+  __m256d a = _mm256_load_pd(x + i), b = _mm256_load_pd(y + i);
+  __m256d c = _mm256_load_pd(z + i);
+  return _mm256_fmadd_pd(a, a, _mm256_fmadd_pd(b, b, _mm256_mul_pd(c, c)));
+}
+
+CMU462_TARGET_AVX2
+static void norm_avx2(size_t n, const double *x, const double *y,
+                      const double *z, double *out, bool root) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256d d = norm2_avx2(x, y, z, i);
+    _mm256_storeu_pd(out + i, root ? _mm256_sqrt_pd(d) : d);
+  }
+  if (root) norm_scalar(i, n, x, y, z, out);
+  else norm2_scalar(i, n, x, y, z, out);
+}
+#endif
+
+static void norm_dispatch(const Vector3DArray &a, double *out, bool root) {
+  size_t n = a.size();
+#ifdef CMU462_AVX2
+  if (SIMD::hasAVX2()) {
+    norm_avx2(n, a.x(), a.y(), a.z(), out, root);
+    return;
+  }
+#endif
+#ifdef CMU462_SSE2
+  if (SIMD::hasSSE2()) {
+    norm_sse2(n, a.x(), a.y(), a.z(), out, root);
+    return;
+  }
+#endif
+  if (root) norm_scalar(0, n, a.x(), a.y(), a.z(), out);
+  else norm2_scalar(0, n, a.x(), a.y(), a.z(), out);
+}
+
+void Vector3DArray::norm(double *out) const { norm_dispatch(*this, out, true); }
+
+void Vector3DArray::norm2(double *out) const {
+  norm_dispatch(*this, out, false);
+}
+
+// unit //
+
+static void unit_scalar(size_t i, size_t n, const double *x, const double *y,
+                        const double *z, double *ox, double *oy, double *oz) {
+  for (; i < n; i++) {
+    double rNorm = 1. / sqrt(x[i] * x[i] + y[i] * y[i] + z[i] * z[i]);
+    ox[i] = rNorm * x[i];
+    oy[i] = rNorm * y[i];
+    oz[i] = rNorm * z[i];
+  }
+}
+
+#ifdef CMU462_SSE2
+static void unit_sse2(size_t n, const double *x, const double *y,
+                      const double *z, double *ox, double *oy, double *oz) {
+  const __m128d one = _mm_set1_pd(1.0);
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    __m128d r = _mm_div_pd(one, _mm_sqrt_pd(norm2_sse2(x, y, z, i)));
+    _mm_store_pd(ox + i, _mm_mul_pd(r, _mm_load_pd(x + i)));
+    _mm_store_pd(oy + i, _mm_mul_pd(r, _mm_load_pd(y + i)));
+    _mm_store_pd(oz + i, _mm_mul_pd(r, _mm_load_pd(z + i)));
+  }
+  unit_scalar(i, n, x, y, z, ox, oy, oz);
+}
+#endif
+
+#ifdef CMU462_AVX2
+CMU462_TARGET_AVX2
+static void unit_avx2(size_t n, const double *x, const double *y,
+                      const double *z, double *ox, double *oy, double *oz) {
+  const __m256d one = _mm256_set1_pd(1.0);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256d r = _mm256_div_pd(one, _mm256_sqrt_pd(norm2_avx2(x, y, z, i)));
+    _mm256_store_pd(ox + i, _mm256_mul_pd(r, _mm256_load_pd(x + i)));
+    _mm256_store_pd(oy + i, _mm256_mul_pd(r, _mm256_load_pd(y + i)));
+    _mm256_store_pd(oz + i, _mm256_mul_pd(r, _mm256_load_pd(z + i)));
+  }
+  unit_scalar(i, n, x, y, z, ox, oy, oz);
+}
+#endif
+
+void Vector3DArray::unit(Vector3DArray &out) const {
+  out.resize(n);
+#ifdef CMU462_AVX2
+  if (SIMD::hasAVX2()) {
+    unit_avx2(n, x(), y(), z(), out.x(), out.y(), out.z());
+    return;
+  }
+#endif
+#ifdef CMU462_SSE2
+  if (SIMD::hasSSE2()) {
+    unit_sse2(n, x(), y(), z(), out.x(), out.y(), out.z());
+    return;
+  }
+#endif
+  unit_scalar(0, n, x(), y(), z(), out.x(), out.y(), out.z());
+}
+
+// axpy //
+
+static void axpy_scalar(size_t i, size_t n, double a, const double *x,
+                        double *y) {
+  for (; i < n; i++) {
+    y[i] += a * x[i];
+  }
+}
+
+#ifdef CMU462_SSE2
+static void axpy_sse2(size_t n, double a, const double *x, double *y) {
+  const __m128d va = _mm_set1_pd(a);
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    __m128d r = _mm_mul_pd(va, _mm_load_pd(x + i));
+    _mm_store_pd(y + i, _mm_add_pd(_mm_load_pd(y + i), r));
+  }
+  axpy_scalar(i, n, a, x, y);
+}
+#endif
+
+#ifdef CMU462_AVX2
+CMU462_TARGET_AVX2
+static void axpy_avx2(size_t n, double a, const double *x, double *y) {
+  const __m256d va = _mm256_set1_pd(a);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256d r =
+        _mm256_fmadd_pd(va, _mm256_load_pd(x + i), _mm256_load_pd(y + i));
+    _mm256_store_pd(y + i, r);
+  }
+  axpy_scalar(i, n, a, x, y);
+}
+#endif
+
+void axpy(double a, const Vector3DArray &x, Vector3DArray &y) {
+  size_t n = x.size();
+  const double *src[3] = {x.x(), x.y(), x.z()};
+  double *dst[3] = {y.x(), y.y(), y.z()};
+
+  for (int k = 0; k < 3; k++) {
+#ifdef CMU462_AVX2
+    if (SIMD::hasAVX2()) {
+      axpy_avx2(n, a, src[k], dst[k]);
+      continue;
+    }
+#endif
+#ifdef CMU462_SSE2
+    if (SIMD::hasSSE2()) {
+      axpy_sse2(n, a, src[k], dst[k]);
+      continue;
+    }
+#endif
+    axpy_scalar(0, n, a, src[k], dst[k]);
+  }
+}
+
+// min and max //
+
+static double reduce_scalar(size_t i, size_t n, const double *x, double r,
+                            bool takeMax) {
+  for (; i < n; i++) {
+    r = takeMax ? std::max(r, x[i]) : std::min(r, x[i]);
+  }
+  return r;
+}
+
+#ifdef CMU462_SSE2
+static double reduce_sse2(size_t n, const double *x, bool takeMax) {
+  if (n < 2) return reduce_scalar(1, n, x, x[0], takeMax);
+
+  __m128d r = _mm_load_pd(x);
+  size_t i = 2;
+  for (; i + 2 <= n; i += 2) {
+    __m128d v = _mm_load_pd(x + i);
+    r = takeMax ? _mm_max_pd(r, v) : _mm_min_pd(r, v);
+  }
+
+  double lanes[2];
+  _mm_storeu_pd(lanes, r);
+  double m = takeMax ? std::max(lanes[0], lanes[1])
+                     : std::min(lanes[0], lanes[1]);
+  return reduce_scalar(i, n, x, m, takeMax);
+}
+#endif
+
+#ifdef CMU462_AVX2
+CMU462_TARGET_AVX2
+static double reduce_avx2(size_t n, const double *x, bool takeMax) {
+  if (n < 4) return reduce_scalar(1, n, x, x[0], takeMax);
+
+  __m256d r = _mm256_load_pd(x);
+  size_t i = 4;
+  for (; i + 4 <= n; i += 4) {
+    __m256d v = _mm256_load_pd(x + i);
+    r = takeMax ? _mm256_max_pd(r, v) : _mm256_min_pd(r, v);
+  }
+
+  double lanes[4];
+  _mm256_storeu_pd(lanes, r);
+  double m = lanes[0];
+  for (int k = 1; k < 4; k++) {
+    m = takeMax ? std::max(m, lanes[k]) : std::min(m, lanes[k]);
+  }
+  return reduce_scalar(i, n, x, m, takeMax);
+}
+#endif
+
+static double reduce(size_t n, const double *x, bool takeMax) {
+#ifdef CMU462_AVX2
+  if (SIMD::hasAVX2()) return reduce_avx2(n, x, takeMax);
+#endif
+#ifdef CMU462_SSE2
+  if (SIMD::hasSSE2()) return reduce_sse2(n, x, takeMax);
+#endif
+  return reduce_scalar(1, n, x, x[0], takeMax);
+}
+
+Vector3D Vector3DArray::min(void) const {
+  return Vector3D(reduce(n, x(), false), reduce(n, y(), false),
+                  reduce(n, z(), false));
+}
+
+Vector3D Vector3DArray::max(void) const {
+  return Vector3D(reduce(n, x(), true), reduce(n, y(), true),
+                  reduce(n, z(), true));
+}
+
+} // namespace CMU462
@@ -2,16 +2,27 @@
 
 namespace CMU462 {
 
-std::ostream &operator<<(std::ostream &os, const Vector4D &v) {
+template <typename T>
+std::ostream &operator<<(std::ostream &os, const BasicVector4D<T> &v) {
   os << "(" << v.x << "," << v.y << "," << v.z << "," << v.w << ")";
   return os;
 }
 
-Vector3D Vector4D::to3D() { return Vector3D(x, y, z); }
+template <typename T>
+BasicVector3D<T> BasicVector4D<T>::to3D() {
+  return BasicVector3D<T>(x, y, z);
+}
 
-Vector3D Vector4D::projectTo3D() {
-  double invW = 1.0 / w;
-  return Vector3D(x * invW, y * invW, z * invW);
+template <typename T>
+BasicVector3D<T> BasicVector4D<T>::projectTo3D() {
+  T invW = T(1) / w;
+  return BasicVector3D<T>(x * invW, y * invW, z * invW);
 }
 
+template class BasicVector4D<double>;
+template class BasicVector4D<float>;
+
+template std::ostream &operator<<(std::ostream &os, const Vector4D &v);
+template std::ostream &operator<<(std::ostream &os, const Vector4f &v);
+
 } // namespace CMU462
@@ -0,0 +1,90 @@
+// Measures the build time and the query throughput of KdTree on a random
+// point cloud (10M points by default), and checks the nearest neighbors
+// of a few queries against brute force. Runs headless.
+
+#include "CMU462/kdTree.h"
+#include "CMU462/timer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+using namespace CMU462;
+
+static double uniform() { return (double)rand() / RAND_MAX; }
+
+// squared distances from q to its k nearest points, by brute force
+static std::vector<double> bruteForce(const std::vector<Vector3D> &points,
+                                      const Vector3D &q, size_t k) {
+  std::vector<double> d(points.size());
+  for (size_t i = 0; i < points.size(); i++) d[i] = (points[i] - q).norm2();
+  k = std::min(k, d.size());
+  std::partial_sort(d.begin(), d.begin() + k, d.end());
+  d.resize(k);
+  return d;
+}
+
+int main(int argc, char *argv[]) {
+  size_t n = argc > 1 ? atoi(argv[1]) : 10000000;
+  size_t m = argc > 2 ? atoi(argv[2]) : 100000;
+  size_t checks = 50;
+
+  srand(462);
+  std::vector<Vector3D> points(n), queries(m);
+  for (size_t i = 0; i < n; i++)
+    points[i] = Vector3D(uniform(), uniform(), uniform());
+  for (size_t i = 0; i < m; i++)
+    queries[i] = Vector3D(uniform(), uniform(), uniform());
+
+  Timer timer;
+  timer.start();
+  KdTree tree(&points[0], n);
+  timer.stop();
+  printf("%zu points, %zu queries\n\n", n, m);
+  printf("build: %.1fms\n\n", 1e3 * timer.duration());
+
+  printf("%-24s %12s %14s %12s\n", "query", "time", "queries/s",
+         "max ratio");
+
+  const size_t ks[] = {1, 8, 8, 8};
+  const double epss[] = {0, 0, 0.5, 2};
+  for (int t = 0; t < 4; t++) {
+    size_t k = ks[t];
+    double eps = epss[t];
+    std::vector<uint32_t> indices(m * k);
+    std::vector<double> dist2(m * k);
+    timer.start();
+    tree.knn(&queries[0], m, k, &indices[0], &dist2[0], INFINITY, eps);
+    timer.stop();
+
+    // worst ratio of the distance to the i-th neighbor found to the true
+    // one, which is 1 for exact queries and at most 1 + eps otherwise
+    double ratio = 1;
+    for (size_t i = 0; i < checks && i < m; i++) {
+      std::vector<double> d = bruteForce(points, queries[i], k);
+      for (size_t j = 0; j < d.size(); j++) {
+        if (d[j] > 0) ratio = std::max(ratio, sqrt(dist2[i * k + j] / d[j]));
+      }
+    }
+
+    char name[64];
+    snprintf(name, sizeof(name), "knn k=%zu eps=%g", k, eps);
+    printf("%-24s %10.1fms %14.0f %12.4f\n", name, 1e3 * timer.duration(),
+           m / timer.duration(), ratio);
+  }
+
+  // radius holding about 16 points on average
+  double r = cbrt(16.0 / (n * 4.0 / 3.0 * M_PI));
+  std::vector<size_t> offsets;
+  std::vector<uint32_t> neighbors;
+  timer.start();
+  tree.radius(&queries[0], m, r, offsets, neighbors);
+  timer.stop();
+  printf("%-24s %10.1fms %14.0f %12s\n", "radius (16 avg.)",
+         1e3 * timer.duration(), m / timer.duration(), "-");
+  printf("\n%.1f neighbors per radius query\n", (double)neighbors.size() / m);
+
+  return 0;
+}
@@ -0,0 +1,133 @@
+// Compares the batched quaternion kernels of quaternionBatch.h with the
+// per-element Quaternion methods, and reports the largest deviation
+// between the two. Runs headless.
+
+#include "CMU462/quaternionBatch.h"
+#include "CMU462/simd.h"
+#include "CMU462/timer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+
+using namespace CMU462;
+
+static double uniform() { return 2.0 * rand() / RAND_MAX - 1.0; }
+
+static Quaternion randomRotation() {
+  Quaternion q;
+  q.from_axis_angle(Vector3D(uniform(), uniform(), uniform()),
+                    M_PI * uniform());
+  return q;
+}
+
+// angle of the rotation taking p to q
+static double angle(const Quaternion &p, const Quaternion &q) {
+  double d = fabs(dot(p.vector(), q.vector()));
+  return 2.0 * acos(d > 1.0 ? 1.0 : d);
+}
+
+static const char *levelName(SIMD::Level level) {
+  switch (level) {
+  case SIMD::AVX2: return "avx2";
+  case SIMD::SSE2: return "sse2";
+  default: return "scalar";
+  }
+}
+
+int main(int argc, char *argv[]) {
+  size_t n = argc > 1 ? atoi(argv[1]) : 100000;
+  int reps = 20;
+
+  srand(462);
+  std::vector<Quaternion> q0(n), q1(n), qa(n), qb(n);
+  std::vector<Vector3D> v(n), va(n), vb(n);
+  for (size_t i = 0; i < n; i++) {
+    q0[i] = randomRotation();
+    q1[i] = randomRotation();
+    v[i] = Vector3D(uniform(), uniform(), uniform());
+  }
+  double t = 0.3;
+
+  Timer timer;
+  printf("%zu elements, %d repetitions, SIMD level %s\n\n", n, reps,
+         levelName(SIMD::level()));
+  printf("%-28s %12s %12s %10s %12s\n", "operation", "per-element",
+         "batch", "speedup", "max error");
+
+  // rotate by one quaternion
+  timer.start();
+  for (int r = 0; r < reps; r++)
+    for (size_t i = 0; i < n; i++) va[i] = q0[0].rotatedVector(v[i]);
+  timer.stop();
+  double ts = timer.duration();
+  timer.start();
+  for (int r = 0; r < reps; r++) rotate(q0[0], &v[0], &vb[0], n);
+  timer.stop();
+  double tb = timer.duration();
+  double err = 0;
+  for (size_t i = 0; i < n; i++) err = std::max(err, (va[i] - vb[i]).norm());
+  printf("%-28s %10.2fms %10.2fms %9.1fx %12.2e\n", "rotate (one quaternion)",
+         1e3 * ts / reps, 1e3 * tb / reps, ts / tb, err);
+
+  // rotate by one quaternion each
+  timer.start();
+  for (int r = 0; r < reps; r++)
+    for (size_t i = 0; i < n; i++) va[i] = q0[i].rotatedVector(v[i]);
+  timer.stop();
+  ts = timer.duration();
+  timer.start();
+  for (int r = 0; r < reps; r++) rotate(&q0[0], &v[0], &vb[0], n);
+  timer.stop();
+  tb = timer.duration();
+  err = 0;
+  for (size_t i = 0; i < n; i++) err = std::max(err, (va[i] - vb[i]).norm());
+  printf("%-28s %10.2fms %10.2fms %9.1fx %12.2e\n", "rotate (n quaternions)",
+         1e3 * ts / reps, 1e3 * tb / reps, ts / tb, err);
+
+  // slerp, against nlerp and the approximation; the per-element slerp
+  // does not pick the shorter arc, so compare against q1 flipped to it
+  for (size_t i = 0; i < n; i++) {
+    if (dot(q0[i].vector(), q1[i].vector()) < 0) q1[i] = -1.0 * q1[i];
+  }
+  timer.start();
+  for (int r = 0; r < reps; r++)
+    for (size_t i = 0; i < n; i++) qa[i] = Quaternion::slerp(q0[i], q1[i], t);
+  timer.stop();
+  ts = timer.duration();
+
+  timer.start();
+  for (int r = 0; r < reps; r++) nlerp(&q0[0], &q1[0], t, &qb[0], n);
+  timer.stop();
+  tb = timer.duration();
+  err = 0;
+  for (size_t i = 0; i < n; i++) err = std::max(err, angle(qa[i], qb[i]));
+  printf("%-28s %10.2fms %10.2fms %9.1fx %12.2e\n", "slerp vs. nlerp",
+         1e3 * ts / reps, 1e3 * tb / reps, ts / tb, err);
+
+  timer.start();
+  for (int r = 0; r < reps; r++) slerpApprox(&q0[0], &q1[0], t, &qb[0], n);
+  timer.stop();
+  tb = timer.duration();
+  err = 0;
+  for (size_t i = 0; i < n; i++) err = std::max(err, angle(qa[i], qb[i]));
+  printf("%-28s %10.2fms %10.2fms %9.1fx %12.2e\n", "slerp vs. slerpApprox",
+         1e3 * ts / reps, 1e3 * tb / reps, ts / tb, err);
+
+  // worst case of the approximation over t and the angle between the
+  // quaternions (error in radians)
+  err = 0;
+  for (int k = 0; k <= 100; k++) {
+    for (int j = 0; j <= 100; j++) {
+      Quaternion a, b, s, c;
+      b.from_axis_angle(Vector3D(0, 0, 1), M_PI * j / 100.0);
+      s = Quaternion::slerp(a, b, k / 100.0);
+      slerpApprox(&a, &b, k / 100.0, &c, 1);
+      err = std::max(err, angle(s, c));
+    }
+  }
+  printf("\nslerpApprox worst case error: %.2e radians\n", err);
+
+  return 0;
+}
@@ -0,0 +1,77 @@
+// Measures the build time and the query throughput of SpatialHash on a
+// random particle cloud around the origin (2M particles by default, enough
+// for more than 2^21 buckets), and checks the neighbors of queries
+// straddling the cell boundary at x = 0 against brute force. Runs
+// headless; returns 1 if a query is wrong.
+
+#include "CMU462/spatialHash.h"
+#include "CMU462/timer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+using namespace CMU462;
+
+static double uniform() { return (double)rand() / RAND_MAX; }
+
+// the particles within distance r of q, by brute force
+static std::vector<uint32_t> bruteForce(const std::vector<Vector3D> &points,
+                                        const Vector3D &q, double r) {
+  std::vector<uint32_t> indices;
+  for (size_t i = 0; i < points.size(); i++) {
+    if ((points[i] - q).norm2() <= r * r) indices.push_back((uint32_t)i);
+  }
+  return indices;
+}
+
+int main(int argc, char *argv[]) {
+  size_t n = argc > 1 ? atoi(argv[1]) : 2000000;
+  size_t m = argc > 2 ? atoi(argv[2]) : 100000;
+  size_t checks = 300;
+
+  // radius holding about 64 particles on average in the cube [-1, 1]^3,
+  // one cell wide
+  double r = cbrt(8 * 64.0 / (n * 4.0 / 3.0 * M_PI));
+
+  srand(462);
+  std::vector<Vector3D> points(n), queries(m);
+  for (size_t i = 0; i < n; i++)
+    points[i] = Vector3D(uniform(), uniform(), uniform()) * 2 -
+                Vector3D(1, 1, 1);
+  for (size_t i = 0; i < m; i++)
+    queries[i] = Vector3D(uniform(), uniform(), uniform()) * 1.5 -
+                 Vector3D(0.75, 0.75, 0.75);
+
+  Timer timer;
+  timer.start();
+  SpatialHash hash(r);
+  hash.build(&points[0], n);
+  timer.stop();
+  printf("%zu particles, %zu queries, radius %g\n\n", n, m, r);
+  printf("build: %.1fms\n", 1e3 * timer.duration());
+
+  std::vector<uint32_t> indices;
+  size_t found = 0;
+  timer.start();
+  for (size_t i = 0; i < m; i++) {
+    found += hash.neighbors(queries[i], r, indices);
+  }
+  timer.stop();
+  printf("queries: %.1fms, %.0f queries/s, %.1f neighbors per query\n",
+         1e3 * timer.duration(), m / timer.duration(), (double)found / m);
+
+  // queries whose range of cells spans x = 0
+  size_t wrong = 0;
+  for (size_t i = 0; i < checks; i++) {
+    Vector3D q(r * (2 * uniform() - 1), 2 * uniform() - 1, 2 * uniform() - 1);
+    hash.neighbors(q, r, indices);
+    std::sort(indices.begin(), indices.end());
+    if (indices != bruteForce(points, q, r)) wrong++;
+  }
+  printf("\n%zu of %zu queries across x = 0 wrong\n", wrong, checks);
+
+  return wrong ? 1 : 0;
+}